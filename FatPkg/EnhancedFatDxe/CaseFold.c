@@ -0,0 +1,196 @@
+/** @file
+  ASCII fast paths for case folding and case insensitive comparison of file names.
+
+  File names are mostly plain ASCII. These routines handle such names locally,
+  a few characters at a time, and report when a name has other characters so
+  that the caller falls back to the Unicode Collation protocol. For ASCII
+  characters they produce the same results as the protocol.
+
+Copyright (c) Microsoft Corporation.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "Fat.h"
+
+//
+// Replicate a 16-bit value in the four lanes of a 64-bit word
+//
+#define FAT_ASCII_LANES(a)  ((UINT64)(a) * 0x0001000100010001ULL)
+
+//
+// Lane bits that are only set by non-ASCII characters
+//
+#define FAT_NON_ASCII_MASK  FAT_ASCII_LANES (0xFF80)
+
+//
+// Number of characters handled at a time
+//
+#define FAT_ASCII_LANE_COUNT  (sizeof (UINT64) / sizeof (CHAR16))
+
+/**
+
+  Get the mask of the lanes of Word whose character is in the range [First, Last].
+  Every lane of Word must hold an ASCII character, so that no lane overflows into
+  its neighbor.
+
+  @param  Word                  - Four ASCII characters.
+  @param  First                 - The first character of the range.
+  @param  Last                  - The last character of the range.
+
+  @return The mask with 0x80 set in each lane whose character is in the range.
+
+**/
+STATIC
+UINT64
+FatAsciiRangeMask (
+  IN UINT64  Word,
+  IN CHAR16  First,
+  IN CHAR16  Last
+  )
+{
+  return (Word + FAT_ASCII_LANES (0x80 - First)) &
+         ~(Word + FAT_ASCII_LANES (0x7F - Last)) &
+         FAT_ASCII_LANES (0x80);
+}
+
+/**
+
+  Fold the characters of String in the range [First, Last] to the other case,
+  four characters at a time.
+
+  @param  String                - The string to be folded.
+  @param  First                 - The first character of the range.
+  @param  Last                  - The last character of the range.
+  @param  ToUpper               - TRUE to upper case the range, FALSE to lower case it.
+
+  @retval TRUE                  - The string is ASCII and has been folded.
+  @retval FALSE                 - The string has a non-ASCII character, the characters
+                                  before it may have been folded already.
+
+**/
+STATIC
+BOOLEAN
+FatAsciiFold (
+  IN OUT CHAR16   *String,
+  IN     CHAR16   First,
+  IN     CHAR16   Last,
+  IN     BOOLEAN  ToUpper
+  )
+{
+  UINTN   Length;
+  UINTN   Index;
+  UINT64  Word;
+  UINT64  Mask;
+
+  Length = StrLen (String);
+  for (Index = 0; Index + FAT_ASCII_LANE_COUNT <= Length; Index += FAT_ASCII_LANE_COUNT) {
+    Word = ReadUnaligned64 ((UINT64 *)(String + Index));
+    if ((Word & FAT_NON_ASCII_MASK) != 0) {
+      return FALSE;
+    }
+
+    //
+    // 0x80 >> 2 is the distance between the upper and lower case letters
+    //
+    Mask = FatAsciiRangeMask (Word, First, Last) >> 2;
+    WriteUnaligned64 ((UINT64 *)(String + Index), ToUpper ? Word - Mask : Word + Mask);
+  }
+
+  for ( ; Index < Length; Index++) {
+    if (String[Index] >= 0x80) {
+      return FALSE;
+    }
+
+    if ((String[Index] >= First) && (String[Index] <= Last)) {
+      String[Index] = (CHAR16)(ToUpper ? String[Index] - 0x20 : String[Index] + 0x20);
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+
+  Upper case an ASCII string in place.
+
+  @param  String                - The string to be upper cased.
+
+  @retval TRUE                  - The string is ASCII and has been upper cased.
+  @retval FALSE                 - The string has a non-ASCII character, the characters
+                                  before it may have been upper cased already.
+
+**/
+BOOLEAN
+FatAsciiStrUpr (
+  IN OUT CHAR16  *String
+  )
+{
+  return FatAsciiFold (String, L'a', L'z', TRUE);
+}
+
+/**
+
+  Lower case an ASCII string in place.
+
+  @param  String                - The string to be lower cased.
+
+  @retval TRUE                  - The string is ASCII and has been lower cased.
+  @retval FALSE                 - The string has a non-ASCII character, the characters
+                                  before it may have been lower cased already.
+
+**/
+BOOLEAN
+FatAsciiStrLwr (
+  IN OUT CHAR16  *String
+  )
+{
+  return FatAsciiFold (String, L'A', L'Z', FALSE);
+}
+
+/**
+
+  Perform a case insensitive comparison of two strings, as long as the comparison
+  is decided by ASCII characters.
+
+  @param  S1                    - A pointer to a Null-terminated Unicode string.
+  @param  S2                    - A pointer to a Null-terminated Unicode string.
+  @param  Result                - 0 if S1 is equivalent to S2, >0 if S1 is lexically
+                                  greater than S2, <0 if S1 is lexically less than S2.
+
+  @retval TRUE                  - The comparison is decided and Result is set.
+  @retval FALSE                 - A non-ASCII character is reached before the comparison
+                                  is decided.
+
+**/
+BOOLEAN
+FatAsciiStriCmp (
+  IN  CHAR16  *S1,
+  IN  CHAR16  *S2,
+  OUT INTN    *Result
+  )
+{
+  CHAR16  C1;
+  CHAR16  C2;
+
+  for ( ; ; S1++, S2++) {
+    C1 = *S1;
+    C2 = *S2;
+    if ((C1 >= 0x80) || (C2 >= 0x80)) {
+      return FALSE;
+    }
+
+    if ((C1 >= L'a') && (C1 <= L'z')) {
+      C1 = (CHAR16)(C1 - 0x20);
+    }
+
+    if ((C2 >= L'a') && (C2 <= L'z')) {
+      C2 = (CHAR16)(C2 - 0x20);
+    }
+
+    if ((C1 != C2) || (C1 == 0)) {
+      *Result = (INTN)C1 - (INTN)C2;
+      return TRUE;
+    }
+  }
+}
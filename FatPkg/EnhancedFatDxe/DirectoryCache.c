@@ -37,6 +37,7 @@ FatFreeODir (
     FatFreeDirEnt (DirEnt);
   }
 
+  FatFreeHashTable (ODir);
   FreePool (ODir);
 }
 
@@ -54,6 +55,7 @@ FatAllocateODir (
   )
 {
   FAT_ODIR  *ODir;
+  UINTN     Index;
 
   ODir = AllocateZeroPool (sizeof (FAT_ODIR));
   if (ODir != NULL) {
@@ -63,15 +65,50 @@ FatAllocateODir (
     ODir->Signature = FAT_ODIR_SIGNATURE;
     InitializeListHead (&ODir->ChildList);
     ODir->CurrentCursor = &ODir->ChildList;
+    for (Index = 0; Index < FAT_FREE_RUN_LIST_COUNT; Index++) {
+      InitializeListHead (&ODir->FreeRunList[Index]);
+    }
+
+    //
+    // The hash tables and directory entries add their size as they are allocated
+    //
+    ODir->DirCacheSize = sizeof (FAT_ODIR);
+    if (EFI_ERROR (FatInitializeHashTable (ODir))) {
+      FreePool (ODir);
+      ODir = NULL;
+    }
   }
 
   return ODir;
 }
 
+/**
+
+  Remove the directory from the directory cache of the volume.
+
+  @param  Volume                - FAT file system volume.
+  @param  ODir                  - The cached directory.
+
+**/
+STATIC
+VOID
+FatRemoveODirFromCache (
+  IN FAT_VOLUME  *Volume,
+  IN FAT_ODIR    *ODir
+  )
+{
+  RemoveEntryList (&ODir->DirCacheLink);
+  RemoveEntryList (&ODir->DirCacheHashLink);
+  Volume->DirCacheCount--;
+  Volume->DirCacheSize -= ODir->DirCacheSize;
+}
+
 /**
 
   Discard the directory structure when an OFile will be freed.
-  Volume will cache this directory if the OFile does not represent a deleted file.
+  Volume will cache this directory if the OFile does not represent a deleted file,
+  and free the least recently used cached directories that exceed the memory budget
+  of the directory cache.
 
   @param  OFile                 - The OFile whose directory structure is to be discarded.
 
@@ -82,6 +119,7 @@ FatDiscardODir (
   )
 {
   FAT_ODIR    *ODir;
+  FAT_ODIR    *LruODir;
   FAT_VOLUME  *Volume;
 
   Volume = OFile->Volume;
@@ -90,21 +128,27 @@ FatDiscardODir (
     //
     // If OFile does not represent a deleted file, then we will cache the directory
     // We use OFile's first cluster as the directory's tag
+    // A directory larger than the whole budget is not cached
     //
     ODir->DirCacheTag = OFile->FileCluster;
-    InsertHeadList (&Volume->DirCacheList, &ODir->DirCacheLink);
-    if (Volume->DirCacheCount == FAT_MAX_DIR_CACHE_COUNT) {
-      //
-      // Replace the least recent used directory
-      //
-      ODir = ODIR_FROM_DIRCACHELINK (Volume->DirCacheList.BackLink);
-      RemoveEntryList (&ODir->DirCacheLink);
-    } else {
+    if (ODir->DirCacheSize <= FAT_DIR_CACHE_MAX_SIZE) {
+      InsertHeadList (&Volume->DirCacheList, &ODir->DirCacheLink);
+      InsertHeadList (
+        &Volume->DirCacheHashTable[ODir->DirCacheTag & (FAT_DIR_CACHE_HASH_SIZE - 1)],
+        &ODir->DirCacheHashLink
+        );
+      Volume->DirCacheCount++;
+      Volume->DirCacheSize += ODir->DirCacheSize;
+      ODir                  = NULL;
+
       //
-      // No need to find a replace
+      // Replace the least recent used directories until the cache fits in its budget
       //
-      Volume->DirCacheCount++;
-      ODir = NULL;
+      while (Volume->DirCacheSize > FAT_DIR_CACHE_MAX_SIZE) {
+        LruODir = ODIR_FROM_DIRCACHELINK (Volume->DirCacheList.BackLink);
+        FatRemoveODirFromCache (Volume, LruODir);
+        FatFreeODir (LruODir);
+      }
     }
   }
 
@@ -135,20 +179,22 @@ FatRequestODir (
   FAT_VOLUME  *Volume;
   FAT_ODIR    *ODir;
   FAT_ODIR    *CurrentODir;
+  LIST_ENTRY  *ListHead;
   LIST_ENTRY  *CurrentODirLink;
 
   Volume      = OFile->Volume;
   ODir        = NULL;
   DirCacheTag = OFile->FileCluster;
-  for (CurrentODirLink  = Volume->DirCacheList.ForwardLink;
-       CurrentODirLink != &Volume->DirCacheList;
+  ListHead    = &Volume->DirCacheHashTable[DirCacheTag & (FAT_DIR_CACHE_HASH_SIZE - 1)];
+  for (CurrentODirLink  = ListHead->ForwardLink;
+       CurrentODirLink != ListHead;
        CurrentODirLink  = CurrentODirLink->ForwardLink
        )
   {
-    CurrentODir = ODIR_FROM_DIRCACHELINK (CurrentODirLink);
+    CurrentODir = ODIR_FROM_DIRCACHEHASHLINK (CurrentODirLink);
     if (CurrentODir->DirCacheTag == DirCacheTag) {
-      RemoveEntryList (&CurrentODir->DirCacheLink);
-      Volume->DirCacheCount--;
+      FatRemoveODirFromCache (Volume, CurrentODir);
+      Volume->DirCacheHits++;
       ODir = CurrentODir;
       break;
     }
@@ -158,6 +204,7 @@ FatRequestODir (
     //
     // This directory is not cached, then allocate a new one
     //
+    Volume->DirCacheMisses++;
     ODir = FatAllocateODir (OFile);
   }
 
@@ -178,10 +225,16 @@ FatCleanupODirCache (
 {
   FAT_ODIR  *ODir;
 
+  DEBUG ((
+    DEBUG_INFO,
+    "FatCleanupODirCache: Hits %ld Misses %ld\n",
+    Volume->DirCacheHits,
+    Volume->DirCacheMisses
+    ));
+
   while (Volume->DirCacheCount > 0) {
     ODir = ODIR_FROM_DIRCACHELINK (Volume->DirCacheList.BackLink);
-    RemoveEntryList (&ODir->DirCacheLink);
+    FatRemoveODirFromCache (Volume, ODir);
     FatFreeODir (ODir);
-    Volume->DirCacheCount--;
   }
 }
@@ -305,6 +305,123 @@ FatLoadLongNameEntry (
   DirEnt->FileString = AllocateCopyPool (StrSize (LfnBuffer), LfnBuffer);
 }
 
+/**
+
+  Get the position of the directory entry preceding the directory entry linked at Link.
+  The position 0 is returned if there is no preceding directory entry.
+
+  @param  ODir                  - The directory.
+  @param  Link                  - The link of the directory entry in the directory entry list.
+
+  @return The position of the preceding directory entry.
+
+**/
+STATIC
+UINT32
+FatPrevEntryPos (
+  IN FAT_ODIR    *ODir,
+  IN LIST_ENTRY  *Link
+  )
+{
+  if (Link->BackLink == &ODir->ChildList) {
+    return 0;
+  }
+
+  return DIRENT_FROM_LINK (Link->BackLink)->EntryPos;
+}
+
+/**
+
+  Remove the directory entry from the free run index of the directory.
+
+  @param  ODir                  - The directory.
+  @param  DirEnt                - The directory entry.
+
+**/
+STATIC
+VOID
+FatRemoveFreeRun (
+  IN FAT_ODIR    *ODir,
+  IN FAT_DIRENT  *DirEnt
+  )
+{
+  if (DirEnt->FreeSlotCount != 0) {
+    RemoveEntryList (&DirEnt->FreeRunLink);
+    DirEnt->FreeSlotCount = 0;
+  }
+}
+
+/**
+
+  Update the free run before the directory entry linked at Link in the free run index
+  of the directory. Nothing is done for the end of the directory entry list, since the
+  free run at the end of the directory is computed from the current end position.
+
+  @param  ODir                  - The directory.
+  @param  Link                  - The link of the directory entry in the directory entry list.
+
+**/
+STATIC
+VOID
+FatUpdateFreeRun (
+  IN FAT_ODIR    *ODir,
+  IN LIST_ENTRY  *Link
+  )
+{
+  FAT_DIRENT  *DirEnt;
+  UINT32      PrevPos;
+  UINT32      FreeSlotCount;
+
+  if (Link == &ODir->ChildList) {
+    return;
+  }
+
+  DirEnt = DIRENT_FROM_LINK (Link);
+  FatRemoveFreeRun (ODir, DirEnt);
+
+  //
+  // The directory entry occupies the slots from EntryPos - EntryCount + 1 to EntryPos
+  //
+  PrevPos       = FatPrevEntryPos (ODir, Link);
+  FreeSlotCount = 0;
+  if (DirEnt->EntryPos > PrevPos + DirEnt->EntryCount) {
+    FreeSlotCount = DirEnt->EntryPos - PrevPos - DirEnt->EntryCount;
+  }
+
+  if (FreeSlotCount != 0) {
+    DirEnt->FreeSlotCount = (UINT16)FreeSlotCount;
+    InsertTailList (
+      &ODir->FreeRunList[MIN (FreeSlotCount, FAT_FREE_RUN_LIST_COUNT - 1)],
+      &DirEnt->FreeRunLink
+      );
+  }
+}
+
+/**
+
+  Get the memory used by the directory entry and its file name.
+
+  @param  DirEnt                - The directory entry.
+
+  @return The size of the memory used by the directory entry.
+
+**/
+STATIC
+UINTN
+FatGetDirEntSize (
+  IN FAT_DIRENT  *DirEnt
+  )
+{
+  UINTN  Size;
+
+  Size = sizeof (FAT_DIRENT);
+  if (DirEnt->FileString != NULL) {
+    Size += StrSize (DirEnt->FileString);
+  }
+
+  return Size;
+}
+
 /**
 
   Add this directory entry node to the list of directory entries and hash table.
@@ -326,6 +443,12 @@ FatAddDirEnt (
 
   InsertTailList (DirEnt->Link.BackLink, &DirEnt->Link);
   FatInsertToHashTable (ODir, DirEnt);
+  ODir->DirCacheSize += FatGetDirEntSize (DirEnt);
+  //
+  // Update the free runs before this directory entry and its successor
+  //
+  FatUpdateFreeRun (ODir, &DirEnt->Link);
+  FatUpdateFreeRun (ODir, DirEnt->Link.ForwardLink);
 }
 
 /**
@@ -759,6 +882,9 @@ FatSeekVolumeId (
 /**
 
   Use First Fit Algorithm to insert directory entry.
+  The free runs are looked up in the free run index of the directory, from the
+  shortest runs that can hold the directory entry, before the free run at the end
+  of the directory.
   Only this function will erase "E5" entries in a directory.
   In view of safest recovery, this function will only be triggered
   when maximum directory entry number has reached.
@@ -781,11 +907,12 @@ FatFirstFitInsertDirEnt (
   EFI_STATUS  Status;
   FAT_ODIR    *ODir;
   LIST_ENTRY  *CurrentEntry;
-  FAT_DIRENT  *CurrentDirEnt;
+  LIST_ENTRY  *Link;
   UINT32      CurrentPos;
   UINT32      LabelPos;
   UINT32      NewEntryPos;
   UINT16      EntryCount;
+  UINTN       Index;
   FAT_DIRENT  LabelDirEnt;
 
   LabelPos = 0;
@@ -800,17 +927,16 @@ FatFirstFitInsertDirEnt (
     }
   }
 
-  EntryCount  = DirEnt->EntryCount;
-  NewEntryPos = EntryCount;
-  CurrentPos  = 0;
-  ODir        = OFile->ODir;
-  for (CurrentEntry = ODir->ChildList.ForwardLink;
-       CurrentEntry != &ODir->ChildList;
-       CurrentEntry = CurrentEntry->ForwardLink
-       )
-  {
-    CurrentDirEnt = DIRENT_FROM_LINK (CurrentEntry);
-    if (NewEntryPos + CurrentDirEnt->EntryCount <= CurrentDirEnt->EntryPos) {
+  EntryCount = DirEnt->EntryCount;
+  ODir       = OFile->ODir;
+  for (Index = MIN (EntryCount, FAT_FREE_RUN_LIST_COUNT - 1); Index < FAT_FREE_RUN_LIST_COUNT; Index++) {
+    for (Link = ODir->FreeRunList[Index].ForwardLink; Link != &ODir->FreeRunList[Index]; Link = Link->ForwardLink) {
+      //
+      // The free run lies between the preceding directory entry and this one
+      //
+      CurrentEntry = &DIRENT_FROM_FREERUNLINK (Link)->Link;
+      CurrentPos   = FatPrevEntryPos (ODir, CurrentEntry);
+      NewEntryPos  = CurrentPos + EntryCount;
       if ((LabelPos > NewEntryPos) || (LabelPos <= CurrentPos)) {
         //
         // first fit succeeded
@@ -818,9 +944,16 @@ FatFirstFitInsertDirEnt (
         goto Done;
       }
     }
+  }
 
-    CurrentPos  = CurrentDirEnt->EntryPos;
-    NewEntryPos = CurrentPos + EntryCount;
+  //
+  // Try the free run at the end of the directory
+  //
+  CurrentEntry = &ODir->ChildList;
+  CurrentPos   = FatPrevEntryPos (ODir, CurrentEntry);
+  NewEntryPos  = CurrentPos + EntryCount;
+  if ((LabelPos <= NewEntryPos) && (LabelPos > CurrentPos)) {
+    NewEntryPos = LabelPos + EntryCount;
   }
 
   if (NewEntryPos >= ODir->CurrentEndPos) {
@@ -1103,7 +1236,8 @@ FatRemoveDirEnt (
   IN FAT_DIRENT  *DirEnt
   )
 {
-  FAT_ODIR  *ODir;
+  FAT_ODIR    *ODir;
+  LIST_ENTRY  *NextLink;
 
   ODir = OFile->ODir;
   if (ODir->CurrentCursor == &DirEnt->Link) {
@@ -1114,13 +1248,18 @@ FatRemoveDirEnt (
   }
 
   //
-  // Remove from directory entry list
+  // Remove from directory entry list, the slots of the directory entry join the free run
+  // before its successor
   //
+  NextLink = DirEnt->Link.ForwardLink;
   RemoveEntryList (&DirEnt->Link);
+  FatRemoveFreeRun (ODir, DirEnt);
+  FatUpdateFreeRun (ODir, NextLink);
   //
   // Remove from hash table
   //
   FatDeleteFromHashTable (ODir, DirEnt);
+  ODir->DirCacheSize       -= FatGetDirEntSize (DirEnt);
   DirEnt->Entry.FileName[0] = DELETE_ENTRY_MARK;
   DirEnt->Invalid           = TRUE;
   return FatStoreDirEnt (OFile, DirEnt);
@@ -1234,6 +1373,7 @@ FatCloseDirEnt (
     RemoveEntryList (&OFile->ChildLink);
   }
 
+  FatDiscardExtentMap (OFile);
   FreePool (OFile);
   DirEnt->OFile = NULL;
   if (DirEnt->Invalid == TRUE) {
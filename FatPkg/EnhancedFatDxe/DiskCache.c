@@ -118,6 +118,67 @@ SetCacheTagDirty (
   CacheTag->Dirty = TRUE;
 }
 
+/**
+  Helper function to find the next run of dirty blocks in a cache line. Clean gaps of up to
+  FAT_FLUSH_MAX_GAP_BLOCKS blocks between dirty blocks are included in the run, since writing
+  the unchanged cached data of a short gap is cheaper than issuing another write.
+
+  @param[in]       DiskCache    - DiskCache
+  @param[in]       CacheTag     - Cache line to check for dirty bits from
+  @param[in, out]  BlockIndex   - On input, the block to start the search from.
+                                  On output, the first block of the run.
+  @param[out]      RunBlocks    - The number of blocks in the run.
+
+  @retval TRUE                  - A run of dirty blocks was found.
+  @retval FALSE                 - There are no more dirty blocks in the cache line.
+
+**/
+STATIC
+BOOLEAN
+FatNextDirtyRun (
+  IN     DISK_CACHE  *DiskCache,
+  IN     CACHE_TAG   *CacheTag,
+  IN OUT UINTN       *BlockIndex,
+  OUT    UINTN       *RunBlocks
+  )
+{
+  UINTN  LastBit;
+  UINTN  Index;
+  UINTN  Start;
+  UINTN  End;
+  UINTN  Gap;
+
+  if (CacheTag->RealSize == 0) {
+    return FALSE;
+  }
+
+  LastBit = (CacheTag->RealSize - 1) / DiskCache->BlockSize;
+  Index   = *BlockIndex;
+  while ((Index <= LastBit) && !IsBitInBlockDirty (Index, CacheTag->DirtyBlocks)) {
+    Index++;
+  }
+
+  if (Index > LastBit) {
+    return FALSE;
+  }
+
+  Start = Index;
+  End   = Index + 1;
+  Gap   = 0;
+  for (Index++; Index <= LastBit; Index++) {
+    if (IsBitInBlockDirty (Index, CacheTag->DirtyBlocks)) {
+      End = Index + 1;
+      Gap = 0;
+    } else if (++Gap > FAT_FLUSH_MAX_GAP_BLOCKS) {
+      break;
+    }
+  }
+
+  *BlockIndex = Start;
+  *RunBlocks  = End - Start;
+  return TRUE;
+}
+
 /**
   Cache version of FatDiskIo for writing only those LBA's with dirty data.
 
@@ -125,7 +186,7 @@ SetCacheTagDirty (
   full cache line, and all writes to the cache line will update which Lba is dirty in DIRTY_BITS.
 
   At flush time, when the cache line is written out, only write the blocks that are dirty, coalescing
-  adjacent writes to a single FatDiskIo write.
+  adjacent and nearly adjacent writes to a single FatDiskIo write.
 
   @param[in]       CacheTag     - Cache line to check for dirty bits from
   @param[in]       DataType     - Type of Cache.
@@ -156,48 +217,28 @@ CacheFatDiskIo (
 {
   DISK_CACHE  *DiskCache;
   UINTN       BlockIndexInTag;
-  VOID        *WriteBuffer;
-  UINTN       LastBit;
-  UINT64      StartPos;
+  UINTN       RunBlocks;
   EFI_STATUS  Status;
-  UINTN       WriteSize;
 
   Status = EFI_SUCCESS;
   if ((IoMode == WriteDisk) && (CacheTag->RealSize != 0)) {
     DiskCache       = &Volume->DiskCache[DataType];
-    WriteBuffer     = Buffer;
-    LastBit         = (CacheTag->RealSize - 1) / DiskCache->BlockSize;
-    StartPos        = Offset;
     BlockIndexInTag = 0;
-    WriteSize       = 0;
-
-    do {
-      if (IsBitInBlockDirty (BlockIndexInTag, CacheTag->DirtyBlocks)) {
-        do {
-          WriteSize += DiskCache->BlockSize;
-          BlockIndexInTag++;
-          if (BlockIndexInTag > LastBit) {
-            break;
-          }
-        } while (IsBitInBlockDirty (BlockIndexInTag, CacheTag->DirtyBlocks));
-
-        Status = FatDiskIo (Volume, IoMode, StartPos, WriteSize, WriteBuffer, Task);
-        if (EFI_ERROR (Status)) {
-          return Status;
-        }
-
-        StartPos   += WriteSize + DiskCache->BlockSize;
-        WriteBuffer = (VOID *)((UINTN)WriteBuffer + WriteSize + DiskCache->BlockSize);
-        WriteSize   = 0;
-        BlockIndexInTag++;
-      } else {
-        StartPos   += DiskCache->BlockSize;
-        WriteBuffer = (VOID *)((UINTN)WriteBuffer + DiskCache->BlockSize);
-        BlockIndexInTag++;
+    while (FatNextDirtyRun (DiskCache, CacheTag, &BlockIndexInTag, &RunBlocks)) {
+      Status = FatDiskIo (
+                 Volume,
+                 IoMode,
+                 Offset + MultU64x32 (BlockIndexInTag, DiskCache->BlockSize),
+                 RunBlocks * DiskCache->BlockSize,
+                 (UINT8 *)Buffer + BlockIndexInTag * DiskCache->BlockSize,
+                 Task
+                 );
+      if (EFI_ERROR (Status)) {
+        return Status;
       }
-    } while (BlockIndexInTag <= LastBit);
 
-    ASSERT (WriteSize == 0);
+      BlockIndexInTag += RunBlocks;
+    }
   } else {
     Status = FatDiskIo (Volume, IoMode, Offset, BufferSize, Buffer, Task);
     if (EFI_ERROR (Status)) {
@@ -208,6 +249,133 @@ CacheFatDiskIo (
   return Status;
 }
 
+/**
+
+  Get the address of the cache page held by the cache tag.
+
+  @param  DiskCache             - The disk cache.
+  @param  CacheTag              - The cache tag.
+
+  @return The address of the cache page in the cache buffer.
+
+**/
+STATIC
+UINT8 *
+FatCachePageAddress (
+  IN DISK_CACHE  *DiskCache,
+  IN CACHE_TAG   *CacheTag
+  )
+{
+  return DiskCache->CacheBase + ((UINTN)(CacheTag - DiskCache->CacheTag) << DiskCache->PageAlignment);
+}
+
+/**
+
+  Find the cache tag holding the page of the specified PageNo.
+
+  @param  DiskCache             - The disk cache.
+  @param  PageNo                - PageNo to match with the cache.
+
+  @return The cache tag holding the page, or NULL if the page is not in the cache.
+
+**/
+STATIC
+CACHE_TAG *
+FatLookupCachePage (
+  IN DISK_CACHE  *DiskCache,
+  IN UINTN       PageNo
+  )
+{
+  CACHE_TAG  *CacheTag;
+  UINTN      Way;
+
+  CacheTag = &DiskCache->CacheTag[PageNo & DiskCache->GroupMask];
+  for (Way = 0; Way < DiskCache->WayCount; Way++) {
+    if ((CacheTag->RealSize > 0) && (CacheTag->PageNo == PageNo)) {
+      return CacheTag;
+    }
+
+    CacheTag += DiskCache->GroupMask + 1;
+  }
+
+  return NULL;
+}
+
+/**
+
+  Select the cache tag to be replaced by the page of the specified PageNo.
+  An unused page of the cache group is preferred, otherwise the least
+  recently used page of the group is chosen.
+
+  @param  DiskCache             - The disk cache.
+  @param  PageNo                - PageNo of the page to be loaded.
+
+  @return The cache tag to be replaced.
+
+**/
+STATIC
+CACHE_TAG *
+FatSelectCacheVictim (
+  IN DISK_CACHE  *DiskCache,
+  IN UINTN       PageNo
+  )
+{
+  CACHE_TAG  *CacheTag;
+  CACHE_TAG  *Victim;
+  UINTN      Way;
+
+  CacheTag = &DiskCache->CacheTag[PageNo & DiskCache->GroupMask];
+  Victim   = CacheTag;
+  for (Way = 0; Way < DiskCache->WayCount; Way++) {
+    if (CacheTag->RealSize == 0) {
+      return CacheTag;
+    }
+
+    if (CacheTag->LastUsed < Victim->LastUsed) {
+      Victim = CacheTag;
+    }
+
+    CacheTag += DiskCache->GroupMask + 1;
+  }
+
+  return Victim;
+}
+
+/**
+
+  Check whether a data cache read continues where one of the recently
+  tracked sequential readers stopped, and update the tracked readers.
+
+  @param  DiskCache             - The data cache.
+  @param  Offset                - The starting byte offset of the read.
+  @param  BufferSize            - Size of the read.
+
+  @retval TRUE                  - The read is part of a sequential stream.
+  @retval FALSE                 - The read starts a new stream.
+
+**/
+STATIC
+BOOLEAN
+FatDetectSequentialRead (
+  IN DISK_CACHE  *DiskCache,
+  IN UINT64      Offset,
+  IN UINTN       BufferSize
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < FAT_CACHE_STREAM_COUNT; Index++) {
+    if (DiskCache->StreamOffset[Index] == Offset) {
+      DiskCache->StreamOffset[Index] = Offset + BufferSize;
+      return TRUE;
+    }
+  }
+
+  DiskCache->StreamOffset[DiskCache->NextStream] = Offset + BufferSize;
+  DiskCache->NextStream                          = (DiskCache->NextStream + 1) % FAT_CACHE_STREAM_COUNT;
+  return FALSE;
+}
+
 /**
 
   This function is used by the Data Cache.
@@ -238,24 +406,18 @@ FatFlushDataCacheRange (
   )
 {
   UINTN       PageNo;
-  UINTN       GroupNo;
-  UINTN       GroupMask;
   UINTN       PageSize;
   UINT8       PageAlignment;
   DISK_CACHE  *DiskCache;
   CACHE_TAG   *CacheTag;
-  UINT8       *BaseAddress;
 
   DiskCache     = &Volume->DiskCache[CacheData];
-  BaseAddress   = DiskCache->CacheBase;
-  GroupMask     = DiskCache->GroupMask;
   PageAlignment = DiskCache->PageAlignment;
   PageSize      = (UINTN)1 << PageAlignment;
 
   for (PageNo = StartPageNo; PageNo < EndPageNo; PageNo++) {
-    GroupNo  = PageNo & GroupMask;
-    CacheTag = &DiskCache->CacheTag[GroupNo];
-    if ((CacheTag->RealSize > 0) && (CacheTag->PageNo == PageNo)) {
+    CacheTag = FatLookupCachePage (DiskCache, PageNo);
+    if (CacheTag != NULL) {
       //
       // When reading data from disk directly, if some dirty data
       // in cache is in this range, this data in the Buffer needs to
@@ -265,7 +427,7 @@ FatFlushDataCacheRange (
         if (CacheTag->Dirty) {
           CopyMem (
             Buffer + ((PageNo - StartPageNo) << PageAlignment),
-            BaseAddress + (GroupNo << PageAlignment),
+            FatCachePageAddress (DiskCache, CacheTag),
             PageSize
             );
         }
@@ -304,7 +466,6 @@ FatExchangeCachePage (
   )
 {
   EFI_STATUS  Status;
-  UINTN       GroupNo;
   UINTN       PageNo;
   UINTN       WriteCount;
   UINTN       RealSize;
@@ -316,9 +477,8 @@ FatExchangeCachePage (
 
   DiskCache     = &Volume->DiskCache[DataType];
   PageNo        = CacheTag->PageNo;
-  GroupNo       = PageNo & DiskCache->GroupMask;
   PageAlignment = DiskCache->PageAlignment;
-  PageAddress   = DiskCache->CacheBase + (GroupNo << PageAlignment);
+  PageAddress   = FatCachePageAddress (DiskCache, CacheTag);
   EntryPos      = (DiskCache->BaseAddress + LShiftU64 (PageNo, PageAlignment));
   RealSize      = CacheTag->RealSize;
   if (IoMode == ReadDisk) {
@@ -352,6 +512,103 @@ FatExchangeCachePage (
   return EFI_SUCCESS;
 }
 
+/**
+
+  Load the page of the cache tag from the disk, together with the following pages
+  for a sequential reader. The following pages are read with the same disk access
+  as long as they are adjacent in the cache buffer, are not cached yet, and their
+  cache tags are the clean victims of their own cache groups. A page that another
+  reader used more recently than the rest of its group is never replaced.
+
+  @param  Volume                - FAT file system volume.
+  @param  CacheDataType         - The cache type: CACHE_FAT or CACHE_DATA.
+  @param  CacheTag              - The Cache Tag for the missed cache page.
+
+  @retval EFI_SUCCESS           - The cache pages are loaded successfully.
+  @return other                 - An error occurred when accessing data.
+
+**/
+STATIC
+EFI_STATUS
+FatReadAheadCachePages (
+  IN FAT_VOLUME       *Volume,
+  IN CACHE_DATA_TYPE  CacheDataType,
+  IN CACHE_TAG        *CacheTag
+  )
+{
+  EFI_STATUS  Status;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *NextTag;
+  UINTN       PageNo;
+  UINTN       Count;
+  UINTN       Index;
+  UINT64      EntryPos;
+  UINT8       PageAlignment;
+
+  DiskCache     = &Volume->DiskCache[CacheDataType];
+  PageNo        = CacheTag->PageNo;
+  PageAlignment = DiskCache->PageAlignment;
+  EntryPos      = DiskCache->BaseAddress + LShiftU64 (PageNo, PageAlignment);
+
+  for (Count = 1; Count < FAT_DATACACHE_READ_AHEAD_PAGES; Count++) {
+    //
+    // The next group of the same way wraps around to the next way
+    //
+    if (((PageNo + Count) & DiskCache->GroupMask) == 0) {
+      break;
+    }
+
+    if (EntryPos + LShiftU64 (Count + 1, PageAlignment) > DiskCache->LimitAddress) {
+      break;
+    }
+
+    NextTag = CacheTag + Count;
+    if ((NextTag->RealSize > 0) &&
+        (NextTag->Dirty || (FatSelectCacheVictim (DiskCache, PageNo + Count) != NextTag)))
+    {
+      break;
+    }
+
+    if (FatLookupCachePage (DiskCache, PageNo + Count) != NULL) {
+      break;
+    }
+  }
+
+  if (Count == 1) {
+    return FatExchangeCachePage (Volume, CacheDataType, ReadDisk, CacheTag, NULL);
+  }
+
+  Status = FatDiskIo (
+             Volume,
+             ReadDisk,
+             EntryPos,
+             Count << PageAlignment,
+             FatCachePageAddress (DiskCache, CacheTag),
+             NULL
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    NextTag = CacheTag + Index;
+    if (Index != 0) {
+      if (NextTag->RealSize > 0) {
+        DiskCache->Statistics.Evictions++;
+      }
+
+      NextTag->PageNo   = PageNo + Index;
+      NextTag->LastUsed = CacheTag->LastUsed;
+    }
+
+    ClearCacheTagDirtyState (NextTag);
+    NextTag->RealSize = (UINTN)1 << PageAlignment;
+  }
+
+  DiskCache->Statistics.ReadAheads += Count - 1;
+  return EFI_SUCCESS;
+}
+
 /**
 
   Get one cache page by specified PageNo.
@@ -359,6 +616,8 @@ FatExchangeCachePage (
   @param  Volume                - FAT file system volume.
   @param  CacheDataType         - The cache type: CACHE_FAT or CACHE_DATA.
   @param  PageNo                - PageNo to match with the cache.
+  @param  ReadAhead             - TRUE if the page is accessed by a sequential reader,
+                                  and following pages may be loaded together with it.
   @param  CacheTag              - The Cache Tag for the current cache page.
 
   @retval EFI_SUCCESS           - Get the cache page successfully.
@@ -368,38 +627,70 @@ FatExchangeCachePage (
 STATIC
 EFI_STATUS
 FatGetCachePage (
-  IN FAT_VOLUME       *Volume,
-  IN CACHE_DATA_TYPE  CacheDataType,
-  IN UINTN            PageNo,
-  IN CACHE_TAG        *CacheTag
+  IN  FAT_VOLUME       *Volume,
+  IN  CACHE_DATA_TYPE  CacheDataType,
+  IN  UINTN            PageNo,
+  IN  BOOLEAN          ReadAhead,
+  OUT CACHE_TAG        **CacheTag
   )
 {
   EFI_STATUS  Status;
-  UINTN       OldPageNo;
+  DISK_CACHE  *DiskCache;
+  CACHE_TAG   *Tag;
 
-  OldPageNo = CacheTag->PageNo;
-  if ((CacheTag->RealSize > 0) && (OldPageNo == PageNo)) {
+  DiskCache = &Volume->DiskCache[CacheDataType];
+  DiskCache->AccessCount++;
+
+  Tag = FatLookupCachePage (DiskCache, PageNo);
+  if (Tag != NULL) {
     //
     // Cache Hit occurred
     //
+    DiskCache->Statistics.Hits++;
+    Tag->LastUsed = DiskCache->AccessCount;
+    *CacheTag     = Tag;
     return EFI_SUCCESS;
   }
 
-  //
-  // Write dirty cache page back to disk
-  //
-  if ((CacheTag->RealSize > 0) && CacheTag->Dirty) {
-    Status = FatExchangeCachePage (Volume, CacheDataType, WriteDisk, CacheTag, NULL);
-    if (EFI_ERROR (Status)) {
-      return Status;
+  DiskCache->Statistics.Misses++;
+  Tag = FatSelectCacheVictim (DiskCache, PageNo);
+  if (Tag->RealSize > 0) {
+    DiskCache->Statistics.Evictions++;
+
+    //
+    // Write dirty cache page back to disk
+    //
+    if (Tag->Dirty) {
+      Status = FatExchangeCachePage (Volume, CacheDataType, WriteDisk, Tag, NULL);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
     }
+
+    Tag->RealSize = 0;
   }
 
   //
   // Load new data from disk;
   //
-  CacheTag->PageNo = PageNo;
-  Status           = FatExchangeCachePage (Volume, CacheDataType, ReadDisk, CacheTag, NULL);
+  Tag->PageNo   = PageNo;
+  Tag->LastUsed = DiskCache->AccessCount;
+  if (ReadAhead) {
+    Status = FatReadAheadCachePages (Volume, CacheDataType, Tag);
+  } else {
+    Status = FatExchangeCachePage (Volume, CacheDataType, ReadDisk, Tag, NULL);
+  }
+
+  if (!EFI_ERROR (Status)) {
+    //
+    // Verify the free clusters of a FAT page while it is at hand
+    //
+    if (CacheDataType == CacheFat) {
+      FatVerifyFreeChunksInPage (Volume, PageNo << DiskCache->PageAlignment, FatCachePageAddress (DiskCache, Tag), Tag->RealSize);
+    }
+
+    *CacheTag = Tag;
+  }
 
   return Status;
 }
@@ -416,6 +707,7 @@ FatGetCachePage (
   @param  Offset                - The starting byte of cache page.
   @param  Length                - The number of bytes that is read or written
   @param  Buffer                - Buffer containing cache data.
+  @param  ReadAhead             - TRUE if the page is read by a sequential reader.
 
   @retval EFI_SUCCESS           - The data was accessed correctly.
   @return Others                - An error occurred when accessing unaligned cache page.
@@ -430,7 +722,8 @@ FatAccessUnalignedCachePage (
   IN     UINTN            PageNo,
   IN     UINTN            Offset,
   IN     UINTN            Length,
-  IN OUT VOID             *Buffer
+  IN OUT VOID             *Buffer,
+  IN     BOOLEAN          ReadAhead
   )
 {
   EFI_STATUS  Status;
@@ -438,14 +731,11 @@ FatAccessUnalignedCachePage (
   VOID        *Destination;
   DISK_CACHE  *DiskCache;
   CACHE_TAG   *CacheTag;
-  UINTN       GroupNo;
 
   DiskCache = &Volume->DiskCache[CacheDataType];
-  GroupNo   = PageNo & DiskCache->GroupMask;
-  CacheTag  = &DiskCache->CacheTag[GroupNo];
-  Status    = FatGetCachePage (Volume, CacheDataType, PageNo, CacheTag);
+  Status    = FatGetCachePage (Volume, CacheDataType, PageNo, ReadAhead, &CacheTag);
   if (!EFI_ERROR (Status)) {
-    Source      = DiskCache->CacheBase + (GroupNo << DiskCache->PageAlignment) + Offset;
+    Source      = FatCachePageAddress (DiskCache, CacheTag) + Offset;
     Destination = Buffer;
     if (IoMode != ReadDisk) {
       SetCacheTagDirty (DiskCache, CacheTag, Offset, Length);
@@ -512,6 +802,7 @@ FatAccessCache (
   DISK_CACHE  *DiskCache;
   UINT64      EntryPos;
   UINT8       PageAlignment;
+  BOOLEAN     ReadAhead;
 
   ASSERT (Volume->CacheBuffer != NULL);
 
@@ -523,13 +814,21 @@ FatAccessCache (
   PageNo        = (UINTN)RShiftU64 (EntryPos, PageAlignment);
   UnderRun      = ((UINTN)EntryPos) & (PageSize - 1);
 
+  //
+  // Pages missed by a sequential reader of the data cache are loaded with read ahead
+  //
+  ReadAhead = FALSE;
+  if ((CacheDataType == CacheData) && (IoMode == ReadDisk)) {
+    ReadAhead = FatDetectSequentialRead (DiskCache, Offset, BufferSize);
+  }
+
   if (UnderRun > 0) {
     Length = PageSize - UnderRun;
     if (Length > BufferSize) {
       Length = BufferSize;
     }
 
-    Status = FatAccessUnalignedCachePage (Volume, CacheDataType, IoMode, PageNo, UnderRun, Length, Buffer);
+    Status = FatAccessUnalignedCachePage (Volume, CacheDataType, IoMode, PageNo, UnderRun, Length, Buffer, ReadAhead);
     if (EFI_ERROR (Status)) {
       return Status;
     }
@@ -574,12 +873,196 @@ FatAccessCache (
     //
     // Last read is not a complete page
     //
-    Status = FatAccessUnalignedCachePage (Volume, CacheDataType, IoMode, OverRunPageNo, 0, OverRun, Buffer);
+    Status = FatAccessUnalignedCachePage (Volume, CacheDataType, IoMode, OverRunPageNo, 0, OverRun, Buffer, ReadAhead);
   }
 
   return Status;
 }
 
+/**
+
+  Compare two write back runs by their offset on the disk.
+
+  @param  Buffer1               - The first FAT_FLUSH_RUN.
+  @param  Buffer2               - The second FAT_FLUSH_RUN.
+
+  @retval 0                     - The runs start at the same offset.
+  @retval <0                    - The first run is before the second run on the disk.
+  @retval >0                    - The first run is after the second run on the disk.
+
+**/
+STATIC
+INTN
+EFIAPI
+FatCompareFlushRuns (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  UINT64  Offset1;
+  UINT64  Offset2;
+
+  Offset1 = ((CONST FAT_FLUSH_RUN *)Buffer1)->Offset;
+  Offset2 = ((CONST FAT_FLUSH_RUN *)Buffer2)->Offset;
+  if (Offset1 == Offset2) {
+    return 0;
+  }
+
+  return (Offset1 < Offset2) ? -1 : 1;
+}
+
+/**
+
+  Collect the dirty runs of the dirty cache pages of both caches, or count them.
+  A run of the FAT cache is collected once for every copy of the FAT.
+
+  @param  Volume                - FAT file system volume.
+  @param  Runs                  - The buffer receiving the runs, or NULL to only count them.
+
+  @return The number of runs.
+
+**/
+STATIC
+UINTN
+FatCollectFlushRuns (
+  IN  FAT_VOLUME     *Volume,
+  OUT FAT_FLUSH_RUN  *Runs OPTIONAL
+  )
+{
+  CACHE_DATA_TYPE  CacheDataType;
+  DISK_CACHE       *DiskCache;
+  CACHE_TAG        *CacheTag;
+  UINTN            TagIndex;
+  UINTN            TagCount;
+  UINTN            CopyCount;
+  UINTN            Copy;
+  UINTN            BlockIndex;
+  UINTN            RunBlocks;
+  UINTN            RunCount;
+  UINT64           Offset;
+
+  RunCount = 0;
+  for (CacheDataType = (CACHE_DATA_TYPE)0; CacheDataType < CacheMaxType; CacheDataType++) {
+    DiskCache = &Volume->DiskCache[CacheDataType];
+    if (!DiskCache->Dirty) {
+      continue;
+    }
+
+    CopyCount = (CacheDataType == CacheFat) ? Volume->NumFats : 1;
+    TagCount  = (DiskCache->GroupMask + 1) * DiskCache->WayCount;
+    for (TagIndex = 0; TagIndex < TagCount; TagIndex++) {
+      CacheTag = &DiskCache->CacheTag[TagIndex];
+      if (!CacheTag->Dirty) {
+        continue;
+      }
+
+      BlockIndex = 0;
+      while (FatNextDirtyRun (DiskCache, CacheTag, &BlockIndex, &RunBlocks)) {
+        if (Runs != NULL) {
+          Offset = DiskCache->BaseAddress + LShiftU64 (CacheTag->PageNo, DiskCache->PageAlignment) +
+                   MultU64x32 (BlockIndex, DiskCache->BlockSize);
+          for (Copy = 0; Copy < CopyCount; Copy++) {
+            Runs[RunCount + Copy].Offset = Offset;
+            Runs[RunCount + Copy].Size   = RunBlocks * DiskCache->BlockSize;
+            Runs[RunCount + Copy].Buffer = FatCachePageAddress (DiskCache, CacheTag) +
+                                           BlockIndex * DiskCache->BlockSize;
+            Offset += Volume->FatSize;
+          }
+        }
+
+        RunCount   += CopyCount;
+        BlockIndex += RunBlocks;
+      }
+    }
+  }
+
+  return RunCount;
+}
+
+/**
+
+  Write all the dirty data of both caches back in the order of disk offsets.
+  Dirty runs that are adjacent on the disk and adjacent in the cache buffer
+  are merged into one write. The copies of the FAT are written in the same pass.
+
+  @param  Volume                - FAT file system volume.
+  @param  Task                    point to task instance.
+
+  @retval EFI_SUCCESS           - All the dirty data is written back.
+  @retval EFI_OUT_OF_RESOURCES  - Can not allocate the run list, nothing is written.
+  @return other                 - An error occurred when writing the data into the disk
+
+**/
+STATIC
+EFI_STATUS
+FatFlushDirtyRuns (
+  IN FAT_VOLUME  *Volume,
+  IN FAT_TASK    *Task
+  )
+{
+  EFI_STATUS       Status;
+  FAT_FLUSH_RUN    *Runs;
+  FAT_FLUSH_RUN    Run;
+  UINTN            RunCount;
+  UINTN            Index;
+  UINTN            Next;
+  UINTN            Size;
+  CACHE_DATA_TYPE  CacheDataType;
+  DISK_CACHE       *DiskCache;
+  UINTN            TagIndex;
+  UINTN            TagCount;
+
+  RunCount = FatCollectFlushRuns (Volume, NULL);
+  if (RunCount != 0) {
+    Runs = AllocatePool (RunCount * sizeof (FAT_FLUSH_RUN));
+    if (Runs == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    //
+    // The runs are collected in cache tag order, with the runs of the FAT copies
+    // interleaved, so they have to be sorted before adjacent runs are merged.
+    //
+    FatCollectFlushRuns (Volume, Runs);
+    QuickSort (Runs, RunCount, sizeof (FAT_FLUSH_RUN), FatCompareFlushRuns, &Run);
+
+    for (Index = 0; Index < RunCount; Index = Next) {
+      Size = Runs[Index].Size;
+      for (Next = Index + 1; Next < RunCount; Next++) {
+        if ((Runs[Next].Offset != Runs[Index].Offset + Size) ||
+            (Runs[Next].Buffer != Runs[Index].Buffer + Size))
+        {
+          break;
+        }
+
+        Size += Runs[Next].Size;
+      }
+
+      Status = FatDiskIo (Volume, WriteDisk, Runs[Index].Offset, Size, Runs[Index].Buffer, Task);
+      if (EFI_ERROR (Status)) {
+        FreePool (Runs);
+        return Status;
+      }
+    }
+
+    FreePool (Runs);
+  }
+
+  for (CacheDataType = (CACHE_DATA_TYPE)0; CacheDataType < CacheMaxType; CacheDataType++) {
+    DiskCache = &Volume->DiskCache[CacheDataType];
+    if (DiskCache->Dirty) {
+      TagCount = (DiskCache->GroupMask + 1) * DiskCache->WayCount;
+      for (TagIndex = 0; TagIndex < TagCount; TagIndex++) {
+        ClearCacheTagDirtyState (&DiskCache->CacheTag[TagIndex]);
+      }
+
+      DiskCache->Dirty = FALSE;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
 
   Flush all the dirty cache back, include the FAT cache and the Data cache.
@@ -599,20 +1082,29 @@ FatVolumeFlushCache (
 {
   EFI_STATUS       Status;
   CACHE_DATA_TYPE  CacheDataType;
-  UINTN            GroupIndex;
-  UINTN            GroupMask;
+  UINTN            TagIndex;
+  UINTN            TagCount;
   DISK_CACHE       *DiskCache;
   CACHE_TAG        *CacheTag;
 
+  //
+  // Write the dirty data back in disk order with coalesced writes; if the run list
+  // can not be allocated, write the dirty pages back one by one instead
+  //
+  Status = FatFlushDirtyRuns (Volume, Task);
+  if (EFI_ERROR (Status) && (Status != EFI_OUT_OF_RESOURCES)) {
+    return Status;
+  }
+
   for (CacheDataType = (CACHE_DATA_TYPE)0; CacheDataType < CacheMaxType; CacheDataType++) {
     DiskCache = &Volume->DiskCache[CacheDataType];
     if (DiskCache->Dirty) {
       //
       // Data cache or fat cache is dirty, write the dirty data back
       //
-      GroupMask = DiskCache->GroupMask;
-      for (GroupIndex = 0; GroupIndex <= GroupMask; GroupIndex++) {
-        CacheTag = &DiskCache->CacheTag[GroupIndex];
+      TagCount = (DiskCache->GroupMask + 1) * DiskCache->WayCount;
+      for (TagIndex = 0; TagIndex < TagCount; TagIndex++) {
+        CacheTag = &DiskCache->CacheTag[TagIndex];
         if ((CacheTag->RealSize > 0) && CacheTag->Dirty) {
           //
           // Write back all Dirty Data Cache Page to disk
@@ -651,7 +1143,7 @@ FatInitializeDiskCache (
   )
 {
   DISK_CACHE  *DiskCache;
-  UINTN       FatCacheGroupCount;
+  UINTN       FatCachePageCount;
   UINTN       DataCacheSize;
   UINTN       FatCacheSize;
   UINT8       *CacheBuffer;
@@ -661,23 +1153,25 @@ FatInitializeDiskCache (
   // Configure the parameters of disk cache
   //
   if (Volume->FatType == Fat12) {
-    FatCacheGroupCount                 = FAT_FATCACHE_GROUP_MIN_COUNT;
+    FatCachePageCount                  = FAT_FATCACHE_PAGE_MIN_COUNT;
     DiskCache[CacheFat].PageAlignment  = FAT_FATCACHE_PAGE_MIN_ALIGNMENT;
     DiskCache[CacheData].PageAlignment = FAT_DATACACHE_PAGE_MIN_ALIGNMENT;
   } else {
-    FatCacheGroupCount                 = FAT_FATCACHE_GROUP_MAX_COUNT;
+    FatCachePageCount                  = FAT_FATCACHE_PAGE_MAX_COUNT;
     DiskCache[CacheFat].PageAlignment  = FAT_FATCACHE_PAGE_MAX_ALIGNMENT;
     DiskCache[CacheData].PageAlignment = FAT_DATACACHE_PAGE_MAX_ALIGNMENT;
   }
 
-  DiskCache[CacheData].GroupMask    = FAT_DATACACHE_GROUP_COUNT - 1;
+  DiskCache[CacheData].WayCount     = FAT_DATACACHE_WAY_COUNT;
+  DiskCache[CacheData].GroupMask    = FAT_DATACACHE_PAGE_COUNT / FAT_DATACACHE_WAY_COUNT - 1;
   DiskCache[CacheData].BaseAddress  = Volume->RootPos;
   DiskCache[CacheData].LimitAddress = Volume->VolumeSize;
-  DiskCache[CacheFat].GroupMask     = FatCacheGroupCount - 1;
+  DiskCache[CacheFat].WayCount      = MIN (FAT_FATCACHE_WAY_COUNT, FatCachePageCount);
+  DiskCache[CacheFat].GroupMask     = FatCachePageCount / DiskCache[CacheFat].WayCount - 1;
   DiskCache[CacheFat].BaseAddress   = Volume->FatPos;
   DiskCache[CacheFat].LimitAddress  = Volume->FatPos + Volume->FatSize;
-  FatCacheSize                      = FatCacheGroupCount << DiskCache[CacheFat].PageAlignment;
-  DataCacheSize                     = FAT_DATACACHE_GROUP_COUNT << DiskCache[CacheData].PageAlignment;
+  FatCacheSize                      = FatCachePageCount << DiskCache[CacheFat].PageAlignment;
+  DataCacheSize                     = FAT_DATACACHE_PAGE_COUNT << DiskCache[CacheData].PageAlignment;
   //
   // Allocate the Fat Cache buffer
   //
@@ -695,3 +1189,71 @@ FatInitializeDiskCache (
 
   return EFI_SUCCESS;
 }
+
+/**
+
+  Get the hit, miss, eviction and read ahead counters of a disk cache.
+
+  @param  Volume                - FAT file system volume.
+  @param  CacheDataType         - The cache type: CACHE_FAT or CACHE_DATA.
+  @param  Statistics            - The counters of the cache.
+
+**/
+VOID
+FatGetCacheStatistics (
+  IN  FAT_VOLUME        *Volume,
+  IN  CACHE_DATA_TYPE   CacheDataType,
+  OUT CACHE_STATISTICS  *Statistics
+  )
+{
+  ASSERT (CacheDataType < CacheMaxType);
+  CopyMem (Statistics, &Volume->DiskCache[CacheDataType].Statistics, sizeof (CACHE_STATISTICS));
+}
+
+/**
+
+  Reset the counters of both disk caches.
+
+  @param  Volume                - FAT file system volume.
+
+**/
+VOID
+FatResetCacheStatistics (
+  IN FAT_VOLUME  *Volume
+  )
+{
+  CACHE_DATA_TYPE  CacheDataType;
+
+  for (CacheDataType = (CACHE_DATA_TYPE)0; CacheDataType < CacheMaxType; CacheDataType++) {
+    ZeroMem (&Volume->DiskCache[CacheDataType].Statistics, sizeof (CACHE_STATISTICS));
+  }
+}
+
+/**
+
+  Report the hit, miss, eviction and read ahead counters of the disk caches.
+
+  @param  Volume                - FAT file system volume.
+
+**/
+VOID
+FatLogCacheStatistics (
+  IN FAT_VOLUME  *Volume
+  )
+{
+  CACHE_DATA_TYPE   CacheDataType;
+  CACHE_STATISTICS  *Statistics;
+
+  for (CacheDataType = (CACHE_DATA_TYPE)0; CacheDataType < CacheMaxType; CacheDataType++) {
+    Statistics = &Volume->DiskCache[CacheDataType].Statistics;
+    DEBUG ((
+      DEBUG_INFO,
+      "FatLogCacheStatistics: %a cache Hits %ld Misses %ld Evictions %ld ReadAheads %ld\n",
+      (CacheDataType == CacheFat) ? "FAT" : "Data",
+      Statistics->Hits,
+      Statistics->Misses,
+      Statistics->Evictions,
+      Statistics->ReadAheads
+      ));
+  }
+}
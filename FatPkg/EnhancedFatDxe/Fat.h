@@ -49,12 +49,16 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #define DIRENT_FROM_LINK(a)  CR (a, FAT_DIRENT, Link, FAT_DIRENT_SIGNATURE)
 
+#define DIRENT_FROM_FREERUNLINK(a)  CR (a, FAT_DIRENT, FreeRunLink, FAT_DIRENT_SIGNATURE)
+
 #define VOLUME_FROM_ROOT_DIRENT(a)  CR (a, FAT_VOLUME, RootDirEnt, FAT_VOLUME_SIGNATURE)
 
 #define VOLUME_FROM_VOL_INTERFACE(a)  CR (a, FAT_VOLUME, VolumeInterface, FAT_VOLUME_SIGNATURE);
 
 #define ODIR_FROM_DIRCACHELINK(a)  CR (a, FAT_ODIR, DirCacheLink, FAT_ODIR_SIGNATURE)
 
+#define ODIR_FROM_DIRCACHEHASHLINK(a)  CR (a, FAT_ODIR, DirCacheHashLink, FAT_ODIR_SIGNATURE)
+
 #define OFILE_FROM_CHECKLINK(a)  CR (a, FAT_OFILE, CheckLink, FAT_OFILE_SIGNATURE)
 
 #define OFILE_FROM_CHILDLINK(a)  CR (a, FAT_OFILE, ChildLink, FAT_OFILE_SIGNATURE)
@@ -80,9 +84,33 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define FAT_FATCACHE_PAGE_MAX_ALIGNMENT   15
 #define FAT_DATACACHE_PAGE_MIN_ALIGNMENT  13
 #define FAT_DATACACHE_PAGE_MAX_ALIGNMENT  16
-#define FAT_DATACACHE_GROUP_COUNT         64
-#define FAT_FATCACHE_GROUP_MIN_COUNT      1
-#define FAT_FATCACHE_GROUP_MAX_COUNT      16
+#define FAT_DATACACHE_PAGE_COUNT          64
+#define FAT_FATCACHE_PAGE_MIN_COUNT       1
+#define FAT_FATCACHE_PAGE_MAX_COUNT       16
+
+//
+// The disk caches are set associative: a page can be held by any of the WAY_COUNT
+// pages of its cache group, and the least recently used one is replaced on a miss.
+// All the page and way counts must be powers of two.
+//
+#define FAT_DATACACHE_WAY_COUNT  4
+#define FAT_FATCACHE_WAY_COUNT   4
+
+//
+// Number of sequential readers tracked by the data cache, and the number of pages
+// loaded with one disk read when a page is missed by a sequential reader
+//
+#define FAT_CACHE_STREAM_COUNT          4
+#define FAT_DATACACHE_READ_AHEAD_PAGES  4
+
+//
+// Clean blocks between two dirty blocks of a cache page are written back with them,
+// instead of splitting the write, if there are no more than this many of them
+//
+#define FAT_FLUSH_MAX_GAP_BLOCKS  4
+
+STATIC_ASSERT ((FAT_DATACACHE_PAGE_COUNT % FAT_DATACACHE_WAY_COUNT) == 0, "FAT_DATACACHE_WAY_COUNT must divide FAT_DATACACHE_PAGE_COUNT");
+STATIC_ASSERT (FAT_FATCACHE_PAGE_MAX_COUNT <= FAT_DATACACHE_PAGE_COUNT, "FAT cache must fit in the cache tag array");
 
 // For cache block bits, use a UINT64
 typedef UINT64 DIRTY_BLOCKS;
@@ -97,6 +125,40 @@ typedef UINT64 DIRTY_BLOCKS;
 
 STATIC_ASSERT ((((1 << FAT_DATACACHE_PAGE_MAX_ALIGNMENT) / (1 << MIN_BLOCK_ALIGNMENT)) % sizeof (DIRTY_BLOCKS)) == 0, "DIRTY_BLOCKS not a proper size");
 
+//
+// Free cluster bitmap, one bit per cluster (set if the cluster is free).
+// The FAT is verified into the bitmap FAT_FREEMAP_CHUNK_ENTRIES entries at a time,
+// the count must be even so that every FAT12 chunk starts on a byte boundary.
+// A free cluster info query reads at most FAT_FREEMAP_VERIFY_STEP more chunks,
+// the rest is verified as FAT cache pages are loaded.
+//
+#define FAT_FREEMAP_BITS_PER_WORD  (sizeof (UINTN) * BITS_PER_BYTE)
+#define FAT_FREEMAP_CHUNK_ENTRIES  1024
+#define FAT_FREEMAP_VERIFY_STEP    16
+
+STATIC_ASSERT ((FAT_FREEMAP_CHUNK_ENTRIES % 2) == 0, "FAT_FREEMAP_CHUNK_ENTRIES must be even");
+
+//
+// Files grown by at least this many clusters at once are allocated as one contiguous extent.
+// The free runs for the extent are searched in a window of FAT_EXTENT_SEARCH_CHUNKS chunks
+// of the FAT, and at most FAT_EXTENT_SEARCH_RUNS runs are compared once one fits.
+//
+#define FAT_EXTENT_MIN_CLUSTERS   64
+#define FAT_EXTENT_SEARCH_CHUNKS  16
+#define FAT_EXTENT_SEARCH_RUNS    32
+
+//
+// The extent map of an open file grows by this many entries at a time
+//
+#define FAT_EXTENT_MAP_GROW_COUNT  16
+
+//
+// Non-blocking transfers are split into subtasks of at most FAT_ASYNC_SUBTASK_MAX_SIZE bytes,
+// and up to FAT_ASYNC_QUEUE_DEPTH subtasks of a task are outstanding at the same time
+//
+#define FAT_ASYNC_SUBTASK_MAX_SIZE  SIZE_1MB
+#define FAT_ASYNC_QUEUE_DEPTH       8
+
 //
 // Used in 8.3 generation algorithm
 //
@@ -105,6 +167,11 @@ STATIC_ASSERT ((((1 << FAT_DATACACHE_PAGE_MAX_ALIGNMENT) / (1 << MIN_BLOCK_ALIGN
 #define HASH_BASE_TAG_LEN   2
 #define HASH_VALUE_TAG_LEN  (SPEC_BASE_TAG_LEN - HASH_BASE_TAG_LEN)
 
+//
+// Number of base tags whose next numeric tail is remembered by a directory
+//
+#define FAT_SHORT_NAME_TAIL_COUNT  8
+
 //
 // Path name separator is back slash
 //
@@ -112,12 +179,35 @@ STATIC_ASSERT ((((1 << FAT_DATACACHE_PAGE_MAX_ALIGNMENT) / (1 << MIN_BLOCK_ALIGN
 
 #define EFI_PATH_STRING_LENGTH   260
 #define EFI_FILE_STRING_LENGTH   255
-#define FAT_MAX_ALLOCATE_SIZE    0xA00000
 #define LC_ISO_639_2_ENTRY_SIZE  3
 #define MAX_LANG_CODE_SIZE       100
 
-#define FAT_MAX_DIR_CACHE_COUNT  8
-#define FAT_MAX_DIRENTRY_COUNT   0xFFFF
+#define FAT_MAX_DIRENTRY_COUNT  0xFFFF
+
+//
+// Number of free run lists in a directory. The free runs of directory entries are
+// indexed by length, and the last list holds all the runs that are long enough for
+// a directory entry with the longest file name.
+//
+#define FAT_FREE_RUN_LIST_COUNT  (LFN_ENTRY_NUMBER (EFI_FILE_STRING_LENGTH) + 2)
+
+//
+// Discarded directories are cached by the volume, and the least recently used ones
+// are freed once the memory used by the cached directories exceeds this budget
+//
+#define FAT_DIR_CACHE_MAX_SIZE  SIZE_1MB
+
+//
+// Number of buckets of the hash table indexing the cached directories by their tag,
+// must be a power of 2
+//
+#define FAT_DIR_CACHE_HASH_SIZE  256
+
+//
+// Zero bytes appended to a file are written from one zero buffer of this size,
+// which is shared by all the files of the volume
+//
+#define FAT_ZERO_BUFFER_SIZE  SIZE_256KB
 typedef CHAR8 LC_ISO_639_2;
 
 //
@@ -158,26 +248,67 @@ typedef enum {
 typedef struct {
   UINTN           PageNo;
   UINTN           RealSize;
+  UINTN           LastUsed;         // Value of the cache's AccessCount when the page was last accessed
   BOOLEAN         Dirty;
   DIRTY_BLOCKS    DirtyBlocks[DIRTY_BLOCKS_SIZE];
 } CACHE_TAG;
 
+//
+// Disk cache counters, for profiling
+//
+typedef struct {
+  UINT64    Hits;                   // Page accesses found in the cache
+  UINT64    Misses;                 // Page accesses that had to load the page
+  UINT64    Evictions;              // Valid pages replaced by another page
+  UINT64    ReadAheads;             // Pages loaded ahead of a sequential reader
+} CACHE_STATISTICS;
+
+//
+// The page of CacheTag[Index] is stored at CacheBase + (Index << PageAlignment),
+// where Index = Way * (GroupMask + 1) + (PageNo & GroupMask). Consecutive pages
+// of the same way are therefore adjacent in the cache buffer.
+//
 typedef struct {
-  UINT64       BaseAddress;
-  UINT64       LimitAddress;
-  UINT8        *CacheBase;
-  UINT32       BlockSize;
-  BOOLEAN      Dirty;
-  UINT8        PageAlignment;
-  UINTN        GroupMask;
-  CACHE_TAG    CacheTag[FAT_DATACACHE_GROUP_COUNT];
+  UINT64              BaseAddress;
+  UINT64              LimitAddress;
+  UINT8               *CacheBase;
+  UINT32              BlockSize;
+  BOOLEAN             Dirty;
+  UINT8               PageAlignment;
+  UINTN               GroupMask;    // Number of cache groups - 1
+  UINTN               WayCount;     // Number of pages in each cache group
+  UINTN               AccessCount;  // Clock used to find the least recently used page
+  UINT64              StreamOffset[FAT_CACHE_STREAM_COUNT]; // Where each tracked sequential reader continues
+  UINTN               NextStream;   // The tracked reader replaced by the next new reader
+  CACHE_STATISTICS    Statistics;
+  CACHE_TAG           CacheTag[FAT_DATACACHE_PAGE_COUNT];
 } DISK_CACHE;
 
 //
-// Hash table size
+// A run of dirty blocks to be written back when the disk caches are flushed
+//
+typedef struct {
+  UINT64    Offset;                 // Offset of the run on the disk
+  UINTN     Size;                   // Size of the run in bytes
+  UINT8     *Buffer;                // The cached data of the run
+} FAT_FLUSH_RUN;
+
+//
+// Hash table size. The name hash tables of a directory start with HASH_TABLE_MIN_SIZE buckets
+// and are doubled whenever the directory holds more than HASH_TABLE_MAX_LOAD entries per bucket,
+// up to HASH_TABLE_MAX_SIZE buckets. The sizes must be powers of two.
+//
+#define HASH_TABLE_MIN_SIZE  0x10
+#define HASH_TABLE_MAX_SIZE  0x10000
+#define HASH_TABLE_MAX_LOAD  2
+
+//
+// The next numeric tail to try for an 8.3 base tag, remembered by the directory
 //
-#define HASH_TABLE_SIZE  0x400
-#define HASH_TABLE_MASK  (HASH_TABLE_SIZE - 1)
+typedef struct {
+  CHAR8     BaseName[FAT_NAME_LEN];     // The 8.3 name whose numeric tail is blanked out
+  UINT32    NextTail;                   // The next numeric tail to try for the base name
+} FAT_SHORT_NAME_TAIL;
 
 //
 // The directory entry for opened directory
@@ -197,21 +328,31 @@ struct _FAT_DIRENT {
   FAT_OFILE              *OFile;                // The OFile of the corresponding directory entry
   FAT_DIRENT             *ShortNameForwardLink; // Hash successor link for short filename
   FAT_DIRENT             *LongNameForwardLink;  // Hash successor link for long filename
+  UINT32                 ShortNameHash;         // Hash value of the short filename
+  UINT32                 LongNameHash;          // Hash value of the long filename
   LIST_ENTRY             Link;                  // Connection of every directory entry
+  LIST_ENTRY             FreeRunLink;           // Linked in the free run list of the parent directory
+  UINT16                 FreeSlotCount;         // Number of free directory entries right before this one
   FAT_DIRECTORY_ENTRY    Entry;                 // The physical directory entry stored in disk
 };
 
 struct _FAT_ODIR {
-  UINTN         Signature;
-  UINT32        CurrentEndPos;                // Current end position of the directory
-  UINT32        CurrentPos;                   // Current position of the directory
-  LIST_ENTRY    *CurrentCursor;               // Current directory entry pointer
-  LIST_ENTRY    ChildList;                    // List of all directory entries
-  BOOLEAN       EndOfDir;                     // Indicate whether we have reached the end of the directory
-  LIST_ENTRY    DirCacheLink;                 // Linked in Volume->DirCacheList when discarded
-  UINTN         DirCacheTag;                  // The identification of the directory when in directory cache
-  FAT_DIRENT    *LongNameHashTable[HASH_TABLE_SIZE];
-  FAT_DIRENT    *ShortNameHashTable[HASH_TABLE_SIZE];
+  UINTN                  Signature;
+  UINT32                 CurrentEndPos;                // Current end position of the directory
+  UINT32                 CurrentPos;                   // Current position of the directory
+  LIST_ENTRY             *CurrentCursor;               // Current directory entry pointer
+  LIST_ENTRY             ChildList;                    // List of all directory entries
+  BOOLEAN                EndOfDir;                     // Indicate whether we have reached the end of the directory
+  LIST_ENTRY             DirCacheLink;                 // Linked in Volume->DirCacheList when discarded
+  LIST_ENTRY             DirCacheHashLink;             // Linked in Volume->DirCacheHashTable when discarded
+  UINTN                  DirCacheTag;                  // The identification of the directory when in directory cache
+  UINTN                  DirCacheSize;                 // The memory used by the directory, updated as entries are added and removed
+  FAT_DIRENT             **LongNameHashTable;
+  FAT_DIRENT             **ShortNameHashTable;
+  UINT32                 HashTableMask;                // Number of buckets in each hash table - 1
+  UINTN                  HashEntryCount;               // Number of directory entries in the hash tables
+  LIST_ENTRY             FreeRunList[FAT_FREE_RUN_LIST_COUNT];
+  FAT_SHORT_NAME_TAIL    ShortNameTail[FAT_SHORT_NAME_TAIL_COUNT];
 };
 
 typedef struct {
@@ -229,6 +370,9 @@ typedef struct {
   EFI_FILE_IO_TOKEN    *FileIoToken;
   FAT_IFILE            *IFile;
   LIST_ENTRY           Subtasks;              // List of all FAT_SUBTASKs
+  UINTN                Outstanding;           // Number of submitted FAT_SUBTASKs not completed yet
+  BOOLEAN              Submitting;            // FatSubmitSubtasks () is running for the task
+  EFI_EVENT            SubmitEvent;           // Submits the pending FAT_SUBTASKs at TPL_CALLBACK
   LIST_ENTRY           Link;                  // Link to other FAT_TASKs
 } FAT_TASK;
 
@@ -237,6 +381,7 @@ typedef struct {
   EFI_DISK_IO2_TOKEN    DiskIo2Token;
   FAT_TASK              *Task;
   BOOLEAN               Write;
+  BOOLEAN               Submitted;            // The subtask has been submitted to DiskIo2
   UINT64                Offset;
   VOID                  *Buffer;
   UINTN                 BufferSize;
@@ -246,6 +391,15 @@ typedef struct {
 //
 // FAT_OFILE - Each opened file
 //
+//
+// A run of physically consecutive clusters in the cluster chain of a file
+//
+typedef struct {
+  UINTN    FileCluster;                 // Index of the first cluster of the run within the file
+  UINTN    Cluster;                     // First cluster of the run on the volume
+  UINTN    Count;                       // Number of clusters in the run
+} FAT_EXTENT;
+
 struct _FAT_OFILE {
   UINTN         Signature;
   FAT_VOLUME    *Volume;
@@ -286,6 +440,12 @@ struct _FAT_OFILE {
   UINT64        PosDisk;        // on the disk
   UINTN         PosRem;         // remaining in this disk run
   //
+  // Cached map of the cluster chain, built on demand and
+  // discarded whenever the cluster chain changes
+  //
+  FAT_EXTENT    *Extents;
+  UINTN         ExtentCount;
+  //
   // The opened parent, full path length and currently opened child files
   //
   FAT_OFILE     *Parent;
@@ -343,12 +503,19 @@ struct _FAT_VOLUME {
   //
   // Current part of fat table that's present
   //
-  UINT64                             FatEntryPos;    // Location of buffer
-  UINTN                              FatEntrySize;   // Size of buffer
-  UINT32                             FatEntryBuffer; // The buffer
-  FAT_INFO_SECTOR                    FatInfoSector;  // Free cluster info
-  UINTN                              FreeInfoPos;    // Pos with the free cluster info
-  BOOLEAN                            FreeInfoValid;  // If free cluster info is valid
+  UINT64                             FatEntryPos;          // Location of buffer
+  UINTN                              FatEntrySize;         // Size of buffer
+  UINT32                             FatEntryBuffer;       // The buffer
+  FAT_INFO_SECTOR                    FatInfoSector;        // Free cluster info
+  UINTN                              FreeInfoPos;          // Pos with the free cluster info
+  BOOLEAN                            FreeInfoValid;        // If free cluster info is valid
+  UINTN                              *FreeBitmap;          // Free cluster bitmap, NULL until first needed
+  UINT8                              *FreeChunkMap;        // FAT chunks verified into FreeBitmap, one bit each
+  UINT8                              *FreeChunkBuffer;     // Buffer to read one FAT chunk
+  UINTN                              FreeChunkCount;       // Number of FAT chunks
+  UINTN                              FreeChunksVerified;   // Number of verified FAT chunks
+  UINTN                              FreeVerifyCursor;     // All the FAT chunks before it are verified
+  UINTN                              FreeVerifiedCount;    // Number of free clusters in the verified FAT chunks
   //
   // Unpacked Fat BPB info
   //
@@ -382,13 +549,22 @@ struct _FAT_VOLUME {
   // Directory cache List
   //
   LIST_ENTRY                         DirCacheList;
+  LIST_ENTRY                         DirCacheHashTable[FAT_DIR_CACHE_HASH_SIZE]; // Cached directories indexed by tag
   UINTN                              DirCacheCount;
+  UINTN                              DirCacheSize;     // Memory used by the cached directories
+  UINT64                             DirCacheHits;     // Directories found in the directory cache
+  UINT64                             DirCacheMisses;   // Directories that had to be loaded again
 
   //
   // Disk Cache for this volume
   //
   VOID                               *CacheBuffer;
   DISK_CACHE                         DiskCache[CacheMaxType];
+
+  //
+  // Zero buffer used to grow files, NULL until first needed
+  //
+  VOID                               *ZeroBuffer;
 };
 
 //
@@ -783,6 +959,46 @@ FatVolumeFlushCache (
   IN FAT_TASK    *Task
   );
 
+/**
+
+  Get the hit, miss, eviction and read ahead counters of a disk cache.
+
+  @param  Volume                - FAT file system volume.
+  @param  CacheDataType         - The cache type: CACHE_FAT or CACHE_DATA.
+  @param  Statistics            - The counters of the cache.
+
+**/
+VOID
+FatGetCacheStatistics (
+  IN  FAT_VOLUME        *Volume,
+  IN  CACHE_DATA_TYPE   CacheDataType,
+  OUT CACHE_STATISTICS  *Statistics
+  );
+
+/**
+
+  Reset the counters of both disk caches.
+
+  @param  Volume                - FAT file system volume.
+
+**/
+VOID
+FatResetCacheStatistics (
+  IN FAT_VOLUME  *Volume
+  );
+
+/**
+
+  Report the hit, miss, eviction and read ahead counters of the disk caches.
+
+  @param  Volume                - FAT file system volume.
+
+**/
+VOID
+FatLogCacheStatistics (
+  IN FAT_VOLUME  *Volume
+  );
+
 //
 // Flush.c
 //
@@ -910,6 +1126,19 @@ FatGrowEof (
   IN UINT64     NewSizeInBytes
   );
 
+/**
+
+  Free the cached extent map of the open file. It must be called whenever
+  the cluster chain of the file changes.
+
+  @param  OFile                 - The open file.
+
+**/
+VOID
+FatDiscardExtentMap (
+  IN FAT_OFILE  *OFile
+  );
+
 /**
 
   Get the size of directory of the open file.
@@ -975,6 +1204,25 @@ FatComputeFreeInfo (
   IN FAT_VOLUME  *Volume
   );
 
+/**
+
+  Verify the chunks of the FAT that are completely contained in a FAT cache page
+  which has just been loaded from the disk.
+
+  @param  Volume                - FAT file system volume.
+  @param  Offset                - The byte offset of the page from the beginning of the FAT.
+  @param  Buffer                - The content of the page.
+  @param  Size                  - The number of bytes in the page.
+
+**/
+VOID
+FatVerifyFreeChunksInPage (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Offset,
+  IN UINT8       *Buffer,
+  IN UINTN       Size
+  );
+
 //
 // Init.c
 //
@@ -1362,6 +1610,64 @@ FatStriCmp (
   IN CHAR16  *Str2
   );
 
+//
+// CaseFold.c
+//
+
+/**
+
+  Upper case an ASCII string in place.
+
+  @param  String                - The string to be upper cased.
+
+  @retval TRUE                  - The string is ASCII and has been upper cased.
+  @retval FALSE                 - The string has a non-ASCII character, the characters
+                                  before it may have been upper cased already.
+
+**/
+BOOLEAN
+FatAsciiStrUpr (
+  IN OUT CHAR16  *String
+  );
+
+/**
+
+  Lower case an ASCII string in place.
+
+  @param  String                - The string to be lower cased.
+
+  @retval TRUE                  - The string is ASCII and has been lower cased.
+  @retval FALSE                 - The string has a non-ASCII character, the characters
+                                  before it may have been lower cased already.
+
+**/
+BOOLEAN
+FatAsciiStrLwr (
+  IN OUT CHAR16  *String
+  );
+
+/**
+
+  Perform a case insensitive comparison of two strings, as long as the comparison
+  is decided by ASCII characters.
+
+  @param  S1                    - A pointer to a Null-terminated Unicode string.
+  @param  S2                    - A pointer to a Null-terminated Unicode string.
+  @param  Result                - 0 if S1 is equivalent to S2, >0 if S1 is lexically
+                                  greater than S2, <0 if S1 is lexically less than S2.
+
+  @retval TRUE                  - The comparison is decided and Result is set.
+  @retval FALSE                 - A non-ASCII character is reached before the comparison
+                                  is decided.
+
+**/
+BOOLEAN
+FatAsciiStriCmp (
+  IN  CHAR16  *S1,
+  IN  CHAR16  *S2,
+  OUT INTN    *Result
+  );
+
 //
 // Open.c
 //
@@ -1473,7 +1779,7 @@ FatAccessOFile (
   Expand OFile by appending zero bytes at the end of OFile.
 
   @param  OFile                 - The open file.
-  @param  ExpandedSize          - The number of zero bytes appended at the end of the file.
+  @param  ExpandedSize          - The new size of the file.
 
   @retval EFI_SUCCESS           - The file is expanded successfully.
   @return other                 - An error occurred when expanding file.
@@ -1487,12 +1793,12 @@ FatExpandOFile (
 
 /**
 
-  Write zero pool from the WritePos to the end of OFile.
+  Write zero bytes from the WritePos to the end of OFile.
 
-  @param  OFile                 - The open file to write zero pool.
-  @param  WritePos              - The number of zero bytes written.
+  @param  OFile                 - The open file to write zero bytes.
+  @param  WritePos              - The position to start writing zero bytes at.
 
-  @retval EFI_SUCCESS           - Write the zero pool successfully.
+  @retval EFI_SUCCESS           - Write the zero bytes successfully.
   @retval EFI_OUT_OF_RESOURCES  - Not enough memory to perform the operation.
   @return other                 - An error occurred when writing disk.
 
@@ -1783,6 +2089,33 @@ FatSetVolumeEntry (
 // Hash.c
 //
 
+/**
+
+  Allocate the initial hash tables of the directory.
+
+  @param  ODir                  - The directory.
+
+  @retval EFI_SUCCESS           - The hash tables are allocated.
+  @retval EFI_OUT_OF_RESOURCES  - Not enough memory to allocate the hash tables.
+
+**/
+EFI_STATUS
+FatInitializeHashTable (
+  IN FAT_ODIR  *ODir
+  );
+
+/**
+
+  Free the hash tables of the directory.
+
+  @param  ODir                  - The directory.
+
+**/
+VOID
+FatFreeHashTable (
+  IN FAT_ODIR  *ODir
+  );
+
 /**
 
   Search the long name hash table for the directory entry.
@@ -157,9 +157,86 @@ FatNameToStr (
   }
 }
 
+/**
+
+  Set the numeric tail "~Tail" of the 8.3 name right after its base tag. The base tag
+  is truncated if the numeric tail does not fit in the main name.
+
+  @param  ShortName             - The 8.3 name.
+  @param  BaseTagLen            - The length of the base tag.
+  @param  Tail                  - The numeric tail.
+
+**/
+STATIC
+VOID
+FatSetNumericTail (
+  IN OUT CHAR8   *ShortName,
+  IN     UINTN   BaseTagLen,
+  IN     UINT32  Tail
+  )
+{
+  CHAR8  Digits[FAT_MAIN_NAME_LEN];
+  UINTN  DigitCount;
+  UINTN  Index;
+
+  DigitCount = 0;
+  do {
+    Digits[DigitCount++] = (CHAR8)('0' + Tail % 10);
+    Tail                /= 10;
+  } while ((Tail != 0) && (DigitCount < FAT_MAIN_NAME_LEN - 2));
+
+  if (BaseTagLen + 1 + DigitCount > FAT_MAIN_NAME_LEN) {
+    BaseTagLen = FAT_MAIN_NAME_LEN - 1 - DigitCount;
+  }
+
+  Index              = BaseTagLen;
+  ShortName[Index++] = '~';
+  while (DigitCount != 0) {
+    ShortName[Index++] = Digits[--DigitCount];
+  }
+
+  SetMem (ShortName + Index, FAT_MAIN_NAME_LEN - Index, ' ');
+}
+
+/**
+
+  Get the numeric tail record of the base tag of the 8.3 name in the directory.
+  The record of another base tag is recycled if the base tag has no record.
+
+  @param  ODir                  - The directory.
+  @param  ShortName             - The 8.3 name.
+  @param  BaseTagLen            - The length of the base tag.
+
+  @return The numeric tail record of the base tag.
+
+**/
+STATIC
+FAT_SHORT_NAME_TAIL *
+FatGetShortNameTail (
+  IN FAT_ODIR  *ODir,
+  IN CHAR8     *ShortName,
+  IN UINTN     BaseTagLen
+  )
+{
+  CHAR8                BaseName[FAT_NAME_LEN];
+  FAT_SHORT_NAME_TAIL  *ShortNameTail;
+
+  CopyMem (BaseName, ShortName, FAT_NAME_LEN);
+  SetMem (BaseName + BaseTagLen, FAT_MAIN_NAME_LEN - BaseTagLen, ' ');
+  ShortNameTail = &ODir->ShortNameTail[CalculateCrc32 (BaseName, FAT_NAME_LEN) % FAT_SHORT_NAME_TAIL_COUNT];
+  if (CompareMem (ShortNameTail->BaseName, BaseName, FAT_NAME_LEN) != 0) {
+    CopyMem (ShortNameTail->BaseName, BaseName, FAT_NAME_LEN);
+    ShortNameTail->NextTail = 1;
+  }
+
+  return ShortNameTail;
+}
+
 /**
 
   This function generates 8Dot3 name from user specified name for a newly created file.
+  The directory remembers the next numeric tail to try for each recently used base tag,
+  so the numeric tails already taken are not probed again.
 
   @param  Parent                - The parent directory.
   @param  DirEnt                - The directory entry whose 8Dot3Name needs to be generated.
@@ -171,12 +248,13 @@ FatCreate8Dot3Name (
   IN FAT_DIRENT  *DirEnt
   )
 {
-  CHAR8  *ShortName;
-  CHAR8  *ShortNameChar;
-  UINTN  BaseTagLen;
-  UINTN  Index;
-  UINTN  Retry;
-  UINT8  Segment;
+  CHAR8                *ShortName;
+  CHAR8                *ShortNameChar;
+  UINTN                BaseTagLen;
+  UINTN                Index;
+  UINT32               Tail;
+  UINT8                Segment;
+  FAT_SHORT_NAME_TAIL  *ShortNameTail;
 
   union {
     UINT32    Crc;
@@ -199,39 +277,46 @@ FatCreate8Dot3Name (
   }
 
   //
-  // We first use the algorithm described by spec.
+  // We first use the algorithm described by spec, starting from the
+  // first numeric tail of the base tag that has not been tried yet.
   //
-  ShortNameChar    = ShortName + BaseTagLen;
-  *ShortNameChar++ = '~';
-  *ShortNameChar   = '1';
-  Retry            = 0;
-  while (*FatShortNameHashSearch (Parent->ODir, ShortName) != NULL) {
-    *ShortNameChar = (CHAR8)(*ShortNameChar + 1);
-    if (++Retry == MAX_SPEC_RETRY) {
-      //
-      // We use new algorithm to generate 8.3 name
-      //
-      ASSERT (DirEnt->FileString != NULL);
-      gBS->CalculateCrc32 (DirEnt->FileString, StrSize (DirEnt->FileString), &HashValue.Crc);
-
-      if (BaseTagLen > HASH_BASE_TAG_LEN) {
-        BaseTagLen = HASH_BASE_TAG_LEN;
-      }
-
-      ShortNameChar = ShortName + BaseTagLen;
-      for (Index = 0; Index < HASH_VALUE_TAG_LEN; Index++) {
-        Segment = HashValue.Hex[Index].Segment;
-        if (Segment > 9) {
-          *ShortNameChar++ = (CHAR8)(Segment - 10 + 'A');
-        } else {
-          *ShortNameChar++ = (CHAR8)(Segment + '0');
-        }
-      }
-
-      *ShortNameChar++ = '~';
-      *ShortNameChar   = '1';
+  ShortNameTail = FatGetShortNameTail (Parent->ODir, ShortName, BaseTagLen);
+  while (ShortNameTail->NextTail <= MAX_SPEC_RETRY) {
+    FatSetNumericTail (ShortName, BaseTagLen, ShortNameTail->NextTail++);
+    if (*FatShortNameHashSearch (Parent->ODir, ShortName) == NULL) {
+      return;
     }
   }
+
+  //
+  // We use new algorithm to generate 8.3 name
+  //
+  ASSERT (DirEnt->FileString != NULL);
+  HashValue.Crc = CalculateCrc32 (DirEnt->FileString, StrSize (DirEnt->FileString));
+
+  if (BaseTagLen > HASH_BASE_TAG_LEN) {
+    BaseTagLen = HASH_BASE_TAG_LEN;
+  }
+
+  ShortNameChar = ShortName + BaseTagLen;
+  for (Index = 0; Index < HASH_VALUE_TAG_LEN; Index++) {
+    Segment = HashValue.Hex[Index].Segment;
+    if (Segment > 9) {
+      *ShortNameChar++ = (CHAR8)(Segment - 10 + 'A');
+    } else {
+      *ShortNameChar++ = (CHAR8)(Segment + '0');
+    }
+  }
+
+  //
+  // The numeric tail always terminates: a directory holds fewer entries than the
+  // number of distinct tails
+  //
+  BaseTagLen += HASH_VALUE_TAG_LEN;
+  Tail        = 1;
+  do {
+    FatSetNumericTail (ShortName, BaseTagLen, Tail++);
+  } while (*FatShortNameHashSearch (Parent->ODir, ShortName) != NULL);
 }
 
 /**
@@ -10,6 +10,36 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "Fat.h"
 
+/**
+
+  Get the byte offset of the FAT entry, which is identified with the Index,
+  from the beginning of the FAT.
+
+  @param  Volume                - FAT file system volume.
+  @param  Index                 - The index of the FAT entry of the volume.
+
+  @return The byte offset of the FAT entry.
+
+**/
+STATIC
+UINTN
+FatEntryOffset (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Index
+  )
+{
+  switch (Volume->FatType) {
+    case Fat12:
+      return FAT_POS_FAT12 (Index);
+
+    case Fat16:
+      return FAT_POS_FAT16 (Index);
+
+    default:
+      return FAT_POS_FAT32 (Index);
+  }
+}
+
 /**
 
   Get the FAT entry of the volume, which is identified with the Index.
@@ -27,7 +57,6 @@ FatLoadFatEntry (
   IN UINTN       Index
   )
 {
-  UINTN       Pos;
   EFI_STATUS  Status;
 
   if (Index > (Volume->MaxCluster + 1)) {
@@ -35,26 +64,10 @@ FatLoadFatEntry (
     return &Volume->FatEntryBuffer;
   }
 
-  //
-  // Compute buffer position needed
-  //
-  switch (Volume->FatType) {
-    case Fat12:
-      Pos = FAT_POS_FAT12 (Index);
-      break;
-
-    case Fat16:
-      Pos = FAT_POS_FAT16 (Index);
-      break;
-
-    default:
-      Pos = FAT_POS_FAT32 (Index);
-  }
-
   //
   // Set the position and read the buffer
   //
-  Volume->FatEntryPos = Volume->FatPos + Pos;
+  Volume->FatEntryPos = Volume->FatPos + FatEntryOffset (Volume, Index);
   Status              = FatDiskIo (
                           Volume,
                           ReadFat,
@@ -72,32 +85,25 @@ FatLoadFatEntry (
 
 /**
 
-  Get the FAT entry value of the volume, which is identified with the Index.
+  Decode the FAT entry value of the volume from its on-disk image.
 
   @param  Volume                - FAT file system volume.
   @param  Index                 - The index of the FAT entry of the volume.
+  @param  Pos                   - The buffer holding the on-disk image of the FAT entry.
 
   @return  The value of the FAT entry.
 
 **/
 STATIC
 UINTN
-FatGetFatEntry (
+FatDecodeFatEntry (
   IN FAT_VOLUME  *Volume,
-  IN UINTN       Index
+  IN UINTN       Index,
+  IN VOID        *Pos
   )
 {
-  VOID    *Pos;
-  UINT8   *En12;
-  UINT16  *En16;
-  UINT32  *En32;
-  UINTN   Accum;
-
-  Pos = FatLoadFatEntry (Volume, Index);
-
-  if (Index > (Volume->MaxCluster + 1)) {
-    return (UINTN)-1;
-  }
+  UINT8  *En12;
+  UINTN  Accum;
 
   switch (Volume->FatType) {
     case Fat12:
@@ -108,20 +114,557 @@ FatGetFatEntry (
       break;
 
     case Fat16:
-      En16  = Pos;
-      Accum = *En16;
+      Accum = ReadUnaligned16 (Pos);
       Accum = Accum | ((Accum >= FAT_CLUSTER_SPECIAL_FAT16) ? FAT_CLUSTER_SPECIAL_EXT : 0);
       break;
 
     default:
-      En32  = Pos;
-      Accum = *En32 & FAT_CLUSTER_MASK_FAT32;
+      Accum = ReadUnaligned32 (Pos) & FAT_CLUSTER_MASK_FAT32;
       Accum = Accum | ((Accum >= FAT_CLUSTER_SPECIAL_FAT32) ? FAT_CLUSTER_SPECIAL_EXT : 0);
   }
 
   return Accum;
 }
 
+/**
+
+  Encode the FAT entry value of the volume into its on-disk image.
+
+  @param  Volume                - FAT file system volume.
+  @param  Index                 - The index of the FAT entry of the volume.
+  @param  Pos                   - The buffer holding the on-disk image of the FAT entry.
+  @param  Value                 - The new value of the FAT entry.
+
+**/
+STATIC
+VOID
+FatEncodeFatEntry (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Index,
+  IN VOID        *Pos,
+  IN UINTN       Value
+  )
+{
+  UINT8  *En12;
+  UINTN  Accum;
+
+  switch (Volume->FatType) {
+    case Fat12:
+      En12  = Pos;
+      Accum = En12[0] | (En12[1] << 8);
+      Value = Value & FAT_CLUSTER_MASK_FAT12;
+
+      if (FAT_ODD_CLUSTER_FAT12 (Index)) {
+        Accum = (Value << 4) | (Accum & 0xF);
+      } else {
+        Accum = Value | (Accum & FAT_CLUSTER_UNMASK_FAT12);
+      }
+
+      En12[0] = (UINT8)(Accum & 0xFF);
+      En12[1] = (UINT8)(Accum >> 8);
+      break;
+
+    case Fat16:
+      WriteUnaligned16 (Pos, (UINT16)Value);
+      break;
+
+    default:
+      WriteUnaligned32 (
+        Pos,
+        (ReadUnaligned32 (Pos) & FAT_CLUSTER_UNMASK_FAT32) | (UINT32)(Value & FAT_CLUSTER_MASK_FAT32)
+        );
+  }
+}
+
+/**
+
+  Set the volume's dirty bit if it is not set yet.
+
+  @param  Volume                - FAT file system volume.
+
+**/
+STATIC
+VOID
+FatMarkFatDirty (
+  IN FAT_VOLUME  *Volume
+  )
+{
+  if (!Volume->FatDirty && (Volume->FatType != Fat12)) {
+    Volume->FatDirty = TRUE;
+    FatAccessVolumeDirty (Volume, WriteFat, &Volume->DirtyValue);
+  }
+}
+
+/**
+
+  Get the FAT entry value of the volume, which is identified with the Index.
+
+  @param  Volume                - FAT file system volume.
+  @param  Index                 - The index of the FAT entry of the volume.
+
+  @return  The value of the FAT entry.
+
+**/
+STATIC
+UINTN
+FatGetFatEntry (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Index
+  )
+{
+  VOID  *Pos;
+
+  Pos = FatLoadFatEntry (Volume, Index);
+
+  if (Index > (Volume->MaxCluster + 1)) {
+    return (UINTN)-1;
+  }
+
+  return FatDecodeFatEntry (Volume, Index, Pos);
+}
+
+/**
+
+  Check whether the chunk of the FAT has been decoded into the free cluster bitmap.
+
+  @param  Volume                - FAT file system volume.
+  @param  Chunk                 - The index of the chunk of FAT_FREEMAP_CHUNK_ENTRIES entries.
+
+  @retval TRUE                  - The bits of the chunk reflect the FAT.
+  @retval FALSE                 - The chunk has not been verified yet, its bits read as used clusters.
+
+**/
+STATIC
+BOOLEAN
+FatIsFreeChunkVerified (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Chunk
+  )
+{
+  return (BOOLEAN)((Volume->FreeChunkMap[Chunk / BITS_PER_BYTE] & (1 << (Chunk % BITS_PER_BYTE))) != 0);
+}
+
+/**
+
+  Mark the cluster as free or in use in the free cluster bitmap of the volume.
+  Clusters of a chunk that has not been verified yet are left alone, their state
+  is picked up from the FAT when the chunk is verified.
+
+  @param  Volume                - FAT file system volume.
+  @param  Index                 - The index of the cluster.
+  @param  Free                  - TRUE if the cluster becomes free, FALSE if it becomes used.
+
+**/
+STATIC
+VOID
+FatUpdateFreeBitmap (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Index,
+  IN BOOLEAN     Free
+  )
+{
+  UINTN  *Word;
+  UINTN  Mask;
+
+  ASSERT (Volume->FreeBitmap != NULL);
+  ASSERT (Index <= Volume->MaxCluster + 1);
+
+  if (!FatIsFreeChunkVerified (Volume, Index / FAT_FREEMAP_CHUNK_ENTRIES)) {
+    return;
+  }
+
+  Word = &Volume->FreeBitmap[Index / FAT_FREEMAP_BITS_PER_WORD];
+  Mask = (UINTN)1 << (Index % FAT_FREEMAP_BITS_PER_WORD);
+  if (Free && ((*Word & Mask) == 0)) {
+    *Word                     |= Mask;
+    Volume->FreeVerifiedCount += 1;
+  } else if (!Free && ((*Word & Mask) != 0)) {
+    *Word                     &= ~Mask;
+    Volume->FreeVerifiedCount -= 1;
+  }
+}
+
+/**
+
+  Allocate the free cluster bitmap of the volume if it has not been allocated yet.
+  No FAT entry is read here: every chunk of the FAT starts out unverified and is
+  decoded into the bitmap when its FAT cache page is loaded, when an allocation
+  needs it, or a few chunks at a time when the free cluster info is queried.
+
+  @param  Volume                - FAT file system volume.
+
+  @retval TRUE                  - The free cluster bitmap is available.
+  @retval FALSE                 - The free cluster bitmap can not be allocated,
+                                  the caller must fall back to FAT entry lookups.
+
+**/
+STATIC
+BOOLEAN
+FatInitializeFreeBitmap (
+  IN FAT_VOLUME  *Volume
+  )
+{
+  UINTN  EntryCount;
+  UINTN  ChunkCount;
+  UINTN  BitmapSize;
+  UINTN  ChunkMapSize;
+  UINT8  *Buffer;
+
+  if (Volume->FreeBitmap != NULL) {
+    return TRUE;
+  }
+
+  //
+  // The bitmap, the chunk map and the chunk buffer share one pool,
+  // each part is kept UINTN aligned
+  //
+  EntryCount   = Volume->MaxCluster + 2;
+  ChunkCount   = (EntryCount + FAT_FREEMAP_CHUNK_ENTRIES - 1) / FAT_FREEMAP_CHUNK_ENTRIES;
+  BitmapSize   = ALIGN_VALUE (EntryCount, FAT_FREEMAP_BITS_PER_WORD) / BITS_PER_BYTE;
+  ChunkMapSize = ALIGN_VALUE (ChunkCount, FAT_FREEMAP_BITS_PER_WORD) / BITS_PER_BYTE;
+  Buffer       = AllocateZeroPool (BitmapSize + ChunkMapSize + FAT_POS_FAT32 (FAT_FREEMAP_CHUNK_ENTRIES));
+  if (Buffer == NULL) {
+    return FALSE;
+  }
+
+  Volume->FreeBitmap         = (UINTN *)Buffer;
+  Volume->FreeChunkMap       = Buffer + BitmapSize;
+  Volume->FreeChunkBuffer    = Buffer + BitmapSize + ChunkMapSize;
+  Volume->FreeChunkCount     = ChunkCount;
+  Volume->FreeChunksVerified = 0;
+  Volume->FreeVerifyCursor   = 0;
+  Volume->FreeVerifiedCount  = 0;
+  return TRUE;
+}
+
+/**
+
+  Get the position and the size of a chunk of the FAT.
+
+  @param  Volume                - FAT file system volume.
+  @param  Chunk                 - The index of the chunk.
+  @param  Start                 - The first FAT entry of the chunk.
+  @param  End                   - The FAT entry following the chunk.
+  @param  ChunkPos              - The byte offset of the chunk from the beginning of the FAT.
+
+  @return The number of bytes of the FAT covered by the chunk.
+
+**/
+STATIC
+UINTN
+FatGetFreeChunkRange (
+  IN  FAT_VOLUME  *Volume,
+  IN  UINTN       Chunk,
+  OUT UINTN       *Start,
+  OUT UINTN       *End,
+  OUT UINTN       *ChunkPos
+  )
+{
+  *Start = Chunk * FAT_FREEMAP_CHUNK_ENTRIES;
+  *End   = MIN (*Start + FAT_FREEMAP_CHUNK_ENTRIES, Volume->MaxCluster + 2);
+
+  //
+  // A FAT12 entry spans two bytes, the chunk must cover both bytes of its last entry
+  //
+  *ChunkPos = FatEntryOffset (Volume, *Start);
+  return FatEntryOffset (Volume, *End - 1) + Volume->FatEntrySize - *ChunkPos;
+}
+
+/**
+
+  Decode a chunk of the FAT into the free cluster bitmap and mark the chunk verified.
+
+  @param  Volume                - FAT file system volume.
+  @param  Chunk                 - The index of the chunk.
+  @param  Buffer                - The FAT content of the chunk.
+
+**/
+STATIC
+VOID
+FatDecodeFreeChunk (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Chunk,
+  IN UINT8       *Buffer
+  )
+{
+  UINTN  Start;
+  UINTN  End;
+  UINTN  ChunkPos;
+  UINTN  Index;
+
+  ASSERT (!FatIsFreeChunkVerified (Volume, Chunk));
+
+  FatGetFreeChunkRange (Volume, Chunk, &Start, &End, &ChunkPos);
+  for (Index = MAX (Start, FAT_MIN_CLUSTER); Index < End; Index++) {
+    if (FatDecodeFatEntry (Volume, Index, Buffer + FatEntryOffset (Volume, Index) - ChunkPos) == FAT_CLUSTER_FREE) {
+      Volume->FreeBitmap[Index / FAT_FREEMAP_BITS_PER_WORD] |= (UINTN)1 << (Index % FAT_FREEMAP_BITS_PER_WORD);
+      Volume->FreeVerifiedCount                            += 1;
+    }
+  }
+
+  Volume->FreeChunkMap[Chunk / BITS_PER_BYTE] |= (UINT8)(1 << (Chunk % BITS_PER_BYTE));
+  Volume->FreeChunksVerified                  += 1;
+}
+
+/**
+
+  Verify a chunk of the FAT, reading it through the FAT cache if it has not been
+  verified yet.
+
+  @param  Volume                - FAT file system volume.
+  @param  Chunk                 - The index of the chunk.
+
+  @retval TRUE                  - The bits of the chunk reflect the FAT.
+  @retval FALSE                 - The chunk can not be read.
+
+**/
+STATIC
+BOOLEAN
+FatVerifyFreeChunk (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Chunk
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Start;
+  UINTN       End;
+  UINTN       ChunkPos;
+  UINTN       ChunkSize;
+
+  if (FatIsFreeChunkVerified (Volume, Chunk)) {
+    return TRUE;
+  }
+
+  if (Volume->DiskError) {
+    return FALSE;
+  }
+
+  ChunkSize = FatGetFreeChunkRange (Volume, Chunk, &Start, &End, &ChunkPos);
+  Status    = FatDiskIo (Volume, ReadFat, Volume->FatPos + ChunkPos, ChunkSize, Volume->FreeChunkBuffer, NULL);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  //
+  // Loading the FAT cache page may have verified the chunk already
+  //
+  if (!FatIsFreeChunkVerified (Volume, Chunk)) {
+    FatDecodeFreeChunk (Volume, Chunk, Volume->FreeChunkBuffer);
+  }
+
+  return TRUE;
+}
+
+/**
+
+  Verify at most Count more chunks of the FAT, in order from the beginning of the FAT.
+
+  @param  Volume                - FAT file system volume.
+  @param  Count                 - The maximum number of chunks to read.
+
+**/
+STATIC
+VOID
+FatVerifyFreeChunks (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Count
+  )
+{
+  while ((Count > 0) && (Volume->FreeVerifyCursor < Volume->FreeChunkCount)) {
+    if (!FatIsFreeChunkVerified (Volume, Volume->FreeVerifyCursor)) {
+      if (!FatVerifyFreeChunk (Volume, Volume->FreeVerifyCursor)) {
+        return;
+      }
+
+      Count--;
+    }
+
+    Volume->FreeVerifyCursor++;
+  }
+}
+
+/**
+
+  Verify the chunks of the FAT that are completely contained in a FAT cache page
+  which has just been loaded from the disk. The page holds the current FAT content,
+  since a modified page is always written back before it is replaced.
+
+  @param  Volume                - FAT file system volume.
+  @param  Offset                - The byte offset of the page from the beginning of the FAT.
+  @param  Buffer                - The content of the page.
+  @param  Size                  - The number of bytes in the page.
+
+**/
+VOID
+FatVerifyFreeChunksInPage (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Offset,
+  IN UINT8       *Buffer,
+  IN UINTN       Size
+  )
+{
+  UINTN  ChunkBytes;
+  UINTN  Chunk;
+  UINTN  Start;
+  UINTN  End;
+  UINTN  ChunkPos;
+  UINTN  ChunkSize;
+
+  if (Volume->DiskError || !FatInitializeFreeBitmap (Volume)) {
+    return;
+  }
+
+  //
+  // Every chunk starts on a byte boundary, and chunks are laid out back to back
+  //
+  ChunkBytes = FatEntryOffset (Volume, FAT_FREEMAP_CHUNK_ENTRIES);
+  for (Chunk = (Offset + ChunkBytes - 1) / ChunkBytes; Chunk < Volume->FreeChunkCount; Chunk++) {
+    ChunkSize = FatGetFreeChunkRange (Volume, Chunk, &Start, &End, &ChunkPos);
+    if (ChunkPos + ChunkSize > Offset + Size) {
+      break;
+    }
+
+    if (!FatIsFreeChunkVerified (Volume, Chunk)) {
+      FatDecodeFreeChunk (Volume, Chunk, Buffer + ChunkPos - Offset);
+    }
+  }
+}
+
+/**
+
+  Find the first free cluster from Start up to End in the free cluster bitmap.
+  The bitmap is scanned a word at a time.
+
+  @param  Volume                - FAT file system volume.
+  @param  Start                 - The cluster index to start the search from.
+  @param  End                   - The cluster index to stop the search at, at most
+                                  Volume->MaxCluster + 2.
+
+  @return The index of the free cluster, or End if there is no free cluster
+          from Start to End.
+
+**/
+STATIC
+UINTN
+FatFindFreeBit (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Start,
+  IN UINTN       End
+  )
+{
+  UINTN  Index;
+  UINTN  Word;
+
+  ASSERT (Volume->FreeBitmap != NULL);
+  ASSERT (End <= Volume->MaxCluster + 2);
+
+  Index = Start;
+  while (Index < End) {
+    Word = Volume->FreeBitmap[Index / FAT_FREEMAP_BITS_PER_WORD] >> (Index % FAT_FREEMAP_BITS_PER_WORD);
+    if (Word != 0) {
+      if (sizeof (UINTN) == sizeof (UINT64)) {
+        Index += (UINTN)LowBitSet64 ((UINT64)Word);
+      } else {
+        Index += (UINTN)LowBitSet32 ((UINT32)Word);
+      }
+
+      return MIN (Index, End);
+    }
+
+    Index = (Index / FAT_FREEMAP_BITS_PER_WORD + 1) * FAT_FREEMAP_BITS_PER_WORD;
+  }
+
+  return End;
+}
+
+/**
+
+  Find the first cluster from Start up to End that is not free in the free cluster
+  bitmap. The bitmap is scanned a word at a time.
+
+  @param  Volume                - FAT file system volume.
+  @param  Start                 - The cluster index to start the search from.
+  @param  End                   - The cluster index to stop the search at, at most
+                                  Volume->MaxCluster + 2.
+
+  @return The index of the cluster, or End if all the clusters from Start to End
+          are free.
+
+**/
+STATIC
+UINTN
+FatFindUsedBit (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Start,
+  IN UINTN       End
+  )
+{
+  UINTN  Index;
+  UINTN  Word;
+
+  ASSERT (Volume->FreeBitmap != NULL);
+  ASSERT (End <= Volume->MaxCluster + 2);
+
+  Index = Start;
+  while (Index < End) {
+    Word = ~Volume->FreeBitmap[Index / FAT_FREEMAP_BITS_PER_WORD] >> (Index % FAT_FREEMAP_BITS_PER_WORD);
+    if (Word != 0) {
+      if (sizeof (UINTN) == sizeof (UINT64)) {
+        Index += (UINTN)LowBitSet64 ((UINT64)Word);
+      } else {
+        Index += (UINTN)LowBitSet32 ((UINT32)Word);
+      }
+
+      return MIN (Index, End);
+    }
+
+    Index = (Index / FAT_FREEMAP_BITS_PER_WORD + 1) * FAT_FREEMAP_BITS_PER_WORD;
+  }
+
+  return End;
+}
+
+/**
+
+  Find the first free cluster at or after Start, verifying the chunks of the FAT
+  on the way as needed.
+
+  @param  Volume                - FAT file system volume.
+  @param  Start                 - The cluster index to start the search from.
+
+  @return The index of the free cluster, or Volume->MaxCluster + 2 if there is no
+          free cluster from Start to the end of the volume.
+
+**/
+STATIC
+UINTN
+FatFindFreeCluster (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Start
+  )
+{
+  UINTN  Limit;
+  UINTN  End;
+  UINTN  Index;
+
+  Limit = Volume->MaxCluster + 2;
+  while (Start < Limit) {
+    if (!FatVerifyFreeChunk (Volume, Start / FAT_FREEMAP_CHUNK_ENTRIES)) {
+      return Limit;
+    }
+
+    End   = MIN ((Start / FAT_FREEMAP_CHUNK_ENTRIES + 1) * FAT_FREEMAP_CHUNK_ENTRIES, Limit);
+    Index = FatFindFreeBit (Volume, Start, End);
+    if (Index < End) {
+      return Index;
+    }
+
+    Start = End;
+  }
+
+  return Limit;
+}
+
 /**
 
   Set the FAT entry value of the volume, which is identified with the Index.
@@ -144,10 +687,6 @@ FatSetFatEntry (
   )
 {
   VOID        *Pos;
-  UINT8       *En12;
-  UINT16      *En16;
-  UINT32      *En32;
-  UINTN       Accum;
   EFI_STATUS  Status;
   UINTN       OriginalVal;
 
@@ -167,6 +706,13 @@ FatSetFatEntry (
     }
   }
 
+  //
+  // Keep the free cluster bitmap in sync with the FAT
+  //
+  if ((Volume->FreeBitmap != NULL) && (Index <= Volume->MaxCluster + 1)) {
+    FatUpdateFreeBitmap (Volume, Index, (BOOLEAN)(Value == FAT_CLUSTER_FREE));
+  }
+
   //
   // Make sure the entry is in memory
   //
@@ -175,39 +721,12 @@ FatSetFatEntry (
   //
   // Update the value
   //
-  switch (Volume->FatType) {
-    case Fat12:
-      En12  = Pos;
-      Accum = En12[0] | (En12[1] << 8);
-      Value = Value & FAT_CLUSTER_MASK_FAT12;
-
-      if (FAT_ODD_CLUSTER_FAT12 (Index)) {
-        Accum = (Value << 4) | (Accum & 0xF);
-      } else {
-        Accum = Value | (Accum & FAT_CLUSTER_UNMASK_FAT12);
-      }
-
-      En12[0] = (UINT8)(Accum & 0xFF);
-      En12[1] = (UINT8)(Accum >> 8);
-      break;
-
-    case Fat16:
-      En16  = Pos;
-      *En16 = (UINT16)Value;
-      break;
-
-    default:
-      En32  = Pos;
-      *En32 = (*En32 & FAT_CLUSTER_UNMASK_FAT32) | (UINT32)(Value & FAT_CLUSTER_MASK_FAT32);
-  }
+  FatEncodeFatEntry (Volume, Index, Pos, Value);
 
   //
   // If the volume's dirty bit is not set, set it now
   //
-  if (!Volume->FatDirty && (Volume->FatType != Fat12)) {
-    Volume->FatDirty = TRUE;
-    FatAccessVolumeDirty (Volume, WriteFat, &Volume->DirtyValue);
-  }
+  FatMarkFatDirty (Volume);
 
   //
   // Write the updated fat entry value to the volume
@@ -274,7 +793,8 @@ FatAllocateCluster (
   IN FAT_VOLUME  *Volume
   )
 {
-  UINTN  Cluster;
+  UINTN    Cluster;
+  BOOLEAN  Wrapped;
 
   //
   // Start looking at FatFreePos for the next unallocated cluster
@@ -283,19 +803,44 @@ FatAllocateCluster (
     return (UINTN)FAT_CLUSTER_LAST;
   }
 
+  //
+  // Search the free cluster bitmap if it is available,
+  // otherwise fall back to probing the FAT entry by entry
+  //
+  if (FatInitializeFreeBitmap (Volume)) {
+    Cluster = FatFindFreeCluster (Volume, Volume->FatInfoSector.FreeInfo.NextCluster);
+    if (Cluster > Volume->MaxCluster + 1) {
+      //
+      // Wrap around once, clusters below the hint may have been freed
+      //
+      Cluster = FatFindFreeCluster (Volume, FAT_MIN_CLUSTER);
+      if (Cluster > Volume->MaxCluster + 1) {
+        //
+        // The whole FAT has been verified by the search, so the free cluster
+        // info can be brought up to date without another scan
+        //
+        FatComputeFreeInfo (Volume);
+        return (UINTN)FAT_CLUSTER_LAST;
+      }
+    }
+
+    Volume->FatInfoSector.FreeInfo.NextCluster = (UINT32)(Cluster + 1);
+    return Cluster;
+  }
+
+  Wrapped = FALSE;
   for ( ; ;) {
     //
-    // If the end of the list, return no available cluster
+    // If the end of the list, wrap around once, then return no available cluster
     //
     if (Volume->FatInfoSector.FreeInfo.NextCluster > (Volume->MaxCluster + 1)) {
-      if (Volume->FreeInfoValid && (0 < (INT32)(Volume->FatInfoSector.FreeInfo.ClusterCount))) {
-        Volume->FreeInfoValid = FALSE;
-      }
-
-      FatComputeFreeInfo (Volume);
-      if (Volume->FatInfoSector.FreeInfo.NextCluster > (Volume->MaxCluster + 1)) {
+      if (Wrapped || Volume->DiskError) {
+        Volume->FatInfoSector.FreeInfo.ClusterCount = 0;
         return (UINTN)FAT_CLUSTER_LAST;
       }
+
+      Wrapped                                    = TRUE;
+      Volume->FatInfoSector.FreeInfo.NextCluster = FAT_MIN_CLUSTER;
     }
 
     Cluster = FatGetFatEntry (Volume, Volume->FatInfoSector.FreeInfo.NextCluster);
@@ -314,6 +859,263 @@ FatAllocateCluster (
   return Cluster;
 }
 
+/**
+
+  Verify the chunks of the FAT that cover the clusters from Start up to End.
+  A chunk that can not be read stays unverified, its clusters read as used.
+
+  @param  Volume                - FAT file system volume.
+  @param  Start                 - The first cluster.
+  @param  End                   - The cluster following the last cluster.
+
+**/
+STATIC
+VOID
+FatVerifyFreeClusterRange (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Start,
+  IN UINTN       End
+  )
+{
+  UINTN  Chunk;
+
+  for (Chunk = Start / FAT_FREEMAP_CHUNK_ENTRIES; Chunk * FAT_FREEMAP_CHUNK_ENTRIES < End; Chunk++) {
+    if (!FatVerifyFreeChunk (Volume, Chunk)) {
+      return;
+    }
+  }
+}
+
+/**
+
+  Find a run of free clusters for a new extent of Count clusters.
+  A run directly following Hint is preferred so that a growing file stays contiguous.
+  Otherwise the free runs are searched next fit, from Hint or from the free cluster
+  hint of the volume, in a window of FAT_EXTENT_SEARCH_CHUNKS chunks of the FAT or
+  twice Count clusters, whichever is larger, wrapping around to the beginning of
+  the volume. The smallest large enough run among the first one found and the
+  FAT_EXTENT_SEARCH_RUNS runs following it is chosen. The chunks of the window are
+  verified on the way, so the cost is bounded by the window and not by the volume.
+
+  @param  Volume                - FAT file system volume.
+  @param  Hint                  - The last cluster of the file, or FAT_CLUSTER_FREE if the file is empty.
+  @param  Count                 - The number of clusters requested.
+
+  @return The first cluster of the run, or FAT_CLUSTER_FREE if there is no free run
+          large enough in the window.
+
+**/
+STATIC
+UINTN
+FatFindFreeExtent (
+  IN FAT_VOLUME  *Volume,
+  IN UINTN       Hint,
+  IN UINTN       Count
+  )
+{
+  UINTN  Limit;
+  UINTN  Origin;
+  UINTN  Window;
+  UINTN  WindowStart;
+  UINTN  WindowEnd;
+  UINTN  Start;
+  UINTN  End;
+  UINTN  Runs;
+  UINTN  BestStart;
+  UINTN  BestLength;
+
+  Limit = Volume->MaxCluster + 2;
+  if (Count > Limit - FAT_MIN_CLUSTER) {
+    return FAT_CLUSTER_FREE;
+  }
+
+  //
+  // Try to extend the file in place first
+  //
+  if ((Hint >= FAT_MIN_CLUSTER) && (Hint + 1 + Count <= Limit)) {
+    FatVerifyFreeClusterRange (Volume, Hint + 1, Hint + 1 + Count);
+    if (FatFindUsedBit (Volume, Hint + 1, Hint + 1 + Count) == Hint + 1 + Count) {
+      return Hint + 1;
+    }
+  }
+
+  if ((Hint >= FAT_MIN_CLUSTER) && (Hint + 1 < Limit)) {
+    Origin = Hint + 1;
+  } else {
+    Origin = Volume->FatInfoSector.FreeInfo.NextCluster;
+    if ((Origin < FAT_MIN_CLUSTER) || (Origin >= Limit)) {
+      Origin = FAT_MIN_CLUSTER;
+    }
+  }
+
+  Window = MAX (FAT_EXTENT_SEARCH_CHUNKS * FAT_FREEMAP_CHUNK_ENTRIES, 2 * Count);
+  Window = MIN (Window, Limit - FAT_MIN_CLUSTER);
+
+  BestStart   = FAT_CLUSTER_FREE;
+  BestLength  = MAX_UINTN;
+  Runs        = 0;
+  WindowStart = Origin;
+  WindowEnd   = MIN (Origin + Window, Limit);
+  for ( ; ;) {
+    FatVerifyFreeClusterRange (Volume, WindowStart, WindowEnd);
+    Start = FatFindFreeBit (Volume, WindowStart, WindowEnd);
+    while (Start < WindowEnd) {
+      End = FatFindUsedBit (Volume, Start, WindowEnd);
+      if ((End - Start >= Count) && (End - Start < BestLength)) {
+        BestStart  = Start;
+        BestLength = End - Start;
+        if (BestLength == Count) {
+          return BestStart;
+        }
+      }
+
+      if (BestStart != FAT_CLUSTER_FREE) {
+        Runs++;
+        if (Runs > FAT_EXTENT_SEARCH_RUNS) {
+          return BestStart;
+        }
+      }
+
+      Start = FatFindFreeBit (Volume, End, WindowEnd);
+    }
+
+    //
+    // Wrap around to the beginning of the volume for the rest of the window
+    //
+    if ((WindowStart != Origin) || (Origin == FAT_MIN_CLUSTER) || (WindowEnd - Origin >= Window)) {
+      break;
+    }
+
+    WindowEnd   = MIN (FAT_MIN_CLUSTER + Window - (WindowEnd - Origin), Origin);
+    WindowStart = FAT_MIN_CLUSTER;
+  }
+
+  return BestStart;
+}
+
+/**
+
+  Allocate Count contiguous free clusters as one extent and chain them together.
+  The FAT entries of the extent are updated a chunk at a time through the FAT cache,
+  and the last entry is terminated with FAT_CLUSTER_LAST. If updating a chunk fails,
+  the clusters of the chunks already chained are freed again before returning.
+
+  @param  Volume                - FAT file system volume.
+  @param  Hint                  - The last cluster of the file, or FAT_CLUSTER_FREE if the file is empty.
+  @param  Count                 - The number of clusters requested.
+  @param  Cluster               - The first cluster of the allocated extent.
+
+  @retval EFI_SUCCESS           - The extent is allocated.
+  @retval EFI_NOT_FOUND         - There is no free run large enough in the search window,
+                                  or the free cluster bitmap is not available.
+  @retval EFI_OUT_OF_RESOURCES  - Can not allocate the working buffer.
+  @return other                 - An error occurred when updating the FAT entries.
+
+**/
+STATIC
+EFI_STATUS
+FatAllocateExtent (
+  IN  FAT_VOLUME  *Volume,
+  IN  UINTN       Hint,
+  IN  UINTN       Count,
+  OUT UINTN       *Cluster
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Buffer;
+  UINTN       Start;
+  UINTN       End;
+  UINTN       ChunkStart;
+  UINTN       ChunkEnd;
+  UINTN       ChunkPos;
+  UINTN       ChunkSize;
+  UINTN       Index;
+
+  if (Volume->DiskError || !FatInitializeFreeBitmap (Volume)) {
+    return EFI_NOT_FOUND;
+  }
+
+  Start = FatFindFreeExtent (Volume, Hint, Count);
+  if (Start == FAT_CLUSTER_FREE) {
+    return EFI_NOT_FOUND;
+  }
+
+  Buffer = AllocatePool (FAT_POS_FAT32 (FAT_FREEMAP_CHUNK_ENTRIES));
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  FatMarkFatDirty (Volume);
+
+  End = Start + Count;
+  for (ChunkStart = Start; ChunkStart < End; ChunkStart = ChunkEnd) {
+    ChunkEnd = MIN (ChunkStart + FAT_FREEMAP_CHUNK_ENTRIES, End);
+
+    //
+    // Read the chunk first, since a FAT12 entry shares a byte with its neighbour
+    // and the upper bits of a FAT32 entry must be preserved
+    //
+    ChunkPos  = FatEntryOffset (Volume, ChunkStart);
+    ChunkSize = FatEntryOffset (Volume, ChunkEnd - 1) + Volume->FatEntrySize - ChunkPos;
+    Status    = FatDiskIo (Volume, ReadFat, Volume->FatPos + ChunkPos, ChunkSize, Buffer, NULL);
+    if (EFI_ERROR (Status)) {
+      goto Done;
+    }
+
+    for (Index = ChunkStart; Index < ChunkEnd; Index++) {
+      FatEncodeFatEntry (
+        Volume,
+        Index,
+        Buffer + FatEntryOffset (Volume, Index) - ChunkPos,
+        (Index + 1 == End) ? (UINTN)FAT_CLUSTER_LAST : Index + 1
+        );
+    }
+
+    //
+    // The FAT is the first FAT, and other FATs will be in sync
+    // when the FAT cache flush back.
+    //
+    Status = FatDiskIo (Volume, WriteFat, Volume->FatPos + ChunkPos, ChunkSize, Buffer, NULL);
+    if (EFI_ERROR (Status)) {
+      goto Done;
+    }
+
+    for (Index = ChunkStart; Index < ChunkEnd; Index++) {
+      FatUpdateFreeBitmap (Volume, Index, FALSE);
+    }
+
+    //
+    // Every cluster of the extent was free
+    //
+    if (Volume->FatInfoSector.FreeInfo.ClusterCount >= ChunkEnd - ChunkStart) {
+      Volume->FatInfoSector.FreeInfo.ClusterCount -= (UINT32)(ChunkEnd - ChunkStart);
+    } else {
+      Volume->FatInfoSector.FreeInfo.ClusterCount = 0;
+    }
+  }
+
+  if ((Volume->FatInfoSector.FreeInfo.NextCluster >= Start) &&
+      (Volume->FatInfoSector.FreeInfo.NextCluster < End))
+  {
+    Volume->FatInfoSector.FreeInfo.NextCluster = (UINT32)End;
+  }
+
+  *Cluster = Start;
+
+Done:
+  if (EFI_ERROR (Status)) {
+    //
+    // Nothing links the chunks chained so far to a file, free them again
+    //
+    for (Index = Start; Index < ChunkStart; Index++) {
+      FatSetFatEntry (Volume, Index, FAT_CLUSTER_FREE);
+    }
+  }
+
+  FreePool (Buffer);
+  return Status;
+}
+
 /**
 
   Count the number of clusters given a size.
@@ -341,6 +1143,153 @@ FatSizeToClusters (
   return Clusters;
 }
 
+/**
+
+  Free the cached extent map of the open file. It must be called whenever
+  the cluster chain of the file changes.
+
+  @param  OFile                 - The open file.
+
+**/
+VOID
+FatDiscardExtentMap (
+  IN FAT_OFILE  *OFile
+  )
+{
+  if (OFile->Extents != NULL) {
+    FreePool (OFile->Extents);
+    OFile->Extents     = NULL;
+    OFile->ExtentCount = 0;
+  }
+}
+
+/**
+
+  Walk the cluster chain of the open file once and record it as a sorted list
+  of runs of physically consecutive clusters.
+
+  @param  OFile                 - The open file.
+
+  @retval TRUE                  - The extent map is built.
+  @retval FALSE                 - The extent map can not be built because of a corrupt
+                                  cluster chain or lack of memory.
+
+**/
+STATIC
+BOOLEAN
+FatBuildExtentMap (
+  IN FAT_OFILE  *OFile
+  )
+{
+  FAT_VOLUME  *Volume;
+  FAT_EXTENT  *Extents;
+  FAT_EXTENT  *NewExtents;
+  UINTN       ExtentCount;
+  UINTN       MaxExtents;
+  UINTN       FileCluster;
+  UINTN       Cluster;
+
+  ASSERT (OFile->Extents == NULL);
+
+  Volume      = OFile->Volume;
+  MaxExtents  = FAT_EXTENT_MAP_GROW_COUNT;
+  Extents     = AllocatePool (MaxExtents * sizeof (FAT_EXTENT));
+  ExtentCount = 0;
+  if (Extents == NULL) {
+    return FALSE;
+  }
+
+  Cluster = OFile->FileCluster;
+  for (FileCluster = 0; !FAT_END_OF_FAT_CHAIN (Cluster); FileCluster++) {
+    //
+    // A chain longer than the volume must contain a loop
+    //
+    if ((Cluster < FAT_MIN_CLUSTER) || (Cluster > Volume->MaxCluster + 1) || (FileCluster > Volume->MaxCluster)) {
+      goto Error;
+    }
+
+    if ((ExtentCount != 0) &&
+        (Extents[ExtentCount - 1].Cluster + Extents[ExtentCount - 1].Count == Cluster))
+    {
+      Extents[ExtentCount - 1].Count++;
+    } else {
+      if (ExtentCount == MaxExtents) {
+        NewExtents = ReallocatePool (
+                       MaxExtents * sizeof (FAT_EXTENT),
+                       (MaxExtents + FAT_EXTENT_MAP_GROW_COUNT) * sizeof (FAT_EXTENT),
+                       Extents
+                       );
+        if (NewExtents == NULL) {
+          goto Error;
+        }
+
+        Extents     = NewExtents;
+        MaxExtents += FAT_EXTENT_MAP_GROW_COUNT;
+      }
+
+      Extents[ExtentCount].FileCluster = FileCluster;
+      Extents[ExtentCount].Cluster     = Cluster;
+      Extents[ExtentCount].Count       = 1;
+      ExtentCount++;
+    }
+
+    Cluster = FatGetFatEntry (Volume, Cluster);
+  }
+
+  if (Volume->DiskError || (ExtentCount == 0)) {
+    goto Error;
+  }
+
+  OFile->Extents     = Extents;
+  OFile->ExtentCount = ExtentCount;
+  return TRUE;
+
+Error:
+  FreePool (Extents);
+  return FALSE;
+}
+
+/**
+
+  Find the extent of the open file that contains the cluster of the given index
+  within the file, by a binary search of the extent map.
+
+  @param  OFile                 - The open file.
+  @param  FileCluster           - The index of the cluster within the file.
+
+  @return The extent containing the cluster, or NULL if the cluster is beyond the
+          end of the cluster chain.
+
+**/
+STATIC
+FAT_EXTENT *
+FatLookupExtent (
+  IN FAT_OFILE  *OFile,
+  IN UINTN      FileCluster
+  )
+{
+  FAT_EXTENT  *Extent;
+  UINTN       Low;
+  UINTN       High;
+  UINTN       Middle;
+
+  Low  = 0;
+  High = OFile->ExtentCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    Extent = &OFile->Extents[Middle];
+    if (FileCluster < Extent->FileCluster) {
+      High = Middle;
+    } else if (FileCluster >= Extent->FileCluster + Extent->Count) {
+      Low = Middle + 1;
+    } else {
+      return Extent;
+    }
+  }
+
+  return NULL;
+}
+
 /**
 
   Shrink the end of the open file base on the file size.
@@ -364,6 +1313,7 @@ FatShrinkEof (
 
   Volume = OFile->Volume;
   ASSERT_VOLUME_LOCKED (Volume);
+  FatDiscardExtentMap (OFile);
 
   NewSize = FatSizeToClusters (Volume, OFile->FileSize);
 
@@ -456,6 +1406,8 @@ FatGrowEof (
   NewSize = FatSizeToClusters (Volume, (UINTN)NewSizeInBytes);
 
   if (CurSize < NewSize) {
+    FatDiscardExtentMap (OFile);
+
     //
     // If we haven't found the files last cluster do it now
     //
@@ -488,11 +1440,33 @@ FatGrowEof (
       }
     }
 
+    LastCluster = OFile->FileLastCluster;
+
     //
-    // Loop until we've allocated enough space
+    // Try to allocate the remaining space as one contiguous extent, so that
+    // large files are not fragmented when the free space is interleaved
     //
-    LastCluster = OFile->FileLastCluster;
+    if (NewSize - CurSize >= FAT_EXTENT_MIN_CLUSTERS) {
+      Status = FatAllocateExtent (Volume, LastCluster, NewSize - CurSize, &NewCluster);
+      if (!EFI_ERROR (Status)) {
+        if (LastCluster != 0) {
+          FatSetFatEntry (Volume, LastCluster, NewCluster);
+        } else {
+          OFile->FileCluster        = NewCluster;
+          OFile->FileCurrentCluster = NewCluster;
+        }
+
+        LastCluster            = NewCluster + NewSize - CurSize - 1;
+        CurSize                = NewSize;
+        OFile->FileLastCluster = LastCluster;
+      } else if (Status != EFI_NOT_FOUND) {
+        goto Done;
+      }
+    }
 
+    //
+    // Loop until we've allocated enough space
+    //
     while (CurSize < NewSize) {
       NewCluster = FatAllocateCluster (Volume);
       if (FAT_END_OF_FAT_CHAIN (NewCluster)) {
@@ -566,13 +1540,17 @@ FatOFilePosition (
   )
 {
   FAT_VOLUME  *Volume;
+  FAT_EXTENT  *Extent;
   UINTN       ClusterSize;
   UINTN       Cluster;
   UINTN       StartPos;
   UINTN       Run;
+  UINTN       Index;
 
   Volume      = OFile->Volume;
   ClusterSize = Volume->ClusterSize;
+  Extent      = NULL;
+  Index       = 0;
 
   ASSERT_VOLUME_LOCKED (Volume);
 
@@ -596,21 +1574,41 @@ FatOFilePosition (
     // when OFile->FileCluster is updated, so make a check of this
     // and invalidate the original OFile->Position in this case
     //
-    Cluster  = OFile->FileCurrentCluster;
-    StartPos = OFile->Position;
-    if ((Position < StartPos) || (OFile->FileCluster == Cluster)) {
-      StartPos = 0;
-      Cluster  = OFile->FileCluster;
+    // If the chain would have to be walked again from its first cluster,
+    // build the extent map of the file once and look the position up
+    // in the map from then on.
+    //
+    if ((OFile->Extents == NULL) && (Position >= ClusterSize) &&
+        ((Position < OFile->Position) || (OFile->FileCluster == OFile->FileCurrentCluster)))
+    {
+      FatBuildExtentMap (OFile);
     }
 
-    while (StartPos + ClusterSize <= Position) {
-      StartPos += ClusterSize;
-      if ((Cluster == FAT_CLUSTER_FREE) || (Cluster >= FAT_CLUSTER_SPECIAL)) {
-        DEBUG ((DEBUG_INIT | DEBUG_ERROR, "FatOFilePosition:" " cluster chain corrupt\n"));
-        return EFI_VOLUME_CORRUPTED;
+    if (OFile->Extents != NULL) {
+      Extent = FatLookupExtent (OFile, Position >> Volume->ClusterAlignment);
+    }
+
+    if (Extent != NULL) {
+      Index    = (Position >> Volume->ClusterAlignment) - Extent->FileCluster;
+      Cluster  = Extent->Cluster + Index;
+      StartPos = Position & ~(ClusterSize - 1);
+    } else {
+      Cluster  = OFile->FileCurrentCluster;
+      StartPos = OFile->Position;
+      if ((Position < StartPos) || (OFile->FileCluster == Cluster)) {
+        StartPos = 0;
+        Cluster  = OFile->FileCluster;
       }
 
-      Cluster = FatGetFatEntry (Volume, Cluster);
+      while (StartPos + ClusterSize <= Position) {
+        StartPos += ClusterSize;
+        if ((Cluster == FAT_CLUSTER_FREE) || (Cluster >= FAT_CLUSTER_SPECIAL)) {
+          DEBUG ((DEBUG_INIT | DEBUG_ERROR, "FatOFilePosition:" " cluster chain corrupt\n"));
+          return EFI_VOLUME_CORRUPTED;
+        }
+
+        Cluster = FatGetFatEntry (Volume, Cluster);
+      }
     }
 
     if ((Cluster < FAT_MIN_CLUSTER) || (Cluster > Volume->MaxCluster + 1)) {
@@ -627,7 +1625,9 @@ FatOFilePosition (
     // Compute the number of consecutive clusters in the file
     //
     Run = StartPos + ClusterSize - Position;
-    if (!FAT_END_OF_FAT_CHAIN (Cluster)) {
+    if (Extent != NULL) {
+      Run += (Extent->Count - Index - 1) << Volume->ClusterAlignment;
+    } else if (!FAT_END_OF_FAT_CHAIN (Cluster)) {
       while ((FatGetFatEntry (Volume, Cluster) == Cluster + 1) && Run < PosLimit) {
         Run     += ClusterSize;
         Cluster += 1;
@@ -713,6 +1713,14 @@ FatPhysicalFileSize (
 
   Update the free cluster info of FatInfoSector of the volume.
 
+  The free cluster count is not recomputed by a scan of the whole FAT. Each call
+  reads at most FAT_FREEMAP_VERIFY_STEP more chunks of the FAT, the rest is
+  verified as FAT cache pages are loaded by normal file system activity.
+  Until the whole FAT has been verified, the count of the FSInfo sector is trusted
+  if it was valid at mount time. Otherwise the free clusters found in the verified
+  chunks are reported, a lower bound of the free space that grows as more of the
+  FAT is verified. That count is not written back to the disk.
+
   @param  Volume                - FAT file system volume.
 
 **/
@@ -723,25 +1731,65 @@ FatComputeFreeInfo (
 {
   UINTN  Index;
 
-  //
-  // If we don't have valid info, compute it now
-  //
-  if (!Volume->FreeInfoValid) {
-    Volume->FreeInfoValid                       = TRUE;
-    Volume->FatInfoSector.FreeInfo.ClusterCount = 0;
-    for (Index = Volume->MaxCluster + 1; Index >= FAT_MIN_CLUSTER; Index--) {
-      if (Volume->DiskError) {
-        break;
-      }
+  if (!FatInitializeFreeBitmap (Volume)) {
+    //
+    // Without the free cluster bitmap, compute the info now
+    //
+    if (!Volume->FreeInfoValid) {
+      Volume->FreeInfoValid                       = TRUE;
+      Volume->FatInfoSector.FreeInfo.ClusterCount = 0;
+      for (Index = Volume->MaxCluster + 1; Index >= FAT_MIN_CLUSTER; Index--) {
+        if (Volume->DiskError) {
+          break;
+        }
 
-      if (FatGetFatEntry (Volume, Index) == FAT_CLUSTER_FREE) {
-        Volume->FatInfoSector.FreeInfo.ClusterCount += 1;
-        Volume->FatInfoSector.FreeInfo.NextCluster   = (UINT32)Index;
+        if (FatGetFatEntry (Volume, Index) == FAT_CLUSTER_FREE) {
+          Volume->FatInfoSector.FreeInfo.ClusterCount += 1;
+          Volume->FatInfoSector.FreeInfo.NextCluster   = (UINT32)Index;
+        }
       }
+
+      Volume->FatInfoSector.Signature          = FAT_INFO_SIGNATURE;
+      Volume->FatInfoSector.InfoBeginSignature = FAT_INFO_BEGIN_SIGNATURE;
+      Volume->FatInfoSector.InfoEndSignature   = FAT_INFO_END_SIGNATURE;
+    }
+
+    return;
+  }
+
+  FatVerifyFreeChunks (Volume, FAT_FREEMAP_VERIFY_STEP);
+  if (Volume->FreeChunksVerified < Volume->FreeChunkCount) {
+    if (!Volume->FreeInfoValid) {
+      Volume->FatInfoSector.FreeInfo.ClusterCount = (UINT32)Volume->FreeVerifiedCount;
     }
 
-    Volume->FatInfoSector.Signature          = FAT_INFO_SIGNATURE;
-    Volume->FatInfoSector.InfoBeginSignature = FAT_INFO_BEGIN_SIGNATURE;
-    Volume->FatInfoSector.InfoEndSignature   = FAT_INFO_END_SIGNATURE;
+    return;
+  }
+
+  //
+  // The whole FAT has been verified, the count is exact now
+  //
+  if (Volume->FreeInfoValid && (Volume->FatInfoSector.FreeInfo.ClusterCount == Volume->FreeVerifiedCount)) {
+    return;
+  }
+
+  if (Volume->FreeInfoValid) {
+    DEBUG ((
+      DEBUG_WARN,
+      "FatComputeFreeInfo: FSInfo free cluster count %u corrected to %u\n",
+      Volume->FatInfoSector.FreeInfo.ClusterCount,
+      (UINT32)Volume->FreeVerifiedCount
+      ));
+  }
+
+  Volume->FreeInfoValid                       = TRUE;
+  Volume->FatInfoSector.FreeInfo.ClusterCount = (UINT32)Volume->FreeVerifiedCount;
+  Index                                       = FatFindFreeBit (Volume, FAT_MIN_CLUSTER, Volume->MaxCluster + 2);
+  if (Index <= Volume->MaxCluster + 1) {
+    Volume->FatInfoSector.FreeInfo.NextCluster = (UINT32)Index;
   }
+
+  Volume->FatInfoSector.Signature          = FAT_INFO_SIGNATURE;
+  Volume->FatInfoSector.InfoBeginSignature = FAT_INFO_BEGIN_SIGNATURE;
+  Volume->FatInfoSector.InfoEndSignature   = FAT_INFO_END_SIGNATURE;
 }
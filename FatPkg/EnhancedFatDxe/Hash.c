@@ -23,7 +23,6 @@ FatHashLongName (
   IN CHAR16  *LongNameString
   )
 {
-  UINT32  HashValue;
   CHAR16  UpCasedLongFileName[EFI_PATH_STRING_LENGTH];
 
   StrnCpyS (
@@ -33,8 +32,7 @@ FatHashLongName (
     ARRAY_SIZE (UpCasedLongFileName) - 1
     );
   FatStrUpr (UpCasedLongFileName);
-  gBS->CalculateCrc32 (UpCasedLongFileName, StrSize (UpCasedLongFileName), &HashValue);
-  return (HashValue & HASH_TABLE_MASK);
+  return CalculateCrc32 (UpCasedLongFileName, StrSize (UpCasedLongFileName));
 }
 
 /**
@@ -52,10 +50,119 @@ FatHashShortName (
   IN CHAR8  *ShortNameString
   )
 {
-  UINT32  HashValue;
+  return CalculateCrc32 (ShortNameString, FAT_NAME_LEN);
+}
+
+/**
+
+  Allocate the initial hash tables of the directory.
 
-  gBS->CalculateCrc32 (ShortNameString, FAT_NAME_LEN, &HashValue);
-  return (HashValue & HASH_TABLE_MASK);
+  @param  ODir                  - The directory.
+
+  @retval EFI_SUCCESS           - The hash tables are allocated.
+  @retval EFI_OUT_OF_RESOURCES  - Not enough memory to allocate the hash tables.
+
+**/
+EFI_STATUS
+FatInitializeHashTable (
+  IN FAT_ODIR  *ODir
+  )
+{
+  ODir->LongNameHashTable  = AllocateZeroPool (HASH_TABLE_MIN_SIZE * sizeof (FAT_DIRENT *));
+  ODir->ShortNameHashTable = AllocateZeroPool (HASH_TABLE_MIN_SIZE * sizeof (FAT_DIRENT *));
+  if ((ODir->LongNameHashTable == NULL) || (ODir->ShortNameHashTable == NULL)) {
+    FatFreeHashTable (ODir);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ODir->HashTableMask  = HASH_TABLE_MIN_SIZE - 1;
+  ODir->HashEntryCount = 0;
+  ODir->DirCacheSize  += 2 * HASH_TABLE_MIN_SIZE * sizeof (FAT_DIRENT *);
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Free the hash tables of the directory.
+
+  @param  ODir                  - The directory.
+
+**/
+VOID
+FatFreeHashTable (
+  IN FAT_ODIR  *ODir
+  )
+{
+  if (ODir->LongNameHashTable != NULL) {
+    FreePool (ODir->LongNameHashTable);
+    ODir->LongNameHashTable = NULL;
+  }
+
+  if (ODir->ShortNameHashTable != NULL) {
+    FreePool (ODir->ShortNameHashTable);
+    ODir->ShortNameHashTable = NULL;
+  }
+}
+
+/**
+
+  Double the number of buckets of the hash tables of the directory, and move the
+  directory entries to their new buckets using the hash values cached in them.
+  The tables are left as they are if the memory can not be allocated.
+
+  @param  ODir                  - The directory.
+
+**/
+STATIC
+VOID
+FatGrowHashTable (
+  IN FAT_ODIR  *ODir
+  )
+{
+  FAT_DIRENT  **LongNameHashTable;
+  FAT_DIRENT  **ShortNameHashTable;
+  FAT_DIRENT  *DirEnt;
+  FAT_DIRENT  *NextDirEnt;
+  UINT32      NewMask;
+  UINT32      Index;
+  UINT32      NewIndex;
+
+  NewMask            = ODir->HashTableMask * 2 + 1;
+  LongNameHashTable  = AllocateZeroPool ((NewMask + 1) * sizeof (FAT_DIRENT *));
+  ShortNameHashTable = AllocateZeroPool ((NewMask + 1) * sizeof (FAT_DIRENT *));
+  if ((LongNameHashTable == NULL) || (ShortNameHashTable == NULL)) {
+    if (LongNameHashTable != NULL) {
+      FreePool (LongNameHashTable);
+    }
+
+    if (ShortNameHashTable != NULL) {
+      FreePool (ShortNameHashTable);
+    }
+
+    return;
+  }
+
+  for (Index = 0; Index <= ODir->HashTableMask; Index++) {
+    for (DirEnt = ODir->LongNameHashTable[Index]; DirEnt != NULL; DirEnt = NextDirEnt) {
+      NextDirEnt                  = DirEnt->LongNameForwardLink;
+      NewIndex                    = DirEnt->LongNameHash & NewMask;
+      DirEnt->LongNameForwardLink = LongNameHashTable[NewIndex];
+      LongNameHashTable[NewIndex] = DirEnt;
+    }
+
+    for (DirEnt = ODir->ShortNameHashTable[Index]; DirEnt != NULL; DirEnt = NextDirEnt) {
+      NextDirEnt                   = DirEnt->ShortNameForwardLink;
+      NewIndex                     = DirEnt->ShortNameHash & NewMask;
+      DirEnt->ShortNameForwardLink = ShortNameHashTable[NewIndex];
+      ShortNameHashTable[NewIndex] = DirEnt;
+    }
+  }
+
+  FatFreeHashTable (ODir);
+  ODir->DirCacheSize      += 2 * (NewMask - ODir->HashTableMask) * sizeof (FAT_DIRENT *);
+  ODir->LongNameHashTable  = LongNameHashTable;
+  ODir->ShortNameHashTable = ShortNameHashTable;
+  ODir->HashTableMask      = NewMask;
 }
 
 /**
@@ -76,7 +183,7 @@ FatLongNameHashSearch (
 {
   FAT_DIRENT  **PreviousHashNode;
 
-  for (PreviousHashNode   = &ODir->LongNameHashTable[FatHashLongName (LongNameString)];
+  for (PreviousHashNode   = &ODir->LongNameHashTable[FatHashLongName (LongNameString) & ODir->HashTableMask];
        *PreviousHashNode != NULL;
        PreviousHashNode   = &(*PreviousHashNode)->LongNameForwardLink
        )
@@ -107,7 +214,7 @@ FatShortNameHashSearch (
 {
   FAT_DIRENT  **PreviousHashNode;
 
-  for (PreviousHashNode   = &ODir->ShortNameHashTable[FatHashShortName (ShortNameString)];
+  for (PreviousHashNode   = &ODir->ShortNameHashTable[FatHashShortName (ShortNameString) & ODir->HashTableMask];
        *PreviousHashNode != NULL;
        PreviousHashNode   = &(*PreviousHashNode)->ShortNameForwardLink
        )
@@ -123,6 +230,8 @@ FatShortNameHashSearch (
 /**
 
   Insert directory entry to hash table.
+  The hash values of the names are cached in the directory entry, and the hash
+  tables grow as the directory fills up.
 
   @param  ODir                  - The parent directory.
   @param  DirEnt                - The directory entry node.
@@ -140,22 +249,32 @@ FatInsertToHashTable (
   //
   // Insert hash table index for short name
   //
-  HashTableIndex               = FatHashShortName (DirEnt->Entry.FileName);
+  DirEnt->ShortNameHash        = FatHashShortName (DirEnt->Entry.FileName);
+  HashTableIndex               = DirEnt->ShortNameHash & ODir->HashTableMask;
   HashTable                    = ODir->ShortNameHashTable;
   DirEnt->ShortNameForwardLink = HashTable[HashTableIndex];
   HashTable[HashTableIndex]    = DirEnt;
   //
   // Insert hash table index for long name
   //
-  HashTableIndex              = FatHashLongName (DirEnt->FileString);
+  DirEnt->LongNameHash        = FatHashLongName (DirEnt->FileString);
+  HashTableIndex              = DirEnt->LongNameHash & ODir->HashTableMask;
   HashTable                   = ODir->LongNameHashTable;
   DirEnt->LongNameForwardLink = HashTable[HashTableIndex];
   HashTable[HashTableIndex]   = DirEnt;
+
+  ODir->HashEntryCount++;
+  if ((ODir->HashEntryCount > (ODir->HashTableMask + 1) * HASH_TABLE_MAX_LOAD) &&
+      (ODir->HashTableMask + 1 < HASH_TABLE_MAX_SIZE))
+  {
+    FatGrowHashTable (ODir);
+  }
 }
 
 /**
 
   Delete directory entry from hash table.
+  The buckets are found with the hash values cached in the directory entry.
 
   @param  ODir                  - The parent directory.
   @param  DirEnt                - The directory entry node.
@@ -167,6 +286,24 @@ FatDeleteFromHashTable (
   IN FAT_DIRENT  *DirEnt
   )
 {
-  *FatShortNameHashSearch (ODir, DirEnt->Entry.FileName) = DirEnt->ShortNameForwardLink;
-  *FatLongNameHashSearch (ODir, DirEnt->FileString)      = DirEnt->LongNameForwardLink;
+  FAT_DIRENT  **PreviousHashNode;
+
+  PreviousHashNode = &ODir->ShortNameHashTable[DirEnt->ShortNameHash & ODir->HashTableMask];
+  while (*PreviousHashNode != DirEnt) {
+    ASSERT (*PreviousHashNode != NULL);
+    PreviousHashNode = &(*PreviousHashNode)->ShortNameForwardLink;
+  }
+
+  *PreviousHashNode = DirEnt->ShortNameForwardLink;
+
+  PreviousHashNode = &ODir->LongNameHashTable[DirEnt->LongNameHash & ODir->HashTableMask];
+  while (*PreviousHashNode != DirEnt) {
+    ASSERT (*PreviousHashNode != NULL);
+    PreviousHashNode = &(*PreviousHashNode)->LongNameForwardLink;
+  }
+
+  *PreviousHashNode = DirEnt->LongNameForwardLink;
+
+  ASSERT (ODir->HashEntryCount > 0);
+  ODir->HashEntryCount--;
 }
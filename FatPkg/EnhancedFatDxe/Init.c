@@ -33,6 +33,7 @@ FatAllocateVolume (
 {
   EFI_STATUS  Status;
   FAT_VOLUME  *Volume;
+  UINTN       Index;
 
   //
   // Allocate a volume structure
@@ -56,6 +57,10 @@ FatAllocateVolume (
   Volume->VolumeInterface.OpenVolume = FatOpenVolume;
   InitializeListHead (&Volume->CheckRef);
   InitializeListHead (&Volume->DirCacheList);
+  for (Index = 0; Index < FAT_DIR_CACHE_HASH_SIZE; Index++) {
+    InitializeListHead (&Volume->DirCacheHashTable[Index]);
+  }
+
   //
   // Initialize Root Directory entry
   //
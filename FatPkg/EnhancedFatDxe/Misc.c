@@ -61,28 +61,11 @@ FatDestroyTask (
     Link    = FatDestroySubtask (Subtask);
   }
 
-  FreePool (Task);
-}
-
-/**
-
-  Wait all non-blocking requests complete.
-
-  @param  IFile                 - The instance of the open file.
-
-**/
-VOID
-FatWaitNonblockingTask (
-  FAT_IFILE  *IFile
-  )
-{
-  BOOLEAN  TaskQueueEmpty;
+  if (Task->SubmitEvent != NULL) {
+    gBS->CloseEvent (Task->SubmitEvent);
+  }
 
-  do {
-    EfiAcquireLock (&FatTaskLock);
-    TaskQueueEmpty = IsListEmpty (&IFile->Tasks);
-    EfiReleaseLock (&FatTaskLock);
-  } while (!TaskQueueEmpty);
+  FreePool (Task);
 }
 
 /**
@@ -109,10 +92,239 @@ FatDestroySubtask (
   return Link;
 }
 
+/**
+
+  Submit the pending subtasks of the task to DiskIo2, in list order, until
+  FAT_ASYNC_QUEUE_DEPTH subtasks of the task are outstanding.
+  The caller must hold FatTaskLock. The lock is released around each DiskIo2
+  call, so that DiskIo2 is not called at the TPL of FatTaskLock. Task->Submitting
+  keeps the completion callbacks from freeing the task meanwhile, and makes a
+  nested call for the same task return at once.
+
+  @param  Volume                - FAT file system volume.
+  @param  Task                  - The task whose subtasks are submitted.
+
+  @retval EFI_SUCCESS           - The subtasks were submitted successfully.
+  @return other                 - An error occurred when submitting a subtask. The failed subtask
+                                  and the subtasks after it are still pending in the list.
+
+**/
+STATIC
+EFI_STATUS
+FatSubmitSubtasks (
+  IN FAT_VOLUME  *Volume,
+  IN FAT_TASK    *Task
+  )
+{
+  EFI_STATUS   Status;
+  LIST_ENTRY   *Link;
+  FAT_SUBTASK  *Subtask;
+
+  if (Task->Submitting) {
+    return EFI_SUCCESS;
+  }
+
+  Status           = EFI_SUCCESS;
+  Task->Submitting = TRUE;
+  while ((Task->FileIoToken != NULL) && (Task->Outstanding < FAT_ASYNC_QUEUE_DEPTH)) {
+    Subtask = NULL;
+    for (Link = GetFirstNode (&Task->Subtasks); Link != &Task->Subtasks; Link = Link->ForwardLink) {
+      Subtask = CR (Link, FAT_SUBTASK, Link, FAT_SUBTASK_SIGNATURE);
+      if (!Subtask->Submitted) {
+        break;
+      }
+
+      Subtask = NULL;
+    }
+
+    if (Subtask == NULL) {
+      break;
+    }
+
+    //
+    // Account for the subtask before the lock is released, its completion
+    // callback may run before the submission returns.
+    //
+    Subtask->Submitted = TRUE;
+    Task->Outstanding++;
+    EfiReleaseLock (&FatTaskLock);
+
+    if (Subtask->Write) {
+      Status = Volume->DiskIo2->WriteDiskEx (
+                                  Volume->DiskIo2,
+                                  Volume->MediaId,
+                                  Subtask->Offset,
+                                  &Subtask->DiskIo2Token,
+                                  Subtask->BufferSize,
+                                  Subtask->Buffer
+                                  );
+    } else {
+      Status = Volume->DiskIo2->ReadDiskEx (
+                                  Volume->DiskIo2,
+                                  Volume->MediaId,
+                                  Subtask->Offset,
+                                  &Subtask->DiskIo2Token,
+                                  Subtask->BufferSize,
+                                  Subtask->Buffer
+                                  );
+    }
+
+    EfiAcquireLock (&FatTaskLock);
+    if (EFI_ERROR (Status)) {
+      //
+      // A failed submission never signals the token, so the subtask is still in the list.
+      //
+      Subtask->Submitted = FALSE;
+      Task->Outstanding--;
+      break;
+    }
+  }
+
+  Task->Submitting = FALSE;
+  return Status;
+}
+
+/**
+
+  Remove the subtasks of the task that have not been submitted yet.
+
+  @param  Task                  - The task.
+
+**/
+STATIC
+VOID
+FatDestroyPendingSubtasks (
+  IN FAT_TASK  *Task
+  )
+{
+  LIST_ENTRY   *Link;
+  FAT_SUBTASK  *Subtask;
+
+  Link = GetFirstNode (&Task->Subtasks);
+  while (Link != &Task->Subtasks) {
+    Subtask = CR (Link, FAT_SUBTASK, Link, FAT_SUBTASK_SIGNATURE);
+    if (Subtask->Submitted) {
+      Link = Link->ForwardLink;
+    } else {
+      Link = FatDestroySubtask (Subtask);
+    }
+  }
+}
+
+/**
+
+  Free the task once it has no subtasks left.
+  The caller must hold FatTaskLock.
+
+  @param  Task                  - The task.
+
+**/
+STATIC
+VOID
+FatFreeTaskIfDone (
+  IN FAT_TASK  *Task
+  )
+{
+  if (IsListEmpty (&Task->Subtasks) && !Task->Submitting) {
+    RemoveEntryList (&Task->Link);
+    FatDestroyTask (Task);
+  }
+}
+
+/**
+
+  Submit the pending subtasks of a queued task. If a submission fails, the task
+  is completed with the error and its pending subtasks are dropped.
+  The caller must hold FatTaskLock.
+
+  @param  Task                  - The task.
+
+**/
+STATIC
+VOID
+FatResumeTask (
+  IN FAT_TASK  *Task
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = FatSubmitSubtasks (Task->IFile->OFile->Volume, Task);
+  if (EFI_ERROR (Status) && (Task->FileIoToken != NULL)) {
+    Task->FileIoToken->Status = Status;
+    gBS->SignalEvent (Task->FileIoToken->Event);
+    Task->FileIoToken = NULL;
+  }
+
+  if (Task->FileIoToken == NULL) {
+    FatDestroyPendingSubtasks (Task);
+  }
+
+  FatFreeTaskIfDone (Task);
+}
+
+/**
+  Submit the pending subtasks of a task after some of its subtasks completed.
+
+  @param  Event                 Event whose notification function is being invoked.
+  @param  Context               The task.
+
+**/
+STATIC
+VOID
+EFIAPI
+FatOnSubmitSubtasks (
+  IN  EFI_EVENT  Event,
+  IN  VOID       *Context
+  )
+{
+  FAT_TASK  *Task;
+
+  Task = (FAT_TASK *)Context;
+  ASSERT (Task->Signature == FAT_TASK_SIGNATURE);
+
+  EfiAcquireLock (&FatTaskLock);
+  FatResumeTask (Task);
+  EfiReleaseLock (&FatTaskLock);
+}
+
+/**
+
+  Wait all non-blocking requests complete.
+
+  @param  IFile                 - The instance of the open file.
+
+**/
+VOID
+FatWaitNonblockingTask (
+  FAT_IFILE  *IFile
+  )
+{
+  BOOLEAN  TaskQueueEmpty;
+
+  do {
+    EfiAcquireLock (&FatTaskLock);
+    TaskQueueEmpty = IsListEmpty (&IFile->Tasks);
+    if (!TaskQueueEmpty) {
+      //
+      // The submit event of the task cannot run if the caller is at TPL_CALLBACK
+      // already, so submit the pending subtasks from here as well.
+      //
+      FatResumeTask (CR (GetFirstNode (&IFile->Tasks), FAT_TASK, Link, FAT_TASK_SIGNATURE));
+    }
+
+    EfiReleaseLock (&FatTaskLock);
+  } while (!TaskQueueEmpty);
+}
+
 /**
 
   Execute the task.
 
+  The subtasks are submitted to DiskIo2 in order, with at most FAT_ASYNC_QUEUE_DEPTH
+  of them outstanding at a time. Each completion signals the submit event of the
+  task, which submits the next pending subtasks at TPL_CALLBACK, so that the device
+  keeps seeing concurrent requests until the task is done.
+
   @param  IFile                 - The instance of the open file.
   @param  Task                  - The task to be executed.
 
@@ -126,10 +338,7 @@ FatQueueTask (
   IN FAT_TASK   *Task
   )
 {
-  EFI_STATUS   Status;
-  LIST_ENTRY   *Link;
-  LIST_ENTRY   *NextLink;
-  FAT_SUBTASK  *Subtask;
+  EFI_STATUS  Status;
 
   //
   // Sometimes the Task doesn't contain any subtasks, signal the event directly.
@@ -141,76 +350,43 @@ FatQueueTask (
     return EFI_SUCCESS;
   }
 
+  Status = gBS->CreateEvent (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  FatOnSubmitSubtasks,
+                  Task,
+                  &Task->SubmitEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    FatDestroyTask (Task);
+    return Status;
+  }
+
   EfiAcquireLock (&FatTaskLock);
   InsertTailList (&IFile->Tasks, &Task->Link);
-  EfiReleaseLock (&FatTaskLock);
 
-  Status = EFI_SUCCESS;
-  //
-  // Use NextLink to store the next link of the list, because Link might be remove from the
-  // doubly-linked list and get freed in the end of current loop.
   //
-  // Also, list operation APIs like IsNull() and GetNextNode() are avoided during the loop, since
-  // they may check the validity of doubly-linked lists by traversing them. These APIs cannot
-  // handle list elements being removed during the traverse.
+  // FatSubmitSubtasks () releases the lock around the DiskIo2 calls.
   //
-  for ( Link = GetFirstNode (&Task->Subtasks), NextLink = GetNextNode (&Task->Subtasks, Link)
-        ; Link != &Task->Subtasks
-        ; Link = NextLink, NextLink = Link->ForwardLink
-        )
-  {
-    Subtask = CR (Link, FAT_SUBTASK, Link, FAT_SUBTASK_SIGNATURE);
-    if (Subtask->Write) {
-      Status = IFile->OFile->Volume->DiskIo2->WriteDiskEx (
-                                                IFile->OFile->Volume->DiskIo2,
-                                                IFile->OFile->Volume->MediaId,
-                                                Subtask->Offset,
-                                                &Subtask->DiskIo2Token,
-                                                Subtask->BufferSize,
-                                                Subtask->Buffer
-                                                );
-    } else {
-      Status = IFile->OFile->Volume->DiskIo2->ReadDiskEx (
-                                                IFile->OFile->Volume->DiskIo2,
-                                                IFile->OFile->Volume->MediaId,
-                                                Subtask->Offset,
-                                                &Subtask->DiskIo2Token,
-                                                Subtask->BufferSize,
-                                                Subtask->Buffer
-                                                );
-    }
-
-    if (EFI_ERROR (Status)) {
-      break;
-    }
-  }
-
+  Status = FatSubmitSubtasks (IFile->OFile->Volume, Task);
   if (EFI_ERROR (Status)) {
-    EfiAcquireLock (&FatTaskLock);
     //
     // Remove all the remaining subtasks when failure.
     // We shouldn't remove all the tasks because the non-blocking requests have
     // been submitted and cannot be canceled.
     //
-    while (!IsNull (&Task->Subtasks, Link)) {
-      Subtask = CR (Link, FAT_SUBTASK, Link, FAT_SUBTASK_SIGNATURE);
-      Link    = FatDestroySubtask (Subtask);
-    }
+    FatDestroyPendingSubtasks (Task);
 
-    if (IsListEmpty (&Task->Subtasks)) {
-      RemoveEntryList (&Task->Link);
-      FreePool (Task);
-    } else {
-      //
-      // If one or more subtasks have been already submitted, set FileIoToken
-      // to NULL so that the callback won't signal the event.
-      //
-      Task->FileIoToken = NULL;
-    }
-
-    EfiReleaseLock (&FatTaskLock);
+    //
+    // If one or more subtasks have been already submitted, set FileIoToken
+    // to NULL so that the callback won't signal the event.
+    //
+    Task->FileIoToken = NULL;
   }
 
+  FatFreeTaskIfDone (Task);
+  EfiReleaseLock (&FatTaskLock);
+
   return Status;
 }
 
@@ -269,11 +445,23 @@ FatOnAccessComplete (
 
   ASSERT (Task->Signature    == FAT_TASK_SIGNATURE);
   ASSERT (Subtask->Signature == FAT_SUBTASK_SIGNATURE);
+  ASSERT (Subtask->Submitted);
 
   //
   // Remove the task unconditionally
   //
   FatDestroySubtask (Subtask);
+  Task->Outstanding--;
+
+  //
+  // Drop the pending subtasks once the task has failed. Otherwise let the submit
+  // event of the task submit them, DiskIo2 is not called at this TPL.
+  //
+  if ((Task->FileIoToken == NULL) || EFI_ERROR (Status)) {
+    FatDestroyPendingSubtasks (Task);
+  } else if (!IsListEmpty (&Task->Subtasks) && (Task->Outstanding < FAT_ASYNC_QUEUE_DEPTH)) {
+    gBS->SignalEvent (Task->SubmitEvent);
+  }
 
   //
   // Task->FileIoToken is NULL which means the task will be ignored (just recycle the subtask and task memory).
@@ -289,10 +477,7 @@ FatOnAccessComplete (
     }
   }
 
-  if (IsListEmpty (&Task->Subtasks)) {
-    RemoveEntryList (&Task->Link);
-    FreePool (Task);
-  }
+  FatFreeTaskIfDone (Task);
 }
 
 /**
@@ -325,6 +510,7 @@ FatDiskIo (
   EFI_DISK_IO_PROTOCOL  *DiskIo;
   EFI_DISK_READ         IoFunction;
   FAT_SUBTASK           *Subtask;
+  UINTN                 Length;
 
   //
   // Verify the IO is in devices range
@@ -350,17 +536,23 @@ FatDiskIo (
       } else {
         //
         // Non-blocking access
+        // Large transfers are split, so that several subtasks of the
+        // transfer can be outstanding at the same time.
         //
-        Subtask = AllocateZeroPool (sizeof (*Subtask));
-        if (Subtask == NULL) {
-          Status = EFI_OUT_OF_RESOURCES;
-        } else {
+        do {
+          Length  = MIN (BufferSize, FAT_ASYNC_SUBTASK_MAX_SIZE);
+          Subtask = AllocateZeroPool (sizeof (*Subtask));
+          if (Subtask == NULL) {
+            Status = EFI_OUT_OF_RESOURCES;
+            break;
+          }
+
           Subtask->Signature  = FAT_SUBTASK_SIGNATURE;
           Subtask->Task       = Task;
           Subtask->Write      = (BOOLEAN)(IoMode == WriteDisk);
           Subtask->Offset     = Offset;
           Subtask->Buffer     = Buffer;
-          Subtask->BufferSize = BufferSize;
+          Subtask->BufferSize = Length;
           Status              = gBS->CreateEvent (
                                        EVT_NOTIFY_SIGNAL,
                                        TPL_NOTIFY,
@@ -368,12 +560,16 @@ FatDiskIo (
                                        Subtask,
                                        &Subtask->DiskIo2Token.Event
                                        );
-          if (!EFI_ERROR (Status)) {
-            InsertTailList (&Task->Subtasks, &Subtask->Link);
-          } else {
+          if (EFI_ERROR (Status)) {
             FreePool (Subtask);
+            break;
           }
-        }
+
+          InsertTailList (&Task->Subtasks, &Subtask->Link);
+          Offset     += Length;
+          Buffer      = (UINT8 *)Buffer + Length;
+          BufferSize -= Length;
+        } while (BufferSize > 0);
       }
     }
   }
@@ -465,9 +661,24 @@ FatFreeVolume (
   // Free disk cache
   //
   if (Volume->CacheBuffer != NULL) {
+    FatLogCacheStatistics (Volume);
     FreePool (Volume->CacheBuffer);
   }
 
+  //
+  // Free the zero buffer
+  //
+  if (Volume->ZeroBuffer != NULL) {
+    FreePool (Volume->ZeroBuffer);
+  }
+
+  //
+  // Free the free cluster bitmap
+  //
+  if (Volume->FreeBitmap != NULL) {
+    FreePool (Volume->FreeBitmap);
+  }
+
   //
   // Free directory cache
   //
@@ -527,7 +527,7 @@ FatAccessOFile (
   Expand OFile by appending zero bytes at the end of OFile.
 
   @param  OFile                 - The open file.
-  @param  ExpandedSize          - The number of zero bytes appended at the end of the file.
+  @param  ExpandedSize          - The new size of the file.
 
   @retval EFI_SUCCESS           - The file is expanded successfully.
   @return other                 - An error occurred when expanding file.
@@ -553,12 +553,17 @@ FatExpandOFile (
 
 /**
 
-  Write zero pool from the WritePos to the end of OFile.
+  Write zero bytes from the WritePos to the end of OFile.
 
-  @param  OFile                 - The open file to write zero pool.
-  @param  WritePos              - The number of zero bytes written.
+  The bytes are written from the zero buffer of the volume, a buffer at a time.
+  Each write is split at the cluster run boundaries by FatAccessOFile (), and only
+  the partial cache pages at both ends of a run go through the data cache, the
+  rest is written to the disk directly.
 
-  @retval EFI_SUCCESS           - Write the zero pool successfully.
+  @param  OFile                 - The open file to write zero bytes.
+  @param  WritePos              - The position to start writing zero bytes at.
+
+  @retval EFI_SUCCESS           - Write the zero bytes successfully.
   @retval EFI_OUT_OF_RESOURCES  - Not enough memory to perform the operation.
   @return other                 - An error occurred when writing disk.
 
@@ -570,40 +575,33 @@ FatWriteZeroPool (
   )
 {
   EFI_STATUS  Status;
-  VOID        *ZeroBuffer;
-  UINTN       AppendedSize;
-  UINTN       BufferSize;
+  FAT_VOLUME  *Volume;
+  UINTN       EndPos;
   UINTN       WriteSize;
 
-  AppendedSize = OFile->FileSize - WritePos;
-  BufferSize   = AppendedSize;
-  if (AppendedSize > FAT_MAX_ALLOCATE_SIZE) {
-    //
-    // If the appended size is larger, maybe we can not allocate the whole
-    // memory once. So if the growed size is larger than 10M, we just
-    // allocate 10M memory (one healthy system should have 10M available
-    // memory), and then write the zerobuffer to the file several times.
-    //
-    BufferSize = FAT_MAX_ALLOCATE_SIZE;
+  Volume = OFile->Volume;
+  EndPos = OFile->FileSize;
+  if (WritePos >= EndPos) {
+    return EFI_SUCCESS;
   }
 
-  ZeroBuffer = AllocateZeroPool (BufferSize);
-  if (ZeroBuffer == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  if (Volume->ZeroBuffer == NULL) {
+    Volume->ZeroBuffer = AllocateZeroPool (FAT_ZERO_BUFFER_SIZE);
+    if (Volume->ZeroBuffer == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
   }
 
   do {
-    WriteSize     = AppendedSize > BufferSize ? BufferSize : (UINTN)AppendedSize;
-    AppendedSize -= WriteSize;
-    Status        = FatAccessOFile (OFile, WriteData, WritePos, &WriteSize, ZeroBuffer, NULL);
+    WriteSize = MIN (EndPos - WritePos, FAT_ZERO_BUFFER_SIZE);
+    Status    = FatAccessOFile (OFile, WriteData, WritePos, &WriteSize, Volume->ZeroBuffer, NULL);
     if (EFI_ERROR (Status)) {
       break;
     }
 
     WritePos += WriteSize;
-  } while (AppendedSize > 0);
+  } while (WritePos < EndPos);
 
-  FreePool (ZeroBuffer);
   return Status;
 }
 
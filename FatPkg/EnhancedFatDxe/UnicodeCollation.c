@@ -152,6 +152,7 @@ InitializeUnicodeCollationSupport (
 
 /**
   Performs a case-insensitive comparison of two Null-terminated Unicode strings.
+  The comparison is done locally as long as it is decided by ASCII characters.
 
   @param  S1                   A pointer to a Null-terminated Unicode string.
   @param  S2                   A pointer to a Null-terminated Unicode string.
@@ -166,10 +167,16 @@ FatStriCmp (
   IN CHAR16  *S2
   )
 {
+  INTN  Result;
+
   ASSERT (StrSize (S1) != 0);
   ASSERT (StrSize (S2) != 0);
   ASSERT (mUnicodeCollationInterface != NULL);
 
+  if (FatAsciiStriCmp (S1, S2, &Result)) {
+    return Result;
+  }
+
   return mUnicodeCollationInterface->StriColl (
                                        mUnicodeCollationInterface,
                                        S1,
@@ -179,6 +186,7 @@ FatStriCmp (
 
 /**
   Uppercase a string.
+  ASCII strings are upper-cased locally.
 
   @param  String                   The string which will be upper-cased.
 
@@ -192,11 +200,14 @@ FatStrUpr (
   ASSERT (StrSize (String) != 0);
   ASSERT (mUnicodeCollationInterface != NULL);
 
-  mUnicodeCollationInterface->StrUpr (mUnicodeCollationInterface, String);
+  if (!FatAsciiStrUpr (String)) {
+    mUnicodeCollationInterface->StrUpr (mUnicodeCollationInterface, String);
+  }
 }
 
 /**
   Lowercase a string
+  ASCII strings are lower-cased locally.
 
   @param  String                   The string which will be lower-cased.
 
@@ -210,7 +221,9 @@ FatStrLwr (
   ASSERT (StrSize (String) != 0);
   ASSERT (mUnicodeCollationInterface != NULL);
 
-  mUnicodeCollationInterface->StrLwr (mUnicodeCollationInterface, String);
+  if (!FatAsciiStrLwr (String)) {
+    mUnicodeCollationInterface->StrLwr (mUnicodeCollationInterface, String);
+  }
 }
 
 /**
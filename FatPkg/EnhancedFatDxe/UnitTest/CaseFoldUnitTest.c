@@ -0,0 +1,451 @@
+/** @file
+  Unit tests proving that the ASCII fast paths of CaseFold.c give the same
+  results as the Unicode Collation protocol path they bypass.
+
+  The reference folding below follows the English Unicode Collation driver,
+  which maps 'a'-'z' and the Latin-1 letters 0xE0-0xFE (except 0xF7) to upper
+  case, and back.
+
+  Copyright (c) Microsoft Corporation.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include "../Fat.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_NAME     "EnhancedFatDxe Case Fold Unit Tests"
+#define UNIT_TEST_VERSION  "1.0"
+
+#define TEST_ITERATIONS  20000
+#define TEST_MAX_LENGTH  40
+
+//
+// Characters picked by the random strings. The first TEST_ASCII_CHAR_COUNT ones are
+// ASCII, and cover the boundaries of the letter ranges.
+//
+STATIC CONST CHAR16  mTestChars[] = {
+  L'a', L'z', L'A', L'Z', L'@', L'[', L'`', L'{', L'0', L' ', L'.', L'~', 0x7F, L'm', L'M', L'_',
+  0xC9, 0xD7, 0xE9, 0xF7, 0xFF, 0x100, 0x3A9, 0x3C9
+};
+
+#define TEST_ASCII_CHAR_COUNT  16
+
+STATIC UINT32  mSeed;
+
+/**
+  Deterministic pseudo random number generator.
+
+  @return A pseudo random number.
+**/
+STATIC
+UINT32
+TestRandom (
+  VOID
+  )
+{
+  mSeed = mSeed * 1103515245 + 12345;
+  return mSeed >> 8;
+}
+
+/**
+  Upper case a character the way the English Unicode Collation driver does.
+
+  @param[in] Char  The character.
+
+  @return The upper cased character.
+**/
+STATIC
+CHAR16
+RefToUpper (
+  IN CHAR16  Char
+  )
+{
+  if (((Char >= L'a') && (Char <= L'z')) || ((Char >= 0xE0) && (Char <= 0xFE) && (Char != 0xF7))) {
+    return (CHAR16)(Char - 0x20);
+  }
+
+  return Char;
+}
+
+/**
+  Lower case a character the way the English Unicode Collation driver does.
+
+  @param[in] Char  The character.
+
+  @return The lower cased character.
+**/
+STATIC
+CHAR16
+RefToLower (
+  IN CHAR16  Char
+  )
+{
+  if (((Char >= L'A') && (Char <= L'Z')) || ((Char >= 0xC0) && (Char <= 0xDE) && (Char != 0xD7))) {
+    return (CHAR16)(Char + 0x20);
+  }
+
+  return Char;
+}
+
+/**
+  Case insensitive comparison the way the English Unicode Collation driver does.
+
+  @param[in] S1  A pointer to a Null-terminated Unicode string.
+  @param[in] S2  A pointer to a Null-terminated Unicode string.
+
+  @return The difference of the first upper cased characters that differ.
+**/
+STATIC
+INTN
+RefStriColl (
+  IN CHAR16  *S1,
+  IN CHAR16  *S2
+  )
+{
+  while ((*S1 != 0) && (RefToUpper (*S1) == RefToUpper (*S2))) {
+    S1++;
+    S2++;
+  }
+
+  return (INTN)RefToUpper (*S1) - (INTN)RefToUpper (*S2);
+}
+
+/**
+  Bitwise CRC32, as computed by the CalculateCrc32 boot service.
+
+  @param[in] Buffer  The data.
+  @param[in] Size    The size of the data in bytes.
+
+  @return The CRC32 of the data.
+**/
+STATIC
+UINT32
+RefCrc32 (
+  IN VOID   *Buffer,
+  IN UINTN  Size
+  )
+{
+  UINT8   *Data;
+  UINT32  Crc;
+  UINTN   Bit;
+
+  Data = Buffer;
+  Crc  = 0xFFFFFFFF;
+  while (Size-- != 0) {
+    Crc ^= *Data++;
+    for (Bit = 0; Bit < 8; Bit++) {
+      Crc = (Crc >> 1) ^ ((Crc & 1) != 0 ? 0xEDB88320 : 0);
+    }
+  }
+
+  return Crc ^ 0xFFFFFFFF;
+}
+
+/**
+  Generate a random string.
+
+  @param[out] String     The buffer of TEST_MAX_LENGTH + 1 characters receiving the string.
+  @param[in]  AsciiOnly  TRUE to only pick ASCII characters.
+
+  @return The length of the string.
+**/
+STATIC
+UINTN
+RandomString (
+  OUT CHAR16   *String,
+  IN  BOOLEAN  AsciiOnly
+  )
+{
+  UINTN  Length;
+  UINTN  Index;
+
+  Length = TestRandom () % (TEST_MAX_LENGTH + 1);
+  for (Index = 0; Index < Length; Index++) {
+    String[Index] = mTestChars[TestRandom () % (AsciiOnly ? TEST_ASCII_CHAR_COUNT : ARRAY_SIZE (mTestChars))];
+  }
+
+  String[Length] = 0;
+  return Length;
+}
+
+/**
+  Check that the ASCII fast paths fold every ASCII character like the protocol.
+
+  @param[in] Context  The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestAsciiCharacters (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CHAR16  Char;
+  CHAR16  String[2];
+
+  for (Char = 1; Char < 0x100; Char++) {
+    String[0] = Char;
+    String[1] = 0;
+    UT_ASSERT_EQUAL (FatAsciiStrUpr (String), Char < 0x80);
+    if (Char < 0x80) {
+      UT_ASSERT_EQUAL (String[0], RefToUpper (Char));
+    }
+
+    String[0] = Char;
+    UT_ASSERT_EQUAL (FatAsciiStrLwr (String), Char < 0x80);
+    if (Char < 0x80) {
+      UT_ASSERT_EQUAL (String[0], RefToLower (Char));
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that FatStrUpr and FatStrLwr give the protocol results on random strings,
+  including unaligned ones. A string rejected by the fast path is completed with
+  the reference folding, as FatStrUpr and FatStrLwr do with the protocol.
+
+  @param[in] Context  The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestStrUprStrLwr (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CHAR16   Original[TEST_MAX_LENGTH + 1];
+  CHAR16   Expected[TEST_MAX_LENGTH + 1];
+  CHAR16   Buffer[TEST_MAX_LENGTH + 2];
+  CHAR16   *String;
+  UINTN    Length;
+  UINTN    Index;
+  UINTN    Iteration;
+  BOOLEAN  Ascii;
+
+  mSeed = 1;
+  for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+    Length = RandomString (Original, (BOOLEAN)((Iteration & 1) == 0));
+    String = Buffer + (Iteration & 2) / 2;
+    Ascii  = TRUE;
+    for (Index = 0; Index < Length; Index++) {
+      Ascii = (BOOLEAN)(Ascii && (Original[Index] < 0x80));
+    }
+
+    //
+    // Upper case
+    //
+    for (Index = 0; Index <= Length; Index++) {
+      Expected[Index] = RefToUpper (Original[Index]);
+    }
+
+    CopyMem (String, Original, (Length + 1) * sizeof (CHAR16));
+    UT_ASSERT_EQUAL (FatAsciiStrUpr (String), Ascii);
+    if (!Ascii) {
+      for (Index = 0; Index < Length; Index++) {
+        String[Index] = RefToUpper (String[Index]);
+      }
+    }
+
+    UT_ASSERT_MEM_EQUAL (String, Expected, (Length + 1) * sizeof (CHAR16));
+
+    //
+    // Lower case
+    //
+    for (Index = 0; Index <= Length; Index++) {
+      Expected[Index] = RefToLower (Original[Index]);
+    }
+
+    CopyMem (String, Original, (Length + 1) * sizeof (CHAR16));
+    UT_ASSERT_EQUAL (FatAsciiStrLwr (String), Ascii);
+    if (!Ascii) {
+      for (Index = 0; Index < Length; Index++) {
+        String[Index] = RefToLower (String[Index]);
+      }
+    }
+
+    UT_ASSERT_MEM_EQUAL (String, Expected, (Length + 1) * sizeof (CHAR16));
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that FatAsciiStriCmp agrees with the protocol whenever it decides a comparison.
+
+  @param[in] Context  The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestStriCmp (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CHAR16  S1[TEST_MAX_LENGTH + 1];
+  CHAR16  S2[TEST_MAX_LENGTH + 1];
+  UINTN   Length;
+  UINTN   Index;
+  UINTN   Iteration;
+  INTN    Result;
+
+  mSeed = 2;
+  for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+    Length = RandomString (S1, (BOOLEAN)((Iteration & 1) == 0));
+
+    //
+    // Derive S2 from S1 by changing the case of some characters, replacing one
+    // character or truncating it, so that many pairs are equal or nearly equal
+    //
+    CopyMem (S2, S1, sizeof (S1));
+    for (Index = 0; Index < Length; Index++) {
+      if (TestRandom () % 3 == 0) {
+        S2[Index] = (TestRandom () % 2 == 0) ? RefToUpper (S2[Index]) : RefToLower (S2[Index]);
+      }
+    }
+
+    if ((Length != 0) && (TestRandom () % 4 == 0)) {
+      S2[TestRandom () % Length] = mTestChars[TestRandom () % ARRAY_SIZE (mTestChars)];
+    }
+
+    if (TestRandom () % 8 == 0) {
+      S2[TestRandom () % (Length + 1)] = 0;
+    }
+
+    if (FatAsciiStriCmp (S1, S2, &Result)) {
+      UT_ASSERT_EQUAL (Result, RefStriColl (S1, S2));
+    } else {
+      //
+      // Only a non-ASCII character may leave the comparison to the protocol
+      //
+      for (Index = 0; (S1[Index] < 0x80) && (S2[Index] < 0x80); Index++) {
+        UT_ASSERT_TRUE ((S1[Index] != 0) && (RefToUpper (S1[Index]) == RefToUpper (S2[Index])));
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that the long name hash, upper casing through the fast path and the BaseLib
+  CRC32, matches the hash of the protocol upper cased name by the CRC32 boot service.
+
+  @param[in] Context  The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestLongNameHash (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CHAR16  Name[TEST_MAX_LENGTH + 1];
+  CHAR16  Expected[TEST_MAX_LENGTH + 1];
+  UINTN   Length;
+  UINTN   Index;
+  UINTN   Iteration;
+
+  mSeed = 3;
+  for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+    Length = RandomString (Name, (BOOLEAN)((Iteration & 1) == 0));
+    for (Index = 0; Index <= Length; Index++) {
+      Expected[Index] = RefToUpper (Name[Index]);
+    }
+
+    if (!FatAsciiStrUpr (Name)) {
+      for (Index = 0; Index < Length; Index++) {
+        Name[Index] = RefToUpper (Name[Index]);
+      }
+    }
+
+    UT_ASSERT_EQUAL (
+      CalculateCrc32 (Name, (Length + 1) * sizeof (CHAR16)),
+      RefCrc32 (Expected, (Length + 1) * sizeof (CHAR16))
+      );
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the case fold
+  fast paths and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      CaseFoldTestSuite;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in InitUnitTestFramework. Status = %r\n", UNIT_TEST_NAME, Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&CaseFoldTestSuite, Framework, "CaseFoldTestSuite", "FatPkg.EnhancedFatDxe.CaseFold", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in CreateUnitTestSuite for CaseFoldTestSuite\n", UNIT_TEST_NAME));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (CaseFoldTestSuite, "ASCII characters fold like the protocol", "AsciiCharacters", TestAsciiCharacters, NULL, NULL, NULL);
+  AddTestCase (CaseFoldTestSuite, "Strings fold like the protocol", "StrUprStrLwr", TestStrUprStrLwr, NULL, NULL, NULL);
+  AddTestCase (CaseFoldTestSuite, "Case insensitive comparison matches the protocol", "StriCmp", TestStriCmp, NULL, NULL, NULL);
+  AddTestCase (CaseFoldTestSuite, "Long name hash matches the protocol path", "LongNameHash", TestLongNameHash, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define CaseFoldUnitTestMain  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+CaseFoldUnitTestMain (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return (INT32)UefiTestMain ();
+}
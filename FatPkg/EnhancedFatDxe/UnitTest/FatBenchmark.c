@@ -0,0 +1,1254 @@
+/** @file
+  Host based performance benchmark of EnhancedFatDxe.
+
+  Each scenario formats a FAT32 volume on a RAM disk, mounts it with the driver
+  and measures one workload through the EFI_FILE_PROTOCOL interface: sequential
+  and random reads and writes, creating and deleting many files in a directory,
+  walking a deep directory tree and allocating a file on a fragmented volume.
+  Set up work is done before the volume is mounted again, so that every
+  measured workload starts with cold caches.
+
+  The RAM disk counts the DiskIo calls and the bytes they move. Those counts do
+  not depend on the host, and expose regressions of the disk cache, the cluster
+  allocator and the directory code more reliably than the elapsed time.
+
+  Copyright (c) Microsoft Corporation.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include "FatBenchmark.h"
+#include <Library/PrintLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_NAME     "EnhancedFatDxe Host Benchmark"
+#define UNIT_TEST_VERSION  "1.0"
+
+//
+// RAM disk geometry. With one sector per cluster, a 64MB volume is FAT32.
+//
+#define BENCH_BLOCK_SIZE        512
+#define BENCH_DISK_SIZE         SIZE_64MB
+#define BENCH_RESERVED_SECTORS  32
+#define BENCH_FAT_COUNT         2
+#define BENCH_ROOT_CLUSTER      2
+#define BENCH_MEDIA_ID          1
+
+//
+// Workload sizes
+//
+#define BENCH_FILE_SIZE             SIZE_8MB
+#define BENCH_IO_SIZE               SIZE_64KB
+#define BENCH_RANDOM_IO_SIZE        SIZE_4KB
+#define BENCH_RANDOM_IO_COUNT       2048
+#define BENCH_FILE_COUNT            1000
+#define BENCH_TREE_DEPTH            5
+#define BENCH_TREE_FAN_OUT          3
+#define BENCH_TREE_FILES            2
+#define BENCH_FRAGMENT_COUNT        256
+#define BENCH_FRAGMENT_SIZE         SIZE_32KB
+#define BENCH_FRAGMENTED_FILE_SIZE  SIZE_2MB
+#define BENCH_FREE_INFO_QUERIES     1000
+
+#define BENCH_NAME_LENGTH  64
+
+#define BENCH_DISK_SIGNATURE  SIGNATURE_32 ('B', 'D', 'S', 'K')
+
+typedef struct {
+  UINT64    ReadCalls;
+  UINT64    ReadBytes;
+  UINT64    WriteCalls;
+  UINT64    WriteBytes;
+  UINT64    FlushCalls;
+} BENCH_DISK_COUNTERS;
+
+typedef struct {
+  UINT32                   Signature;
+  EFI_DISK_IO_PROTOCOL     DiskIo;
+  EFI_BLOCK_IO_PROTOCOL    BlockIo;
+  EFI_BLOCK_IO_MEDIA       Media;
+  UINT8                    *Buffer;
+  BENCH_DISK_COUNTERS      Counters;
+} BENCH_DISK;
+
+#define BENCH_DISK_FROM_DISK_IO(a)   CR (a, BENCH_DISK, DiskIo, BENCH_DISK_SIGNATURE)
+#define BENCH_DISK_FROM_BLOCK_IO(a)  CR (a, BENCH_DISK, BlockIo, BENCH_DISK_SIGNATURE)
+
+typedef struct {
+  BENCH_DISK           Disk;
+  EFI_FILE_PROTOCOL    *Root;
+  UINT8                *Buffer;
+  UINT64               StartTime;
+} BENCH_CONTEXT;
+
+STATIC BENCH_CONTEXT  mBenchContext;
+STATIC UINT32         mSeed;
+
+/**
+  Deterministic pseudo random number generator.
+
+  @return A pseudo random number.
+**/
+STATIC
+UINT32
+BenchRandom (
+  VOID
+  )
+{
+  mSeed = mSeed * 1103515245 + 12345;
+  return mSeed >> 8;
+}
+
+/**
+  Fill a buffer with the content expected at an offset of a benchmark file.
+
+  @param[out] Buffer  The buffer.
+  @param[in]  Offset  The file offset of the first byte of Buffer.
+  @param[in]  Size    The size of Buffer in bytes.
+**/
+STATIC
+VOID
+BenchFill (
+  OUT UINT8   *Buffer,
+  IN  UINT64  Offset,
+  IN  UINTN   Size
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Size; Index++) {
+    Buffer[Index] = (UINT8)((Offset + Index) ^ RShiftU64 (Offset + Index, 9));
+  }
+}
+
+/**
+  Check that a buffer holds the content expected at an offset of a benchmark file.
+
+  @param[in] Buffer  The buffer.
+  @param[in] Offset  The file offset of the first byte of Buffer.
+  @param[in] Size    The size of Buffer in bytes.
+
+  @retval TRUE   The content is the expected one.
+  @retval FALSE  The content differs.
+**/
+STATIC
+BOOLEAN
+BenchCheck (
+  IN UINT8   *Buffer,
+  IN UINT64  Offset,
+  IN UINTN   Size
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Size; Index++) {
+    if (Buffer[Index] != (UINT8)((Offset + Index) ^ RShiftU64 (Offset + Index, 9))) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Read from the RAM disk.
+
+  @param[in]  This        The DiskIo instance of the RAM disk.
+  @param[in]  MediaId     The media of the RAM disk.
+  @param[in]  Offset      The byte offset to read from.
+  @param[in]  BufferSize  The number of bytes to read.
+  @param[out] Buffer      The buffer to read into.
+
+  @retval EFI_SUCCESS            The data was read.
+  @retval EFI_MEDIA_CHANGED      MediaId is not the one of the RAM disk.
+  @retval EFI_INVALID_PARAMETER  The range is beyond the end of the RAM disk.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+BenchReadDisk (
+  IN  EFI_DISK_IO_PROTOCOL  *This,
+  IN  UINT32                MediaId,
+  IN  UINT64                Offset,
+  IN  UINTN                 BufferSize,
+  OUT VOID                  *Buffer
+  )
+{
+  BENCH_DISK  *Disk;
+
+  Disk = BENCH_DISK_FROM_DISK_IO (This);
+  if (MediaId != Disk->Media.MediaId) {
+    return EFI_MEDIA_CHANGED;
+  }
+
+  if ((Offset > BENCH_DISK_SIZE) || (BufferSize > BENCH_DISK_SIZE - Offset)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Disk->Counters.ReadCalls++;
+  Disk->Counters.ReadBytes += BufferSize;
+  CopyMem (Buffer, Disk->Buffer + Offset, BufferSize);
+  return EFI_SUCCESS;
+}
+
+/**
+  Write to the RAM disk.
+
+  @param[in] This        The DiskIo instance of the RAM disk.
+  @param[in] MediaId     The media of the RAM disk.
+  @param[in] Offset      The byte offset to write to.
+  @param[in] BufferSize  The number of bytes to write.
+  @param[in] Buffer      The buffer to write from.
+
+  @retval EFI_SUCCESS            The data was written.
+  @retval EFI_MEDIA_CHANGED      MediaId is not the one of the RAM disk.
+  @retval EFI_INVALID_PARAMETER  The range is beyond the end of the RAM disk.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+BenchWriteDisk (
+  IN EFI_DISK_IO_PROTOCOL  *This,
+  IN UINT32                MediaId,
+  IN UINT64                Offset,
+  IN UINTN                 BufferSize,
+  IN VOID                  *Buffer
+  )
+{
+  BENCH_DISK  *Disk;
+
+  Disk = BENCH_DISK_FROM_DISK_IO (This);
+  if (MediaId != Disk->Media.MediaId) {
+    return EFI_MEDIA_CHANGED;
+  }
+
+  if ((Offset > BENCH_DISK_SIZE) || (BufferSize > BENCH_DISK_SIZE - Offset)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Disk->Counters.WriteCalls++;
+  Disk->Counters.WriteBytes += BufferSize;
+  CopyMem (Disk->Buffer + Offset, Buffer, BufferSize);
+  return EFI_SUCCESS;
+}
+
+/**
+  Flush the RAM disk, which has no write cache.
+
+  @param[in] This  The BlockIo instance of the RAM disk.
+
+  @retval EFI_SUCCESS  The RAM disk was flushed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+BenchFlushBlocks (
+  IN EFI_BLOCK_IO_PROTOCOL  *This
+  )
+{
+  BENCH_DISK  *Disk;
+
+  Disk = BENCH_DISK_FROM_BLOCK_IO (This);
+  Disk->Counters.FlushCalls++;
+  return EFI_SUCCESS;
+}
+
+/**
+  Create a RAM disk holding an empty FAT32 volume.
+
+  @param[out] Disk  The RAM disk.
+
+  @retval EFI_SUCCESS           The RAM disk was created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the RAM disk.
+**/
+STATIC
+EFI_STATUS
+BenchCreateDisk (
+  OUT BENCH_DISK  *Disk
+  )
+{
+  FAT_BOOT_SECTOR  *BootSector;
+  FAT_INFO_SECTOR  *InfoSector;
+  UINT32           *Fat;
+  UINTN            Sectors;
+  UINTN            SectorsPerFat;
+  UINTN            Clusters;
+  UINTN            Index;
+
+  ZeroMem (Disk, sizeof (BENCH_DISK));
+  Disk->Buffer = AllocateZeroPool (BENCH_DISK_SIZE);
+  if (Disk->Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Disk->Signature           = BENCH_DISK_SIGNATURE;
+  Disk->DiskIo.Revision     = EFI_DISK_IO_PROTOCOL_REVISION;
+  Disk->DiskIo.ReadDisk     = BenchReadDisk;
+  Disk->DiskIo.WriteDisk    = BenchWriteDisk;
+  Disk->BlockIo.Revision    = EFI_BLOCK_IO_PROTOCOL_REVISION;
+  Disk->BlockIo.Media       = &Disk->Media;
+  Disk->BlockIo.FlushBlocks = BenchFlushBlocks;
+  Disk->Media.MediaId       = BENCH_MEDIA_ID;
+  Disk->Media.MediaPresent  = TRUE;
+  Disk->Media.BlockSize     = BENCH_BLOCK_SIZE;
+  Disk->Media.LastBlock     = BENCH_DISK_SIZE / BENCH_BLOCK_SIZE - 1;
+
+  //
+  // Size the FATs the way the FAT specification does for FAT32
+  //
+  Sectors       = BENCH_DISK_SIZE / BENCH_BLOCK_SIZE;
+  SectorsPerFat = (Sectors - BENCH_RESERVED_SECTORS + 128) / 129;
+  Clusters      = Sectors - BENCH_RESERVED_SECTORS - BENCH_FAT_COUNT * SectorsPerFat;
+
+  BootSector                                      = (FAT_BOOT_SECTOR *)Disk->Buffer;
+  BootSector->FatBsb.Ia32Jump[0]                  = 0xEB;
+  BootSector->FatBsb.Ia32Jump[1]                  = 0x58;
+  BootSector->FatBsb.Ia32Jump[2]                  = 0x90;
+  BootSector->FatBsb.SectorSize                   = BENCH_BLOCK_SIZE;
+  BootSector->FatBsb.SectorsPerCluster            = 1;
+  BootSector->FatBsb.ReservedSectors              = BENCH_RESERVED_SECTORS;
+  BootSector->FatBsb.NumFats                      = BENCH_FAT_COUNT;
+  BootSector->FatBsb.Media                        = 0xF8;
+  BootSector->FatBsb.LargeSectors                 = (UINT32)Sectors;
+  BootSector->FatBse.Fat32Bse.LargeSectorsPerFat  = (UINT32)SectorsPerFat;
+  BootSector->FatBse.Fat32Bse.RootDirFirstCluster = BENCH_ROOT_CLUSTER;
+  BootSector->FatBse.Fat32Bse.FsInfoSector        = 1;
+  BootSector->FatBse.Fat32Bse.BackupBootSector    = 6;
+  BootSector->FatBse.Fat32Bse.Signature           = 0x29;
+  CopyMem (BootSector->FatBsb.OemId, "MSWIN4.1", sizeof (BootSector->FatBsb.OemId));
+  CopyMem (BootSector->FatBse.Fat32Bse.FatLabel, "NO NAME    ", sizeof (BootSector->FatBse.Fat32Bse.FatLabel));
+  CopyMem (BootSector->FatBse.Fat32Bse.SystemId, "FAT32   ", sizeof (BootSector->FatBse.Fat32Bse.SystemId));
+  Disk->Buffer[510] = 0x55;
+  Disk->Buffer[511] = 0xAA;
+
+  //
+  // The root directory takes the first cluster
+  //
+  InfoSector                        = (FAT_INFO_SECTOR *)(Disk->Buffer + BENCH_BLOCK_SIZE);
+  InfoSector->Signature             = FAT_INFO_SIGNATURE;
+  InfoSector->InfoBeginSignature    = FAT_INFO_BEGIN_SIGNATURE;
+  InfoSector->FreeInfo.ClusterCount = (UINT32)(Clusters - 1);
+  InfoSector->FreeInfo.NextCluster  = BENCH_ROOT_CLUSTER + 1;
+  InfoSector->InfoEndSignature      = FAT_INFO_END_SIGNATURE;
+
+  for (Index = 0; Index < BENCH_FAT_COUNT; Index++) {
+    Fat                     = (UINT32 *)(Disk->Buffer + (BENCH_RESERVED_SECTORS + Index * SectorsPerFat) * BENCH_BLOCK_SIZE);
+    Fat[0]                  = 0x0FFFFF00 | BootSector->FatBsb.Media;
+    Fat[1]                  = 0x0FFFFFFF;
+    Fat[BENCH_ROOT_CLUSTER] = 0x0FFFFFFF;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Mount the volume of the RAM disk, and open its root directory.
+
+  @param[in, out] Context  The benchmark context.
+
+  @retval EFI_SUCCESS  The volume is mounted.
+  @return Others       The volume could not be mounted.
+**/
+STATIC
+EFI_STATUS
+BenchMount (
+  IN OUT BENCH_CONTEXT  *Context
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = FatAllocateVolume ((EFI_HANDLE)&Context->Disk, &Context->Disk.DiskIo, NULL, &Context->Disk.BlockIo);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return mBenchFileSystem->OpenVolume (mBenchFileSystem, &Context->Root);
+}
+
+/**
+  Close the root directory, which flushes the volume, and unmount the volume.
+
+  @param[in, out] Context  The benchmark context.
+**/
+STATIC
+VOID
+BenchUnmount (
+  IN OUT BENCH_CONTEXT  *Context
+  )
+{
+  FAT_VOLUME  *Volume;
+
+  if (Context->Root != NULL) {
+    Context->Root->Close (Context->Root);
+    Context->Root = NULL;
+  }
+
+  if (mBenchFileSystem != NULL) {
+    Volume = VOLUME_FROM_VOL_INTERFACE (mBenchFileSystem);
+    FatAbandonVolume (Volume);
+  }
+}
+
+/**
+  Mount the volume again, so that the next workload starts with cold caches.
+
+  @param[in, out] Context  The benchmark context.
+
+  @retval EFI_SUCCESS  The volume is mounted.
+  @return Others       The volume could not be mounted.
+**/
+STATIC
+EFI_STATUS
+BenchRemount (
+  IN OUT BENCH_CONTEXT  *Context
+  )
+{
+  BenchUnmount (Context);
+  return BenchMount (Context);
+}
+
+/**
+  Create a RAM disk with an empty volume, and mount it.
+
+  @param[in] Context  The benchmark context.
+
+  @retval UNIT_TEST_PASSED                      The volume is mounted.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  The volume could not be created or mounted.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BENCH_CONTEXT  *Bench;
+
+  Bench         = (BENCH_CONTEXT *)Context;
+  Bench->Buffer = AllocatePool (BENCH_IO_SIZE);
+  mSeed         = 1;
+  if ((Bench->Buffer == NULL) || EFI_ERROR (BenchCreateDisk (&Bench->Disk))) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  if (EFI_ERROR (BenchMount (Bench))) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unmount the volume, and free the RAM disk.
+
+  @param[in] Context  The benchmark context.
+**/
+STATIC
+VOID
+EFIAPI
+BenchCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BENCH_CONTEXT  *Bench;
+
+  Bench = (BENCH_CONTEXT *)Context;
+  BenchUnmount (Bench);
+  if (Bench->Disk.Buffer != NULL) {
+    FreePool (Bench->Disk.Buffer);
+    Bench->Disk.Buffer = NULL;
+  }
+
+  if (Bench->Buffer != NULL) {
+    FreePool (Bench->Buffer);
+    Bench->Buffer = NULL;
+  }
+}
+
+/**
+  Start measuring a workload.
+
+  @param[in, out] Context  The benchmark context.
+**/
+STATIC
+VOID
+BenchStart (
+  IN OUT BENCH_CONTEXT  *Context
+  )
+{
+  FAT_VOLUME  *Volume;
+
+  Volume = VOLUME_FROM_VOL_INTERFACE (mBenchFileSystem);
+  FatResetCacheStatistics (Volume);
+  Volume->DirCacheHits   = 0;
+  Volume->DirCacheMisses = 0;
+  ZeroMem (&Context->Disk.Counters, sizeof (BENCH_DISK_COUNTERS));
+  Context->StartTime = BenchGetTimeInNanoSecond ();
+}
+
+/**
+  Report the measurements of a workload.
+
+  @param[in] Context     The benchmark context.
+  @param[in] Operations  The number of file operations of the workload.
+  @param[in] Bytes       The number of file bytes read or written by the workload.
+**/
+STATIC
+VOID
+BenchReport (
+  IN BENCH_CONTEXT  *Context,
+  IN UINT64         Operations,
+  IN UINT64         Bytes
+  )
+{
+  UINT64               Elapsed;
+  FAT_VOLUME           *Volume;
+  BENCH_DISK_COUNTERS  *Counters;
+  CACHE_STATISTICS     FatCache;
+  CACHE_STATISTICS     DataCache;
+
+  Elapsed  = MAX (BenchGetTimeInNanoSecond () - Context->StartTime, 1);
+  Volume   = VOLUME_FROM_VOL_INTERFACE (mBenchFileSystem);
+  Counters = &Context->Disk.Counters;
+  FatGetCacheStatistics (Volume, CacheFat, &FatCache);
+  FatGetCacheStatistics (Volume, CacheData, &DataCache);
+
+  UT_LOG_INFO (
+    "%ld operations, %ld KB in %ld us: %ld operations/s, %ld KB/s\n",
+    Operations,
+    Bytes / SIZE_1KB,
+    Elapsed / 1000,
+    DivU64x64Remainder (MultU64x32 (Operations, 1000000000), Elapsed, NULL),
+    DivU64x64Remainder (MultU64x32 (Bytes / SIZE_1KB, 1000000000), Elapsed, NULL)
+    );
+  UT_LOG_INFO (
+    "DiskIo reads %ld (%ld KB), writes %ld (%ld KB), BlockIo flushes %ld\n",
+    Counters->ReadCalls,
+    Counters->ReadBytes / SIZE_1KB,
+    Counters->WriteCalls,
+    Counters->WriteBytes / SIZE_1KB,
+    Counters->FlushCalls
+    );
+  UT_LOG_INFO (
+    "FAT cache hits %ld misses %ld evictions %ld, data cache hits %ld misses %ld evictions %ld read aheads %ld\n",
+    FatCache.Hits,
+    FatCache.Misses,
+    FatCache.Evictions,
+    DataCache.Hits,
+    DataCache.Misses,
+    DataCache.Evictions,
+    DataCache.ReadAheads
+    );
+  UT_LOG_INFO (
+    "directory cache hits %ld misses %ld\n",
+    Volume->DirCacheHits,
+    Volume->DirCacheMisses
+    );
+}
+
+/**
+  Create a file holding the benchmark content.
+
+  @param[in] Context  The benchmark context.
+  @param[in] Parent   The directory to create the file in.
+  @param[in] Name     The name of the file.
+  @param[in] Size     The size of the file in bytes.
+
+  @retval EFI_SUCCESS  The file was created.
+  @return Others       The file could not be created or written.
+**/
+STATIC
+EFI_STATUS
+BenchWriteFile (
+  IN BENCH_CONTEXT      *Context,
+  IN EFI_FILE_PROTOCOL  *Parent,
+  IN CHAR16             *Name,
+  IN UINT64             Size
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+  UINT64             Offset;
+  UINTN              IoSize;
+
+  Status = Parent->Open (Parent, &File, Name, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, 0);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Offset = 0; Offset < Size; Offset += IoSize) {
+    IoSize = (UINTN)MIN (Size - Offset, BENCH_IO_SIZE);
+    BenchFill (Context->Buffer, Offset, IoSize);
+    Status = File->Write (File, &IoSize, Context->Buffer);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+
+  File->Close (File);
+  return Status;
+}
+
+/**
+  Check that a file holds the benchmark content.
+
+  @param[in] Context  The benchmark context.
+  @param[in] Parent   The directory of the file.
+  @param[in] Name     The name of the file.
+  @param[in] Size     The expected size of the file in bytes.
+
+  @retval EFI_SUCCESS           The file holds the expected content.
+  @retval EFI_VOLUME_CORRUPTED  The file content or size differs.
+  @return Others                The file could not be opened or read.
+**/
+STATIC
+EFI_STATUS
+BenchCheckFile (
+  IN BENCH_CONTEXT      *Context,
+  IN EFI_FILE_PROTOCOL  *Parent,
+  IN CHAR16             *Name,
+  IN UINT64             Size
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+  UINT64             Offset;
+  UINTN              IoSize;
+
+  Status = Parent->Open (Parent, &File, Name, EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Offset = 0; ; Offset += IoSize) {
+    IoSize = BENCH_IO_SIZE;
+    Status = File->Read (File, &IoSize, Context->Buffer);
+    if (EFI_ERROR (Status) || (IoSize == 0)) {
+      break;
+    }
+
+    if (!BenchCheck (Context->Buffer, Offset, IoSize)) {
+      Status = EFI_VOLUME_CORRUPTED;
+      break;
+    }
+  }
+
+  if (!EFI_ERROR (Status) && (Offset != Size)) {
+    Status = EFI_VOLUME_CORRUPTED;
+  }
+
+  File->Close (File);
+  return Status;
+}
+
+/**
+  Write a large file sequentially.
+
+  @param[in] Context  The benchmark context.
+
+  @retval UNIT_TEST_PASSED             The workload completed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A file operation failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchSequentialWrite (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BENCH_CONTEXT  *Bench;
+
+  Bench = (BENCH_CONTEXT *)Context;
+
+  BenchStart (Bench);
+  UT_ASSERT_NOT_EFI_ERROR (BenchWriteFile (Bench, Bench->Root, L"Sequential.bin", BENCH_FILE_SIZE));
+  UT_ASSERT_NOT_EFI_ERROR (Bench->Root->Flush (Bench->Root));
+  BenchReport (Bench, BENCH_FILE_SIZE / BENCH_IO_SIZE, BENCH_FILE_SIZE);
+
+  UT_ASSERT_NOT_EFI_ERROR (BenchRemount (Bench));
+  UT_ASSERT_NOT_EFI_ERROR (BenchCheckFile (Bench, Bench->Root, L"Sequential.bin", BENCH_FILE_SIZE));
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Read a large file sequentially.
+
+  @param[in] Context  The benchmark context.
+
+  @retval UNIT_TEST_PASSED             The workload completed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A file operation failed, or read wrong data.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchSequentialRead (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BENCH_CONTEXT  *Bench;
+
+  Bench = (BENCH_CONTEXT *)Context;
+  UT_ASSERT_NOT_EFI_ERROR (BenchWriteFile (Bench, Bench->Root, L"Sequential.bin", BENCH_FILE_SIZE));
+  UT_ASSERT_NOT_EFI_ERROR (BenchRemount (Bench));
+
+  BenchStart (Bench);
+  UT_ASSERT_NOT_EFI_ERROR (BenchCheckFile (Bench, Bench->Root, L"Sequential.bin", BENCH_FILE_SIZE));
+  BenchReport (Bench, BENCH_FILE_SIZE / BENCH_IO_SIZE, BENCH_FILE_SIZE);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Rewrite blocks of a large file in random order.
+
+  @param[in] Context  The benchmark context.
+
+  @retval UNIT_TEST_PASSED             The workload completed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A file operation failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchRandomWrite (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BENCH_CONTEXT      *Bench;
+  EFI_FILE_PROTOCOL  *File;
+  UINTN              Index;
+  UINT64             Offset;
+  UINTN              IoSize;
+
+  Bench = (BENCH_CONTEXT *)Context;
+  UT_ASSERT_NOT_EFI_ERROR (BenchWriteFile (Bench, Bench->Root, L"Random.bin", BENCH_FILE_SIZE));
+  UT_ASSERT_NOT_EFI_ERROR (BenchRemount (Bench));
+
+  BenchStart (Bench);
+  UT_ASSERT_NOT_EFI_ERROR (Bench->Root->Open (Bench->Root, &File, L"Random.bin", EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0));
+  for (Index = 0; Index < BENCH_RANDOM_IO_COUNT; Index++) {
+    Offset = (BenchRandom () % (BENCH_FILE_SIZE / BENCH_RANDOM_IO_SIZE)) * BENCH_RANDOM_IO_SIZE;
+    IoSize = BENCH_RANDOM_IO_SIZE;
+    BenchFill (Bench->Buffer, Offset, IoSize);
+    UT_ASSERT_NOT_EFI_ERROR (File->SetPosition (File, Offset));
+    UT_ASSERT_NOT_EFI_ERROR (File->Write (File, &IoSize, Bench->Buffer));
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (File->Close (File));
+  UT_ASSERT_NOT_EFI_ERROR (Bench->Root->Flush (Bench->Root));
+  BenchReport (Bench, BENCH_RANDOM_IO_COUNT, BENCH_RANDOM_IO_COUNT * BENCH_RANDOM_IO_SIZE);
+
+  UT_ASSERT_NOT_EFI_ERROR (BenchRemount (Bench));
+  UT_ASSERT_NOT_EFI_ERROR (BenchCheckFile (Bench, Bench->Root, L"Random.bin", BENCH_FILE_SIZE));
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Read blocks of a large file in random order.
+
+  @param[in] Context  The benchmark context.
+
+  @retval UNIT_TEST_PASSED             The workload completed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A file operation failed, or read wrong data.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchRandomRead (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BENCH_CONTEXT      *Bench;
+  EFI_FILE_PROTOCOL  *File;
+  UINTN              Index;
+  UINT64             Offset;
+  UINTN              IoSize;
+
+  Bench = (BENCH_CONTEXT *)Context;
+  UT_ASSERT_NOT_EFI_ERROR (BenchWriteFile (Bench, Bench->Root, L"Random.bin", BENCH_FILE_SIZE));
+  UT_ASSERT_NOT_EFI_ERROR (BenchRemount (Bench));
+
+  BenchStart (Bench);
+  UT_ASSERT_NOT_EFI_ERROR (Bench->Root->Open (Bench->Root, &File, L"Random.bin", EFI_FILE_MODE_READ, 0));
+  for (Index = 0; Index < BENCH_RANDOM_IO_COUNT; Index++) {
+    Offset = (BenchRandom () % (BENCH_FILE_SIZE / BENCH_RANDOM_IO_SIZE)) * BENCH_RANDOM_IO_SIZE;
+    IoSize = BENCH_RANDOM_IO_SIZE;
+    UT_ASSERT_NOT_EFI_ERROR (File->SetPosition (File, Offset));
+    UT_ASSERT_NOT_EFI_ERROR (File->Read (File, &IoSize, Bench->Buffer));
+    UT_ASSERT_EQUAL (IoSize, BENCH_RANDOM_IO_SIZE);
+    UT_ASSERT_TRUE (BenchCheck (Bench->Buffer, Offset, IoSize));
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (File->Close (File));
+  BenchReport (Bench, BENCH_RANDOM_IO_COUNT, BENCH_RANDOM_IO_COUNT * BENCH_RANDOM_IO_SIZE);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Create, look up and delete many files with long names in one directory.
+
+  @param[in] Context  The benchmark context.
+
+  @retval UNIT_TEST_PASSED             The workload completed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A file operation failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchManyFiles (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BENCH_CONTEXT      *Bench;
+  EFI_FILE_PROTOCOL  *Directory;
+  EFI_FILE_PROTOCOL  *File;
+  CHAR16             Name[BENCH_NAME_LENGTH];
+  UINT32             Index;
+
+  Bench = (BENCH_CONTEXT *)Context;
+  UT_ASSERT_NOT_EFI_ERROR (
+    Bench->Root->Open (Bench->Root, &Directory, L"Many", EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, EFI_FILE_DIRECTORY)
+    );
+  UT_ASSERT_NOT_EFI_ERROR (Directory->Close (Directory));
+  UT_ASSERT_NOT_EFI_ERROR (BenchRemount (Bench));
+
+  BenchStart (Bench);
+  UT_ASSERT_NOT_EFI_ERROR (Bench->Root->Open (Bench->Root, &Directory, L"Many", EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0));
+  for (Index = 0; Index < BENCH_FILE_COUNT; Index++) {
+    UnicodeSPrint (Name, sizeof (Name), L"Benchmark file %04d.dat", Index);
+    UT_ASSERT_NOT_EFI_ERROR (Directory->Open (Directory, &File, Name, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, 0));
+    UT_ASSERT_NOT_EFI_ERROR (File->Close (File));
+  }
+
+  for (Index = 0; Index < BENCH_FILE_COUNT; Index++) {
+    UnicodeSPrint (Name, sizeof (Name), L"BENCHMARK FILE %04d.DAT", Index);
+    UT_ASSERT_NOT_EFI_ERROR (Directory->Open (Directory, &File, Name, EFI_FILE_MODE_READ, 0));
+    UT_ASSERT_NOT_EFI_ERROR (File->Close (File));
+  }
+
+  for (Index = 0; Index < BENCH_FILE_COUNT; Index++) {
+    UnicodeSPrint (Name, sizeof (Name), L"Benchmark file %04d.dat", Index);
+    UT_ASSERT_NOT_EFI_ERROR (Directory->Open (Directory, &File, Name, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0));
+    UT_ASSERT_NOT_EFI_ERROR (File->Delete (File));
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Directory->Close (Directory));
+  UT_ASSERT_NOT_EFI_ERROR (Bench->Root->Flush (Bench->Root));
+  BenchReport (Bench, 3 * BENCH_FILE_COUNT, 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Create a directory tree of BENCH_TREE_FAN_OUT directories and BENCH_TREE_FILES
+  files per directory.
+
+  @param[in] Context    The benchmark context.
+  @param[in] Directory  The directory to populate.
+  @param[in] Depth      The number of directory levels to create below Directory.
+
+  @retval EFI_SUCCESS  The tree was created.
+  @return Others       A file operation failed.
+**/
+STATIC
+EFI_STATUS
+BenchCreateTree (
+  IN BENCH_CONTEXT      *Context,
+  IN EFI_FILE_PROTOCOL  *Directory,
+  IN UINTN              Depth
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *Child;
+  CHAR16             Name[BENCH_NAME_LENGTH];
+  UINT32             Index;
+
+  for (Index = 0; Index < BENCH_TREE_FILES; Index++) {
+    UnicodeSPrint (Name, sizeof (Name), L"File %d.txt", Index);
+    Status = BenchWriteFile (Context, Directory, Name, BENCH_BLOCK_SIZE);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  if (Depth == 0) {
+    return EFI_SUCCESS;
+  }
+
+  for (Index = 0; Index < BENCH_TREE_FAN_OUT; Index++) {
+    UnicodeSPrint (Name, sizeof (Name), L"Directory %d", Index);
+    Status = Directory->Open (Directory, &Child, Name, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, EFI_FILE_DIRECTORY);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Status = BenchCreateTree (Context, Child, Depth - 1);
+    Child->Close (Child);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Walk a directory tree, reading every directory entry and opening every
+  subdirectory.
+
+  @param[in]  Context    The benchmark context.
+  @param[in]  Directory  The directory to walk.
+  @param[out] Entries    Incremented by the number of entries found below Directory,
+                         other than "." and "..".
+
+  @retval EFI_SUCCESS  The tree was walked.
+  @return Others       A file operation failed.
+**/
+STATIC
+EFI_STATUS
+BenchWalkTree (
+  IN     BENCH_CONTEXT      *Context,
+  IN     EFI_FILE_PROTOCOL  *Directory,
+  IN OUT UINTN              *Entries
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *Child;
+  EFI_FILE_INFO      *Info;
+  UINTN              InfoSize;
+
+  Info = (EFI_FILE_INFO *)Context->Buffer;
+  for ( ; ;) {
+    InfoSize = BENCH_IO_SIZE;
+    Status   = Directory->Read (Directory, &InfoSize, Info);
+    if (EFI_ERROR (Status) || (InfoSize == 0)) {
+      return Status;
+    }
+
+    if ((StrCmp (Info->FileName, L".") == 0) || (StrCmp (Info->FileName, L"..") == 0)) {
+      continue;
+    }
+
+    (*Entries)++;
+    if ((Info->Attribute & EFI_FILE_DIRECTORY) == 0) {
+      continue;
+    }
+
+    Status = Directory->Open (Directory, &Child, Info->FileName, EFI_FILE_MODE_READ, 0);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Status = BenchWalkTree (Context, Child, Entries);
+    Child->Close (Child);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+}
+
+/**
+  Walk a deep directory tree.
+
+  @param[in] Context  The benchmark context.
+
+  @retval UNIT_TEST_PASSED             The workload completed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A file operation failed, or the tree is incomplete.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchDeepTreeWalk (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BENCH_CONTEXT  *Bench;
+  UINTN          Expected;
+  UINTN          Entries;
+  UINTN          Directories;
+  UINTN          Depth;
+
+  Bench = (BENCH_CONTEXT *)Context;
+  UT_ASSERT_NOT_EFI_ERROR (BenchCreateTree (Bench, Bench->Root, BENCH_TREE_DEPTH));
+  UT_ASSERT_NOT_EFI_ERROR (BenchRemount (Bench));
+
+  //
+  // Every directory below the root holds BENCH_TREE_FILES files
+  //
+  Directories = 1;
+  Expected    = BENCH_TREE_FILES;
+  for (Depth = 0; Depth < BENCH_TREE_DEPTH; Depth++) {
+    Directories *= BENCH_TREE_FAN_OUT;
+    Expected    += Directories * (1 + BENCH_TREE_FILES);
+  }
+
+  BenchStart (Bench);
+  Entries = 0;
+  UT_ASSERT_NOT_EFI_ERROR (BenchWalkTree (Bench, Bench->Root, &Entries));
+  BenchReport (Bench, Entries, 0);
+  UT_ASSERT_EQUAL (Entries, Expected);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Write a file into the holes left by deleting every other file of a full
+  directory.
+
+  @param[in] Context  The benchmark context.
+
+  @retval UNIT_TEST_PASSED             The workload completed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A file operation failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchFragmentedAllocation (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BENCH_CONTEXT      *Bench;
+  EFI_FILE_PROTOCOL  *File;
+  CHAR16             Name[BENCH_NAME_LENGTH];
+  UINT32             Index;
+
+  Bench = (BENCH_CONTEXT *)Context;
+  for (Index = 0; Index < BENCH_FRAGMENT_COUNT; Index++) {
+    UnicodeSPrint (Name, sizeof (Name), L"Fragment %d.bin", Index);
+    UT_ASSERT_NOT_EFI_ERROR (BenchWriteFile (Bench, Bench->Root, Name, BENCH_FRAGMENT_SIZE));
+  }
+
+  for (Index = 0; Index < BENCH_FRAGMENT_COUNT; Index += 2) {
+    UnicodeSPrint (Name, sizeof (Name), L"Fragment %d.bin", Index);
+    UT_ASSERT_NOT_EFI_ERROR (Bench->Root->Open (Bench->Root, &File, Name, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0));
+    UT_ASSERT_NOT_EFI_ERROR (File->Delete (File));
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (BenchRemount (Bench));
+
+  BenchStart (Bench);
+  UT_ASSERT_NOT_EFI_ERROR (BenchWriteFile (Bench, Bench->Root, L"Fragmented.bin", BENCH_FRAGMENTED_FILE_SIZE));
+  UT_ASSERT_NOT_EFI_ERROR (Bench->Root->Flush (Bench->Root));
+  BenchReport (Bench, BENCH_FRAGMENTED_FILE_SIZE / BENCH_IO_SIZE, BENCH_FRAGMENTED_FILE_SIZE);
+
+  UT_ASSERT_NOT_EFI_ERROR (BenchRemount (Bench));
+  UT_ASSERT_NOT_EFI_ERROR (BenchCheckFile (Bench, Bench->Root, L"Fragmented.bin", BENCH_FRAGMENTED_FILE_SIZE));
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Grow an empty file with SetInfo () over the clusters of a deleted file, and
+  check that it reads back as zeros.
+
+  @param[in] Context  The benchmark context.
+
+  @retval UNIT_TEST_PASSED             The workload completed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A file operation failed, or stale data
+                                       showed up in the file.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchPreallocate (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BENCH_CONTEXT      *Bench;
+  EFI_FILE_PROTOCOL  *File;
+  EFI_FILE_INFO      *Info;
+  UINTN              Size;
+  UINT64             Offset;
+
+  Bench = (BENCH_CONTEXT *)Context;
+  UT_ASSERT_NOT_EFI_ERROR (BenchWriteFile (Bench, Bench->Root, L"Stale.bin", BENCH_FILE_SIZE));
+  UT_ASSERT_NOT_EFI_ERROR (Bench->Root->Open (Bench->Root, &File, L"Stale.bin", EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0));
+  UT_ASSERT_NOT_EFI_ERROR (File->Delete (File));
+  UT_ASSERT_NOT_EFI_ERROR (BenchRemount (Bench));
+
+  BenchStart (Bench);
+  UT_ASSERT_NOT_EFI_ERROR (
+    Bench->Root->Open (Bench->Root, &File, L"Preallocated.bin", EFI_FILE_MODE_CREATE | EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0)
+    );
+  Info = (EFI_FILE_INFO *)Bench->Buffer;
+  Size = BENCH_IO_SIZE;
+  UT_ASSERT_NOT_EFI_ERROR (File->GetInfo (File, &gEfiFileInfoGuid, &Size, Info));
+  Info->FileSize = BENCH_FILE_SIZE;
+  UT_ASSERT_NOT_EFI_ERROR (File->SetInfo (File, &gEfiFileInfoGuid, Size, Info));
+  UT_ASSERT_NOT_EFI_ERROR (File->Close (File));
+  BenchReport (Bench, 1, BENCH_FILE_SIZE);
+
+  UT_ASSERT_NOT_EFI_ERROR (BenchRemount (Bench));
+  UT_ASSERT_NOT_EFI_ERROR (Bench->Root->Open (Bench->Root, &File, L"Preallocated.bin", EFI_FILE_MODE_READ, 0));
+  for (Offset = 0; Offset < BENCH_FILE_SIZE; Offset += Size) {
+    Size = BENCH_IO_SIZE;
+    UT_ASSERT_NOT_EFI_ERROR (File->Read (File, &Size, Bench->Buffer));
+    UT_ASSERT_EQUAL (Size, BENCH_IO_SIZE);
+    UT_ASSERT_TRUE (IsZeroBuffer (Bench->Buffer, Size));
+  }
+
+  File->Close (File);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Get the number of free bytes of the volume.
+
+  @param[in]  Context    The benchmark context.
+  @param[out] FreeSpace  The number of free bytes.
+
+  @retval EFI_SUCCESS  The free space was returned.
+  @return Others       The file system info could not be read.
+**/
+STATIC
+EFI_STATUS
+BenchGetFreeSpace (
+  IN  BENCH_CONTEXT  *Context,
+  OUT UINT64         *FreeSpace
+  )
+{
+  EFI_STATUS            Status;
+  EFI_FILE_SYSTEM_INFO  *Info;
+  UINTN                 Size;
+
+  Info   = (EFI_FILE_SYSTEM_INFO *)Context->Buffer;
+  Size   = BENCH_IO_SIZE;
+  Status = Context->Root->GetInfo (Context->Root, &gEfiFileSystemInfoGuid, &Size, Info);
+  if (!EFI_ERROR (Status)) {
+    *FreeSpace = Info->FreeSpace;
+  }
+
+  return Status;
+}
+
+/**
+  Query the free space of a partly used volume whose FSInfo sector is not valid,
+  until the free cluster count has been verified against the whole FAT. The free
+  space reported before that must never exceed the actual free space.
+
+  @param[in] Context  The benchmark context.
+
+  @retval UNIT_TEST_PASSED             The workload completed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A file operation failed, a partial free
+                                       space exceeds the actual one, or the
+                                       verified free space is wrong.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchFreeSpaceQuery (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BENCH_CONTEXT    *Bench;
+  FAT_VOLUME       *Volume;
+  FAT_INFO_SECTOR  *InfoSector;
+  CHAR16           Name[BENCH_NAME_LENGTH];
+  UINT64           Expected;
+  UINT64           FreeSpace;
+  UINT32           Index;
+
+  Bench = (BENCH_CONTEXT *)Context;
+  for (Index = 0; Index < BENCH_FRAGMENT_COUNT; Index++) {
+    UnicodeSPrint (Name, sizeof (Name), L"Fragment %d.bin", Index);
+    UT_ASSERT_NOT_EFI_ERROR (BenchWriteFile (Bench, Bench->Root, Name, BENCH_FRAGMENT_SIZE));
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (BenchGetFreeSpace (Bench, &Expected));
+  BenchUnmount (Bench);
+
+  //
+  // Invalidate the FSInfo free cluster count, as an unclean shutdown would
+  //
+  InfoSector                        = (FAT_INFO_SECTOR *)(Bench->Disk.Buffer + BENCH_BLOCK_SIZE);
+  InfoSector->FreeInfo.ClusterCount = MAX_UINT32;
+  UT_ASSERT_NOT_EFI_ERROR (BenchMount (Bench));
+
+  BenchStart (Bench);
+  Volume    = VOLUME_FROM_VOL_INTERFACE (mBenchFileSystem);
+  FreeSpace = 0;
+  for (Index = 0; Index < BENCH_FREE_INFO_QUERIES && !Volume->FreeInfoValid; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (BenchGetFreeSpace (Bench, &FreeSpace));
+    UT_ASSERT_TRUE (FreeSpace <= Expected);
+  }
+
+  BenchReport (Bench, Index, 0);
+
+  UT_ASSERT_TRUE (Volume->FreeInfoValid);
+  UT_ASSERT_EQUAL (FreeSpace, Expected);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  benchmark and run them.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkSuite;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  BenchInitializeServices ();
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in InitUnitTestFramework. Status = %r\n", UNIT_TEST_NAME, Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&BenchmarkSuite, Framework, "FatBenchmarkSuite", "FatPkg.EnhancedFatDxe.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in CreateUnitTestSuite for FatBenchmarkSuite\n", UNIT_TEST_NAME));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BenchmarkSuite, "Sequential write", "SequentialWrite", BenchSequentialWrite, BenchSetup, BenchCleanup, &mBenchContext);
+  AddTestCase (BenchmarkSuite, "Sequential read", "SequentialRead", BenchSequentialRead, BenchSetup, BenchCleanup, &mBenchContext);
+  AddTestCase (BenchmarkSuite, "Random write", "RandomWrite", BenchRandomWrite, BenchSetup, BenchCleanup, &mBenchContext);
+  AddTestCase (BenchmarkSuite, "Random read", "RandomRead", BenchRandomRead, BenchSetup, BenchCleanup, &mBenchContext);
+  AddTestCase (BenchmarkSuite, "Create, look up and delete many files", "ManyFiles", BenchManyFiles, BenchSetup, BenchCleanup, &mBenchContext);
+  AddTestCase (BenchmarkSuite, "Deep directory tree walk", "DeepTreeWalk", BenchDeepTreeWalk, BenchSetup, BenchCleanup, &mBenchContext);
+  AddTestCase (BenchmarkSuite, "Fragmented volume allocation", "FragmentedAllocation", BenchFragmentedAllocation, BenchSetup, BenchCleanup, &mBenchContext);
+  AddTestCase (BenchmarkSuite, "Preallocate a file with SetInfo", "Preallocate", BenchPreallocate, BenchSetup, BenchCleanup, &mBenchContext);
+  AddTestCase (BenchmarkSuite, "Free space query without valid FSInfo", "FreeSpaceQuery", BenchFreeSpaceQuery, BenchSetup, BenchCleanup, &mBenchContext);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define FatBenchmarkMain  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+FatBenchmarkMain (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return (INT32)UefiTestMain ();
+}
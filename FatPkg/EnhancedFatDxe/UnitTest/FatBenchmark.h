@@ -0,0 +1,38 @@
+/** @file
+  Definitions shared by the EnhancedFatDxe host benchmark and the minimal UEFI
+  services it runs the driver on.
+
+  Copyright (c) Microsoft Corporation.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef FAT_BENCHMARK_H_
+#define FAT_BENCHMARK_H_
+
+#include "../Fat.h"
+
+//
+// The Simple File System instance installed by the last FatAllocateVolume ()
+//
+extern EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *mBenchFileSystem;
+
+/**
+  Point gBS, gRT and mUnicodeCollationInterface at the host implementations
+  the driver needs.
+**/
+VOID
+BenchInitializeServices (
+  VOID
+  );
+
+/**
+  Get a wall clock time stamp.
+
+  @return The time stamp in nanoseconds.
+**/
+UINT64
+BenchGetTimeInNanoSecond (
+  VOID
+  );
+
+#endif
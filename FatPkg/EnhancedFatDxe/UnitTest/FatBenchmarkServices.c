@@ -0,0 +1,490 @@
+/** @file
+  Minimal UEFI services for running EnhancedFatDxe in a host application.
+
+  Only the services the driver uses once a volume is mounted are provided:
+  TPL based locks, protocol installation of the Simple File System instance,
+  the time of day and an English (ASCII) Unicode Collation instance. There is
+  a single thread and no timer interrupt, so TPLs are only tracked.
+
+  Copyright (c) Microsoft Corporation.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include "FatBenchmark.h"
+
+#include <time.h>
+
+EFI_BOOT_SERVICES     *gBS;
+EFI_RUNTIME_SERVICES  *gRT;
+
+EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *mBenchFileSystem;
+
+extern EFI_UNICODE_COLLATION_PROTOCOL  *mUnicodeCollationInterface;
+
+STATIC EFI_BOOT_SERVICES               mBenchBootServices;
+STATIC EFI_RUNTIME_SERVICES            mBenchRuntimeServices;
+STATIC EFI_UNICODE_COLLATION_PROTOCOL  mBenchUnicodeCollation;
+STATIC EFI_TPL                         mBenchTpl = TPL_APPLICATION;
+
+//
+// ASCII characters, other than letters and digits, that are valid in an 8.3 name
+//
+STATIC CONST CHAR8  mBenchFatChars[] = "$%'-_@~`!(){}^#&";
+
+/**
+  Raise the task priority level.
+
+  @param[in] NewTpl  The new task priority level.
+
+  @return The previous task priority level.
+**/
+STATIC
+EFI_TPL
+EFIAPI
+BenchRaiseTpl (
+  IN EFI_TPL  NewTpl
+  )
+{
+  EFI_TPL  OldTpl;
+
+  ASSERT (NewTpl >= mBenchTpl);
+  OldTpl    = mBenchTpl;
+  mBenchTpl = NewTpl;
+  return OldTpl;
+}
+
+/**
+  Restore the task priority level.
+
+  @param[in] OldTpl  The task priority level to restore.
+**/
+STATIC
+VOID
+EFIAPI
+BenchRestoreTpl (
+  IN EFI_TPL  OldTpl
+  )
+{
+  ASSERT (OldTpl <= mBenchTpl);
+  mBenchTpl = OldTpl;
+}
+
+/**
+  Record the Simple File System instance installed by the driver.
+
+  @param[in, out] Handle  The handle the interfaces are installed on.
+  @param[in]      ...     Pairs of protocol GUIDs and interfaces, terminated by NULL.
+
+  @retval EFI_SUCCESS  The interfaces were installed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+BenchInstallMultipleProtocolInterfaces (
+  IN OUT EFI_HANDLE  *Handle,
+  ...
+  )
+{
+  VA_LIST   Args;
+  EFI_GUID  *Protocol;
+  VOID      *Interface;
+
+  VA_START (Args, Handle);
+  for (Protocol = VA_ARG (Args, EFI_GUID *); Protocol != NULL; Protocol = VA_ARG (Args, EFI_GUID *)) {
+    Interface = VA_ARG (Args, VOID *);
+    if (CompareGuid (Protocol, &gEfiSimpleFileSystemProtocolGuid)) {
+      mBenchFileSystem = Interface;
+    }
+  }
+
+  VA_END (Args);
+  return EFI_SUCCESS;
+}
+
+/**
+  Forget the Simple File System instance uninstalled by the driver.
+
+  @param[in] Handle  The handle the interfaces are uninstalled from.
+  @param[in] ...     Pairs of protocol GUIDs and interfaces, terminated by NULL.
+
+  @retval EFI_SUCCESS  The interfaces were uninstalled.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+BenchUninstallMultipleProtocolInterfaces (
+  IN EFI_HANDLE  Handle,
+  ...
+  )
+{
+  VA_LIST   Args;
+  EFI_GUID  *Protocol;
+  VOID      *Interface;
+
+  VA_START (Args, Handle);
+  for (Protocol = VA_ARG (Args, EFI_GUID *); Protocol != NULL; Protocol = VA_ARG (Args, EFI_GUID *)) {
+    Interface = VA_ARG (Args, VOID *);
+    if (CompareGuid (Protocol, &gEfiSimpleFileSystemProtocolGuid) && (Interface == mBenchFileSystem)) {
+      mBenchFileSystem = NULL;
+    }
+  }
+
+  VA_END (Args);
+  return EFI_SUCCESS;
+}
+
+/**
+  Get a fixed time of day, so that directory entries do not depend on when
+  the benchmark runs.
+
+  @param[out] Time          The time of day.
+  @param[out] Capabilities  The clock capabilities.
+
+  @retval EFI_SUCCESS  The time was returned.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+BenchGetTime (
+  OUT EFI_TIME               *Time,
+  OUT EFI_TIME_CAPABILITIES  *Capabilities OPTIONAL
+  )
+{
+  ZeroMem (Time, sizeof (EFI_TIME));
+  Time->Year     = 2024;
+  Time->Month    = 1;
+  Time->Day      = 1;
+  Time->TimeZone = EFI_UNSPECIFIED_TIMEZONE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Upper case an ASCII character.
+
+  @param[in] Char  The character.
+
+  @return The upper cased character.
+**/
+STATIC
+CHAR16
+BenchToUpper (
+  IN CHAR16  Char
+  )
+{
+  return ((Char >= L'a') && (Char <= L'z')) ? (CHAR16)(Char - 0x20) : Char;
+}
+
+/**
+  Lower case an ASCII character.
+
+  @param[in] Char  The character.
+
+  @return The lower cased character.
+**/
+STATIC
+CHAR16
+BenchToLower (
+  IN CHAR16  Char
+  )
+{
+  return ((Char >= L'A') && (Char <= L'Z')) ? (CHAR16)(Char + 0x20) : Char;
+}
+
+/**
+  Perform a case insensitive comparison of two strings.
+
+  @param[in] This  The Unicode Collation instance.
+  @param[in] Str1  A Null-terminated string.
+  @param[in] Str2  A Null-terminated string.
+
+  @return 0 if the strings are equivalent, otherwise the difference of the
+          first characters that differ.
+**/
+STATIC
+INTN
+EFIAPI
+BenchStriColl (
+  IN EFI_UNICODE_COLLATION_PROTOCOL  *This,
+  IN CHAR16                          *Str1,
+  IN CHAR16                          *Str2
+  )
+{
+  while ((*Str1 != 0) && (BenchToUpper (*Str1) == BenchToUpper (*Str2))) {
+    Str1++;
+    Str2++;
+  }
+
+  return (INTN)BenchToUpper (*Str1) - (INTN)BenchToUpper (*Str2);
+}
+
+/**
+  Lower case a string in place.
+
+  @param[in]      This  The Unicode Collation instance.
+  @param[in, out] Str   A Null-terminated string.
+**/
+STATIC
+VOID
+EFIAPI
+BenchStrLwr (
+  IN     EFI_UNICODE_COLLATION_PROTOCOL  *This,
+  IN OUT CHAR16                          *Str
+  )
+{
+  for ( ; *Str != 0; Str++) {
+    *Str = BenchToLower (*Str);
+  }
+}
+
+/**
+  Upper case a string in place.
+
+  @param[in]      This  The Unicode Collation instance.
+  @param[in, out] Str   A Null-terminated string.
+**/
+STATIC
+VOID
+EFIAPI
+BenchStrUpr (
+  IN     EFI_UNICODE_COLLATION_PROTOCOL  *This,
+  IN OUT CHAR16                          *Str
+  )
+{
+  for ( ; *Str != 0; Str++) {
+    *Str = BenchToUpper (*Str);
+  }
+}
+
+/**
+  Convert an 8.3 name component to a string.
+
+  @param[in]  This     The Unicode Collation instance.
+  @param[in]  FatSize  The size of Fat in bytes.
+  @param[in]  Fat      The OEM characters.
+  @param[out] String   The Null-terminated string.
+**/
+STATIC
+VOID
+EFIAPI
+BenchFatToStr (
+  IN  EFI_UNICODE_COLLATION_PROTOCOL  *This,
+  IN  UINTN                           FatSize,
+  IN  CHAR8                           *Fat,
+  OUT CHAR16                          *String
+  )
+{
+  for ( ; (FatSize != 0) && (*Fat != 0); FatSize--) {
+    *String++ = (CHAR16)(UINT8)*Fat++;
+  }
+
+  *String = 0;
+}
+
+/**
+  Convert a string to an upper case 8.3 name component, the way the English
+  Unicode Collation driver does.
+
+  @param[in]  This     The Unicode Collation instance.
+  @param[in]  String   The Null-terminated string.
+  @param[in]  FatSize  The size of Fat in bytes.
+  @param[out] Fat      The OEM characters.
+
+  @retval TRUE   A character was not valid in an 8.3 name, and was replaced by '_'.
+  @retval FALSE  All the characters were valid in an 8.3 name.
+**/
+STATIC
+BOOLEAN
+EFIAPI
+BenchStrToFat (
+  IN  EFI_UNICODE_COLLATION_PROTOCOL  *This,
+  IN  CHAR16                          *String,
+  IN  UINTN                           FatSize,
+  OUT CHAR8                           *Fat
+  )
+{
+  BOOLEAN  SpecialCharExist;
+  CHAR16   Char;
+
+  SpecialCharExist = FALSE;
+  for ( ; (*String != 0) && (FatSize != 0); String++) {
+    if (*String == L'.') {
+      continue;
+    }
+
+    Char = BenchToUpper (*String);
+    if (((Char >= L'A') && (Char <= L'Z')) ||
+        ((Char >= L'0') && (Char <= L'9')) ||
+        ((Char < 0x80) && (ScanMem8 (mBenchFatChars, sizeof (mBenchFatChars) - 1, (UINT8)Char) != NULL)))
+    {
+      *Fat = (CHAR8)Char;
+    } else {
+      *Fat             = '_';
+      SpecialCharExist = TRUE;
+    }
+
+    Fat++;
+    FatSize--;
+  }
+
+  return SpecialCharExist;
+}
+
+/**
+  Raise the task priority level to the level of the lock, and acquire it.
+
+  @param[in] Lock  The lock.
+**/
+VOID
+EFIAPI
+EfiAcquireLock (
+  IN EFI_LOCK  *Lock
+  )
+{
+  ASSERT (Lock->Lock == EfiLockReleased);
+  Lock->OwnerTpl = gBS->RaiseTPL (Lock->Tpl);
+  Lock->Lock     = EfiLockAcquired;
+}
+
+/**
+  Acquire a lock if it is not already held.
+
+  @param[in] Lock  The lock.
+
+  @retval EFI_SUCCESS        The lock was acquired.
+  @retval EFI_ACCESS_DENIED  The lock is already held.
+**/
+EFI_STATUS
+EFIAPI
+EfiAcquireLockOrFail (
+  IN EFI_LOCK  *Lock
+  )
+{
+  if (Lock->Lock == EfiLockAcquired) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  EfiAcquireLock (Lock);
+  return EFI_SUCCESS;
+}
+
+/**
+  Release a lock, and restore the task priority level it was acquired at.
+
+  @param[in] Lock  The lock.
+**/
+VOID
+EFIAPI
+EfiReleaseLock (
+  IN EFI_LOCK  *Lock
+  )
+{
+  ASSERT (Lock->Lock == EfiLockAcquired);
+  Lock->Lock = EfiLockReleased;
+  gBS->RestoreTPL (Lock->OwnerTpl);
+}
+
+/**
+  Get the current task priority level.
+
+  @return The current task priority level.
+**/
+EFI_TPL
+EFIAPI
+EfiGetCurrentTpl (
+  VOID
+  )
+{
+  return mBenchTpl;
+}
+
+/**
+  There are no variables on the host.
+
+  @param[in]  Name   The variable name.
+  @param[out] Value  Set to NULL.
+  @param[out] Size   Set to 0.
+
+  @retval EFI_NOT_FOUND  The variable does not exist.
+**/
+EFI_STATUS
+EFIAPI
+GetEfiGlobalVariable2 (
+  IN CONST CHAR16  *Name,
+  OUT VOID         **Value,
+  OUT UINTN        *Size OPTIONAL
+  )
+{
+  *Value = NULL;
+  if (Size != NULL) {
+    *Size = 0;
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  The benchmark sets the Unicode Collation instance directly, so the driver
+  never negotiates a language.
+
+  @param[in] SupportedLanguages  The supported languages.
+  @param[in] Iso639Language      TRUE for ISO 639-2 language codes.
+  @param[in] ...                 The requested languages.
+
+  @return NULL.
+**/
+CHAR8 *
+EFIAPI
+GetBestLanguage (
+  IN CONST CHAR8  *SupportedLanguages,
+  IN UINTN        Iso639Language,
+  ...
+  )
+{
+  return NULL;
+}
+
+/**
+  Point gBS, gRT and mUnicodeCollationInterface at the host implementations
+  the driver needs.
+**/
+VOID
+BenchInitializeServices (
+  VOID
+  )
+{
+  mBenchBootServices.RaiseTPL                            = BenchRaiseTpl;
+  mBenchBootServices.RestoreTPL                          = BenchRestoreTpl;
+  mBenchBootServices.InstallMultipleProtocolInterfaces   = BenchInstallMultipleProtocolInterfaces;
+  mBenchBootServices.UninstallMultipleProtocolInterfaces = BenchUninstallMultipleProtocolInterfaces;
+  gBS                                                    = &mBenchBootServices;
+
+  mBenchRuntimeServices.GetTime = BenchGetTime;
+  gRT                           = &mBenchRuntimeServices;
+
+  //
+  // MetaiMatch is not used by the driver
+  //
+  mBenchUnicodeCollation.StriColl           = BenchStriColl;
+  mBenchUnicodeCollation.StrLwr             = BenchStrLwr;
+  mBenchUnicodeCollation.StrUpr             = BenchStrUpr;
+  mBenchUnicodeCollation.FatToStr           = BenchFatToStr;
+  mBenchUnicodeCollation.StrToFat           = BenchStrToFat;
+  mBenchUnicodeCollation.SupportedLanguages = "en";
+  mUnicodeCollationInterface                = &mBenchUnicodeCollation;
+}
+
+/**
+  Get a wall clock time stamp.
+
+  @return The time stamp in nanoseconds.
+**/
+UINT64
+BenchGetTimeInNanoSecond (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  timespec_get (&Now, TIME_UTC);
+  return (UINT64)Now.tv_sec * 1000000000ULL + (UINT64)Now.tv_nsec;
+}
@@ -170,6 +170,79 @@ FatGetBpbInfo (
   return EFI_SUCCESS;
 }
 
+/**
+  Reads a FAT entry through the FAT buffer. If the entry is not in the FAT
+  buffer, the buffer is refilled with a batch of FAT sectors starting at the
+  block holding the entry.
+
+  @param  PrivateData            Global memory map for accessing global variables
+  @param  Volume                 The volume
+  @param  FatEntryPos            The position of the FAT entry on the block device
+  @param  Size                   The size of the FAT entry in bytes
+  @param  Entry                  The buffer receiving the FAT entry
+
+  @retval EFI_SUCCESS            The FAT entry is read
+  @retval EFI_DEVICE_ERROR       Read disk error
+
+**/
+EFI_STATUS
+FatReadFatEntry (
+  IN  PEI_FAT_PRIVATE_DATA  *PrivateData,
+  IN  PEI_FAT_VOLUME        *Volume,
+  IN  UINT64                FatEntryPos,
+  IN  UINTN                 Size,
+  OUT VOID                  *Entry
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Offset;
+  UINT64      BufferPos;
+  UINT64      BufferSize;
+
+  if ((PrivateData->FatBufferSize == 0) ||
+      (PrivateData->FatBufferDeviceNo != Volume->BlockDeviceNo) ||
+      (FatEntryPos < PrivateData->FatBufferPos) ||
+      (FatEntryPos + Size > PrivateData->FatBufferPos + PrivateData->FatBufferSize))
+  {
+    //
+    // Refill the FAT buffer from the block holding the entry, without going
+    // beyond the FAT region
+    //
+    DivU64x32Remainder (FatEntryPos, PrivateData->BlockDevice[Volume->BlockDeviceNo].BlockSize, &Offset);
+    BufferPos  = FatEntryPos - Offset;
+    BufferSize = Volume->FirstClusterPos - BufferPos;
+    if (BufferSize > PEI_FAT_FAT_BUFFER_SIZE) {
+      BufferSize = PEI_FAT_FAT_BUFFER_SIZE;
+    }
+
+    if ((FatEntryPos >= Volume->FirstClusterPos) || (FatEntryPos + Size > BufferPos + BufferSize)) {
+      //
+      // The entry is out of the FAT region, read it directly
+      //
+      return FatReadDisk (PrivateData, Volume->BlockDeviceNo, FatEntryPos, Size, Entry);
+    }
+
+    PrivateData->FatBufferSize = 0;
+    Status                     = FatReadDisk (
+                                   PrivateData,
+                                   Volume->BlockDeviceNo,
+                                   BufferPos,
+                                   (UINTN)BufferSize,
+                                   PrivateData->FatBuffer
+                                   );
+    if (EFI_ERROR (Status)) {
+      return EFI_DEVICE_ERROR;
+    }
+
+    PrivateData->FatBufferDeviceNo = Volume->BlockDeviceNo;
+    PrivateData->FatBufferPos      = BufferPos;
+    PrivateData->FatBufferSize     = (UINTN)BufferSize;
+  }
+
+  CopyMem (Entry, (UINT8 *)PrivateData->FatBuffer + (UINTN)(FatEntryPos - PrivateData->FatBufferPos), Size);
+  return EFI_SUCCESS;
+}
+
 /**
   Gets the next cluster in the cluster chain
 
@@ -200,7 +273,7 @@ FatGetNextCluster (
   if (Volume->FatType == Fat32) {
     FatEntryPos = Volume->FatPos + MultU64x32 (4, Cluster);
 
-    Status        = FatReadDisk (PrivateData, Volume->BlockDeviceNo, FatEntryPos, 4, NextCluster);
+    Status        = FatReadFatEntry (PrivateData, Volume, FatEntryPos, 4, NextCluster);
     *NextCluster &= 0x0fffffff;
 
     //
@@ -212,7 +285,7 @@ FatGetNextCluster (
   } else if (Volume->FatType == Fat16) {
     FatEntryPos = Volume->FatPos + MultU64x32 (2, Cluster);
 
-    Status = FatReadDisk (PrivateData, Volume->BlockDeviceNo, FatEntryPos, 2, NextCluster);
+    Status = FatReadFatEntry (PrivateData, Volume, FatEntryPos, 2, NextCluster);
 
     //
     // Pad high bits for our FAT_CLUSTER_... macro definitions to work
@@ -223,7 +296,7 @@ FatGetNextCluster (
   } else {
     FatEntryPos = Volume->FatPos + DivU64x32Remainder (MultU64x32 (3, Cluster), 2, &Dummy);
 
-    Status = FatReadDisk (PrivateData, Volume->BlockDeviceNo, FatEntryPos, 2, NextCluster);
+    Status = FatReadFatEntry (PrivateData, Volume, FatEntryPos, 2, NextCluster);
 
     if ((Cluster & 0x01) != 0) {
       *NextCluster = (*NextCluster) >> 4;
@@ -271,6 +344,7 @@ FatSetFilePos (
   UINT32      Offset;
   UINT32      Cluster;
   UINT32      PrevCluster;
+  UINT32      RunClusters;
 
   if (File->IsFixedRootDir) {
     if (Pos >= MultU64x32 (File->Volume->RootEntries, 32) - File->CurrentPos) {
@@ -283,6 +357,26 @@ FatSetFilePos (
     DivU64x32Remainder (File->CurrentPos, File->Volume->ClusterSize, &Offset);
     AlignedPos = (UINT32)File->CurrentPos - (UINT32)Offset;
 
+    //
+    // The clusters of the current straight run are consecutive, so a position
+    // inside the run is reached without walking the cluster chain.
+    //
+    if (Pos < File->StraightReadAmount) {
+      File->CurrentCluster     += (Offset + Pos) / File->Volume->ClusterSize;
+      File->CurrentPos         += Pos;
+      File->StraightReadAmount -= Pos;
+      return EFI_SUCCESS;
+    }
+
+    //
+    // Otherwise skip to the last cluster of the run and walk the chain from there
+    //
+    if (File->StraightReadAmount != 0) {
+      RunClusters           = (Offset + File->StraightReadAmount - 1) / File->Volume->ClusterSize;
+      File->CurrentCluster += RunClusters;
+      AlignedPos           += RunClusters * File->Volume->ClusterSize;
+    }
+
     while
     (
      !FAT_CLUSTER_FUNCTIONAL (File->CurrentCluster) &&
@@ -308,7 +402,8 @@ FatSetFilePos (
     File->CurrentPos += Pos;
     //
     // Calculate the amount of consecutive cluster occupied by the file.
-    // FatReadFile() will use it to read these blocks once.
+    // FatReadFile() will use it to read these blocks once. The FAT entries
+    // are mostly served from the FAT buffer.
     //
     File->StraightReadAmount = 0;
     Cluster                  = File->CurrentCluster;
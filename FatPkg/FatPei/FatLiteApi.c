@@ -71,6 +71,8 @@ UpdateBlocksAndVolumes (
     PrivateData->CacheBuffer[Index].Valid = FALSE;
   }
 
+  PrivateData->FatBufferSize = 0;
+
   PrivateData->BlockDeviceCount = 0;
 
   //
@@ -112,7 +112,7 @@ FatReadBlock (
 
 /**
   Find a cache block designated to specific Block device and Lba.
-  If not found, invalidate an oldest one and use it. (LRU cache)
+  If not found, reuse an invalid cache block or the least recently used one. (LRU cache)
 
   @param  PrivateData       the global memory map.
   @param  BlockDeviceNo     the Block device.
@@ -134,43 +134,29 @@ FatGetCacheBlock (
 {
   EFI_STATUS            Status;
   PEI_FAT_CACHE_BUFFER  *CacheBuffer;
+  PEI_FAT_CACHE_BUFFER  *Victim;
   INTN                  Index;
-  STATIC UINT8          Seed;
 
-  Status      = EFI_SUCCESS;
-  CacheBuffer = NULL;
+  Status = EFI_SUCCESS;
+  Victim = NULL;
 
   //
-  // go through existing cache buffers
+  // go through existing cache buffers, and pick an invalid or the least
+  // recently used cache buffer as the victim in case of a miss
   //
   for (Index = 0; Index < PEI_FAT_CACHE_SIZE; Index++) {
     CacheBuffer = &(PrivateData->CacheBuffer[Index]);
     if (CacheBuffer->Valid && (CacheBuffer->BlockDeviceNo == BlockDeviceNo) && (CacheBuffer->Lba == Lba)) {
-      break;
+      CacheBuffer->Lru = ++PrivateData->CacheLru;
+      *CachePtr        = (CHAR8 *)CacheBuffer->Buffer;
+      return EFI_SUCCESS;
     }
-  }
-
-  if (Index < PEI_FAT_CACHE_SIZE) {
-    *CachePtr = (CHAR8 *)CacheBuffer->Buffer;
-    return EFI_SUCCESS;
-  }
 
-  //
-  // We have to find an invalid cache buffer
-  //
-  for (Index = 0; Index < PEI_FAT_CACHE_SIZE; Index++) {
-    if (!PrivateData->CacheBuffer[Index].Valid) {
-      break;
+    if ((Victim == NULL) || (Victim->Valid && (!CacheBuffer->Valid || (CacheBuffer->Lru < Victim->Lru)))) {
+      Victim = CacheBuffer;
     }
   }
 
-  //
-  // Use the cache buffer
-  //
-  if (Index == PEI_FAT_CACHE_SIZE) {
-    Index = (Seed++) % PEI_FAT_CACHE_SIZE;
-  }
-
   //
   // Current device ID should be less than maximum device ID.
   //
@@ -178,8 +164,11 @@ FatGetCacheBlock (
     return EFI_DEVICE_ERROR;
   }
 
-  CacheBuffer = &(PrivateData->CacheBuffer[Index]);
-
+  //
+  // Use the victim cache buffer. It stays invalid until the new data is read in.
+  //
+  CacheBuffer                = Victim;
+  CacheBuffer->Valid         = FALSE;
   CacheBuffer->BlockDeviceNo = BlockDeviceNo;
   CacheBuffer->Lba           = Lba;
   CacheBuffer->Size          = PrivateData->BlockDevice[BlockDeviceNo].BlockSize;
@@ -199,6 +188,7 @@ FatGetCacheBlock (
   }
 
   CacheBuffer->Valid = TRUE;
+  CacheBuffer->Lru   = ++PrivateData->CacheLru;
   *CachePtr          = (CHAR8 *)CacheBuffer->Buffer;
 
   return Status;
@@ -206,6 +196,8 @@ FatGetCacheBlock (
 
 /**
   Disk reading.
+  Partial blocks are read through the block cache, while whole aligned blocks
+  are read into the buffer directly with a single multi-block read.
 
   @param  PrivateData       the global memory map;
   @param  BlockDeviceNo     the block device to read;
@@ -240,38 +232,42 @@ FatReadDisk (
   BlockSize = PrivateData->BlockDevice[BlockDeviceNo].BlockSize;
 
   //
-  // Read underrun
+  // Read underrun, unless the read starts with a whole block
   //
-  Lba    = DivU64x32Remainder (StartingAddress, BlockSize, &Offset);
-  Status = FatGetCacheBlock (PrivateData, BlockDeviceNo, Lba, &CachePtr);
-  if (EFI_ERROR (Status)) {
-    return EFI_DEVICE_ERROR;
-  }
+  Lba = DivU64x32Remainder (StartingAddress, BlockSize, &Offset);
+  if ((Offset != 0) || (Size < BlockSize)) {
+    Status = FatGetCacheBlock (PrivateData, BlockDeviceNo, Lba, &CachePtr);
+    if (EFI_ERROR (Status)) {
+      return EFI_DEVICE_ERROR;
+    }
 
-  Amount = Size < (BlockSize - Offset) ? Size : (BlockSize - Offset);
-  CopyMem (BufferPtr, CachePtr + Offset, Amount);
+    Amount = Size < (BlockSize - Offset) ? Size : (BlockSize - Offset);
+    CopyMem (BufferPtr, CachePtr + Offset, Amount);
 
-  if (Size == Amount) {
-    return EFI_SUCCESS;
-  }
+    if (Size == Amount) {
+      return EFI_SUCCESS;
+    }
 
-  Size            -= Amount;
-  BufferPtr       += Amount;
-  StartingAddress += Amount;
-  Lba             += 1;
+    Size            -= Amount;
+    BufferPtr       += Amount;
+    StartingAddress += Amount;
+    Lba             += 1;
+  }
 
   //
-  // Read aligned parts
+  // Read aligned parts directly, bypassing the cache
   //
   OverRunLba = Lba + DivU64x32Remainder (Size, BlockSize, &Offset);
 
-  Size  -= Offset;
-  Status = FatReadBlock (PrivateData, BlockDeviceNo, Lba, Size, BufferPtr);
-  if (EFI_ERROR (Status)) {
-    return EFI_DEVICE_ERROR;
-  }
+  Size -= Offset;
+  if (Size != 0) {
+    Status = FatReadBlock (PrivateData, BlockDeviceNo, Lba, Size, BufferPtr);
+    if (EFI_ERROR (Status)) {
+      return EFI_DEVICE_ERROR;
+    }
 
-  BufferPtr += Size;
+    BufferPtr += Size;
+  }
 
   //
   // Read overrun
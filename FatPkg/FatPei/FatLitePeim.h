@@ -33,8 +33,22 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 // Definitions
 //
 
-#define PEI_FAT_CACHE_SIZE        4
+//
+// Number of blocks held by the LRU block cache. The cache only serves partial
+// block accesses such as FAT entries, directory entries and boot sectors; whole
+// aligned blocks, like the cluster runs of a file, are read into the caller's
+// buffer directly.
+//
+#define PEI_FAT_CACHE_SIZE        16
 #define PEI_FAT_MAX_BLOCK_SIZE    8192
+
+//
+// Size of the FAT buffer. Consecutive FAT sectors are read into it in one batch,
+// so that walking a cluster chain does not issue one read per FAT entry.
+// It must be a multiple of PEI_FAT_MAX_BLOCK_SIZE.
+//
+#define PEI_FAT_FAT_BUFFER_SIZE   0x8000
+
 #define FAT_MAX_FILE_NAME_LENGTH  128
 #define PEI_FAT_MAX_BLOCK_DEVICE  64
 #define PEI_FAT_MAX_BLOCK_IO_PPI  32
@@ -151,7 +165,13 @@ typedef struct {
   UINTN                                 VolumeCount;
   PEI_FAT_VOLUME                        Volume[PEI_FAT_MAX_VOLUME];
   PEI_FAT_FILE                          File;
+  UINT32                                CacheLru;
   PEI_FAT_CACHE_BUFFER                  CacheBuffer[PEI_FAT_CACHE_SIZE];
+
+  UINTN                                 FatBufferDeviceNo;
+  UINT64                                FatBufferPos;
+  UINTN                                 FatBufferSize;
+  UINT64                                FatBuffer[PEI_FAT_FAT_BUFFER_SIZE / 8];
 } PEI_FAT_PRIVATE_DATA;
 
 #define PEI_FAT_PRIVATE_DATA_FROM_THIS(a) \
@@ -377,6 +397,30 @@ FatGetBpbInfo (
   IN OUT  PEI_FAT_VOLUME        *Volume
   );
 
+/**
+  Reads a FAT entry through the FAT buffer. If the entry is not in the FAT
+  buffer, the buffer is refilled with a batch of FAT sectors starting at the
+  block holding the entry.
+
+  @param  PrivateData            Global memory map for accessing global variables
+  @param  Volume                 The volume
+  @param  FatEntryPos            The position of the FAT entry on the block device
+  @param  Size                   The size of the FAT entry in bytes
+  @param  Entry                  The buffer receiving the FAT entry
+
+  @retval EFI_SUCCESS            The FAT entry is read
+  @retval EFI_DEVICE_ERROR       Read disk error
+
+**/
+EFI_STATUS
+FatReadFatEntry (
+  IN  PEI_FAT_PRIVATE_DATA  *PrivateData,
+  IN  PEI_FAT_VOLUME        *Volume,
+  IN  UINT64                FatEntryPos,
+  IN  UINTN                 Size,
+  OUT VOID                  *Entry
+  );
+
 /**
   Gets the next cluster in the cluster chain.
 
@@ -60,4 +60,30 @@ extern EFI_GUID  gTpm2StartupLocalityHobGuid;
 
 extern EFI_GUID  gTcg800155PlatformIdEventHobGuid;
 
+///
+/// The Global ID of a GUIDed HOB used to pass a buffer of TCG events from a TPM PEIM to
+/// a TPM DXE Driver. The HOB payload is a TCG_EVENT_LOG_BUFFER_HOB followed by the
+/// events, back to back, in the same format as the payload of the gTcgEventEntryHobGuid
+/// (EFI_TCG2_EVENT_LOG_FORMAT_TCG_1_2) or gTcgEvent2EntryHobGuid (EFI_TCG2_EVENT_LOG_FORMAT_TCG_2)
+/// HOBs. Each event starts on a 64-bit boundary. Events in these HOBs and in the per-event
+/// HOBs are ordered by HOB list position.
+///
+#define EFI_TCG_EVENT_LOG_BUFFER_HOB_GUID \
+  { \
+    0xf8c7b4b0, 0x9af5, 0x4fe1, { 0x80, 0x13, 0xd9, 0x99, 0x4e, 0x34, 0x22, 0x45 } \
+  }
+
+extern EFI_GUID  gTcgEventLogBufferHobGuid;
+
+typedef struct {
+  ///
+  /// EFI_TCG2_EVENT_LOG_FORMAT of the events in the buffer.
+  ///
+  UINT32    LogFormat;
+  ///
+  /// Size in bytes of the events in the buffer.
+  ///
+  UINT32    EventLogSize;
+} TCG_EVENT_LOG_BUFFER_HOB;
+
 #endif
@@ -0,0 +1,63 @@
+/** @file
+  Defines the HOB GUID used to collect TPM2 command latency statistics during boot.
+
+  The HOB is created by the TPM2 PEIM before it sends its first command. The dTPM2.0
+  device library then updates it in place for each command it completes, in PEI and
+  in DXE, so the table covers every TPM2 command sent through that library in boot.
+
+Copyright (c) Microsoft Corporation.
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _TPM2_COMMAND_LATENCY_HOB_H_
+#define _TPM2_COMMAND_LATENCY_HOB_H_
+
+///
+/// The Global ID of a GUIDed HOB used to collect TPM2 command latency statistics.
+/// HOB payload is TPM2_COMMAND_LATENCY_HOB.
+///
+#define TPM2_COMMAND_LATENCY_HOB_GUID \
+  { \
+    0x5b3f6e2a, 0x8c41, 0x4d7e, { 0x9a, 0x16, 0x2e, 0x70, 0xc4, 0xb8, 0x53, 0xd9 } \
+  }
+
+extern EFI_GUID  gTpm2CommandLatencyHobGuid;
+
+///
+/// Number of distinct command codes tracked. Commands beyond that are counted
+/// in DroppedCount only.
+///
+#define TPM2_COMMAND_LATENCY_MAX_ENTRIES  48
+
+typedef struct {
+  ///
+  /// TPM_CC of the command, in host byte order.
+  ///
+  UINT32    CommandCode;
+  ///
+  /// Number of commands completed.
+  ///
+  UINT32    Count;
+  ///
+  /// Shortest, longest and total time in nanoseconds from sending the command
+  /// to receiving its response. The average is TotalTime / Count.
+  ///
+  UINT64    MinTime;
+  UINT64    MaxTime;
+  UINT64    TotalTime;
+} TPM2_COMMAND_LATENCY_ENTRY;
+
+typedef struct {
+  ///
+  /// Number of valid entries in Entries.
+  ///
+  UINT32                        EntryCount;
+  ///
+  /// Number of commands not recorded because Entries was full.
+  ///
+  UINT32                        DroppedCount;
+  TPM2_COMMAND_LATENCY_ENTRY    Entries[TPM2_COMMAND_LATENCY_MAX_ENTRIES];
+} TPM2_COMMAND_LATENCY_HOB;
+
+#endif
@@ -0,0 +1,60 @@
+/** @file
+  Pass the Authenticode digests of a PE/COFF image between the security handlers
+  of one image load.
+
+  The measured boot handler gets the digests of the image it measured from
+  Tcg2Dxe, and image verification takes them instead of hashing the image again.
+  The digests live in the module that links this library only; there is no
+  interface for other modules to provide digests.
+
+  The library registers a security handler of its own, ahead of the handlers of
+  the libraries that depend on it, that drops any digests at the start of every
+  image load. Digests set during one image load can therefore only be taken
+  during the same image load, and are dropped when they are taken.
+
+  Copyright (c) Microsoft Corporation.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef PE_IMAGE_DIGEST_LIB_H_
+#define PE_IMAGE_DIGEST_LIB_H_
+
+#include <IndustryStandard/Tpm20.h>
+
+/**
+  Set the digests of the image of the current image load.
+
+  @param[in]  FileBuffer  The image buffer passed to the security handlers.
+  @param[in]  FileSize    The size of the image buffer in bytes.
+  @param[in]  DigestList  The Authenticode digests of the image.
+**/
+VOID
+EFIAPI
+SetPeImageDigests (
+  IN CONST VOID                *FileBuffer,
+  IN UINTN                     FileSize,
+  IN CONST TPML_DIGEST_VALUES  *DigestList
+  );
+
+/**
+  Take the digests of the image of the current image load. The digests are
+  dropped whether they are returned or not.
+
+  @param[in]  FileBuffer  The image buffer passed to the security handlers.
+  @param[in]  FileSize    The size of the image buffer in bytes.
+  @param[out] DigestList  The Authenticode digests of the image.
+
+  @retval EFI_SUCCESS            The digests were returned.
+  @retval EFI_NOT_FOUND          No digests were set for FileBuffer and FileSize
+                                 during the current image load.
+  @retval EFI_INVALID_PARAMETER  DigestList is NULL.
+**/
+EFI_STATUS
+EFIAPI
+TakePeImageDigests (
+  IN  CONST VOID          *FileBuffer,
+  IN  UINTN               FileSize,
+  OUT TPML_DIGEST_VALUES  *DigestList
+  );
+
+#endif
@@ -0,0 +1,58 @@
+/** @file
+  Tcg2 PE image digest protocol.
+
+  Tcg2Dxe produces this protocol next to the Tcg2 protocol. It returns the
+  Authenticode digests that Tcg2Dxe calculated and extended for the PE/COFF image
+  of the last HashLogExtendEvent () call, so that the measured boot security
+  handler can hand them to image verification for the same image load.
+
+  The protocol is read only: the digests always come from Tcg2Dxe hashing the
+  image itself. They are dropped when they are read and at the start of every
+  HashLogExtendEvent () call.
+
+  Copyright (c) Microsoft Corporation.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef TCG2_PE_IMAGE_DIGEST_H_
+#define TCG2_PE_IMAGE_DIGEST_H_
+
+#include <IndustryStandard/Tpm20.h>
+
+#define EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL_GUID \
+  { \
+    0x3b8f4c2e, 0x71d5, 0x4a09, { 0xb6, 0x2c, 0x5e, 0x93, 0x0a, 0xd7, 0x41, 0xf8 } \
+  }
+
+typedef struct _EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL;
+
+/**
+  Get the digests that the last HashLogExtendEvent () call extended for a PE/COFF
+  image, and drop them.
+
+  @param[in]  This          Pointer to the EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL instance.
+  @param[in]  ImageAddress  The image address passed to HashLogExtendEvent ().
+  @param[in]  ImageSize     The image size passed to HashLogExtendEvent ().
+  @param[out] DigestList    The digests extended for the image, one per active PCR bank.
+
+  @retval EFI_SUCCESS            The digests were returned.
+  @retval EFI_NOT_FOUND          The last HashLogExtendEvent () call did not measure
+                                 a PE/COFF image at ImageAddress of ImageSize bytes.
+  @retval EFI_INVALID_PARAMETER  DigestList is NULL.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_TCG2_GET_PE_IMAGE_DIGESTS)(
+  IN  EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL  *This,
+  IN  EFI_PHYSICAL_ADDRESS                 ImageAddress,
+  IN  UINT64                               ImageSize,
+  OUT TPML_DIGEST_VALUES                   *DigestList
+  );
+
+struct _EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL {
+  EDKII_TCG2_GET_PE_IMAGE_DIGESTS    GetPeImageDigests;
+};
+
+extern EFI_GUID  gEdkiiTcg2PeImageDigestProtocolGuid;
+
+#endif
@@ -36,6 +36,25 @@ UINT8  *mImageBase = NULL;
 UINT8  mImageDigest[MAX_DIGEST_SIZE];
 UINTN  mImageDigestSize;
 
+//
+// Digests of current PE/COFF image, indexed by hash algorithm. mImageDigestsValid
+// holds the HASHALG_MASK () bits of the digests calculated for this image.
+//
+UINT8   mImageDigests[HASHALG_MAX][MAX_DIGEST_SIZE];
+UINT32  mImageDigestsValid;
+
+//
+// TPM algorithm IDs of the hash algorithms, used to take the image digests
+// that measured boot calculated for the same image load.
+//
+TPMI_ALG_HASH  mHashTpmAlg[HASHALG_MAX] = {
+  TPM_ALG_SHA1,
+  TPM_ALG_NULL,
+  TPM_ALG_SHA256,
+  TPM_ALG_SHA384,
+  TPM_ALG_SHA512
+};
+
 //
 // Notify string for authorization UI.
 //
@@ -46,29 +65,6 @@ CHAR16  mNotifyString2[MAX_NOTIFY_STRING_LEN] = L"Launch this image anyway? (Yes
 //
 CONST UINT8  mRsaE[] = { 0x01, 0x00, 0x01 };
 
-//
-// OID ASN.1 Value for Hash Algorithms
-//
-UINT8  mHashOidValue[] = {
-  0x2B, 0x0E, 0x03, 0x02, 0x1A,                         // OBJ_sha1
-  0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x04, // OBJ_sha224
-  0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, // OBJ_sha256
-  0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x02, // OBJ_sha384
-  0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x03, // OBJ_sha512
-};
-
-HASH_TABLE  mHash[] = {
- #ifndef DISABLE_SHA1_DEPRECATED_INTERFACES
-  { L"SHA1",   20, &mHashOidValue[0],  5, Sha1GetContextSize,   Sha1Init,   Sha1Update,   Sha1Final   },
- #else
-  { L"SHA1",   20, &mHashOidValue[0],  5, NULL,                 NULL,       NULL,         NULL        },
- #endif
-  { L"SHA224", 28, &mHashOidValue[5],  9, NULL,                 NULL,       NULL,         NULL        },
-  { L"SHA256", 32, &mHashOidValue[14], 9, Sha256GetContextSize, Sha256Init, Sha256Update, Sha256Final },
-  { L"SHA384", 48, &mHashOidValue[23], 9, Sha384GetContextSize, Sha384Init, Sha384Update, Sha384Final },
-  { L"SHA512", 64, &mHashOidValue[32], 9, Sha512GetContextSize, Sha512Init, Sha512Update, Sha512Final }
-};
-
 EFI_STRING  mHashTypeStr;
 
 /**
@@ -271,10 +267,72 @@ GetImageType (
   return IMAGE_UNKNOWN;
 }
 
+/**
+  Calculate the hashes of the current Pe/Coff image for all the algorithms in
+  HashAlgMask that have not been calculated yet, in a single pass over the image.
+
+  @param[in]    HashAlgMask   The hash algorithms, as HASHALG_MASK () values.
+
+  @retval TRUE            The digests of all the algorithms are available.
+  @retval FALSE           Fail in hash image.
+
+**/
+BOOLEAN
+PrepareImageDigests (
+  IN  UINT32  HashAlgMask
+  )
+{
+  HashAlgMask &= ~mImageDigestsValid;
+  if (HashAlgMask == 0) {
+    return TRUE;
+  }
+
+  if (!HashPeImageAll (mImageBase, mImageSize, mPeCoffHeaderOffset, HashAlgMask, mImageDigests)) {
+    return FALSE;
+  }
+
+  mImageDigestsValid |= HashAlgMask;
+  return TRUE;
+}
+
+/**
+  Take the digests of the current Pe/Coff image that measured boot calculated
+  during the same image load, so that PrepareImageDigests () does not calculate
+  them again.
+**/
+VOID
+TakeMeasuredImageDigests (
+  VOID
+  )
+{
+  EFI_STATUS          Status;
+  TPML_DIGEST_VALUES  DigestList;
+  UINT32              Index;
+  UINT32              HashAlg;
+
+  Status = TakePeImageDigests (mImageBase, mImageSize, &DigestList);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  for (Index = 0; Index < DigestList.count; Index++) {
+    for (HashAlg = 0; HashAlg < HASHALG_MAX; HashAlg++) {
+      if ((mHashTpmAlg[HashAlg] != TPM_ALG_NULL) && (mHashTpmAlg[HashAlg] == DigestList.digests[Index].hashAlg)) {
+        CopyMem (mImageDigests[HashAlg], &DigestList.digests[Index].digest, mHash[HashAlg].DigestLength);
+        mImageDigestsValid |= HASHALG_MASK (HashAlg);
+        break;
+      }
+    }
+  }
+}
+
 /**
   Calculate hash of Pe/Coff image based on the authenticode image hashing in
   PE/COFF Specification 8.0 Appendix A
 
+  The digests of the current image are calculated once per hash algorithm, later
+  calls for the same algorithm return the digest calculated before.
+
   Caution: This function may receive untrusted input.
   PE/COFF image is external input, so this function will validate its data structure
   within this image buffer before use.
@@ -293,30 +351,10 @@ HashPeImage (
   IN  UINT32  HashAlg
   )
 {
-  BOOLEAN                   Status;
-  EFI_IMAGE_SECTION_HEADER  *Section;
-  VOID                      *HashCtx;
-  UINTN                     CtxSize;
-  UINT8                     *HashBase;
-  UINTN                     HashSize;
-  UINTN                     SumOfBytesHashed;
-  EFI_IMAGE_SECTION_HEADER  *SectionHeader;
-  UINTN                     Index;
-  UINTN                     Pos;
-  UINT32                    CertSize;
-  UINT32                    NumberOfRvaAndSizes;
-
-  HashCtx       = NULL;
-  SectionHeader = NULL;
-  Status        = FALSE;
-
   if ((HashAlg >= HASHALG_MAX)) {
     return FALSE;
   }
 
-  //
-  // Initialize context of hash.
-  //
   ZeroMem (mImageDigest, MAX_DIGEST_SIZE);
 
   switch (HashAlg) {
@@ -347,268 +385,17 @@ HashPeImage (
   }
 
   mHashTypeStr = mHash[HashAlg].Name;
-  CtxSize      = mHash[HashAlg].GetContextSize ();
 
-  HashCtx = AllocatePool (CtxSize);
-  if (HashCtx == NULL) {
+  if (!PrepareImageDigests (HASHALG_MASK (HashAlg))) {
     return FALSE;
   }
 
-  // 1.  Load the image header into memory.
-
-  // 2.  Initialize a SHA hash context.
-  Status = mHash[HashAlg].HashInit (HashCtx);
-
-  if (!Status) {
-    goto Done;
-  }
-
-  //
-  // Measuring PE/COFF Image Header;
-  // But CheckSum field and SECURITY data directory (certificate) are excluded
-  //
-
-  //
-  // 3.  Calculate the distance from the base of the image header to the image checksum address.
-  // 4.  Hash the image header from its base to beginning of the image checksum.
-  //
-  HashBase = mImageBase;
-  if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-    //
-    // Use PE32 offset.
-    //
-    HashSize            = (UINTN)(&mNtHeader.Pe32->OptionalHeader.CheckSum) - (UINTN)HashBase;
-    NumberOfRvaAndSizes = mNtHeader.Pe32->OptionalHeader.NumberOfRvaAndSizes;
-  } else if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
-    //
-    // Use PE32+ offset.
-    //
-    HashSize            = (UINTN)(&mNtHeader.Pe32Plus->OptionalHeader.CheckSum) - (UINTN)HashBase;
-    NumberOfRvaAndSizes = mNtHeader.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes;
-  } else {
-    //
-    // Invalid header magic number.
-    //
-    Status = FALSE;
-    goto Done;
-  }
-
-  Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-  if (!Status) {
-    goto Done;
-  }
-
-  //
-  // 5.  Skip over the image checksum (it occupies a single ULONG).
-  //
-  if (NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
-    //
-    // 6.  Since there is no Cert Directory in optional header, hash everything
-    //     from the end of the checksum to the end of image header.
-    //
-    if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-      //
-      // Use PE32 offset.
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32->OptionalHeader.CheckSum + sizeof (UINT32);
-      HashSize = mNtHeader.Pe32->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)mImageBase);
-    } else {
-      //
-      // Use PE32+ offset.
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32Plus->OptionalHeader.CheckSum + sizeof (UINT32);
-      HashSize = mNtHeader.Pe32Plus->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)mImageBase);
-    }
-
-    if (HashSize != 0) {
-      Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-      if (!Status) {
-        goto Done;
-      }
-    }
-  } else {
-    //
-    // 7.  Hash everything from the end of the checksum to the start of the Cert Directory.
-    //
-    if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-      //
-      // Use PE32 offset.
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32->OptionalHeader.CheckSum + sizeof (UINT32);
-      HashSize = (UINTN)(&mNtHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]) - (UINTN)HashBase;
-    } else {
-      //
-      // Use PE32+ offset.
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32Plus->OptionalHeader.CheckSum + sizeof (UINT32);
-      HashSize = (UINTN)(&mNtHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]) - (UINTN)HashBase;
-    }
-
-    if (HashSize != 0) {
-      Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-      if (!Status) {
-        goto Done;
-      }
-    }
-
-    //
-    // 8.  Skip over the Cert Directory. (It is sizeof(IMAGE_DATA_DIRECTORY) bytes.)
-    // 9.  Hash everything from the end of the Cert Directory to the end of image header.
-    //
-    if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-      //
-      // Use PE32 offset
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1];
-      HashSize = mNtHeader.Pe32->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)mImageBase);
-    } else {
-      //
-      // Use PE32+ offset.
-      //
-      HashBase = (UINT8 *)&mNtHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1];
-      HashSize = mNtHeader.Pe32Plus->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)mImageBase);
-    }
-
-    if (HashSize != 0) {
-      Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-      if (!Status) {
-        goto Done;
-      }
-    }
-  }
-
-  //
-  // 10. Set the SUM_OF_BYTES_HASHED to the size of the header.
-  //
-  if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-    //
-    // Use PE32 offset.
-    //
-    SumOfBytesHashed = mNtHeader.Pe32->OptionalHeader.SizeOfHeaders;
-  } else {
-    //
-    // Use PE32+ offset
-    //
-    SumOfBytesHashed = mNtHeader.Pe32Plus->OptionalHeader.SizeOfHeaders;
-  }
-
-  Section = (EFI_IMAGE_SECTION_HEADER *)(
-                                         mImageBase +
-                                         mPeCoffHeaderOffset +
-                                         sizeof (UINT32) +
-                                         sizeof (EFI_IMAGE_FILE_HEADER) +
-                                         mNtHeader.Pe32->FileHeader.SizeOfOptionalHeader
-                                         );
-
-  //
-  // 11. Build a temporary table of pointers to all the IMAGE_SECTION_HEADER
-  //     structures in the image. The 'NumberOfSections' field of the image
-  //     header indicates how big the table should be. Do not include any
-  //     IMAGE_SECTION_HEADERs in the table whose 'SizeOfRawData' field is zero.
-  //
-  SectionHeader = (EFI_IMAGE_SECTION_HEADER *)AllocateZeroPool (sizeof (EFI_IMAGE_SECTION_HEADER) * mNtHeader.Pe32->FileHeader.NumberOfSections);
-  if (SectionHeader == NULL) {
-    Status = FALSE;
-    goto Done;
-  }
-
-  //
-  // 12.  Using the 'PointerToRawData' in the referenced section headers as
-  //      a key, arrange the elements in the table in ascending order. In other
-  //      words, sort the section headers according to the disk-file offset of
-  //      the section.
-  //
-  for (Index = 0; Index < mNtHeader.Pe32->FileHeader.NumberOfSections; Index++) {
-    Pos = Index;
-    while ((Pos > 0) && (Section->PointerToRawData < SectionHeader[Pos - 1].PointerToRawData)) {
-      CopyMem (&SectionHeader[Pos], &SectionHeader[Pos - 1], sizeof (EFI_IMAGE_SECTION_HEADER));
-      Pos--;
-    }
-
-    CopyMem (&SectionHeader[Pos], Section, sizeof (EFI_IMAGE_SECTION_HEADER));
-    Section += 1;
-  }
-
-  //
-  // 13.  Walk through the sorted table, bring the corresponding section
-  //      into memory, and hash the entire section (using the 'SizeOfRawData'
-  //      field in the section header to determine the amount of data to hash).
-  // 14.  Add the section's 'SizeOfRawData' to SUM_OF_BYTES_HASHED .
-  // 15.  Repeat steps 13 and 14 for all the sections in the sorted table.
-  //
-  for (Index = 0; Index < mNtHeader.Pe32->FileHeader.NumberOfSections; Index++) {
-    Section = &SectionHeader[Index];
-    if (Section->SizeOfRawData == 0) {
-      continue;
-    }
-
-    HashBase = mImageBase + Section->PointerToRawData;
-    HashSize = (UINTN)Section->SizeOfRawData;
-
-    Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-    if (!Status) {
-      goto Done;
-    }
-
-    SumOfBytesHashed += HashSize;
-  }
-
-  //
-  // 16.  If the file size is greater than SUM_OF_BYTES_HASHED, there is extra
-  //      data in the file that needs to be added to the hash. This data begins
-  //      at file offset SUM_OF_BYTES_HASHED and its length is:
-  //             FileSize  -  (CertDirectory->Size)
-  //
-  if (mImageSize > SumOfBytesHashed) {
-    HashBase = mImageBase + SumOfBytesHashed;
-
-    if (NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
-      CertSize = 0;
-    } else {
-      if (mNtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-        //
-        // Use PE32 offset.
-        //
-        CertSize = mNtHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size;
-      } else {
-        //
-        // Use PE32+ offset.
-        //
-        CertSize = mNtHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size;
-      }
-    }
-
-    if (mImageSize > CertSize + SumOfBytesHashed) {
-      HashSize = (UINTN)(mImageSize - CertSize - SumOfBytesHashed);
-
-      Status = mHash[HashAlg].HashUpdate (HashCtx, HashBase, HashSize);
-      if (!Status) {
-        goto Done;
-      }
-    } else if (mImageSize < CertSize + SumOfBytesHashed) {
-      Status = FALSE;
-      goto Done;
-    }
-  }
-
-  Status = mHash[HashAlg].HashFinal (HashCtx, mImageDigest);
-
-Done:
-  if (HashCtx != NULL) {
-    FreePool (HashCtx);
-  }
-
-  if (SectionHeader != NULL) {
-    FreePool (SectionHeader);
-  }
-
-  return Status;
+  CopyMem (mImageDigest, mImageDigests[HashAlg], mImageDigestSize);
+  return TRUE;
 }
 
 /**
-  Recognize the Hash algorithm in PE/COFF Authenticode and calculate hash of
-  Pe/Coff image based on the authenticode image hashing in PE/COFF Specification
-  8.0 Appendix A
+  Recognize the Hash algorithm in PE/COFF Authenticode.
 
   Caution: This function may receive untrusted input.
   PE/COFF image is external input, so this function will validate its data structure
@@ -617,17 +404,16 @@ Done:
   @param[in]  AuthData            Pointer to the Authenticode Signature retrieved from signed image.
   @param[in]  AuthDataSize        Size of the Authenticode Signature in bytes.
 
-  @retval EFI_UNSUPPORTED             Hash algorithm is not supported.
-  @retval EFI_SUCCESS                 Hash successfully.
+  @return The hash algorithm type, or HASHALG_MAX if the algorithm is not recognized.
 
 **/
-EFI_STATUS
-HashPeImageByType (
+UINT32
+GetAuthenticodeHashAlg (
   IN UINT8  *AuthData,
   IN UINTN  AuthDataSize
   )
 {
-  UINT8  Index;
+  UINT32  Index;
 
   for (Index = 0; Index < HASHALG_MAX; Index++) {
     //
@@ -650,7 +436,7 @@ HashPeImageByType (
     }
 
     if (AuthDataSize < 32 + mHash[Index].OidLength) {
-      return EFI_UNSUPPORTED;
+      return HASHALG_MAX;
     }
 
     if (CompareMem (AuthData + 32, mHash[Index].OidValue, mHash[Index].OidLength) == 0) {
@@ -658,6 +444,34 @@ HashPeImageByType (
     }
   }
 
+  return Index;
+}
+
+/**
+  Recognize the Hash algorithm in PE/COFF Authenticode and calculate hash of
+  Pe/Coff image based on the authenticode image hashing in PE/COFF Specification
+  8.0 Appendix A
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use.
+
+  @param[in]  AuthData            Pointer to the Authenticode Signature retrieved from signed image.
+  @param[in]  AuthDataSize        Size of the Authenticode Signature in bytes.
+
+  @retval EFI_UNSUPPORTED             Hash algorithm is not supported.
+  @retval EFI_SUCCESS                 Hash successfully.
+
+**/
+EFI_STATUS
+HashPeImageByType (
+  IN UINT8  *AuthData,
+  IN UINTN  AuthDataSize
+  )
+{
+  UINT32  Index;
+
+  Index = GetAuthenticodeHashAlg (AuthData, AuthDataSize);
   if (Index == HASHALG_MAX) {
     return EFI_UNSUPPORTED;
   }
@@ -672,6 +486,92 @@ HashPeImageByType (
   return EFI_SUCCESS;
 }
 
+/**
+  Collect the hash algorithms used by the Authenticode signatures in the attribute
+  certificate table of the current PE/COFF image.
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use. The walk applies the same checks as the
+  certificate loop in DxeImageVerificationHandler(), and stops where that loop stops.
+
+  @param[in]  SecDataDir          Security data directory of the current image.
+
+  @return The HASHALG_MASK () bits of the recognized hash algorithms.
+
+**/
+UINT32
+GetSignatureHashAlgMask (
+  IN EFI_IMAGE_DATA_DIRECTORY  *SecDataDir
+  )
+{
+  WIN_CERTIFICATE            *WinCertificate;
+  WIN_CERTIFICATE_EFI_PKCS   *PkcsCertData;
+  WIN_CERTIFICATE_UEFI_GUID  *WinCertUefiGuid;
+  UINT8                      *AuthData;
+  UINTN                      AuthDataSize;
+  UINT32                     OffSet;
+  UINT32                     SecDataDirEnd;
+  UINT32                     SecDataDirLeft;
+  UINT32                     HashAlg;
+  UINT32                     HashAlgMask;
+
+  HashAlgMask   = 0;
+  SecDataDirEnd = SecDataDir->VirtualAddress + SecDataDir->Size;
+  for (OffSet = SecDataDir->VirtualAddress;
+       OffSet < SecDataDirEnd;
+       OffSet += (WinCertificate->dwLength + ALIGN_SIZE (WinCertificate->dwLength)))
+  {
+    SecDataDirLeft = SecDataDirEnd - OffSet;
+    if (SecDataDirLeft <= sizeof (WIN_CERTIFICATE)) {
+      break;
+    }
+
+    WinCertificate = (WIN_CERTIFICATE *)(mImageBase + OffSet);
+    if ((SecDataDirLeft < WinCertificate->dwLength) ||
+        (SecDataDirLeft - WinCertificate->dwLength <
+         ALIGN_SIZE (WinCertificate->dwLength)))
+    {
+      break;
+    }
+
+    if (WinCertificate->wCertificateType == WIN_CERT_TYPE_PKCS_SIGNED_DATA) {
+      PkcsCertData = (WIN_CERTIFICATE_EFI_PKCS *)WinCertificate;
+      if (PkcsCertData->Hdr.dwLength <= sizeof (PkcsCertData->Hdr)) {
+        break;
+      }
+
+      AuthData     = PkcsCertData->CertData;
+      AuthDataSize = PkcsCertData->Hdr.dwLength - sizeof (PkcsCertData->Hdr);
+    } else if (WinCertificate->wCertificateType == WIN_CERT_TYPE_EFI_GUID) {
+      WinCertUefiGuid = (WIN_CERTIFICATE_UEFI_GUID *)WinCertificate;
+      if (WinCertUefiGuid->Hdr.dwLength <= OFFSET_OF (WIN_CERTIFICATE_UEFI_GUID, CertData)) {
+        break;
+      }
+
+      if (!CompareGuid (&WinCertUefiGuid->CertType, &gEfiCertPkcs7Guid)) {
+        continue;
+      }
+
+      AuthData     = WinCertUefiGuid->CertData;
+      AuthDataSize = WinCertUefiGuid->Hdr.dwLength - OFFSET_OF (WIN_CERTIFICATE_UEFI_GUID, CertData);
+    } else {
+      if (WinCertificate->dwLength < sizeof (WIN_CERTIFICATE)) {
+        break;
+      }
+
+      continue;
+    }
+
+    HashAlg = GetAuthenticodeHashAlg (AuthData, AuthDataSize);
+    if (HashAlg < HASHALG_MAX) {
+      HashAlgMask |= HASHALG_MASK (HashAlg);
+    }
+  }
+
+  return HashAlgMask & GetSupportedHashAlgMask ();
+}
+
 /**
   Returns the size of a given image execution info table in bytes.
 
@@ -990,21 +890,15 @@ IsSignatureFoundInDatabase (
   )
 {
   EFI_STATUS          Status;
-  EFI_SIGNATURE_LIST  *CertList;
+  SIGNATURE_DATABASE  *Database;
   EFI_SIGNATURE_DATA  *Cert;
-  UINTN               DataSize;
-  UINT8               *Data;
-  UINTN               Index;
-  UINTN               CertCount;
 
   //
-  // Read signature database variable.
+  // Get the parsed signature database.
   //
   *IsFound = FALSE;
-  Data     = NULL;
-  DataSize = 0;
-  Status   = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  if (Status != EFI_BUFFER_TOO_SMALL) {
+  Status   = GetSignatureDatabase (VariableName, &Database);
+  if (EFI_ERROR (Status)) {
     if (Status == EFI_NOT_FOUND) {
       //
       // No database, no need to search.
@@ -1015,60 +909,21 @@ IsSignatureFoundInDatabase (
     return Status;
   }
 
-  Data = (UINT8 *)AllocateZeroPool (DataSize);
-  if (Data == NULL) {
-    return EFI_OUT_OF_RESOURCES;
-  }
-
-  Status = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, Data);
-  if (EFI_ERROR (Status)) {
-    goto Done;
-  }
-
-  //
-  // Enumerate all signature data in SigDB to check if signature exists for executable.
-  //
-  CertList = (EFI_SIGNATURE_LIST *)Data;
-  // MU_CHANGE Start - CodeQL change - comparison-with-wider-type
-  while ((DataSize > 0) && (DataSize >= (UINTN)CertList->SignatureListSize)) {
-    // MU_CHANGE End - CodeQL change - comparison-with-wider-type
-    CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
-    Cert      = (EFI_SIGNATURE_DATA *)((UINT8 *)CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
-    if ((CertList->SignatureSize == sizeof (EFI_SIGNATURE_DATA) - 1 + SignatureSize) && (CompareGuid (&CertList->SignatureType, CertType))) {
-      for (Index = 0; Index < CertCount; Index++) {
-        if (CompareMem (Cert->SignatureData, Signature, SignatureSize) == 0) {
-          //
-          // Find the signature in database.
-          //
-          *IsFound = TRUE;
-          //
-          // Entries in UEFI_IMAGE_SECURITY_DATABASE that are used to validate image should be measured
-          //
-          if (StrCmp (VariableName, EFI_IMAGE_SECURITY_DATABASE) == 0) {
-            SecureBootHook (VariableName, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, Cert);
-          }
-
-          break;
-        }
-
-        Cert = (EFI_SIGNATURE_DATA *)((UINT8 *)Cert + CertList->SignatureSize);
-      }
-
-      if (*IsFound) {
-        break;
-      }
+  Cert = FindSignatureInDatabase (Database, Signature, CertType, SignatureSize);
+  if (Cert != NULL) {
+    //
+    // Find the signature in database.
+    //
+    *IsFound = TRUE;
+    //
+    // Entries in UEFI_IMAGE_SECURITY_DATABASE that are used to validate image should be measured
+    //
+    if (StrCmp (VariableName, EFI_IMAGE_SECURITY_DATABASE) == 0) {
+      SecureBootHook (VariableName, &gEfiImageSecurityDatabaseGuid, sizeof (EFI_SIGNATURE_DATA) - 1 + SignatureSize, Cert);
     }
-
-    DataSize -= CertList->SignatureListSize;
-    CertList  = (EFI_SIGNATURE_LIST *)((UINT8 *)CertList + CertList->SignatureListSize);
   }
 
-Done:
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-
-  return Status;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -1150,7 +1005,7 @@ PassTimestampCheck (
   BOOLEAN             VerifyStatus;
   EFI_SIGNATURE_LIST  *CertList;
   EFI_SIGNATURE_DATA  *Cert;
-  UINT8               *DbtData;
+  SIGNATURE_DATABASE  *Dbt;
   UINTN               DbtDataSize;
   UINT8               *RootCert;
   UINTN               RootCertSize;
@@ -1162,7 +1017,6 @@ PassTimestampCheck (
   // Variable Initialization
   //
   VerifyStatus = FALSE;
-  DbtData      = NULL;
   CertList     = NULL;
   Cert         = NULL;
   RootCert     = NULL;
@@ -1179,23 +1033,13 @@ PassTimestampCheck (
   // RevocationTime is non-zero, the certificate should be considered to be revoked from that time and onwards.
   // Using the dbt to get the trusted TSA certificates.
   //
-  DbtDataSize = 0;
-  Status      = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE2, &gEfiImageSecurityDatabaseGuid, NULL, &DbtDataSize, NULL);
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    goto Done;
-  }
-
-  DbtData = (UINT8 *)AllocateZeroPool (DbtDataSize);
-  if (DbtData == NULL) {
-    goto Done;
-  }
-
-  Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE2, &gEfiImageSecurityDatabaseGuid, NULL, &DbtDataSize, (VOID *)DbtData);
+  Status = GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE2, &Dbt);
   if (EFI_ERROR (Status)) {
     goto Done;
   }
 
-  CertList = (EFI_SIGNATURE_LIST *)DbtData;
+  DbtDataSize = Dbt->DataSize;
+  CertList    = (EFI_SIGNATURE_LIST *)Dbt->Data;
   // MU_CHANGE Start - CodeQL change - comparison-with-wider-type
   while ((DbtDataSize > 0) && (DbtDataSize >= (UINTN)CertList->SignatureListSize)) {
     // MU_CHANGE End - CodeQL change - comparison-with-wider-type
@@ -1230,10 +1074,6 @@ PassTimestampCheck (
   }
 
 Done:
-  if (DbtData != NULL) {
-    FreePool (DbtData);
-  }
-
   return VerifyStatus;
 }
 
@@ -1257,6 +1097,7 @@ IsForbiddenByDbx (
   EFI_STATUS          Status;
   BOOLEAN             IsForbidden;
   BOOLEAN             IsFound;
+  SIGNATURE_DATABASE  *Dbx;
   UINT8               *Data;
   UINTN               DataSize;
   EFI_SIGNATURE_LIST  *CertList;
@@ -1294,10 +1135,8 @@ IsForbiddenByDbx (
   //
   // The image will not be forbidden if dbx can't be got.
   //
-  DataSize = 0;
-  Status   = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  ASSERT (EFI_ERROR (Status));
-  if (Status != EFI_BUFFER_TOO_SMALL) {
+  Status = GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE1, &Dbx);
+  if (EFI_ERROR (Status)) {
     if (Status == EFI_NOT_FOUND) {
       //
       // Evidently not in dbx if the database doesn't exist.
@@ -1308,15 +1147,8 @@ IsForbiddenByDbx (
     return IsForbidden;
   }
 
-  Data = (UINT8 *)AllocateZeroPool (DataSize);
-  if (Data == NULL) {
-    return IsForbidden;
-  }
-
-  Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, (VOID *)Data);
-  if (EFI_ERROR (Status)) {
-    goto Done;
-  }
+  Data     = Dbx->Data;
+  DataSize = Dbx->DataSize;
 
   //
   // Verify image signature with RAW X509 certificates in DBX database.
@@ -1426,10 +1258,6 @@ IsForbiddenByDbx (
   IsForbidden = FALSE;
 
 Done:
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-
   Pkcs7FreeSigners (CertBuffer);
   Pkcs7FreeSigners (TrustedCert);
 
@@ -1463,6 +1291,8 @@ IsAllowedByDb (
   UINTN               RootCertSize;
   UINTN               Index;
   UINTN               CertCount;
+  SIGNATURE_DATABASE  *Db;
+  SIGNATURE_DATABASE  *Dbx;
   UINTN               DbxDataSize;
   UINT8               *DbxData;
   EFI_TIME            RevocationTime;
@@ -1479,22 +1309,13 @@ IsAllowedByDb (
   // Fetch 'db' content. If 'db' doesn't exist or encounters problem to get the
   // data, return not-allowed-by-db (FALSE).
   //
-  DataSize = 0;
-  Status   = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  ASSERT (EFI_ERROR (Status));
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    return VerifyStatus;
-  }
-
-  Data = (UINT8 *)AllocateZeroPool (DataSize);
-  if (Data == NULL) {
+  Status = GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE, &Db);
+  if (EFI_ERROR (Status)) {
     return VerifyStatus;
   }
 
-  Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, (VOID *)Data);
-  if (EFI_ERROR (Status)) {
-    goto Done;
-  }
+  Data     = Db->Data;
+  DataSize = Db->DataSize;
 
   //
   // Fetch 'dbx' content. If 'dbx' doesn't exist, continue to check 'db'.
@@ -1502,9 +1323,8 @@ IsAllowedByDb (
   // not-allowed-by-db (FALSE) to avoid bypass.
   //
   DbxDataSize = 0;
-  Status      = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DbxDataSize, NULL);
-  ASSERT (EFI_ERROR (Status));
-  if (Status != EFI_BUFFER_TOO_SMALL) {
+  Status      = GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE1, &Dbx);
+  if (EFI_ERROR (Status)) {
     if (Status != EFI_NOT_FOUND) {
       goto Done;
     }
@@ -1513,18 +1333,8 @@ IsAllowedByDb (
     // 'dbx' does not exist. Continue to check 'db'.
     //
   } else {
-    //
-    // 'dbx' exists. Get its content.
-    //
-    DbxData = (UINT8 *)AllocateZeroPool (DbxDataSize);
-    if (DbxData == NULL) {
-      goto Done;
-    }
-
-    Status = gRT->GetVariable (EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, NULL, &DbxDataSize, (VOID *)DbxData);
-    if (EFI_ERROR (Status)) {
-      goto Done;
-    }
+    DbxData     = Dbx->Data;
+    DbxDataSize = Dbx->DataSize;
   }
 
   //
@@ -1605,14 +1415,6 @@ Done:
     SecureBootHook (EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, CertData);
   }
 
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-
-  if (DbxData != NULL) {
-    FreePool (DbxData);
-  }
-
   return VerifyStatus;
 }
 
@@ -1785,8 +1587,15 @@ DxeImageVerificationHandler (
     return EFI_ACCESS_DENIED;
   }
 
-  mImageBase = (UINT8 *)FileBuffer;
-  mImageSize = FileSize;
+  mImageBase         = (UINT8 *)FileBuffer;
+  mImageSize         = FileSize;
+  mImageDigestsValid = 0;
+  TakeMeasuredImageDigests ();
+
+  //
+  // Signature databases retired since the previous image are no longer referenced.
+  //
+  ReleaseStaleSignatureDatabases ();
 
   ZeroMem (&ImageContext, sizeof (ImageContext));
   ImageContext.Handle    = (VOID *)FileBuffer;
@@ -1852,7 +1661,9 @@ DxeImageVerificationHandler (
     //
     // This image is not signed. The hash value of the image must match a record in the security database "db",
     // and not be reflected in the security data base "dbx".
+    // Calculate the digests of all the supported algorithms in one pass over the image.
     //
+    PrepareImageDigests (GetSupportedHashAlgMask ());
     HashAlg = sizeof (mHash) / sizeof (HASH_TABLE);
     while (HashAlg > 0) {
       HashAlg--;
@@ -1909,7 +1720,9 @@ DxeImageVerificationHandler (
   // Verify the signature of the image, multiple signatures are allowed as per PE/COFF Section 4.7
   // "Attribute Certificate Table".
   // The first certificate starts at offset (SecDataDir->VirtualAddress) from the start of the file.
+  // Calculate the digests for all the algorithms used by the signatures in one pass over the image.
   //
+  PrepareImageDigests (GetSignatureHashAlgMask (SecDataDir));
   SecDataDirEnd = SecDataDir->VirtualAddress + SecDataDir->Size;
   for (OffSet = SecDataDir->VirtualAddress;
        OffSet < SecDataDirEnd;
@@ -20,6 +20,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/MemoryAllocationLib.h>
 #include <Library/BaseCryptLib.h>
 #include <Library/PcdLib.h>
+#include <Library/PeImageDigestLib.h>
 #include <Library/DevicePathLib.h>
 #include <Library/SecurityManagementLib.h>
 #include <Library/PeCoffLib.h>
@@ -27,7 +28,6 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/DevicePath.h>
 #include <Protocol/BlockIo.h>
 #include <Protocol/SimpleFileSystem.h>
-#include <Protocol/VariableWrite.h>
 #include <Guid/ImageAuthentication.h>
 #include <Guid/AuthenticatedVariableFormat.h>
 #include <IndustryStandard/PeImage.h>
@@ -69,6 +69,14 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define HASHALG_SHA512  0x00000004
 #define HASHALG_MAX     0x00000005
 
+#define HASHALG_MASK(HashAlg)  (1U << (HashAlg))
+
+//
+// Size of the blocks fed to each hash algorithm in turn when several digests of
+// one image are calculated together, small enough to stay in the data cache.
+//
+#define PE_IMAGE_HASH_BLOCK_SIZE  SIZE_16KB
+
 //
 // Set max digest size as SHA512 Output (64 bytes) by far
 //
@@ -195,4 +203,137 @@ typedef struct {
   HASH_FINAL               HashFinal;
 } HASH_TABLE;
 
+extern HASH_TABLE  mHash[HASHALG_MAX];
+
+/**
+  Get the hash algorithms that are supported by the crypto library.
+
+  @return A bit mask of HASHALG_MASK () values.
+
+**/
+UINT32
+GetSupportedHashAlgMask (
+  VOID
+  );
+
+/**
+  Calculate the Authenticode digests of a Pe/Coff image for several hash algorithms
+  in a single pass over the image, based on the authenticode image hashing in
+  PE/COFF Specification 8.0 Appendix A.
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use.
+
+  @param[in]    ImageBase           Pointer to the Pe/Coff image.
+  @param[in]    ImageSize           Size of the Pe/Coff image in bytes.
+  @param[in]    PeCoffHeaderOffset  Offset of the Pe/Coff header in the image.
+  @param[in]    HashAlgMask         The hash algorithms to calculate, as HASHALG_MASK () values.
+  @param[out]   Digests             The digests, indexed by hash algorithm.
+
+  @retval TRUE            Successfully hash image.
+  @retval FALSE           Fail in hash image.
+
+**/
+BOOLEAN
+HashPeImageAll (
+  IN  UINT8   *ImageBase,
+  IN  UINTN   ImageSize,
+  IN  UINT32  PeCoffHeaderOffset,
+  IN  UINT32  HashAlgMask,
+  OUT UINT8   Digests[HASHALG_MAX][MAX_DIGEST_SIZE]
+  );
+
+//
+// Number of hash signature types (EFI_CERT_SHAxxx) indexed in a signature database.
+//
+#define SIGNATURE_HASH_TYPE_COUNT  4
+
+//
+// Range of the sorted hash entries of one signature type in SIGNATURE_DATABASE.Entries.
+//
+typedef struct {
+  UINTN    First;
+  UINTN    Count;
+} SIGNATURE_HASH_INDEX;
+
+typedef struct _SIGNATURE_DATABASE SIGNATURE_DATABASE;
+
+//
+// Parsed copy of an image security database variable (db, dbx or dbt).
+//
+struct _SIGNATURE_DATABASE {
+  //
+  // Link in the list of retired databases that are freed before the next image
+  // is verified.
+  //
+  SIGNATURE_DATABASE      *NextStale;
+  //
+  // Content of the variable, a list of EFI_SIGNATURE_LIST.
+  //
+  UINT8                   *Data;
+  UINTN                   DataSize;
+  //
+  // Hash signature entries, grouped by signature type and sorted by hash value
+  // within each group.
+  //
+  EFI_SIGNATURE_DATA      **Entries;
+  SIGNATURE_HASH_INDEX    HashIndex[SIGNATURE_HASH_TYPE_COUNT];
+};
+
+/**
+  Get the parsed content of an image security database variable.
+
+  The variable is read on every call. The parsed database is cached and reused
+  as long as the variable content is unchanged. The returned buffer is owned by
+  the cache and must not be freed or modified by the caller; it stays valid
+  until the next image is verified.
+
+  @param[in]  VariableName        Name of database variable, db, dbx or dbt.
+  @param[out] Database            The parsed database.
+
+  @retval EFI_SUCCESS             The database is returned.
+  @retval EFI_NOT_FOUND           The database variable does not exist.
+  @retval EFI_INVALID_PARAMETER   VariableName is not an image security database.
+  @retval Others                  Failed to read the database variable.
+
+**/
+EFI_STATUS
+GetSignatureDatabase (
+  IN  CHAR16              *VariableName,
+  OUT SIGNATURE_DATABASE  **Database
+  );
+
+/**
+  Find a signature in a parsed image security database.
+
+  Hash signatures of the EFI_CERT_SHAxxx types are looked up with a binary search
+  in the sorted index of the database, other signature types are searched linearly.
+
+  @param[in]  Database            The parsed database.
+  @param[in]  Signature           Pointer to signature that is searched for.
+  @param[in]  CertType            Pointer to signature type.
+  @param[in]  SignatureSize       Size of Signature.
+
+  @return The first matching signature data in the database, or NULL if not found.
+
+**/
+EFI_SIGNATURE_DATA *
+FindSignatureInDatabase (
+  IN SIGNATURE_DATABASE  *Database,
+  IN UINT8               *Signature,
+  IN EFI_GUID            *CertType,
+  IN UINTN               SignatureSize
+  );
+
+/**
+  Free the databases that have been replaced in the cache since the previous
+  image was verified.
+
+**/
+VOID
+ReleaseStaleSignatureDatabases (
+  VOID
+  );
+
 #endif
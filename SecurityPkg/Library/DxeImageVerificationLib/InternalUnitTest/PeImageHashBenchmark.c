@@ -0,0 +1,407 @@
+/** @file
+  Host based unit tests and benchmark of the single pass Authenticode hashing of
+  PE/COFF images in DxeImageVerificationLib.
+
+  A synthetic PE32+ image is built with sections listed out of file order, extra
+  data after the last section and an attribute certificate table at the end. The
+  digests calculated in one pass for all the algorithms are checked against one
+  pass per algorithm, and the SHA-256 digest against a hash of the Authenticode
+  ranges copied out by hand. The benchmark reports MB/s for every algorithm on
+  its own and for all of them together.
+
+  Copyright (c) Microsoft Corporation.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include "../DxeImageVerificationLib.h"
+#include <Library/PrintLib.h>
+#include <Library/UnitTestLib.h>
+
+#include <time.h>
+
+#define UNIT_TEST_NAME     "DxeImageVerificationLib PE Image Hash Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+//
+// Synthetic image layout
+//
+#define TEST_PE_HEADER_OFFSET   0x80
+#define TEST_SIZE_OF_HEADERS    0x400
+#define TEST_FILE_ALIGNMENT     0x200
+#define TEST_SECTION_COUNT      8
+#define TEST_SECTION_MAX_SIZE   SIZE_2MB
+#define TEST_TRAILER_SIZE       0x1000
+#define TEST_CERT_TABLE_SIZE    0x800
+#define TEST_BENCH_ITERATIONS   8
+
+typedef struct {
+  UINT8    *Image;
+  UINTN    ImageSize;
+} PE_IMAGE_HASH_TEST_CONTEXT;
+
+PE_IMAGE_HASH_TEST_CONTEXT  mTestContext;
+
+UINT32  mTestSeed = 0x5EC0B007;
+
+/**
+  Get the next value of a linear congruential generator, so that the image is
+  the same in every run.
+
+  @return A pseudo random value.
+**/
+UINT32
+TestRandom (
+  VOID
+  )
+{
+  mTestSeed = mTestSeed * 1103515245 + 12345;
+  return mTestSeed >> 8;
+}
+
+/**
+  Get a wall clock time stamp.
+
+  @return The time stamp in nanoseconds.
+**/
+UINT64
+TestGetTimeInNanoSecond (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  timespec_get (&Now, TIME_UTC);
+  return (UINT64)Now.tv_sec * 1000000000ULL + (UINT64)Now.tv_nsec;
+}
+
+/**
+  Build the synthetic PE32+ image.
+
+  @param[in]  Context   The unit test context.
+
+  @retval UNIT_TEST_PASSED                      The image was built.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Out of memory.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PE_IMAGE_HASH_TEST_CONTEXT  *TestContext;
+  EFI_IMAGE_DOS_HEADER        *DosHdr;
+  EFI_IMAGE_NT_HEADERS64      *NtHdr;
+  EFI_IMAGE_DATA_DIRECTORY    *SecDataDir;
+  EFI_IMAGE_SECTION_HEADER    *Section;
+  UINT32                      RawSize[TEST_SECTION_COUNT];
+  UINT32                      RawOffset[TEST_SECTION_COUNT];
+  UINT32                      Offset;
+  UINTN                       Index;
+
+  TestContext = (PE_IMAGE_HASH_TEST_CONTEXT *)Context;
+
+  //
+  // Lay the sections out in file order, but list them in the section table in
+  // reverse order, with an empty section in the middle.
+  //
+  Offset = TEST_SIZE_OF_HEADERS;
+  for (Index = 0; Index < TEST_SECTION_COUNT; Index++) {
+    if (Index == TEST_SECTION_COUNT / 2) {
+      RawSize[Index] = 0;
+    } else {
+      RawSize[Index] = ALIGN_VALUE (TestRandom () % TEST_SECTION_MAX_SIZE + 1, TEST_FILE_ALIGNMENT);
+    }
+
+    RawOffset[Index] = Offset;
+    Offset          += RawSize[Index];
+  }
+
+  TestContext->ImageSize = Offset + TEST_TRAILER_SIZE + TEST_CERT_TABLE_SIZE;
+  TestContext->Image     = AllocatePool (TestContext->ImageSize);
+  if (TestContext->Image == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  for (Index = 0; Index < TestContext->ImageSize; Index++) {
+    TestContext->Image[Index] = (UINT8)TestRandom ();
+  }
+
+  ZeroMem (TestContext->Image, TEST_SIZE_OF_HEADERS);
+  DosHdr           = (EFI_IMAGE_DOS_HEADER *)TestContext->Image;
+  DosHdr->e_magic  = EFI_IMAGE_DOS_SIGNATURE;
+  DosHdr->e_lfanew = TEST_PE_HEADER_OFFSET;
+
+  NtHdr                                     = (EFI_IMAGE_NT_HEADERS64 *)(TestContext->Image + TEST_PE_HEADER_OFFSET);
+  NtHdr->Signature                          = EFI_IMAGE_NT_SIGNATURE;
+  NtHdr->FileHeader.Machine                 = IMAGE_FILE_MACHINE_X64;
+  NtHdr->FileHeader.NumberOfSections        = TEST_SECTION_COUNT;
+  NtHdr->FileHeader.SizeOfOptionalHeader    = sizeof (EFI_IMAGE_OPTIONAL_HEADER64);
+  NtHdr->OptionalHeader.Magic               = EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+  NtHdr->OptionalHeader.FileAlignment       = TEST_FILE_ALIGNMENT;
+  NtHdr->OptionalHeader.SizeOfHeaders       = TEST_SIZE_OF_HEADERS;
+  NtHdr->OptionalHeader.CheckSum            = 0x12345678;
+  NtHdr->OptionalHeader.NumberOfRvaAndSizes = EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES;
+
+  SecDataDir                 = &NtHdr->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY];
+  SecDataDir->VirtualAddress = (UINT32)(TestContext->ImageSize - TEST_CERT_TABLE_SIZE);
+  SecDataDir->Size           = TEST_CERT_TABLE_SIZE;
+
+  Section = (EFI_IMAGE_SECTION_HEADER *)(NtHdr + 1);
+  for (Index = 0; Index < TEST_SECTION_COUNT; Index++) {
+    Section[Index].PointerToRawData = RawOffset[TEST_SECTION_COUNT - 1 - Index];
+    Section[Index].SizeOfRawData    = RawSize[TEST_SECTION_COUNT - 1 - Index];
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the synthetic PE32+ image.
+
+  @param[in]  Context   The unit test context.
+**/
+VOID
+EFIAPI
+TestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PE_IMAGE_HASH_TEST_CONTEXT  *TestContext;
+
+  TestContext = (PE_IMAGE_HASH_TEST_CONTEXT *)Context;
+  if (TestContext->Image != NULL) {
+    FreePool (TestContext->Image);
+    TestContext->Image = NULL;
+  }
+}
+
+/**
+  Check that the digests calculated together match the ones calculated one
+  algorithm at a time, and that the SHA-256 digest covers the Authenticode ranges.
+
+  @param[in]  Context   The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestHashAllMatchesSingle (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PE_IMAGE_HASH_TEST_CONTEXT  *TestContext;
+  EFI_IMAGE_NT_HEADERS64      *NtHdr;
+  EFI_IMAGE_SECTION_HEADER    *Section;
+  UINT8                       AllDigests[HASHALG_MAX][MAX_DIGEST_SIZE];
+  UINT8                       Digests[HASHALG_MAX][MAX_DIGEST_SIZE];
+  UINT8                       Expected[SHA256_DIGEST_SIZE];
+  UINT8                       *Ranges;
+  UINTN                       RangesSize;
+  UINT32                      SupportedMask;
+  UINT32                      HashAlg;
+  UINTN                       Index;
+
+  TestContext   = (PE_IMAGE_HASH_TEST_CONTEXT *)Context;
+  SupportedMask = GetSupportedHashAlgMask ();
+  UT_ASSERT_NOT_EQUAL (SupportedMask & HASHALG_MASK (HASHALG_SHA256), 0);
+
+  UT_ASSERT_TRUE (HashPeImageAll (TestContext->Image, TestContext->ImageSize, TEST_PE_HEADER_OFFSET, SupportedMask, AllDigests));
+  for (HashAlg = 0; HashAlg < HASHALG_MAX; HashAlg++) {
+    if ((SupportedMask & HASHALG_MASK (HashAlg)) == 0) {
+      UT_ASSERT_FALSE (HashPeImageAll (TestContext->Image, TestContext->ImageSize, TEST_PE_HEADER_OFFSET, HASHALG_MASK (HashAlg), Digests));
+      continue;
+    }
+
+    UT_ASSERT_TRUE (HashPeImageAll (TestContext->Image, TestContext->ImageSize, TEST_PE_HEADER_OFFSET, HASHALG_MASK (HashAlg), Digests));
+    UT_ASSERT_MEM_EQUAL (AllDigests[HashAlg], Digests[HashAlg], mHash[HashAlg].DigestLength);
+  }
+
+  //
+  // Copy the hashed ranges out: the headers without the checksum and the
+  // security data directory, the sections in file order, and the data after the
+  // last section without the certificate table.
+  //
+  NtHdr  = (EFI_IMAGE_NT_HEADERS64 *)(TestContext->Image + TEST_PE_HEADER_OFFSET);
+  Ranges = AllocatePool (TestContext->ImageSize);
+  UT_ASSERT_NOT_NULL (Ranges);
+
+  RangesSize = (UINT8 *)&NtHdr->OptionalHeader.CheckSum - TestContext->Image;
+  CopyMem (Ranges, TestContext->Image, RangesSize);
+  Index = (UINT8 *)&NtHdr->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY] - ((UINT8 *)&NtHdr->OptionalHeader.CheckSum + sizeof (UINT32));
+  CopyMem (Ranges + RangesSize, (UINT8 *)&NtHdr->OptionalHeader.CheckSum + sizeof (UINT32), Index);
+  RangesSize += Index;
+  Index       = TEST_SIZE_OF_HEADERS - ((UINT8 *)&NtHdr->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1] - TestContext->Image);
+  CopyMem (Ranges + RangesSize, &NtHdr->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1], Index);
+  RangesSize += Index;
+
+  Section = (EFI_IMAGE_SECTION_HEADER *)(NtHdr + 1);
+  for (Index = TEST_SECTION_COUNT; Index > 0; Index--) {
+    CopyMem (Ranges + RangesSize, TestContext->Image + Section[Index - 1].PointerToRawData, Section[Index - 1].SizeOfRawData);
+    RangesSize += Section[Index - 1].SizeOfRawData;
+  }
+
+  CopyMem (Ranges + RangesSize, TestContext->Image + TestContext->ImageSize - TEST_CERT_TABLE_SIZE - TEST_TRAILER_SIZE, TEST_TRAILER_SIZE);
+  RangesSize += TEST_TRAILER_SIZE;
+
+  UT_ASSERT_TRUE (Sha256HashAll (Ranges, RangesSize, Expected));
+  FreePool (Ranges);
+  UT_ASSERT_MEM_EQUAL (AllDigests[HASHALG_SHA256], Expected, SHA256_DIGEST_SIZE);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Log the throughput of a number of passes over the image.
+
+  @param[in]  Name        The hash algorithms that were calculated.
+  @param[in]  ImageSize   The size of the image in bytes.
+  @param[in]  Elapsed     The time of all the passes in nanoseconds.
+**/
+VOID
+TestLogThroughput (
+  IN CONST CHAR8  *Name,
+  IN UINTN        ImageSize,
+  IN UINT64       Elapsed
+  )
+{
+  UINT64  Bytes;
+
+  Bytes   = MultU64x32 (ImageSize, TEST_BENCH_ITERATIONS);
+  Elapsed = MAX (Elapsed, 1);
+  UT_LOG_INFO (
+    "%a: %ld KB in %ld us, %ld MB/s\n",
+    Name,
+    Bytes / SIZE_1KB,
+    Elapsed / 1000,
+    DivU64x64Remainder (MultU64x32 (Bytes, 1000000000), Elapsed, NULL) / SIZE_1MB
+    );
+}
+
+/**
+  Measure the throughput of every supported algorithm on its own, and of all of
+  them in a single pass.
+
+  @param[in]  Context   The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BenchHashThroughput (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PE_IMAGE_HASH_TEST_CONTEXT  *TestContext;
+  UINT8                       Digests[HASHALG_MAX][MAX_DIGEST_SIZE];
+  CHAR8                       Name[32];
+  UINT32                      SupportedMask;
+  UINT32                      HashAlg;
+  UINTN                       Iteration;
+  UINT64                      StartTime;
+  UINT64                      Elapsed;
+  UINT64                      SeparateTime;
+
+  TestContext   = (PE_IMAGE_HASH_TEST_CONTEXT *)Context;
+  SupportedMask = GetSupportedHashAlgMask ();
+  SeparateTime  = 0;
+
+  for (HashAlg = 0; HashAlg < HASHALG_MAX; HashAlg++) {
+    if ((SupportedMask & HASHALG_MASK (HashAlg)) == 0) {
+      continue;
+    }
+
+    StartTime = TestGetTimeInNanoSecond ();
+    for (Iteration = 0; Iteration < TEST_BENCH_ITERATIONS; Iteration++) {
+      UT_ASSERT_TRUE (HashPeImageAll (TestContext->Image, TestContext->ImageSize, TEST_PE_HEADER_OFFSET, HASHALG_MASK (HashAlg), Digests));
+    }
+
+    Elapsed       = TestGetTimeInNanoSecond () - StartTime;
+    SeparateTime += Elapsed;
+    AsciiSPrint (Name, sizeof (Name), "%s", mHash[HashAlg].Name);
+    TestLogThroughput (Name, TestContext->ImageSize, Elapsed);
+  }
+
+  StartTime = TestGetTimeInNanoSecond ();
+  for (Iteration = 0; Iteration < TEST_BENCH_ITERATIONS; Iteration++) {
+    UT_ASSERT_TRUE (HashPeImageAll (TestContext->Image, TestContext->ImageSize, TEST_PE_HEADER_OFFSET, SupportedMask, Digests));
+  }
+
+  Elapsed = TestGetTimeInNanoSecond () - StartTime;
+  TestLogThroughput ("All algorithms in one pass", TestContext->ImageSize, Elapsed);
+  TestLogThroughput ("All algorithms one pass each", TestContext->ImageSize, SeparateTime);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  PE image hashing and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      PeImageHashSuite;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in InitUnitTestFramework. Status = %r\n", UNIT_TEST_NAME, Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&PeImageHashSuite, Framework, "PeImageHashSuite", "SecurityPkg.DxeImageVerificationLib.PeImageHash", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in CreateUnitTestSuite for PeImageHashSuite\n", UNIT_TEST_NAME));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (PeImageHashSuite, "Single pass digests match one pass per algorithm", "HashAllMatchesSingle", TestHashAllMatchesSingle, TestSetup, TestCleanup, &mTestContext);
+  AddTestCase (PeImageHashSuite, "Hash throughput per algorithm", "HashThroughput", BenchHashThroughput, TestSetup, TestCleanup, &mTestContext);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define PeImageHashBenchmarkMain  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+PeImageHashBenchmarkMain (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return (INT32)UefiTestMain ();
+}
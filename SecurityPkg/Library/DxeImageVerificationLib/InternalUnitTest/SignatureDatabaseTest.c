@@ -0,0 +1,657 @@
+/** @file
+  Host based unit tests of the image security database cache and index in
+  DxeImageVerificationLib.
+
+  The database variables are served by a GetVariable() stub. The tests check
+  that FindSignatureInDatabase() returns the first match in database order when
+  a hash is listed more than once, that malformed signature lists end parsing
+  without exposing their entries, that hash types of different sizes and
+  non-hash types are kept apart, and that GetSignatureDatabase() picks up a
+  changed variable on the next call.
+
+  Copyright (c) Microsoft Corporation.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include "../DxeImageVerificationLib.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_NAME     "DxeImageVerificationLib Signature Database Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+#define TEST_VARIABLE_MAX_SIZE  SIZE_16KB
+#define TEST_X509_SIZE          100
+
+typedef struct {
+  CHAR16    *VariableName;
+  UINT8     Data[TEST_VARIABLE_MAX_SIZE];
+  //
+  // 0 if the variable does not exist.
+  //
+  UINTN     DataSize;
+} TEST_VARIABLE;
+
+TEST_VARIABLE  mTestVariables[] = {
+  { EFI_IMAGE_SECURITY_DATABASE,  { 0 }, 0 },
+  { EFI_IMAGE_SECURITY_DATABASE1, { 0 }, 0 },
+  { EFI_IMAGE_SECURITY_DATABASE2, { 0 }, 0 }
+};
+
+#define TEST_DB   (&mTestVariables[0])
+#define TEST_DBX  (&mTestVariables[1])
+
+EFI_GUID  mTestOwner1 = {
+  0x5c2d8a41, 0x0f3e, 0x4b97, { 0x86, 0x1a, 0x2e, 0x7d, 0x90, 0x4c, 0xb3, 0x15 }
+};
+EFI_GUID  mTestOwner2 = {
+  0xa7e4163b, 0x92c5, 0x4d08, { 0xbf, 0x31, 0x6a, 0x58, 0xd2, 0x0e, 0x47, 0xc9 }
+};
+
+EFI_RUNTIME_SERVICES  mTestRuntimeServices;
+EFI_RUNTIME_SERVICES  *gRT = &mTestRuntimeServices;
+
+UINTN  mTestGetVariableCount;
+
+/**
+  GetVariable() stub that serves the image security database variables from
+  mTestVariables.
+
+  @param[in]       VariableName  Name of Variable to be found.
+  @param[in]       VendorGuid    Variable vendor GUID.
+  @param[out]      Attributes    Attribute value of the variable found.
+  @param[in, out]  DataSize      Size of Data found.
+  @param[out]      Data          Data pointer.
+
+  @retval EFI_SUCCESS            The variable is returned.
+  @retval EFI_NOT_FOUND          The variable does not exist.
+  @retval EFI_BUFFER_TOO_SMALL   DataSize is too small for the variable.
+**/
+EFI_STATUS
+EFIAPI
+TestGetVariable (
+  IN     CHAR16    *VariableName,
+  IN     EFI_GUID  *VendorGuid,
+  OUT    UINT32    *Attributes OPTIONAL,
+  IN OUT UINTN     *DataSize,
+  OUT    VOID      *Data OPTIONAL
+  )
+{
+  UINTN  Index;
+
+  mTestGetVariableCount++;
+  if (!CompareGuid (VendorGuid, &gEfiImageSecurityDatabaseGuid)) {
+    return EFI_NOT_FOUND;
+  }
+
+  for (Index = 0; Index < ARRAY_SIZE (mTestVariables); Index++) {
+    if (StrCmp (VariableName, mTestVariables[Index].VariableName) == 0) {
+      break;
+    }
+  }
+
+  if ((Index == ARRAY_SIZE (mTestVariables)) || (mTestVariables[Index].DataSize == 0)) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (*DataSize < mTestVariables[Index].DataSize) {
+    *DataSize = mTestVariables[Index].DataSize;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *DataSize = mTestVariables[Index].DataSize;
+  CopyMem (Data, mTestVariables[Index].Data, *DataSize);
+  return EFI_SUCCESS;
+}
+
+/**
+  Generate the test hash of a value. The hash of a value is a prefix of the
+  longer hashes of the same value.
+
+  @param[in]  Value       The value.
+  @param[in]  HashSize    Size of the hash.
+  @param[out] Hash        The hash.
+**/
+VOID
+TestHash (
+  IN  UINTN  Value,
+  IN  UINTN  HashSize,
+  OUT UINT8  *Hash
+  )
+{
+  UINT32  Seed;
+  UINTN   Index;
+
+  Seed = (UINT32)Value * 0x9E3779B1 + 1;
+  for (Index = 0; Index < HashSize; Index++) {
+    Seed        = Seed * 1103515245 + 12345;
+    Hash[Index] = (UINT8)(Seed >> 16);
+  }
+}
+
+/**
+  Append a signature list to a test variable.
+
+  @param[in, out] Variable        The variable.
+  @param[in]      SignatureType   Type of the signature list.
+  @param[in]      Owner           Owner of the signatures.
+  @param[in]      DataSize        Size of the data of each signature.
+  @param[in]      Values          Values whose test hashes are the signatures.
+  @param[in]      Count           Number of signatures.
+
+  @return Offset of the signature list in the variable.
+**/
+UINTN
+TestAppendSignatureList (
+  IN OUT TEST_VARIABLE  *Variable,
+  IN     EFI_GUID       *SignatureType,
+  IN     EFI_GUID       *Owner,
+  IN     UINTN          DataSize,
+  IN     UINTN          *Values,
+  IN     UINTN          Count
+  )
+{
+  EFI_SIGNATURE_LIST  *CertList;
+  EFI_SIGNATURE_DATA  *Cert;
+  UINTN               Offset;
+  UINTN               Index;
+
+  Offset   = Variable->DataSize;
+  CertList = (EFI_SIGNATURE_LIST *)&Variable->Data[Offset];
+  ASSERT (Offset + sizeof (EFI_SIGNATURE_LIST) + Count * (sizeof (EFI_GUID) + DataSize) <= TEST_VARIABLE_MAX_SIZE);
+
+  CopyGuid (&CertList->SignatureType, SignatureType);
+  CertList->SignatureHeaderSize = 0;
+  CertList->SignatureSize       = (UINT32)(sizeof (EFI_GUID) + DataSize);
+  CertList->SignatureListSize   = (UINT32)(sizeof (EFI_SIGNATURE_LIST) + Count * CertList->SignatureSize);
+
+  Cert = (EFI_SIGNATURE_DATA *)(CertList + 1);
+  for (Index = 0; Index < Count; Index++) {
+    CopyGuid (&Cert->SignatureOwner, Owner);
+    TestHash (Values[Index], DataSize, Cert->SignatureData);
+    Cert = (EFI_SIGNATURE_DATA *)((UINT8 *)Cert + CertList->SignatureSize);
+  }
+
+  Variable->DataSize += CertList->SignatureListSize;
+  return Offset;
+}
+
+/**
+  Get the offset of a signature in a variable.
+
+  @param[in]  ListOffset      Offset of the signature list.
+  @param[in]  DataSize        Size of the data of each signature in the list.
+  @param[in]  Index           Index of the signature in the list.
+
+  @return Offset of the signature.
+**/
+UINTN
+TestSignatureOffset (
+  IN UINTN  ListOffset,
+  IN UINTN  DataSize,
+  IN UINTN  Index
+  )
+{
+  return ListOffset + sizeof (EFI_SIGNATURE_LIST) + Index * (sizeof (EFI_GUID) + DataSize);
+}
+
+/**
+  Look up the test hash of a value in a database.
+
+  @param[in]  Database        The database.
+  @param[in]  CertType        Signature type to look up.
+  @param[in]  HashSize        Size of the hash.
+  @param[in]  Value           The value.
+
+  @return Offset of the first matching signature in the database, or MAX_UINTN
+          if the hash is not found.
+**/
+UINTN
+TestFind (
+  IN SIGNATURE_DATABASE  *Database,
+  IN EFI_GUID            *CertType,
+  IN UINTN               HashSize,
+  IN UINTN               Value
+  )
+{
+  UINT8               Hash[SHA512_DIGEST_SIZE];
+  EFI_SIGNATURE_DATA  *Cert;
+
+  ASSERT (HashSize <= sizeof (Hash));
+  TestHash (Value, HashSize, Hash);
+  Cert = FindSignatureInDatabase (Database, Hash, CertType, HashSize);
+  if (Cert == NULL) {
+    return MAX_UINTN;
+  }
+
+  return (UINTN)((UINT8 *)Cert - Database->Data);
+}
+
+/**
+  Reset the test variables before a test.
+
+  @param[in]  Context   The unit test context.
+**/
+VOID
+EFIAPI
+TestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mTestVariables); Index++) {
+    mTestVariables[Index].DataSize = 0;
+  }
+
+  mTestRuntimeServices.GetVariable = TestGetVariable;
+  mTestGetVariableCount            = 0;
+}
+
+/**
+  Free the databases replaced during a test.
+
+  @param[in]  Context   The unit test context.
+**/
+VOID
+EFIAPI
+TestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIGNATURE_DATABASE  *Database;
+  UINTN               Index;
+
+  //
+  // Replace every cached database with "not found", then free them.
+  //
+  for (Index = 0; Index < ARRAY_SIZE (mTestVariables); Index++) {
+    mTestVariables[Index].DataSize = 0;
+    GetSignatureDatabase (mTestVariables[Index].VariableName, &Database);
+  }
+
+  ReleaseStaleSignatureDatabases ();
+}
+
+/**
+  A hash listed more than once, within a list and across lists, is found at its
+  first position in database order.
+
+  @param[in]  Context   The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestDuplicateHashesFirstMatch (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIGNATURE_DATABASE  *Database;
+  UINTN               ValuesA[32];
+  UINTN               ValuesB[32];
+  UINTN               ValuesC[3];
+  UINTN               OffsetA;
+  UINTN               OffsetB;
+  UINTN               OffsetC;
+  UINTN               Index;
+  UINTN               Offset;
+
+  //
+  // List A holds 0..31, list B holds 47..16 and list C holds 40, 5 and 40.
+  //
+  for (Index = 0; Index < ARRAY_SIZE (ValuesA); Index++) {
+    ValuesA[Index] = Index;
+    ValuesB[Index] = 47 - Index;
+  }
+
+  ValuesC[0] = 40;
+  ValuesC[1] = 5;
+  ValuesC[2] = 40;
+
+  OffsetA = TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner1, SHA256_DIGEST_SIZE, ValuesA, ARRAY_SIZE (ValuesA));
+  OffsetB = TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner2, SHA256_DIGEST_SIZE, ValuesB, ARRAY_SIZE (ValuesB));
+  OffsetC = TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner1, SHA256_DIGEST_SIZE, ValuesC, ARRAY_SIZE (ValuesC));
+
+  UT_ASSERT_NOT_EFI_ERROR (GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE, &Database));
+  UT_ASSERT_NOT_NULL (Database);
+
+  for (Index = 0; Index < 48; Index++) {
+    Offset = TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, Index);
+    if (Index < 32) {
+      UT_ASSERT_EQUAL (Offset, TestSignatureOffset (OffsetA, SHA256_DIGEST_SIZE, Index));
+    } else {
+      UT_ASSERT_EQUAL (Offset, TestSignatureOffset (OffsetB, SHA256_DIGEST_SIZE, 47 - Index));
+    }
+  }
+
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 48), MAX_UINTN);
+
+  //
+  // Replace value 47 at the front of list B with 40, which list B also holds at
+  // index 7. The first of the two is found.
+  //
+  ValuesB[0]        = 40;
+  TEST_DB->DataSize = OffsetB;
+  TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner2, SHA256_DIGEST_SIZE, ValuesB, ARRAY_SIZE (ValuesB));
+  TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner1, SHA256_DIGEST_SIZE, ValuesC, ARRAY_SIZE (ValuesC));
+
+  UT_ASSERT_NOT_EFI_ERROR (GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE, &Database));
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 40), TestSignatureOffset (OffsetB, SHA256_DIGEST_SIZE, 0));
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 47), MAX_UINTN);
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 5), TestSignatureOffset (OffsetA, SHA256_DIGEST_SIZE, 5));
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A malformed signature list ends the parsing of the database. The lists before
+  it are still found, its own entries and the lists after it are not.
+
+  @param[in]  Context   The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestMalformedSignatureLists (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIGNATURE_DATABASE  *Database;
+  EFI_SIGNATURE_LIST  *CertList;
+  UINTN               Good[2];
+  UINTN               Bad;
+  UINTN               After;
+  UINTN               GoodOffset;
+  UINTN               BadOffset;
+  UINTN               Case;
+
+  Good[0] = 1;
+  Good[1] = 2;
+  Bad     = 3;
+  After   = 4;
+
+  for (Case = 0; Case < 5; Case++) {
+    TEST_DB->DataSize = 0;
+    GoodOffset        = TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner1, SHA256_DIGEST_SIZE, Good, ARRAY_SIZE (Good));
+    BadOffset         = TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner1, SHA256_DIGEST_SIZE, &Bad, 1);
+    TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner1, SHA256_DIGEST_SIZE, &After, 1);
+
+    CertList = (EFI_SIGNATURE_LIST *)&TEST_DB->Data[BadOffset];
+    switch (Case) {
+      case 0:
+        //
+        // The list runs past the end of the variable.
+        //
+        CertList->SignatureListSize = (UINT32)(TEST_DB->DataSize - BadOffset + 1);
+        break;
+      case 1:
+        //
+        // The list is shorter than its header.
+        //
+        CertList->SignatureListSize = sizeof (EFI_SIGNATURE_LIST) - 1;
+        break;
+      case 2:
+        CertList->SignatureSize = 0;
+        break;
+      case 3:
+        //
+        // The signature header runs past the end of the list.
+        //
+        CertList->SignatureHeaderSize = CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) + 1;
+        break;
+      default:
+        //
+        // The variable ends with less than a signature list header.
+        //
+        TEST_DB->DataSize = BadOffset + sizeof (EFI_SIGNATURE_LIST) - 1;
+        break;
+    }
+
+    UT_ASSERT_NOT_EFI_ERROR (GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE, &Database));
+    UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 1), TestSignatureOffset (GoodOffset, SHA256_DIGEST_SIZE, 0));
+    UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 2), TestSignatureOffset (GoodOffset, SHA256_DIGEST_SIZE, 1));
+    UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 3), MAX_UINTN);
+    UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 4), MAX_UINTN);
+    UT_ASSERT_EQUAL (Database->HashIndex[1].Count, 2);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Hashes are only matched against lists of the same signature type and size, and
+  non-hash signature types are searched in their own lists.
+
+  @param[in]  Context   The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestMixedHashTypes (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIGNATURE_DATABASE  *Database;
+  UINTN               Value;
+  UINTN               Sha1Offset;
+  UINTN               Sha256Offset;
+  UINTN               Sha384Offset;
+  UINTN               Sha512Offset;
+  UINTN               X509Offset;
+  UINTN               Sha256BigOffset;
+  UINT8               Cert[TEST_X509_SIZE];
+  EFI_SIGNATURE_DATA  *Found;
+
+  //
+  // The SHA-1 hash of a value is a prefix of its SHA-256 hash, and so on.
+  //
+  Value        = 1;
+  Sha1Offset   = TestAppendSignatureList (TEST_DB, &gEfiCertSha1Guid, &mTestOwner1, SHA1_DIGEST_SIZE, &Value, 1);
+  Sha256Offset = TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner1, SHA256_DIGEST_SIZE, &Value, 1);
+  Value        = 2;
+  Sha384Offset = TestAppendSignatureList (TEST_DB, &gEfiCertSha384Guid, &mTestOwner1, SHA384_DIGEST_SIZE, &Value, 1);
+  Value        = 3;
+  Sha512Offset = TestAppendSignatureList (TEST_DB, &gEfiCertSha512Guid, &mTestOwner1, SHA512_DIGEST_SIZE, &Value, 1);
+  Value        = 4;
+  X509Offset   = TestAppendSignatureList (TEST_DB, &gEfiCertX509Guid, &mTestOwner1, TEST_X509_SIZE, &Value, 1);
+  //
+  // A SHA-256 list with SHA-384 sized entries is not a SHA-256 hash list.
+  //
+  Value           = 5;
+  Sha256BigOffset = TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner1, SHA384_DIGEST_SIZE, &Value, 1);
+
+  UT_ASSERT_NOT_EFI_ERROR (GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE, &Database));
+
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha1Guid, SHA1_DIGEST_SIZE, 1), TestSignatureOffset (Sha1Offset, SHA1_DIGEST_SIZE, 0));
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 1), TestSignatureOffset (Sha256Offset, SHA256_DIGEST_SIZE, 0));
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha384Guid, SHA384_DIGEST_SIZE, 2), TestSignatureOffset (Sha384Offset, SHA384_DIGEST_SIZE, 0));
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha512Guid, SHA512_DIGEST_SIZE, 3), TestSignatureOffset (Sha512Offset, SHA512_DIGEST_SIZE, 0));
+
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 2), MAX_UINTN);
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha384Guid, SHA384_DIGEST_SIZE, 3), MAX_UINTN);
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha1Guid, SHA1_DIGEST_SIZE, 3), MAX_UINTN);
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 5), MAX_UINTN);
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha384Guid, SHA384_DIGEST_SIZE, 5), MAX_UINTN);
+  //
+  // Searched with the size of its entries, the list is still matched by the
+  // linear search, as IsSignatureFoundInDatabase() always did.
+  //
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA384_DIGEST_SIZE, 5), TestSignatureOffset (Sha256BigOffset, SHA384_DIGEST_SIZE, 0));
+
+  UT_ASSERT_EQUAL (Database->HashIndex[0].Count, 1);
+  UT_ASSERT_EQUAL (Database->HashIndex[1].Count, 1);
+  UT_ASSERT_EQUAL (Database->HashIndex[2].Count, 1);
+  UT_ASSERT_EQUAL (Database->HashIndex[3].Count, 1);
+
+  //
+  // X509 certificates are found by the linear search, only with their exact size.
+  //
+  TestHash (4, sizeof (Cert), Cert);
+  Found = FindSignatureInDatabase (Database, Cert, &gEfiCertX509Guid, sizeof (Cert));
+  UT_ASSERT_NOT_NULL (Found);
+  UT_ASSERT_EQUAL ((UINTN)((UINT8 *)Found - Database->Data), TestSignatureOffset (X509Offset, TEST_X509_SIZE, 0));
+  UT_ASSERT_EQUAL (FindSignatureInDatabase (Database, Cert, &gEfiCertX509Guid, sizeof (Cert) - 1), NULL);
+  UT_ASSERT_EQUAL (FindSignatureInDatabase (Database, Cert, &gEfiCertSha1Guid, SHA1_DIGEST_SIZE), NULL);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  GetSignatureDatabase() reuses the parsed database while the variable content
+  is unchanged, and returns the new content on the next call after the variable
+  is written, created or deleted by any means.
+
+  @param[in]  Context   The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestCacheFollowsVariable (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SIGNATURE_DATABASE  *Database;
+  SIGNATURE_DATABASE  *Cached;
+  UINTN               Values[64];
+  UINTN               Index;
+  UINTN               Value;
+
+  Value = 1;
+  TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner1, SHA256_DIGEST_SIZE, &Value, 1);
+  UT_ASSERT_NOT_EFI_ERROR (GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE, &Cached));
+  UT_ASSERT_NOT_EQUAL (TestFind (Cached, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 1), MAX_UINTN);
+
+  //
+  // Unchanged: the parsed database is reused after one GetVariable() call.
+  //
+  mTestGetVariableCount = 0;
+  UT_ASSERT_NOT_EFI_ERROR (GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE, &Database));
+  UT_ASSERT_EQUAL (Database, Cached);
+  UT_ASSERT_EQUAL (mTestGetVariableCount, 1);
+
+  //
+  // Same size, different hash.
+  //
+  TEST_DB->DataSize = 0;
+  Value             = 2;
+  TestAppendSignatureList (TEST_DB, &gEfiCertSha256Guid, &mTestOwner1, SHA256_DIGEST_SIZE, &Value, 1);
+  UT_ASSERT_NOT_EFI_ERROR (GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE, &Database));
+  UT_ASSERT_NOT_EQUAL (Database, Cached);
+  UT_ASSERT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 1), MAX_UINTN);
+  UT_ASSERT_NOT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 2), MAX_UINTN);
+
+  //
+  // The replaced database stays usable until the stale databases are released.
+  //
+  UT_ASSERT_NOT_EQUAL (TestFind (Cached, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 1), MAX_UINTN);
+  ReleaseStaleSignatureDatabases ();
+
+  //
+  // Grown past the size of the read buffer.
+  //
+  for (Index = 0; Index < ARRAY_SIZE (Values); Index++) {
+    Values[Index] = 100 + Index;
+  }
+
+  TestAppendSignatureList (TEST_DB, &gEfiCertSha512Guid, &mTestOwner2, SHA512_DIGEST_SIZE, Values, ARRAY_SIZE (Values));
+  UT_ASSERT_NOT_EFI_ERROR (GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE, &Database));
+  UT_ASSERT_NOT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 2), MAX_UINTN);
+  UT_ASSERT_NOT_EQUAL (TestFind (Database, &gEfiCertSha512Guid, SHA512_DIGEST_SIZE, 163), MAX_UINTN);
+
+  //
+  // Deleted.
+  //
+  TEST_DB->DataSize = 0;
+  UT_ASSERT_STATUS_EQUAL (GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE, &Database), EFI_NOT_FOUND);
+  UT_ASSERT_EQUAL (Database, NULL);
+
+  //
+  // A dbx entry created behind the cache is enforced on the next lookup.
+  //
+  UT_ASSERT_STATUS_EQUAL (GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE1, &Database), EFI_NOT_FOUND);
+  Value = 7;
+  TestAppendSignatureList (TEST_DBX, &gEfiCertSha256Guid, &mTestOwner2, SHA256_DIGEST_SIZE, &Value, 1);
+  UT_ASSERT_NOT_EFI_ERROR (GetSignatureDatabase (EFI_IMAGE_SECURITY_DATABASE1, &Database));
+  UT_ASSERT_NOT_EQUAL (TestFind (Database, &gEfiCertSha256Guid, SHA256_DIGEST_SIZE, 7), MAX_UINTN);
+
+  UT_ASSERT_STATUS_EQUAL (GetSignatureDatabase (L"NotASignatureDatabase", &Database), EFI_INVALID_PARAMETER);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the image
+  security database cache and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SignatureDatabaseSuite;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in InitUnitTestFramework. Status = %r\n", UNIT_TEST_NAME, Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&SignatureDatabaseSuite, Framework, "SignatureDatabaseSuite", "SecurityPkg.DxeImageVerificationLib.SignatureDatabase", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in CreateUnitTestSuite for SignatureDatabaseSuite\n", UNIT_TEST_NAME));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (SignatureDatabaseSuite, "Duplicate hashes are found at their first position", "DuplicateHashesFirstMatch", TestDuplicateHashesFirstMatch, TestSetup, TestCleanup, NULL);
+  AddTestCase (SignatureDatabaseSuite, "Malformed signature lists end parsing", "MalformedSignatureLists", TestMalformedSignatureLists, TestSetup, TestCleanup, NULL);
+  AddTestCase (SignatureDatabaseSuite, "Hash types and sizes are kept apart", "MixedHashTypes", TestMixedHashTypes, TestSetup, TestCleanup, NULL);
+  AddTestCase (SignatureDatabaseSuite, "Cached databases follow the variables", "CacheFollowsVariable", TestCacheFollowsVariable, TestSetup, TestCleanup, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define SignatureDatabaseTestMain  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+SignatureDatabaseTestMain (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return (INT32)UefiTestMain ();
+}
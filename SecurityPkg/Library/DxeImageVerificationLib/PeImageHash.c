@@ -0,0 +1,443 @@
+/** @file
+  Single pass Authenticode hashing of PE/COFF images.
+
+  Caution: This file requires additional review when modified.
+  This library will have external input - PE/COFF image.
+  This external input must be validated carefully to avoid security issue like
+  buffer overflow, integer overflow.
+
+  HashPeImageAll() function will accept untrusted PE/COFF image and validate its
+  data structure within this image buffer before use.
+
+Copyright (c) 2009 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) Microsoft Corporation.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeImageVerificationLib.h"
+
+//
+// OID ASN.1 Value for Hash Algorithms
+//
+UINT8  mHashOidValue[] = {
+  0x2B, 0x0E, 0x03, 0x02, 0x1A,                         // OBJ_sha1
+  0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x04, // OBJ_sha224
+  0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, // OBJ_sha256
+  0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x02, // OBJ_sha384
+  0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x03, // OBJ_sha512
+};
+
+HASH_TABLE  mHash[] = {
+ #ifndef DISABLE_SHA1_DEPRECATED_INTERFACES
+  { L"SHA1",   20, &mHashOidValue[0],  5, Sha1GetContextSize,   Sha1Init,   Sha1Update,   Sha1Final   },
+ #else
+  { L"SHA1",   20, &mHashOidValue[0],  5, NULL,                 NULL,       NULL,         NULL        },
+ #endif
+  { L"SHA224", 28, &mHashOidValue[5],  9, NULL,                 NULL,       NULL,         NULL        },
+  { L"SHA256", 32, &mHashOidValue[14], 9, Sha256GetContextSize, Sha256Init, Sha256Update, Sha256Final },
+  { L"SHA384", 48, &mHashOidValue[23], 9, Sha384GetContextSize, Sha384Init, Sha384Update, Sha384Final },
+  { L"SHA512", 64, &mHashOidValue[32], 9, Sha512GetContextSize, Sha512Init, Sha512Update, Sha512Final }
+};
+
+/**
+  Get the hash algorithms that are supported by the hash table.
+
+  @return A bit mask of HASHALG_MASK () values.
+
+**/
+UINT32
+GetSupportedHashAlgMask (
+  VOID
+  )
+{
+  UINT32  HashAlg;
+  UINT32  HashAlgMask;
+
+  HashAlgMask = 0;
+  for (HashAlg = 0; HashAlg < HASHALG_MAX; HashAlg++) {
+    if ((mHash[HashAlg].GetContextSize != NULL) && (mHash[HashAlg].HashInit != NULL) &&
+        (mHash[HashAlg].HashUpdate != NULL) && (mHash[HashAlg].HashFinal != NULL))
+    {
+      HashAlgMask |= HASHALG_MASK (HashAlg);
+    }
+  }
+
+  return HashAlgMask;
+}
+
+/**
+  Feed a range of the image into the hash contexts of all the requested algorithms.
+
+  The range is split into blocks of PE_IMAGE_HASH_BLOCK_SIZE bytes, and every block
+  is hashed by all the algorithms in turn while it is still in the CPU cache, so the
+  image is read from memory only once however many digests are computed.
+
+  @param[in]  HashCtx       Hash contexts, indexed by hash algorithm.
+  @param[in]  HashAlgMask   The hash algorithms to update.
+  @param[in]  HashBase      The start of the range.
+  @param[in]  HashSize      The size of the range in bytes.
+
+  @retval TRUE            All the hash contexts were updated.
+  @retval FALSE           Fail in hash update.
+
+**/
+STATIC
+BOOLEAN
+PeImageHashUpdate (
+  IN VOID         **HashCtx,
+  IN UINT32       HashAlgMask,
+  IN CONST UINT8  *HashBase,
+  IN UINTN        HashSize
+  )
+{
+  UINTN   BlockSize;
+  UINT32  HashAlg;
+
+  while (HashSize > 0) {
+    BlockSize = MIN (HashSize, PE_IMAGE_HASH_BLOCK_SIZE);
+    for (HashAlg = 0; HashAlg < HASHALG_MAX; HashAlg++) {
+      if ((HashAlgMask & HASHALG_MASK (HashAlg)) == 0) {
+        continue;
+      }
+
+      if (!mHash[HashAlg].HashUpdate (HashCtx[HashAlg], HashBase, BlockSize)) {
+        return FALSE;
+      }
+    }
+
+    HashBase += BlockSize;
+    HashSize -= BlockSize;
+  }
+
+  return TRUE;
+}
+
+/**
+  Calculate the hashes of Pe/Coff image for several hash algorithms in a single pass,
+  based on the authenticode image hashing in PE/COFF Specification 8.0 Appendix A
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use.
+
+  Notes: PE/COFF image has been checked by BasePeCoffLib PeCoffLoaderGetImageInfo() in
+  DxeImageVerificationHandler().
+
+  @param[in]    ImageBase           The base of the image buffer.
+  @param[in]    ImageSize           The size of the image buffer in bytes.
+  @param[in]    PeCoffHeaderOffset  The offset of the PE/COFF header in the image.
+  @param[in]    HashAlgMask         The hash algorithms to calculate, as HASHALG_MASK () values.
+  @param[out]   Digests             The digests, indexed by hash algorithm. Only the entries
+                                    of the requested algorithms are written.
+
+  @retval TRUE            Successfully hash image.
+  @retval FALSE           Fail in hash image, or a requested algorithm is not supported.
+
+**/
+BOOLEAN
+HashPeImageAll (
+  IN  UINT8   *ImageBase,
+  IN  UINTN   ImageSize,
+  IN  UINT32  PeCoffHeaderOffset,
+  IN  UINT32  HashAlgMask,
+  OUT UINT8   Digests[HASHALG_MAX][MAX_DIGEST_SIZE]
+  )
+{
+  BOOLEAN                              Status;
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  NtHeader;
+  EFI_IMAGE_SECTION_HEADER             *Section;
+  VOID                                 *HashCtx[HASHALG_MAX];
+  UINT32                               HashAlg;
+  UINT8                                *HashBase;
+  UINTN                                HashSize;
+  UINTN                                SumOfBytesHashed;
+  EFI_IMAGE_SECTION_HEADER             *SectionHeader;
+  UINTN                                Index;
+  UINTN                                Pos;
+  UINT32                               CertSize;
+  UINT32                               NumberOfRvaAndSizes;
+
+  SectionHeader = NULL;
+  Status        = FALSE;
+  ZeroMem (HashCtx, sizeof (HashCtx));
+
+  if ((HashAlgMask == 0) || ((HashAlgMask & ~GetSupportedHashAlgMask ()) != 0)) {
+    return FALSE;
+  }
+
+  NtHeader.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)(ImageBase + PeCoffHeaderOffset);
+
+  // 1.  Load the image header into memory.
+
+  // 2.  Initialize a SHA hash context for each algorithm.
+  for (HashAlg = 0; HashAlg < HASHALG_MAX; HashAlg++) {
+    if ((HashAlgMask & HASHALG_MASK (HashAlg)) == 0) {
+      continue;
+    }
+
+    HashCtx[HashAlg] = AllocatePool (mHash[HashAlg].GetContextSize ());
+    if (HashCtx[HashAlg] == NULL) {
+      Status = FALSE;
+      goto Done;
+    }
+
+    Status = mHash[HashAlg].HashInit (HashCtx[HashAlg]);
+    if (!Status) {
+      goto Done;
+    }
+  }
+
+  //
+  // Measuring PE/COFF Image Header;
+  // But CheckSum field and SECURITY data directory (certificate) are excluded
+  //
+
+  //
+  // 3.  Calculate the distance from the base of the image header to the image checksum address.
+  // 4.  Hash the image header from its base to beginning of the image checksum.
+  //
+  HashBase = ImageBase;
+  if (NtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    //
+    // Use PE32 offset.
+    //
+    HashSize            = (UINTN)(&NtHeader.Pe32->OptionalHeader.CheckSum) - (UINTN)HashBase;
+    NumberOfRvaAndSizes = NtHeader.Pe32->OptionalHeader.NumberOfRvaAndSizes;
+  } else if (NtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
+    //
+    // Use PE32+ offset.
+    //
+    HashSize            = (UINTN)(&NtHeader.Pe32Plus->OptionalHeader.CheckSum) - (UINTN)HashBase;
+    NumberOfRvaAndSizes = NtHeader.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes;
+  } else {
+    //
+    // Invalid header magic number.
+    //
+    Status = FALSE;
+    goto Done;
+  }
+
+  Status = PeImageHashUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
+  if (!Status) {
+    goto Done;
+  }
+
+  //
+  // 5.  Skip over the image checksum (it occupies a single ULONG).
+  //
+  if (NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+    //
+    // 6.  Since there is no Cert Directory in optional header, hash everything
+    //     from the end of the checksum to the end of image header.
+    //
+    if (NtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+      //
+      // Use PE32 offset.
+      //
+      HashBase = (UINT8 *)&NtHeader.Pe32->OptionalHeader.CheckSum + sizeof (UINT32);
+      HashSize = NtHeader.Pe32->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)ImageBase);
+    } else {
+      //
+      // Use PE32+ offset.
+      //
+      HashBase = (UINT8 *)&NtHeader.Pe32Plus->OptionalHeader.CheckSum + sizeof (UINT32);
+      HashSize = NtHeader.Pe32Plus->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)ImageBase);
+    }
+
+    if (HashSize != 0) {
+      Status = PeImageHashUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
+      if (!Status) {
+        goto Done;
+      }
+    }
+  } else {
+    //
+    // 7.  Hash everything from the end of the checksum to the start of the Cert Directory.
+    //
+    if (NtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+      //
+      // Use PE32 offset.
+      //
+      HashBase = (UINT8 *)&NtHeader.Pe32->OptionalHeader.CheckSum + sizeof (UINT32);
+      HashSize = (UINTN)(&NtHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]) - (UINTN)HashBase;
+    } else {
+      //
+      // Use PE32+ offset.
+      //
+      HashBase = (UINT8 *)&NtHeader.Pe32Plus->OptionalHeader.CheckSum + sizeof (UINT32);
+      HashSize = (UINTN)(&NtHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]) - (UINTN)HashBase;
+    }
+
+    if (HashSize != 0) {
+      Status = PeImageHashUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
+      if (!Status) {
+        goto Done;
+      }
+    }
+
+    //
+    // 8.  Skip over the Cert Directory. (It is sizeof(IMAGE_DATA_DIRECTORY) bytes.)
+    // 9.  Hash everything from the end of the Cert Directory to the end of image header.
+    //
+    if (NtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+      //
+      // Use PE32 offset
+      //
+      HashBase = (UINT8 *)&NtHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1];
+      HashSize = NtHeader.Pe32->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)ImageBase);
+    } else {
+      //
+      // Use PE32+ offset.
+      //
+      HashBase = (UINT8 *)&NtHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1];
+      HashSize = NtHeader.Pe32Plus->OptionalHeader.SizeOfHeaders - ((UINTN)HashBase - (UINTN)ImageBase);
+    }
+
+    if (HashSize != 0) {
+      Status = PeImageHashUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
+      if (!Status) {
+        goto Done;
+      }
+    }
+  }
+
+  //
+  // 10. Set the SUM_OF_BYTES_HASHED to the size of the header.
+  //
+  if (NtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+    //
+    // Use PE32 offset.
+    //
+    SumOfBytesHashed = NtHeader.Pe32->OptionalHeader.SizeOfHeaders;
+  } else {
+    //
+    // Use PE32+ offset
+    //
+    SumOfBytesHashed = NtHeader.Pe32Plus->OptionalHeader.SizeOfHeaders;
+  }
+
+  Section = (EFI_IMAGE_SECTION_HEADER *)(
+                                         ImageBase +
+                                         PeCoffHeaderOffset +
+                                         sizeof (UINT32) +
+                                         sizeof (EFI_IMAGE_FILE_HEADER) +
+                                         NtHeader.Pe32->FileHeader.SizeOfOptionalHeader
+                                         );
+
+  //
+  // 11. Build a temporary table of pointers to all the IMAGE_SECTION_HEADER
+  //     structures in the image. The 'NumberOfSections' field of the image
+  //     header indicates how big the table should be. Do not include any
+  //     IMAGE_SECTION_HEADERs in the table whose 'SizeOfRawData' field is zero.
+  //
+  SectionHeader = (EFI_IMAGE_SECTION_HEADER *)AllocateZeroPool (sizeof (EFI_IMAGE_SECTION_HEADER) * NtHeader.Pe32->FileHeader.NumberOfSections);
+  if (SectionHeader == NULL) {
+    Status = FALSE;
+    goto Done;
+  }
+
+  //
+  // 12.  Using the 'PointerToRawData' in the referenced section headers as
+  //      a key, arrange the elements in the table in ascending order. In other
+  //      words, sort the section headers according to the disk-file offset of
+  //      the section.
+  //
+  for (Index = 0; Index < NtHeader.Pe32->FileHeader.NumberOfSections; Index++) {
+    Pos = Index;
+    while ((Pos > 0) && (Section->PointerToRawData < SectionHeader[Pos - 1].PointerToRawData)) {
+      CopyMem (&SectionHeader[Pos], &SectionHeader[Pos - 1], sizeof (EFI_IMAGE_SECTION_HEADER));
+      Pos--;
+    }
+
+    CopyMem (&SectionHeader[Pos], Section, sizeof (EFI_IMAGE_SECTION_HEADER));
+    Section += 1;
+  }
+
+  //
+  // 13.  Walk through the sorted table, bring the corresponding section
+  //      into memory, and hash the entire section (using the 'SizeOfRawData'
+  //      field in the section header to determine the amount of data to hash).
+  // 14.  Add the section's 'SizeOfRawData' to SUM_OF_BYTES_HASHED .
+  // 15.  Repeat steps 13 and 14 for all the sections in the sorted table.
+  //
+  for (Index = 0; Index < NtHeader.Pe32->FileHeader.NumberOfSections; Index++) {
+    Section = &SectionHeader[Index];
+    if (Section->SizeOfRawData == 0) {
+      continue;
+    }
+
+    HashBase = ImageBase + Section->PointerToRawData;
+    HashSize = (UINTN)Section->SizeOfRawData;
+
+    Status = PeImageHashUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
+    if (!Status) {
+      goto Done;
+    }
+
+    SumOfBytesHashed += HashSize;
+  }
+
+  //
+  // 16.  If the file size is greater than SUM_OF_BYTES_HASHED, there is extra
+  //      data in the file that needs to be added to the hash. This data begins
+  //      at file offset SUM_OF_BYTES_HASHED and its length is:
+  //             FileSize  -  (CertDirectory->Size)
+  //
+  if (ImageSize > SumOfBytesHashed) {
+    HashBase = ImageBase + SumOfBytesHashed;
+
+    if (NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+      CertSize = 0;
+    } else {
+      if (NtHeader.Pe32->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+        //
+        // Use PE32 offset.
+        //
+        CertSize = NtHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size;
+      } else {
+        //
+        // Use PE32+ offset.
+        //
+        CertSize = NtHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size;
+      }
+    }
+
+    if (ImageSize > CertSize + SumOfBytesHashed) {
+      HashSize = (UINTN)(ImageSize - CertSize - SumOfBytesHashed);
+
+      Status = PeImageHashUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
+      if (!Status) {
+        goto Done;
+      }
+    } else if (ImageSize < CertSize + SumOfBytesHashed) {
+      Status = FALSE;
+      goto Done;
+    }
+  }
+
+  for (HashAlg = 0; HashAlg < HASHALG_MAX; HashAlg++) {
+    if ((HashAlgMask & HASHALG_MASK (HashAlg)) == 0) {
+      continue;
+    }
+
+    ZeroMem (Digests[HashAlg], MAX_DIGEST_SIZE);
+    Status = mHash[HashAlg].HashFinal (HashCtx[HashAlg], Digests[HashAlg]);
+    if (!Status) {
+      goto Done;
+    }
+  }
+
+Done:
+  for (HashAlg = 0; HashAlg < HASHALG_MAX; HashAlg++) {
+    if (HashCtx[HashAlg] != NULL) {
+      FreePool (HashCtx[HashAlg]);
+    }
+  }
+
+  if (SectionHeader != NULL) {
+    FreePool (SectionHeader);
+  }
+
+  return Status;
+}
@@ -0,0 +1,562 @@
+/** @file
+  Cache of the parsed image security databases (db, dbx and dbt).
+
+  The parsed databases are kept for the rest of boot. The hash signatures of
+  each database are indexed by signature type and sorted, so that an image digest
+  is looked up with a binary search instead of a walk of every signature list.
+
+  The variable is read again each time the database is requested and compared
+  with the cached copy, so a database written by any agent, including one that
+  does not go through gRT, is in effect for the next lookup. Only the parsing
+  and sorting is skipped when the content did not change.
+
+Copyright (c) Microsoft Corporation.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeImageVerificationLib.h"
+
+typedef struct {
+  EFI_GUID    *SignatureType;
+  UINTN       HashSize;
+} SIGNATURE_HASH_TYPE;
+
+typedef struct {
+  CHAR16                *VariableName;
+  //
+  // The database parsed from the last content read from the variable, or NULL.
+  //
+  SIGNATURE_DATABASE    *Database;
+} SIGNATURE_DATABASE_CACHE;
+
+SIGNATURE_HASH_TYPE  mSignatureHashTypes[SIGNATURE_HASH_TYPE_COUNT] = {
+  { &gEfiCertSha1Guid,   SHA1_DIGEST_SIZE   },
+  { &gEfiCertSha256Guid, SHA256_DIGEST_SIZE },
+  { &gEfiCertSha384Guid, SHA384_DIGEST_SIZE },
+  { &gEfiCertSha512Guid, SHA512_DIGEST_SIZE }
+};
+
+SIGNATURE_DATABASE_CACHE  mSignatureDatabaseCache[] = {
+  { EFI_IMAGE_SECURITY_DATABASE,  NULL },
+  { EFI_IMAGE_SECURITY_DATABASE1, NULL },
+  { EFI_IMAGE_SECURITY_DATABASE2, NULL }
+};
+
+//
+// Databases replaced in the cache. A caller may still hold a pointer to them
+// until the current image verification finishes.
+//
+SIGNATURE_DATABASE  *mStaleSignatureDatabases = NULL;
+
+//
+// Buffer the database variables are read into before they are compared with
+// the cached copies. It is kept and only grown, so that an unchanged database
+// is checked with a single GetVariable() call.
+//
+UINT8  *mSignatureDatabaseBuffer     = NULL;
+UINTN  mSignatureDatabaseBufferSize = 0;
+
+//
+// Hash size used by CompareSignatureHash() while sorting.
+//
+UINTN  mSignatureSortHashSize;
+
+/**
+  Free a parsed database.
+
+  @param[in]  Database    The database to free.
+
+**/
+STATIC
+VOID
+FreeSignatureDatabase (
+  IN SIGNATURE_DATABASE  *Database
+  )
+{
+  if (Database->Entries != NULL) {
+    FreePool (Database->Entries);
+  }
+
+  FreePool (Database);
+}
+
+/**
+  Free the databases that have been replaced in the cache since the previous
+  image was verified.
+
+**/
+VOID
+ReleaseStaleSignatureDatabases (
+  VOID
+  )
+{
+  SIGNATURE_DATABASE  *Database;
+  SIGNATURE_DATABASE  *Next;
+
+  Database                 = mStaleSignatureDatabases;
+  mStaleSignatureDatabases = NULL;
+
+  while (Database != NULL) {
+    Next = Database->NextStale;
+    FreeSignatureDatabase (Database);
+    Database = Next;
+  }
+}
+
+/**
+  Compare two hash signature entries by hash value, then by position in the
+  database so that equal hashes keep their database order.
+
+  @param[in]  Buffer1     Pointer to the first EFI_SIGNATURE_DATA pointer.
+  @param[in]  Buffer2     Pointer to the second EFI_SIGNATURE_DATA pointer.
+
+  @return <0, 0 or >0 if the first entry sorts before, equal to or after the second.
+
+**/
+STATIC
+INTN
+EFIAPI
+CompareSignatureHash (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  EFI_SIGNATURE_DATA  *Cert1;
+  EFI_SIGNATURE_DATA  *Cert2;
+  INTN                Result;
+
+  Cert1  = *(EFI_SIGNATURE_DATA **)Buffer1;
+  Cert2  = *(EFI_SIGNATURE_DATA **)Buffer2;
+  Result = CompareMem (Cert1->SignatureData, Cert2->SignatureData, mSignatureSortHashSize);
+  if (Result != 0) {
+    return Result;
+  }
+
+  if ((UINTN)Cert1 == (UINTN)Cert2) {
+    return 0;
+  }
+
+  return ((UINTN)Cert1 < (UINTN)Cert2) ? -1 : 1;
+}
+
+/**
+  Get the next well-formed signature list of a database.
+
+  @param[in]      Database    The database.
+  @param[in, out] Offset      Offset of the signature list in the database. Updated
+                              to the offset of the following signature list.
+
+  @return The signature list, or NULL at the end of the database.
+
+**/
+STATIC
+EFI_SIGNATURE_LIST *
+GetNextSignatureList (
+  IN     SIGNATURE_DATABASE  *Database,
+  IN OUT UINTN               *Offset
+  )
+{
+  EFI_SIGNATURE_LIST  *CertList;
+  UINTN               Remaining;
+
+  Remaining = Database->DataSize - *Offset;
+  if (Remaining < sizeof (EFI_SIGNATURE_LIST)) {
+    return NULL;
+  }
+
+  CertList = (EFI_SIGNATURE_LIST *)(Database->Data + *Offset);
+  if ((CertList->SignatureListSize < sizeof (EFI_SIGNATURE_LIST)) ||
+      ((UINTN)CertList->SignatureListSize > Remaining) ||
+      (CertList->SignatureSize == 0) ||
+      ((UINTN)CertList->SignatureHeaderSize > CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST)))
+  {
+    return NULL;
+  }
+
+  *Offset += CertList->SignatureListSize;
+  return CertList;
+}
+
+/**
+  Get the hash signature type of a signature list.
+
+  @param[in]  CertList    The signature list.
+
+  @return Index in mSignatureHashTypes, or SIGNATURE_HASH_TYPE_COUNT if the list
+          does not hold hash signatures.
+
+**/
+STATIC
+UINTN
+GetSignatureHashType (
+  IN EFI_SIGNATURE_LIST  *CertList
+  )
+{
+  UINTN  Type;
+
+  for (Type = 0; Type < SIGNATURE_HASH_TYPE_COUNT; Type++) {
+    if ((CertList->SignatureSize == sizeof (EFI_SIGNATURE_DATA) - 1 + mSignatureHashTypes[Type].HashSize) &&
+        CompareGuid (&CertList->SignatureType, mSignatureHashTypes[Type].SignatureType))
+    {
+      break;
+    }
+  }
+
+  return Type;
+}
+
+/**
+  Build the sorted hash signature index of a database.
+
+  @param[in, out] Database    The database.
+
+  @retval EFI_SUCCESS             The index is built.
+  @retval EFI_OUT_OF_RESOURCES    No enough memory to build the index.
+
+**/
+STATIC
+EFI_STATUS
+IndexSignatureDatabase (
+  IN OUT SIGNATURE_DATABASE  *Database
+  )
+{
+  EFI_SIGNATURE_LIST  *CertList;
+  EFI_SIGNATURE_DATA  *Cert;
+  EFI_SIGNATURE_DATA  *Swap;
+  UINTN               Offset;
+  UINTN               Type;
+  UINTN               Index;
+  UINTN               CertCount;
+  UINTN               Total;
+  UINTN               Filled[SIGNATURE_HASH_TYPE_COUNT];
+
+  //
+  // Count the hash signatures of each type.
+  //
+  Offset = 0;
+  while ((CertList = GetNextSignatureList (Database, &Offset)) != NULL) {
+    Type = GetSignatureHashType (CertList);
+    if (Type < SIGNATURE_HASH_TYPE_COUNT) {
+      CertCount                        = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
+      Database->HashIndex[Type].Count += CertCount;
+    }
+  }
+
+  Total = 0;
+  for (Type = 0; Type < SIGNATURE_HASH_TYPE_COUNT; Type++) {
+    Database->HashIndex[Type].First = Total;
+    Filled[Type]                    = 0;
+    Total                          += Database->HashIndex[Type].Count;
+  }
+
+  if (Total == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Database->Entries = AllocatePool (Total * sizeof (EFI_SIGNATURE_DATA *));
+  if (Database->Entries == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Collect the hash signatures in database order, then sort each type by hash value.
+  //
+  Offset = 0;
+  while ((CertList = GetNextSignatureList (Database, &Offset)) != NULL) {
+    Type = GetSignatureHashType (CertList);
+    if (Type < SIGNATURE_HASH_TYPE_COUNT) {
+      CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
+      Cert      = (EFI_SIGNATURE_DATA *)((UINT8 *)CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
+      for (Index = 0; Index < CertCount; Index++) {
+        Database->Entries[Database->HashIndex[Type].First + Filled[Type]] = Cert;
+        Filled[Type]++;
+        Cert = (EFI_SIGNATURE_DATA *)((UINT8 *)Cert + CertList->SignatureSize);
+      }
+    }
+  }
+
+  for (Type = 0; Type < SIGNATURE_HASH_TYPE_COUNT; Type++) {
+    if (Database->HashIndex[Type].Count > 1) {
+      mSignatureSortHashSize = mSignatureHashTypes[Type].HashSize;
+      QuickSort (
+        &Database->Entries[Database->HashIndex[Type].First],
+        Database->HashIndex[Type].Count,
+        sizeof (EFI_SIGNATURE_DATA *),
+        CompareSignatureHash,
+        &Swap
+        );
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Read an image security database variable into mSignatureDatabaseBuffer.
+
+  @param[in]  VariableName        Name of database variable.
+  @param[out] DataSize            Size of the variable content.
+
+  @retval EFI_SUCCESS             The variable is read.
+  @retval EFI_NOT_FOUND           The database variable does not exist or is empty.
+  @retval EFI_OUT_OF_RESOURCES    No enough memory to read the variable.
+  @retval Others                  Failed to read the database variable.
+
+**/
+STATIC
+EFI_STATUS
+ReadSignatureDatabaseVariable (
+  IN  CHAR16  *VariableName,
+  OUT UINTN   *DataSize
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Buffer;
+
+  *DataSize = mSignatureDatabaseBufferSize;
+  Status    = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, DataSize, mSignatureDatabaseBuffer);
+  if (Status == EFI_BUFFER_TOO_SMALL) {
+    Buffer = AllocatePool (*DataSize);
+    if (Buffer == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    if (mSignatureDatabaseBuffer != NULL) {
+      FreePool (mSignatureDatabaseBuffer);
+    }
+
+    mSignatureDatabaseBuffer     = Buffer;
+    mSignatureDatabaseBufferSize = *DataSize;
+    Status                       = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, DataSize, mSignatureDatabaseBuffer);
+  }
+
+  if (!EFI_ERROR (Status) && (*DataSize == 0)) {
+    return EFI_NOT_FOUND;
+  }
+
+  return Status;
+}
+
+/**
+  Parse the content of an image security database variable.
+
+  @param[in]  Data                Content of the database variable.
+  @param[in]  DataSize            Size of Data.
+  @param[out] Database            The parsed database.
+
+  @retval EFI_SUCCESS             The database is parsed.
+  @retval EFI_OUT_OF_RESOURCES    No enough memory to parse the database.
+
+**/
+STATIC
+EFI_STATUS
+ParseSignatureDatabase (
+  IN  UINT8               *Data,
+  IN  UINTN               DataSize,
+  OUT SIGNATURE_DATABASE  **Database
+  )
+{
+  EFI_STATUS          Status;
+  SIGNATURE_DATABASE  *NewDatabase;
+  UINTN               HeaderSize;
+
+  *Database   = NULL;
+  HeaderSize  = ALIGN_VALUE (sizeof (SIGNATURE_DATABASE), sizeof (UINT64));
+  NewDatabase = AllocateZeroPool (HeaderSize + DataSize);
+  if (NewDatabase == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewDatabase->Data     = (UINT8 *)NewDatabase + HeaderSize;
+  NewDatabase->DataSize = DataSize;
+  CopyMem (NewDatabase->Data, Data, DataSize);
+  Status = IndexSignatureDatabase (NewDatabase);
+  if (EFI_ERROR (Status)) {
+    FreeSignatureDatabase (NewDatabase);
+    return Status;
+  }
+
+  *Database = NewDatabase;
+  return EFI_SUCCESS;
+}
+
+/**
+  Replace the cached database of a variable. The replaced database stays valid
+  until the next image is verified.
+
+  @param[in, out] Cache       The cache entry of the variable.
+  @param[in]      Database    The new database, or NULL.
+
+**/
+STATIC
+VOID
+ReplaceCachedSignatureDatabase (
+  IN OUT SIGNATURE_DATABASE_CACHE  *Cache,
+  IN     SIGNATURE_DATABASE        *Database
+  )
+{
+  if (Cache->Database != NULL) {
+    Cache->Database->NextStale = mStaleSignatureDatabases;
+    mStaleSignatureDatabases   = Cache->Database;
+  }
+
+  Cache->Database = Database;
+}
+
+/**
+  Get the parsed content of an image security database variable.
+
+  The variable is read on every call. The parsed database is cached and reused
+  as long as the variable content is unchanged. The returned buffer is owned by
+  the cache and must not be freed or modified by the caller; it stays valid
+  until the next image is verified.
+
+  @param[in]  VariableName        Name of database variable, db, dbx or dbt.
+  @param[out] Database            The parsed database.
+
+  @retval EFI_SUCCESS             The database is returned.
+  @retval EFI_NOT_FOUND           The database variable does not exist.
+  @retval EFI_INVALID_PARAMETER   VariableName is not an image security database.
+  @retval Others                  Failed to read the database variable.
+
+**/
+EFI_STATUS
+GetSignatureDatabase (
+  IN  CHAR16              *VariableName,
+  OUT SIGNATURE_DATABASE  **Database
+  )
+{
+  EFI_STATUS                Status;
+  SIGNATURE_DATABASE_CACHE  *Cache;
+  SIGNATURE_DATABASE        *NewDatabase;
+  UINTN                     Index;
+  UINTN                     DataSize;
+
+  *Database = NULL;
+  Cache     = NULL;
+  for (Index = 0; Index < ARRAY_SIZE (mSignatureDatabaseCache); Index++) {
+    if (StrCmp (VariableName, mSignatureDatabaseCache[Index].VariableName) == 0) {
+      Cache = &mSignatureDatabaseCache[Index];
+      break;
+    }
+  }
+
+  if (Cache == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = ReadSignatureDatabaseVariable (VariableName, &DataSize);
+  if (Status == EFI_NOT_FOUND) {
+    ReplaceCachedSignatureDatabase (Cache, NULL);
+    return Status;
+  }
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if ((Cache->Database != NULL) &&
+      (Cache->Database->DataSize == DataSize) &&
+      (CompareMem (Cache->Database->Data, mSignatureDatabaseBuffer, DataSize) == 0))
+  {
+    *Database = Cache->Database;
+    return EFI_SUCCESS;
+  }
+
+  Status = ParseSignatureDatabase (mSignatureDatabaseBuffer, DataSize, &NewDatabase);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ReplaceCachedSignatureDatabase (Cache, NewDatabase);
+  *Database = NewDatabase;
+  return EFI_SUCCESS;
+}
+
+/**
+  Find a signature in a parsed image security database.
+
+  Hash signatures of the EFI_CERT_SHAxxx types are looked up with a binary search
+  in the sorted index of the database, other signature types are searched linearly.
+
+  @param[in]  Database            The parsed database.
+  @param[in]  Signature           Pointer to signature that is searched for.
+  @param[in]  CertType            Pointer to signature type.
+  @param[in]  SignatureSize       Size of Signature.
+
+  @return The first matching signature data in the database, or NULL if not found.
+
+**/
+EFI_SIGNATURE_DATA *
+FindSignatureInDatabase (
+  IN SIGNATURE_DATABASE  *Database,
+  IN UINT8               *Signature,
+  IN EFI_GUID            *CertType,
+  IN UINTN               SignatureSize
+  )
+{
+  EFI_SIGNATURE_LIST  *CertList;
+  EFI_SIGNATURE_DATA  *Cert;
+  EFI_SIGNATURE_DATA  **Entries;
+  UINTN               Type;
+  UINTN               Low;
+  UINTN               High;
+  UINTN               Middle;
+  UINTN               Offset;
+  UINTN               Index;
+  UINTN               CertCount;
+
+  for (Type = 0; Type < SIGNATURE_HASH_TYPE_COUNT; Type++) {
+    if ((SignatureSize == mSignatureHashTypes[Type].HashSize) && CompareGuid (CertType, mSignatureHashTypes[Type].SignatureType)) {
+      break;
+    }
+  }
+
+  if (Type < SIGNATURE_HASH_TYPE_COUNT) {
+    if (Database->HashIndex[Type].Count == 0) {
+      return NULL;
+    }
+
+    //
+    // Find the first entry not less than Signature. Entries with equal hashes
+    // are in database order, so this is the first match in the database.
+    //
+    Entries = &Database->Entries[Database->HashIndex[Type].First];
+    Low     = 0;
+    High    = Database->HashIndex[Type].Count;
+    while (Low < High) {
+      Middle = Low + (High - Low) / 2;
+      if (CompareMem (Entries[Middle]->SignatureData, Signature, SignatureSize) < 0) {
+        Low = Middle + 1;
+      } else {
+        High = Middle;
+      }
+    }
+
+    if ((Low < Database->HashIndex[Type].Count) &&
+        (CompareMem (Entries[Low]->SignatureData, Signature, SignatureSize) == 0))
+    {
+      return Entries[Low];
+    }
+
+    return NULL;
+  }
+
+  Offset = 0;
+  while ((CertList = GetNextSignatureList (Database, &Offset)) != NULL) {
+    if ((CertList->SignatureSize == sizeof (EFI_SIGNATURE_DATA) - 1 + SignatureSize) && (CompareGuid (&CertList->SignatureType, CertType))) {
+      CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
+      Cert      = (EFI_SIGNATURE_DATA *)((UINT8 *)CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
+      for (Index = 0; Index < CertCount; Index++) {
+        if (CompareMem (Cert->SignatureData, Signature, SignatureSize) == 0) {
+          return Cert;
+        }
+
+        Cert = (EFI_SIGNATURE_DATA *)((UINT8 *)Cert + CertList->SignatureSize);
+      }
+    }
+  }
+
+  return NULL;
+}
@@ -0,0 +1,176 @@
+/** @file
+  Pass the Authenticode digests of a PE/COFF image between the security handlers
+  of one image load.
+
+  Copyright (c) Microsoft Corporation.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <PiDxe.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PeImageDigestLib.h>
+#include <Library/SecurityManagementLib.h>
+
+STATIC BOOLEAN             mPeImageDigestsValid;
+STATIC CONST VOID          *mPeImageDigestsBuffer;
+STATIC UINTN               mPeImageDigestsSize;
+STATIC TPML_DIGEST_VALUES  mPeImageDigests;
+
+//
+// TRUE once image verification tried to take the digests during the current
+// image load, so that digests set after that point reveal the handler order.
+//
+STATIC BOOLEAN  mPeImageDigestsTaken;
+STATIC BOOLEAN  mHandlerOrderReported;
+
+/**
+  Drop the digests of the image of the current image load.
+**/
+STATIC
+VOID
+DropPeImageDigests (
+  VOID
+  )
+{
+  mPeImageDigestsValid  = FALSE;
+  mPeImageDigestsBuffer = NULL;
+  mPeImageDigestsSize   = 0;
+  ZeroMem (&mPeImageDigests, sizeof (mPeImageDigests));
+}
+
+/**
+  Set the digests of the image of the current image load.
+
+  If image verification already tried to take the digests during the current image
+  load, the measure handler runs after the verify handler and the digests can never
+  be shared. A warning is reported once in that case.
+
+  @param[in]  FileBuffer  The image buffer passed to the security handlers.
+  @param[in]  FileSize    The size of the image buffer in bytes.
+  @param[in]  DigestList  The Authenticode digests of the image.
+**/
+VOID
+EFIAPI
+SetPeImageDigests (
+  IN CONST VOID                *FileBuffer,
+  IN UINTN                     FileSize,
+  IN CONST TPML_DIGEST_VALUES  *DigestList
+  )
+{
+  DropPeImageDigests ();
+  if (mPeImageDigestsTaken && !mHandlerOrderReported) {
+    DEBUG ((
+      DEBUG_WARN,
+      "%a: the measure handler runs after the verify handler, PE image digests are not shared. "
+      "Link DxeTpm2MeasureBootLib ahead of DxeImageVerificationLib.\n",
+      __func__
+      ));
+    mHandlerOrderReported = TRUE;
+  }
+
+  if ((FileBuffer == NULL) || (DigestList == NULL) || (DigestList->count > HASH_COUNT)) {
+    return;
+  }
+
+  CopyMem (&mPeImageDigests, DigestList, sizeof (mPeImageDigests));
+  mPeImageDigestsBuffer = FileBuffer;
+  mPeImageDigestsSize   = FileSize;
+  mPeImageDigestsValid  = TRUE;
+}
+
+/**
+  Take the digests of the image of the current image load. The digests are
+  dropped whether they are returned or not.
+
+  @param[in]  FileBuffer  The image buffer passed to the security handlers.
+  @param[in]  FileSize    The size of the image buffer in bytes.
+  @param[out] DigestList  The Authenticode digests of the image.
+
+  @retval EFI_SUCCESS            The digests were returned.
+  @retval EFI_NOT_FOUND          No digests were set for FileBuffer and FileSize
+                                 during the current image load.
+  @retval EFI_INVALID_PARAMETER  DigestList is NULL.
+**/
+EFI_STATUS
+EFIAPI
+TakePeImageDigests (
+  IN  CONST VOID          *FileBuffer,
+  IN  UINTN               FileSize,
+  OUT TPML_DIGEST_VALUES  *DigestList
+  )
+{
+  EFI_STATUS  Status;
+
+  mPeImageDigestsTaken = TRUE;
+  if (DigestList == NULL) {
+    DropPeImageDigests ();
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = EFI_NOT_FOUND;
+  if (mPeImageDigestsValid && (mPeImageDigestsBuffer == FileBuffer) && (mPeImageDigestsSize == FileSize)) {
+    CopyMem (DigestList, &mPeImageDigests, sizeof (*DigestList));
+    Status = EFI_SUCCESS;
+  }
+
+  DropPeImageDigests ();
+  return Status;
+}
+
+/**
+  Security handler that runs first for every image load, and drops the digests
+  left from the previous image load.
+
+  @param[in]  AuthenticationStatus  The authentication status of the file.
+  @param[in]  File                  The device path of the file.
+  @param[in]  FileBuffer            The image buffer.
+  @param[in]  FileSize              The size of the image buffer.
+  @param[in]  BootPolicy            The boot policy of the LoadImage () call.
+
+  @retval EFI_SUCCESS   Always.
+**/
+EFI_STATUS
+EFIAPI
+PeImageDigestLibSecurityHandler (
+  IN  UINT32                          AuthenticationStatus,
+  IN  CONST EFI_DEVICE_PATH_PROTOCOL  *File  OPTIONAL,
+  IN  VOID                            *FileBuffer,
+  IN  UINTN                           FileSize,
+  IN  BOOLEAN                         BootPolicy
+  )
+{
+  DropPeImageDigests ();
+  mPeImageDigestsTaken = FALSE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Register the security handler that drops the digests at the start of every
+  image load. The constructor runs before the constructors of the libraries that
+  depend on this library, so the handler is called before their handlers.
+
+  The order of the measure and verify handlers follows the order of the
+  DxeTpm2MeasureBootLib and DxeImageVerificationLib constructors, which this
+  library cannot see. It is checked on the first image load that has both
+  handlers instead, see SetPeImageDigests ().
+
+  @param  ImageHandle  ImageHandle of the loaded driver.
+  @param  SystemTable  Pointer to the EFI System Table.
+
+  @retval  EFI_SUCCESS            Register successfully.
+  @retval  EFI_OUT_OF_RESOURCES   No enough memory to register this handler.
+**/
+EFI_STATUS
+EFIAPI
+DxePeImageDigestLibConstructor (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  return RegisterSecurity2Handler (
+           PeImageDigestLibSecurityHandler,
+           EFI_AUTH_OPERATION_VERIFY_IMAGE | EFI_AUTH_OPERATION_MEASURE_IMAGE
+           );
+}
@@ -27,6 +27,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <PiDxe.h>
 
 #include <Protocol/Tcg2Protocol.h>
+#include <Protocol/Tcg2PeImageDigest.h>
 #include <Protocol/BlockIo.h>
 #include <Protocol/DiskIo.h>
 #include <Protocol/DevicePathToText.h>
@@ -46,6 +47,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/PeCoffLib.h>
 #include <Library/SecurityManagementLib.h>
 #include <Library/HobLib.h>
+#include <Library/PeImageDigestLib.h>
 #include <Protocol/CcMeasurement.h>
 
 #include "DxeTpm2MeasureBootLibSanitization.h"
@@ -68,6 +70,10 @@ UINTN    mTcg2ImageSize;
 EFI_HANDLE         mTcg2CacheMeasuredHandle = NULL;
 MEASURED_HOB_DATA  *mTcg2MeasuredHobData    = NULL;
 EXCLUDED_HOB_DATA  *mExcludedFvHobData      = NULL;                  // MU_CHANGE
+//
+// PE image digest protocol installed with the Tcg2 protocol
+//
+EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL  *mTcg2PeImageDigest = NULL;
 
 /**
   Reads contents of a PE/COFF image in memory buffer.
@@ -362,6 +368,57 @@ Exit:
   return Status;
 }
 
+/**
+  Pass the digests that Tcg2 extended for a PE image to image verification of the
+  same image load, so that the image is not hashed again.
+
+  The digests are only taken from the PE image digest protocol installed on the
+  same handle as Tcg2Protocol.
+
+  @param[in] Tcg2Protocol   The Tcg2 protocol instance that measured the image.
+  @param[in] ImageAddress   Start address of image buffer.
+  @param[in] ImageSize      Image size
+**/
+VOID
+Tcg2SharePeImageDigests (
+  IN  EFI_TCG2_PROTOCOL     *Tcg2Protocol,
+  IN  EFI_PHYSICAL_ADDRESS  ImageAddress,
+  IN  UINTN                 ImageSize
+  )
+{
+  EFI_STATUS          Status;
+  EFI_HANDLE          *HandleBuffer;
+  UINTN               HandleCount;
+  UINTN               Index;
+  VOID                *Interface;
+  TPML_DIGEST_VALUES  DigestList;
+
+  if (mTcg2PeImageDigest == NULL) {
+    Status = gBS->LocateHandleBuffer (ByProtocol, &gEfiTcg2ProtocolGuid, NULL, &HandleCount, &HandleBuffer);
+    if (EFI_ERROR (Status)) {
+      return;
+    }
+
+    for (Index = 0; Index < HandleCount; Index++) {
+      Status = gBS->HandleProtocol (HandleBuffer[Index], &gEfiTcg2ProtocolGuid, &Interface);
+      if (!EFI_ERROR (Status) && (Interface == Tcg2Protocol)) {
+        gBS->HandleProtocol (HandleBuffer[Index], &gEdkiiTcg2PeImageDigestProtocolGuid, (VOID **)&mTcg2PeImageDigest);
+        break;
+      }
+    }
+
+    FreePool (HandleBuffer);
+    if (mTcg2PeImageDigest == NULL) {
+      return;
+    }
+  }
+
+  Status = mTcg2PeImageDigest->GetPeImageDigests (mTcg2PeImageDigest, ImageAddress, ImageSize, &DigestList);
+  if (!EFI_ERROR (Status)) {
+    SetPeImageDigests ((VOID *)(UINTN)ImageAddress, ImageSize, &DigestList);
+  }
+}
+
 /**
   Measure PE image into TPM log based on the authenticode image hashing in
   PE/COFF Specification 8.0 Appendix A.
@@ -505,6 +562,9 @@ Tcg2MeasurePeImage (
                              Tcg2Event
                              );
     DEBUG ((DEBUG_INFO, "DxeTpm2MeasureBootHandler - Tcg2 MeasurePeImage - %r\n", Status));
+    if (!EFI_ERROR (Status) || (Status == EFI_VOLUME_FULL)) {
+      Tcg2SharePeImageDigests (Tcg2Protocol, ImageAddress, ImageSize);
+    }
   }
 
   if (Status == EFI_VOLUME_FULL) {
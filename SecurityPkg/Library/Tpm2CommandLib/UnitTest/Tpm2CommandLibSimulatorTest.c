@@ -0,0 +1,323 @@
+/** @file
+  Host based unit tests of Tpm2CommandLib on the TPM 2.0 simulator.
+
+  The PCR commands used for measured boot are sent through Tpm2CommandLib to
+  Tpm2DeviceLibSimulator, and the PCR values are checked against digests
+  calculated with BaseCryptLib. A measured boot like flow logs the number of
+  commands and the simulated TPM time it costs.
+
+  Copyright (c) Microsoft Corporation.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <IndustryStandard/Tpm20.h>
+#include <Protocol/Tcg2Protocol.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/DebugLib.h>
+#include <Library/Tpm2CommandLib.h>
+#include <Library/Tpm2SimulatorLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_NAME     "Tpm2CommandLib Simulator Test"
+#define UNIT_TEST_VERSION  "1.0"
+
+//
+// Simulated execution times, in microseconds, in the range of discrete TPMs.
+//
+#define TEST_DEFAULT_LATENCY  1000
+#define TEST_EXTEND_LATENCY   3000
+#define TEST_EVENT_LATENCY    5000
+
+#define TEST_EVENT_COUNT        32
+#define TEST_EVENT_BUFFER_SIZE  SIZE_4KB
+
+UINT8  mTestEventData[TEST_EVENT_BUFFER_SIZE];
+
+/**
+  Power cycle the simulated TPM with the SHA-256 and SHA-384 banks active and
+  start it up.
+
+  @param[in]  Context   The unit test context.
+
+  @retval UNIT_TEST_PASSED             The TPM is started.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The TPM failed to start.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < sizeof (mTestEventData); Index++) {
+    mTestEventData[Index] = (UINT8)(Index * 7 + 3);
+  }
+
+  Tpm2SimulatorReset (EFI_TCG2_BOOT_HASH_ALG_SHA256 | EFI_TCG2_BOOT_HASH_ALG_SHA384);
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2Startup (TPM_SU_CLEAR));
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Calculate the SHA-256 value of a PCR after a digest is extended into it.
+
+  @param[in, out] Pcr     On input, the PCR value. On output, the extended value.
+  @param[in]      Digest  The SHA-256 digest extended.
+
+  @retval TRUE   The value is calculated.
+  @retval FALSE  The hash failed.
+**/
+BOOLEAN
+TestExtendSha256 (
+  IN OUT UINT8        *Pcr,
+  IN     CONST UINT8  *Digest
+  )
+{
+  UINT8  Data[SHA256_DIGEST_SIZE * 2];
+
+  CopyMem (Data, Pcr, SHA256_DIGEST_SIZE);
+  CopyMem (Data + SHA256_DIGEST_SIZE, Digest, SHA256_DIGEST_SIZE);
+  return Sha256HashAll (Data, sizeof (Data), Pcr);
+}
+
+/**
+  Check PCR_Extend, PCR_Event and an event sequence against digests calculated
+  with BaseCryptLib, and PCR_Read against the simulator.
+
+  @param[in]  Context   The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestPcrCommands (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TPML_DIGEST_VALUES  Digests;
+  TPM2B_EVENT         Event;
+  TPM2B_MAX_BUFFER    Buffer;
+  TPMI_DH_OBJECT      SequenceHandle;
+  TPML_PCR_SELECTION  PcrSelectionIn;
+  TPML_PCR_SELECTION  PcrSelectionOut;
+  TPML_DIGEST         PcrValues;
+  UINT32              PcrUpdateCounter;
+  TPMU_HA             Pcr;
+  UINT8               Expected[SHA256_DIGEST_SIZE];
+  UINT8               Digest[SHA256_DIGEST_SIZE];
+
+  //
+  // PCR_Extend of a digest in a bank that is not active leaves that bank alone.
+  //
+  ZeroMem (&Digests, sizeof (Digests));
+  Digests.count              = 2;
+  Digests.digests[0].hashAlg = TPM_ALG_SHA1;
+  SetMem (Digests.digests[0].digest.sha1, SHA1_DIGEST_SIZE, 0x11);
+  Digests.digests[1].hashAlg = TPM_ALG_SHA256;
+  SetMem (Digests.digests[1].digest.sha256, SHA256_DIGEST_SIZE, 0x22);
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2PcrExtend (0, &Digests));
+
+  ZeroMem (Expected, sizeof (Expected));
+  UT_ASSERT_TRUE (TestExtendSha256 (Expected, Digests.digests[1].digest.sha256));
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2SimulatorGetPcr (TPM_ALG_SHA256, 0, &Pcr));
+  UT_ASSERT_MEM_EQUAL (Pcr.sha256, Expected, SHA256_DIGEST_SIZE);
+  UT_ASSERT_STATUS_EQUAL (Tpm2SimulatorGetPcr (TPM_ALG_SHA1, 0, &Pcr), EFI_NOT_FOUND);
+
+  //
+  // PCR_Event hashes the event with every active bank.
+  //
+  Event.size = 64;
+  CopyMem (Event.buffer, mTestEventData, Event.size);
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2PcrEvent (0, &Event, &Digests));
+  UT_ASSERT_EQUAL (Digests.count, 2);
+  UT_ASSERT_EQUAL (Digests.digests[0].hashAlg, TPM_ALG_SHA256);
+  UT_ASSERT_TRUE (Sha256HashAll (mTestEventData, Event.size, Digest));
+  UT_ASSERT_MEM_EQUAL (Digests.digests[0].digest.sha256, Digest, SHA256_DIGEST_SIZE);
+  UT_ASSERT_TRUE (TestExtendSha256 (Expected, Digest));
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2SimulatorGetPcr (TPM_ALG_SHA256, 0, &Pcr));
+  UT_ASSERT_MEM_EQUAL (Pcr.sha256, Expected, SHA256_DIGEST_SIZE);
+
+  //
+  // An event sequence over a buffer larger than MAX_DIGEST_BUFFER.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2HashSequenceStart (TPM_ALG_NULL, &SequenceHandle));
+  Buffer.size = MAX_DIGEST_BUFFER;
+  CopyMem (Buffer.buffer, mTestEventData, Buffer.size);
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2SequenceUpdate (SequenceHandle, &Buffer));
+  Buffer.size = 100;
+  CopyMem (Buffer.buffer, mTestEventData + MAX_DIGEST_BUFFER, Buffer.size);
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2EventSequenceComplete (7, SequenceHandle, &Buffer, &Digests));
+
+  UT_ASSERT_TRUE (Sha256HashAll (mTestEventData, MAX_DIGEST_BUFFER + 100, Digest));
+  UT_ASSERT_MEM_EQUAL (Digests.digests[0].digest.sha256, Digest, SHA256_DIGEST_SIZE);
+  ZeroMem (Expected, sizeof (Expected));
+  UT_ASSERT_TRUE (TestExtendSha256 (Expected, Digest));
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2SimulatorGetPcr (TPM_ALG_SHA256, 7, &Pcr));
+  UT_ASSERT_MEM_EQUAL (Pcr.sha256, Expected, SHA256_DIGEST_SIZE);
+
+  //
+  // PCR_Read returns the same value, and counts the three updates.
+  //
+  ZeroMem (&PcrSelectionIn, sizeof (PcrSelectionIn));
+  PcrSelectionIn.count                         = 1;
+  PcrSelectionIn.pcrSelections[0].hash         = TPM_ALG_SHA256;
+  PcrSelectionIn.pcrSelections[0].sizeofSelect = PCR_SELECT_MAX;
+  PcrSelectionIn.pcrSelections[0].pcrSelect[0] = BIT7;
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2PcrRead (&PcrSelectionIn, &PcrUpdateCounter, &PcrSelectionOut, &PcrValues));
+  UT_ASSERT_EQUAL (PcrUpdateCounter, 3);
+  UT_ASSERT_EQUAL (PcrValues.count, 1);
+  UT_ASSERT_EQUAL (PcrValues.digests[0].size, SHA256_DIGEST_SIZE);
+  UT_ASSERT_MEM_EQUAL (PcrValues.digests[0].buffer, Expected, SHA256_DIGEST_SIZE);
+
+  UT_ASSERT_EQUAL (Tpm2SimulatorGetCommandCount (TPM_CC_SequenceUpdate), 1);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Measure events the way Tcg2Dxe does, hashing them on the host and extending
+  the digests, and log the TPM cost of the flow.
+
+  @param[in]  Context   The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BenchMeasuredBoot (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TPML_DIGEST_VALUES  Digests;
+  TPM2B_EVENT         Event;
+  UINT8               Expected[SHA256_DIGEST_SIZE];
+  TPMU_HA             Pcr;
+  UINT32              Index;
+  UINT32              Count;
+  UINT64              Elapsed;
+
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2SimulatorSetLatency (0, TEST_DEFAULT_LATENCY));
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2SimulatorSetLatency (TPM_CC_PCR_Extend, TEST_EXTEND_LATENCY));
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2SimulatorSetLatency (TPM_CC_PCR_Event, TEST_EVENT_LATENCY));
+  Count   = Tpm2SimulatorGetCommandCount (0);
+  Elapsed = Tpm2SimulatorGetElapsedTime ();
+
+  ZeroMem (Expected, sizeof (Expected));
+  ZeroMem (&Digests, sizeof (Digests));
+  Digests.count              = 2;
+  Digests.digests[0].hashAlg = TPM_ALG_SHA256;
+  Digests.digests[1].hashAlg = TPM_ALG_SHA384;
+  for (Index = 0; Index < TEST_EVENT_COUNT; Index++) {
+    UT_ASSERT_TRUE (Sha256HashAll (mTestEventData + Index, SIZE_1KB, Digests.digests[0].digest.sha256));
+    UT_ASSERT_TRUE (Sha384HashAll (mTestEventData + Index, SIZE_1KB, Digests.digests[1].digest.sha384));
+    UT_ASSERT_NOT_EFI_ERROR (Tpm2PcrExtend (4, &Digests));
+    UT_ASSERT_TRUE (TestExtendSha256 (Expected, Digests.digests[0].digest.sha256));
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Tpm2SimulatorGetPcr (TPM_ALG_SHA256, 4, &Pcr));
+  UT_ASSERT_MEM_EQUAL (Pcr.sha256, Expected, SHA256_DIGEST_SIZE);
+  UT_ASSERT_EQUAL (Tpm2SimulatorGetCommandCount (0) - Count, TEST_EVENT_COUNT);
+  UT_ASSERT_EQUAL (Tpm2SimulatorGetElapsedTime () - Elapsed, TEST_EVENT_COUNT * TEST_EXTEND_LATENCY);
+  UT_LOG_INFO (
+    "Host hashing: %d commands, %ld us of TPM time\n",
+    Tpm2SimulatorGetCommandCount (0) - Count,
+    Tpm2SimulatorGetElapsedTime () - Elapsed
+    );
+
+  //
+  // The same events measured with PCR_Event, letting the TPM hash them.
+  //
+  Count      = Tpm2SimulatorGetCommandCount (0);
+  Elapsed    = Tpm2SimulatorGetElapsedTime ();
+  Event.size = SIZE_1KB;
+  for (Index = 0; Index < TEST_EVENT_COUNT; Index++) {
+    CopyMem (Event.buffer, mTestEventData + Index, Event.size);
+    UT_ASSERT_NOT_EFI_ERROR (Tpm2PcrEvent (5, &Event, &Digests));
+  }
+
+  UT_ASSERT_EQUAL (Tpm2SimulatorGetCommandCount (0) - Count, TEST_EVENT_COUNT);
+  UT_LOG_INFO (
+    "TPM hashing: %d commands, %ld us of TPM time\n",
+    Tpm2SimulatorGetCommandCount (0) - Count,
+    Tpm2SimulatorGetElapsedTime () - Elapsed
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for Tpm2CommandLib
+  on the TPM 2.0 simulator and run the unit tests.
+
+  @retval EFI_SUCCESS           All test cases were dispatched.
+  @retval EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SimulatorSuite;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in InitUnitTestFramework. Status = %r\n", UNIT_TEST_NAME, Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&SimulatorSuite, Framework, "Tpm2SimulatorSuite", "SecurityPkg.Tpm2CommandLib.Simulator", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in CreateUnitTestSuite for Tpm2SimulatorSuite\n", UNIT_TEST_NAME));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (SimulatorSuite, "PCR commands match BaseCryptLib digests", "PcrCommands", TestPcrCommands, TestSetup, NULL, NULL);
+  AddTestCase (SimulatorSuite, "TPM cost of measured boot events", "MeasuredBoot", BenchMeasuredBoot, TestSetup, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Tpm2CommandLibSimulatorTestMain  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Tpm2CommandLibSimulatorTestMain (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return (INT32)UefiTestMain ();
+}
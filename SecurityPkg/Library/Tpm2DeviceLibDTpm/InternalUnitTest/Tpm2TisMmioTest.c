@@ -0,0 +1,446 @@
+/** @file
+  Host based unit test of the TIS FIFO transport of Tpm2DeviceLibDTpm.
+
+  The MMIO accessors are replaced with a model of the TIS register block that
+  takes a command and returns a response through the data FIFO, and counts the
+  register accesses the transport makes.
+
+  Copyright (c) Microsoft Corporation.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UnitTestLib.h>
+#include <IndustryStandard/Tpm20.h>
+#include <IndustryStandard/TpmTis.h>
+#include <IndustryStandard/TpmPtp.h>
+
+#define UNIT_TEST_NAME     "Tpm2TisMmioTest"
+#define UNIT_TEST_VERSION  "1.0"
+
+#define TIS_MODEL_BUFFER_SIZE  0x500
+#define TIS_MODEL_BURST_COUNT  67
+#define TIS_MODEL_COMMAND_SIZE  1009
+#define TIS_MODEL_RESPONSE_SIZE  1012
+
+#define TIS_MODEL_CAPABILITY_TIS_12  (INTERFACE_CAPABILITY_INTERFACE_VERSION_TIS_12 << 28)
+#define TIS_MODEL_CAPABILITY_TIS_13  ((INTERFACE_CAPABILITY_INTERFACE_VERSION_TIS_13 << 28) | (3 << 9))
+
+//
+// Register accesses made by the transport, by kind.
+//
+typedef struct {
+  UINTN    Total;
+  UINTN    DataFifo8;           // 8-bit accesses to TPM_DATA_FIFO
+  UINTN    XDataFifo32;         // 32-bit accesses to TPM_XDATA_FIFO
+  UINTN    BurstCount8;         // 8-bit reads of the burstCount bytes of TPM_STS
+  UINTN    Status32;            // 32-bit reads of TPM_STS
+} TIS_MODEL_ACCESS_COUNT;
+
+//
+// State of the TIS register model.
+//
+typedef struct {
+  PTP_FIFO_REGISTERS        Registers;
+  UINT32                    InterfaceCapability;
+  UINT8                     Command[TIS_MODEL_BUFFER_SIZE];
+  UINT32                    CommandSize;
+  UINT8                     Response[TIS_MODEL_BUFFER_SIZE];
+  UINT32                    ResponseSize;
+  UINT32                    ResponsePosition;
+  TIS_MODEL_ACCESS_COUNT    Count;
+} TIS_MODEL;
+
+TIS_MODEL  mTisModel;
+
+/**
+  Send a command to TPM for execution and return response data.
+
+  @param[in]      TisReg        TPM register space base address.
+  @param[in]      BufferIn      Buffer for command data.
+  @param[in]      SizeIn        Size of command data.
+  @param[in, out] BufferOut     Buffer for response data.
+  @param[in, out] SizeOut       Size of response data.
+
+  @retval EFI_SUCCESS           Operation completed successfully.
+  @retval EFI_BUFFER_TOO_SMALL  Response data buffer is too small.
+  @retval EFI_DEVICE_ERROR      Unexpected device behavior.
+  @retval EFI_UNSUPPORTED       Unsupported TPM version
+**/
+EFI_STATUS
+Tpm2TisTpmCommand (
+  IN     TIS_PC_REGISTERS_PTR  TisReg,
+  IN     UINT8                 *BufferIn,
+  IN     UINT32                SizeIn,
+  IN OUT UINT8                 *BufferOut,
+  IN OUT UINT32                *SizeOut
+  );
+
+/**
+  Get the offset of a register address in the TIS register model.
+
+  @param[in]  Address  The register address.
+
+  @return The offset of the register.
+**/
+UINTN
+TisModelOffset (
+  IN UINTN  Address
+  )
+{
+  ASSERT (Address >= (UINTN)&mTisModel.Registers);
+  ASSERT (Address < (UINTN)&mTisModel.Registers + sizeof (mTisModel.Registers));
+  return Address - (UINTN)&mTisModel.Registers;
+}
+
+/**
+  Get the low byte of TPM_STS of the TIS register model.
+
+  @return The status byte.
+**/
+UINT8
+TisModelStatus (
+  VOID
+  )
+{
+  UINT8  Status;
+
+  Status = TIS_PC_VALID | TIS_PC_STS_READY;
+  if (mTisModel.ResponsePosition < mTisModel.ResponseSize) {
+    Status |= TIS_PC_STS_DATA;
+  }
+
+  return Status;
+}
+
+/**
+  Reads an 8-bit MMIO register of the TIS register model.
+
+  @param[in]  Address  The MMIO register to read.
+
+  @return The value read.
+**/
+UINT8
+EFIAPI
+MmioRead8 (
+  IN UINTN  Address
+  )
+{
+  UINTN  Offset;
+
+  mTisModel.Count.Total++;
+  Offset = TisModelOffset (Address);
+  switch (Offset) {
+    case OFFSET_OF (TIS_PC_REGISTERS, DataFifo):
+      mTisModel.Count.DataFifo8++;
+      ASSERT (mTisModel.ResponsePosition < mTisModel.ResponseSize);
+      return mTisModel.Response[mTisModel.ResponsePosition++];
+    case OFFSET_OF (TIS_PC_REGISTERS, Status):
+      return TisModelStatus ();
+    case OFFSET_OF (TIS_PC_REGISTERS, BurstCount):
+      mTisModel.Count.BurstCount8++;
+      return TIS_MODEL_BURST_COUNT;
+    case OFFSET_OF (TIS_PC_REGISTERS, BurstCount) + 1:
+      mTisModel.Count.BurstCount8++;
+      return 0;
+    default:
+      return ((UINT8 *)&mTisModel.Registers)[Offset];
+  }
+}
+
+/**
+  Writes an 8-bit MMIO register of the TIS register model.
+
+  @param[in]  Address  The MMIO register to write.
+  @param[in]  Value    The value to write.
+
+  @return Value.
+**/
+UINT8
+EFIAPI
+MmioWrite8 (
+  IN UINTN  Address,
+  IN UINT8  Value
+  )
+{
+  mTisModel.Count.Total++;
+  if (TisModelOffset (Address) == OFFSET_OF (TIS_PC_REGISTERS, DataFifo)) {
+    mTisModel.Count.DataFifo8++;
+    ASSERT (mTisModel.CommandSize < sizeof (mTisModel.Command));
+    mTisModel.Command[mTisModel.CommandSize++] = Value;
+  }
+
+  return Value;
+}
+
+/**
+  Reads a 32-bit MMIO register of the TIS register model.
+
+  @param[in]  Address  The MMIO register to read.
+
+  @return The value read.
+**/
+UINT32
+EFIAPI
+MmioRead32 (
+  IN UINTN  Address
+  )
+{
+  UINT32  Value;
+
+  mTisModel.Count.Total++;
+  switch (TisModelOffset (Address)) {
+    case OFFSET_OF (PTP_FIFO_REGISTERS, XDataFifo):
+      mTisModel.Count.XDataFifo32++;
+      ASSERT (mTisModel.ResponsePosition + sizeof (UINT32) <= mTisModel.ResponseSize);
+      Value                       = ReadUnaligned32 ((UINT32 *)&mTisModel.Response[mTisModel.ResponsePosition]);
+      mTisModel.ResponsePosition += sizeof (UINT32);
+      return Value;
+    case OFFSET_OF (TIS_PC_REGISTERS, Status):
+      mTisModel.Count.Status32++;
+      return (TIS_MODEL_BURST_COUNT << 8) | TisModelStatus ();
+    case OFFSET_OF (TIS_PC_REGISTERS, IntfCapability):
+      return mTisModel.InterfaceCapability;
+    default:
+      return 0;
+  }
+}
+
+/**
+  Writes a 32-bit MMIO register of the TIS register model.
+
+  @param[in]  Address  The MMIO register to write.
+  @param[in]  Value    The value to write.
+
+  @return Value.
+**/
+UINT32
+EFIAPI
+MmioWrite32 (
+  IN UINTN   Address,
+  IN UINT32  Value
+  )
+{
+  mTisModel.Count.Total++;
+  if (TisModelOffset (Address) == OFFSET_OF (PTP_FIFO_REGISTERS, XDataFifo)) {
+    mTisModel.Count.XDataFifo32++;
+    ASSERT (mTisModel.CommandSize + sizeof (UINT32) <= sizeof (mTisModel.Command));
+    WriteUnaligned32 ((UINT32 *)&mTisModel.Command[mTisModel.CommandSize], Value);
+    mTisModel.CommandSize += sizeof (UINT32);
+  }
+
+  return Value;
+}
+
+/**
+  Wait before the next read of a TPM register that is being polled.
+  The TIS register model is always ready, so nothing is waited for.
+
+  @param[in, out] PollCount  The number of times the register was polled so far.
+  @param[in]      Remaining  Microseconds left before the poll times out.
+
+  @return The number of microseconds waited.
+**/
+UINT32
+Tpm2PollDelay (
+  IN OUT UINT32  *PollCount,
+  IN     UINT32  Remaining
+  )
+{
+  (*PollCount)++;
+  return 1;
+}
+
+/**
+  Send a command through the TIS register model and check that the command and
+  the response are transferred intact.
+
+  @param[in]  InterfaceCapability  The TPM_INTF_CAPABILITY value of the model.
+
+  @retval UNIT_TEST_PASSED             The command and response were transferred.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The transport failed or corrupted data.
+**/
+UNIT_TEST_STATUS
+TisModelRunCommand (
+  IN UINT32  InterfaceCapability
+  )
+{
+  UINT8   Command[TIS_MODEL_COMMAND_SIZE];
+  UINT8   Response[TIS_MODEL_BUFFER_SIZE];
+  UINT32  ResponseSize;
+  UINT32  Index;
+
+  ZeroMem (&mTisModel, sizeof (mTisModel));
+  mTisModel.InterfaceCapability = InterfaceCapability;
+
+  for (Index = 0; Index < sizeof (Command); Index++) {
+    Command[Index] = (UINT8)(Index * 7 + 3);
+  }
+
+  mTisModel.ResponseSize = TIS_MODEL_RESPONSE_SIZE;
+  for (Index = 0; Index < mTisModel.ResponseSize; Index++) {
+    mTisModel.Response[Index] = (UINT8)(Index * 13 + 5);
+  }
+
+  WriteUnaligned16 ((UINT16 *)&mTisModel.Response[0], SwapBytes16 (TPM_ST_NO_SESSIONS));
+  WriteUnaligned32 ((UINT32 *)&mTisModel.Response[2], SwapBytes32 (mTisModel.ResponseSize));
+
+  ResponseSize = sizeof (Response);
+  UT_ASSERT_NOT_EFI_ERROR (
+    Tpm2TisTpmCommand ((TIS_PC_REGISTERS_PTR)&mTisModel.Registers, Command, sizeof (Command), Response, &ResponseSize)
+    );
+
+  UT_ASSERT_EQUAL (mTisModel.CommandSize, sizeof (Command));
+  UT_ASSERT_MEM_EQUAL (mTisModel.Command, Command, sizeof (Command));
+  UT_ASSERT_EQUAL (ResponseSize, mTisModel.ResponseSize);
+  UT_ASSERT_EQUAL (mTisModel.ResponsePosition, mTisModel.ResponseSize);
+  UT_ASSERT_MEM_EQUAL (Response, mTisModel.Response, ResponseSize);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A TIS 1.2 TPM is only accessed one byte at a time, both for the data FIFO and
+  for the burst count.
+
+  @param[in] Context  The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestTis12ByteAccess (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  Status;
+
+  Status = TisModelRunCommand (TIS_MODEL_CAPABILITY_TIS_12);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  UT_ASSERT_EQUAL (mTisModel.Count.XDataFifo32, 0);
+  UT_ASSERT_EQUAL (mTisModel.Count.Status32, 0);
+  UT_ASSERT_NOT_EQUAL (mTisModel.Count.BurstCount8, 0);
+  UT_ASSERT_EQUAL (mTisModel.Count.DataFifo8, TIS_MODEL_COMMAND_SIZE + TIS_MODEL_RESPONSE_SIZE);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A TIS 1.3 TPM with wide transfers gets 32-bit data FIFO and TPM_STS accesses,
+  and needs less than a third of the MMIO accesses of a TIS 1.2 TPM for the
+  same command and response.
+
+  @param[in] Context  The unit test context.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TestTis13WideAccess (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  Status;
+  UINTN             ByteAccessTotal;
+  UINTN             Bursts;
+
+  Status = TisModelRunCommand (TIS_MODEL_CAPABILITY_TIS_12);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  ByteAccessTotal = mTisModel.Count.Total;
+
+  Status = TisModelRunCommand (TIS_MODEL_CAPABILITY_TIS_13);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  DEBUG ((DEBUG_INFO, "%a: MMIO accesses TIS 1.2 %Lu, TIS 1.3 %Lu\n", UNIT_TEST_NAME, (UINT64)ByteAccessTotal, (UINT64)mTisModel.Count.Total));
+
+  //
+  // At most 3 leftover bytes per burst go through the byte wide data FIFO.
+  //
+  Bursts = (TIS_MODEL_COMMAND_SIZE + TIS_MODEL_BURST_COUNT - 1) / TIS_MODEL_BURST_COUNT +
+           (TIS_MODEL_RESPONSE_SIZE + TIS_MODEL_BURST_COUNT - 1) / TIS_MODEL_BURST_COUNT + 1;
+  UT_ASSERT_EQUAL (mTisModel.Count.BurstCount8, 0);
+  UT_ASSERT_NOT_EQUAL (mTisModel.Count.Status32, 0);
+  UT_ASSERT_NOT_EQUAL (mTisModel.Count.XDataFifo32, 0);
+  UT_ASSERT_TRUE (mTisModel.Count.DataFifo8 <= 3 * Bursts);
+  UT_ASSERT_TRUE (mTisModel.Count.Total * 3 < ByteAccessTotal);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  This function acts as the entry point for the unit tests.
+
+  @retval EFI_SUCCESS  The tests ran.
+  @retval others       The test framework could not be set up.
+**/
+EFI_STATUS
+EFIAPI
+UefiTestMain (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      TisSuite;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_NAME, gEfiCallerBaseName, UNIT_TEST_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in InitUnitTestFramework. Status = %r\n", UNIT_TEST_NAME, Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&TisSuite, Framework, "Tpm2TisMmioTestSuite", "SecurityPkg.Tpm2DeviceLibDTpm.Tis", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: Failed in CreateUnitTestSuite. Status = %r\n", UNIT_TEST_NAME, Status));
+    goto EXIT;
+  }
+
+  AddTestCase (TisSuite, "TIS 1.2 TPMs are accessed one byte at a time", "Tis12ByteAccess", TestTis12ByteAccess, NULL, NULL, NULL);
+  AddTestCase (TisSuite, "TIS 1.3 TPMs get 32-bit accesses and fewer MMIO accesses", "Tis13WideAccess", TestTis13WideAccess, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+///
+/// Avoid ECC error for function name that starts with lower case letter
+///
+#define Tpm2TisMmioTestMain  main
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param[in] Argc  Number of arguments
+  @param[in] Argv  Array of pointers to arguments
+
+  @retval 0      Success
+  @retval other  Error
+**/
+INT32
+Tpm2TisMmioTestMain (
+  IN INT32  Argc,
+  IN CHAR8  *Argv[]
+  )
+{
+  return (INT32)UefiTestMain ();
+}
@@ -10,6 +10,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #ifndef _TPM2_DEVICE_LIB_DTPM_H_
 #define _TPM2_DEVICE_LIB_DTPM_H_
 
+#include <Guid/Tpm2CommandLatencyHob.h>
+
 /**
   Return PTP interface type.
 
@@ -64,4 +66,46 @@ InternalTpm2DeviceLibDTpmCommonConstructor (
   VOID
   );
 
+/**
+  Return the TPM2 command latency statistics table of this library instance.
+
+  @return Pointer to the table, or NULL if statistics are not collected.
+**/
+TPM2_COMMAND_LATENCY_HOB *
+GetTpm2CommandLatencyTable (
+  VOID
+  );
+
+/**
+  Wait before the next read of a TPM register that is being polled.
+
+  The first reads are done back to back, so a TPM that completes quickly is
+  noticed at once. Then the delay starts at 1 microsecond and doubles on each
+  call up to TPM2_POLL_MAX_DELAY, so a slow TPM is not flooded with MMIO reads.
+
+  @param[in, out] PollCount  Number of calls made for this wait, 0 for the first call.
+  @param[in]      TimeLeft   The time (unit MicroSecond) left before the wait times out.
+
+  @return The time (unit MicroSecond) waited.
+**/
+UINT32
+Tpm2PollDelay (
+  IN OUT UINT32  *PollCount,
+  IN     UINT32  TimeLeft
+  );
+
+/**
+  Record the latency of a TPM2 command that has completed.
+
+  @param[in] InputParameterBlockSize  Size of the TPM2 input parameter block.
+  @param[in] InputParameterBlock      Pointer to the TPM2 input parameter block.
+  @param[in] StartTicks               Performance counter value when the command was sent.
+**/
+VOID
+Tpm2RecordCommandLatency (
+  IN UINT32  InputParameterBlockSize,
+  IN UINT8   *InputParameterBlock,
+  IN UINT64  StartTicks
+  );
+
 #endif // _TPM2_DEVICE_LIB_DTPM_H_
@@ -87,17 +87,22 @@ PtpCrbWaitRegisterBits (
 {
   UINT32  RegRead;
   UINT32  WaitTime;
+  UINT32  PollCount;
 
-  for (WaitTime = 0; WaitTime < TimeOut; WaitTime += 30) {
+  WaitTime  = 0;
+  PollCount = 0;
+  while (TRUE) {
     RegRead = MmioRead32 ((UINTN)Register);
     if (((RegRead & BitSet) == BitSet) && ((RegRead & BitClear) == 0)) {
       return EFI_SUCCESS;
     }
 
-    MicroSecondDelay (30);
-  }
+    if (WaitTime >= TimeOut) {
+      return EFI_TIMEOUT;
+    }
 
-  return EFI_TIMEOUT;
+    WaitTime += Tpm2PollDelay (&PollCount, TimeOut - WaitTime);
+  }
 }
 
 /**
@@ -614,29 +619,37 @@ DTpm2SubmitCommand (
   )
 {
   TPM2_PTP_INTERFACE_TYPE  PtpInterface;
+  UINT64                   StartTicks;
+  EFI_STATUS               Status;
 
+  StartTicks   = GetPerformanceCounter ();
   PtpInterface = GetCachedPtpInterface ();
   switch (PtpInterface) {
     case Tpm2PtpInterfaceCrb:
-      return PtpCrbTpmCommand (
-               (PTP_CRB_REGISTERS_PTR)(UINTN)PcdGet64 (PcdTpmBaseAddress),
-               InputParameterBlock,
-               InputParameterBlockSize,
-               OutputParameterBlock,
-               OutputParameterBlockSize
-               );
+      Status = PtpCrbTpmCommand (
+                 (PTP_CRB_REGISTERS_PTR)(UINTN)PcdGet64 (PcdTpmBaseAddress),
+                 InputParameterBlock,
+                 InputParameterBlockSize,
+                 OutputParameterBlock,
+                 OutputParameterBlockSize
+                 );
+      break;
     case Tpm2PtpInterfaceFifo:
     case Tpm2PtpInterfaceTis:
-      return Tpm2TisTpmCommand (
-               (TIS_PC_REGISTERS_PTR)(UINTN)PcdGet64 (PcdTpmBaseAddress),
-               InputParameterBlock,
-               InputParameterBlockSize,
-               OutputParameterBlock,
-               OutputParameterBlockSize
-               );
+      Status = Tpm2TisTpmCommand (
+                 (TIS_PC_REGISTERS_PTR)(UINTN)PcdGet64 (PcdTpmBaseAddress),
+                 InputParameterBlock,
+                 InputParameterBlockSize,
+                 OutputParameterBlock,
+                 OutputParameterBlockSize
+                 );
+      break;
     default:
       return EFI_NOT_FOUND;
   }
+
+  Tpm2RecordCommandLatency (InputParameterBlockSize, InputParameterBlock, StartTicks);
+  return Status;
 }
 
 /**
@@ -0,0 +1,170 @@
+/** @file
+  Register polling and command latency statistics used by dTPM2.0 library.
+
+Copyright (c) Microsoft Corporation.
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <IndustryStandard/Tpm20.h>
+
+#include <Library/BaseLib.h>
+#include <Library/TimerLib.h>
+#include <Library/Tpm2DeviceLib.h>
+
+#include "Tpm2DeviceLibDTpm.h"
+
+//
+// Number of register reads done back to back before Tpm2PollDelay () starts to delay.
+//
+#define TPM2_POLL_SPIN_COUNT  8
+
+//
+// Longest delay (unit MicroSecond) between two register reads.
+//
+#define TPM2_POLL_MAX_DELAY  128
+
+/**
+  Wait before the next read of a TPM register that is being polled.
+
+  The first reads are done back to back, so a TPM that completes quickly is
+  noticed at once. Then the delay starts at 1 microsecond and doubles on each
+  call up to TPM2_POLL_MAX_DELAY, so a slow TPM is not flooded with MMIO reads.
+
+  @param[in, out] PollCount  Number of calls made for this wait, 0 for the first call.
+  @param[in]      TimeLeft   The time (unit MicroSecond) left before the wait times out.
+
+  @return The time (unit MicroSecond) waited.
+**/
+UINT32
+Tpm2PollDelay (
+  IN OUT UINT32  *PollCount,
+  IN     UINT32  TimeLeft
+  )
+{
+  UINT32  Delay;
+
+  if (*PollCount < TPM2_POLL_SPIN_COUNT) {
+    (*PollCount)++;
+    CpuPause ();
+    return 0;
+  }
+
+  Delay = TPM2_POLL_MAX_DELAY;
+  if ((1U << (*PollCount - TPM2_POLL_SPIN_COUNT)) < TPM2_POLL_MAX_DELAY) {
+    Delay = 1U << (*PollCount - TPM2_POLL_SPIN_COUNT);
+    (*PollCount)++;
+  }
+
+  Delay = MIN (Delay, TimeLeft);
+  MicroSecondDelay (Delay);
+  return Delay;
+}
+
+/**
+  Return the command code of a TPM2 command.
+
+  @param[in] InputParameterBlockSize  Size of the TPM2 input parameter block.
+  @param[in] InputParameterBlock      Pointer to the TPM2 input parameter block.
+
+  @return The command code, or 0 if the block is too small to hold a command header.
+**/
+STATIC
+UINT32
+Tpm2GetCommandCode (
+  IN UINT32  InputParameterBlockSize,
+  IN UINT8   *InputParameterBlock
+  )
+{
+  if (InputParameterBlockSize < sizeof (TPM2_COMMAND_HEADER)) {
+    return 0;
+  }
+
+  return SwapBytes32 (ReadUnaligned32 (&((TPM2_COMMAND_HEADER *)InputParameterBlock)->commandCode));
+}
+
+/**
+  Add the time elapsed since StartTicks to the statistics of a command code.
+
+  @param[in, out] Table        TPM2 command latency statistics table.
+  @param[in]      CommandCode  Command code of the completed command.
+  @param[in]      StartTicks   Performance counter value when the command was sent.
+**/
+STATIC
+VOID
+Tpm2AddCommandLatency (
+  IN OUT TPM2_COMMAND_LATENCY_HOB  *Table,
+  IN     UINT32                    CommandCode,
+  IN     UINT64                    StartTicks
+  )
+{
+  UINT64                      EndTicks;
+  UINT64                      CounterStart;
+  UINT64                      CounterEnd;
+  UINT64                      Time;
+  UINT32                      Index;
+  TPM2_COMMAND_LATENCY_ENTRY  *Entry;
+
+  EndTicks = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  if (CounterStart > CounterEnd) {
+    Time = GetTimeInNanoSecond (StartTicks - EndTicks);
+  } else {
+    Time = GetTimeInNanoSecond (EndTicks - StartTicks);
+  }
+
+  for (Index = 0; Index < Table->EntryCount; Index++) {
+    if (Table->Entries[Index].CommandCode == CommandCode) {
+      break;
+    }
+  }
+
+  if (Index == Table->EntryCount) {
+    if (Table->EntryCount == TPM2_COMMAND_LATENCY_MAX_ENTRIES) {
+      Table->DroppedCount++;
+      return;
+    }
+
+    Table->EntryCount++;
+    Entry              = &Table->Entries[Index];
+    Entry->CommandCode = CommandCode;
+    Entry->Count       = 0;
+    Entry->MinTime     = MAX_UINT64;
+    Entry->MaxTime     = 0;
+    Entry->TotalTime   = 0;
+  }
+
+  Entry = &Table->Entries[Index];
+  Entry->Count++;
+  Entry->MinTime    = MIN (Entry->MinTime, Time);
+  Entry->MaxTime    = MAX (Entry->MaxTime, Time);
+  Entry->TotalTime += Time;
+}
+
+/**
+  Record the latency of a TPM2 command that has completed.
+
+  @param[in] InputParameterBlockSize  Size of the TPM2 input parameter block.
+  @param[in] InputParameterBlock      Pointer to the TPM2 input parameter block.
+  @param[in] StartTicks               Performance counter value when the command was sent.
+**/
+VOID
+Tpm2RecordCommandLatency (
+  IN UINT32  InputParameterBlockSize,
+  IN UINT8   *InputParameterBlock,
+  IN UINT64  StartTicks
+  )
+{
+  TPM2_COMMAND_LATENCY_HOB  *Table;
+
+  Table = GetTpm2CommandLatencyTable ();
+  if (Table == NULL) {
+    return;
+  }
+
+  Tpm2AddCommandLatency (
+    Table,
+    Tpm2GetCommandCode (InputParameterBlockSize, InputParameterBlock),
+    StartTicks
+    );
+}
@@ -0,0 +1,41 @@
+/** @file
+  Locate the command latency statistics HOB for the dTPM2.0 library instances
+  used in PEI and before ExitBootServices in DXE.
+
+Copyright (c) Microsoft Corporation.
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/Tpm2DeviceLib.h>
+#include <Library/PcdLib.h>
+#include <Library/HobLib.h>
+
+#include "Tpm2DeviceLibDTpm.h"
+
+/**
+  Return the TPM2 command latency statistics table of this library instance.
+
+  @return Pointer to the table, or NULL if statistics are not collected.
+**/
+TPM2_COMMAND_LATENCY_HOB *
+GetTpm2CommandLatencyTable (
+  VOID
+  )
+{
+  EFI_HOB_GUID_TYPE  *GuidHob;
+
+  if (!FeaturePcdGet (PcdTpm2CommandLatencyStatistics)) {
+    return NULL;
+  }
+
+  //
+  // The HOB list moves when PEI installs permanent memory, so look the HOB up each time.
+  //
+  GuidHob = GetFirstGuidHob (&gTpm2CommandLatencyHobGuid);
+  if (GuidHob == NULL) {
+    return NULL;
+  }
+
+  return GET_GUID_HOB_DATA (GuidHob);
+}
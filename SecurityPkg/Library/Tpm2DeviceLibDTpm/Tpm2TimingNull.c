@@ -0,0 +1,29 @@
+/** @file
+  Command latency statistics are not collected by the dTPM2.0 library instances
+  used in runtime drivers and MM.
+
+  The statistics HOB is boot services memory. It belongs to the OS after
+  ExitBootServices and it is not visible in Standalone MM, so these instances
+  must never write to it.
+
+Copyright (c) Microsoft Corporation.
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/Tpm2DeviceLib.h>
+
+#include "Tpm2DeviceLibDTpm.h"
+
+/**
+  Return the TPM2 command latency statistics table of this library instance.
+
+  @return NULL.
+**/
+TPM2_COMMAND_LATENCY_HOB *
+GetTpm2CommandLatencyTable (
+  VOID
+  )
+{
+  return NULL;
+}
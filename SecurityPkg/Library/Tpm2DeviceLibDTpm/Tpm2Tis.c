@@ -21,6 +21,9 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/Tpm2DebugLib.h>       // MU_CHANGE
 
 #include <IndustryStandard/TpmTis.h>
+#include <IndustryStandard/TpmPtp.h>
+
+#include "Tpm2DeviceLibDTpm.h"
 
 #define TIS_TIMEOUT_MAX  (90000 * 1000)             // 90s
 
@@ -69,17 +72,22 @@ TisPcWaitRegisterBits (
 {
   UINT8   RegRead;
   UINT32  WaitTime;
+  UINT32  PollCount;
 
-  for (WaitTime = 0; WaitTime < TimeOut; WaitTime += 30) {
+  WaitTime  = 0;
+  PollCount = 0;
+  while (TRUE) {
     RegRead = MmioRead8 ((UINTN)Register);
     if (((RegRead & BitSet) == BitSet) && ((RegRead & BitClear) == 0)) {
       return EFI_SUCCESS;
     }
 
-    MicroSecondDelay (30);
-  }
+    if (WaitTime >= TimeOut) {
+      return EFI_TIMEOUT;
+    }
 
-  return EFI_TIMEOUT;
+    WaitTime += Tpm2PollDelay (&PollCount, TimeOut - WaitTime);
+  }
 }
 
 /**
@@ -87,6 +95,8 @@ TisPcWaitRegisterBits (
   in the time of default TIS_TIMEOUT_D.
 
   @param[in]  TisReg                Pointer to TIS register.
+  @param[in]  WideFifo              TRUE if the TPM supports 32-bit accesses to TPM_STS,
+                                    as returned by TisPcIsWideFifoSupported ().
   @param[out] BurstCount            Pointer to a buffer to store the got BurstCount.
 
   @retval     EFI_SUCCESS           Get BurstCount.
@@ -96,10 +106,12 @@ TisPcWaitRegisterBits (
 EFI_STATUS
 TisPcReadBurstCount (
   IN      TIS_PC_REGISTERS_PTR  TisReg,
+  IN      BOOLEAN               WideFifo,
   OUT  UINT16                   *BurstCount
   )
 {
   UINT32  WaitTime;
+  UINT32  PollCount;
   UINT8   DataByte0;
   UINT8   DataByte1;
 
@@ -107,24 +119,116 @@ TisPcReadBurstCount (
     return EFI_INVALID_PARAMETER;
   }
 
-  WaitTime = 0;
-  do {
+  WaitTime  = 0;
+  PollCount = 0;
+  while (TRUE) {
     //
-    // TIS_PC_REGISTERS_PTR->burstCount is UINT16, but it is not 2bytes aligned,
-    // so it needs to use MmioRead8 to read two times
+    // TIS_PC_REGISTERS_PTR->burstCount is UINT16, but it is not 2bytes aligned.
+    // TIS 1.3 and PTP TPMs accept one 32-bit access to TPM_STS, TIS 1.2 TPMs
+    // need two MmioRead8.
     //
-    DataByte0   = MmioRead8 ((UINTN)&TisReg->BurstCount);
-    DataByte1   = MmioRead8 ((UINTN)&TisReg->BurstCount + 1);
-    *BurstCount = (UINT16)((DataByte1 << 8) + DataByte0);
+    if (WideFifo) {
+      *BurstCount = (UINT16)(MmioRead32 ((UINTN)&TisReg->Status) >> 8);
+    } else {
+      DataByte0   = MmioRead8 ((UINTN)&TisReg->BurstCount);
+      DataByte1   = MmioRead8 ((UINTN)&TisReg->BurstCount + 1);
+      *BurstCount = (UINT16)((DataByte1 << 8) + DataByte0);
+    }
     if (*BurstCount != 0) {
       return EFI_SUCCESS;
     }
 
-    MicroSecondDelay (30);
-    WaitTime += 30;
-  } while (WaitTime < TIS_TIMEOUT_D);
+    if (WaitTime >= TIS_TIMEOUT_D) {
+      return EFI_TIMEOUT;
+    }
+
+    WaitTime += Tpm2PollDelay (&PollCount, TIS_TIMEOUT_D - WaitTime);
+  }
+}
+
+/**
+  Check whether the TPM data FIFO can be accessed 32 bits at a time.
+
+  TIS 1.3 and PTP FIFO TPMs that support transfers wider than one byte
+  accept 32-bit accesses to the extended data FIFO (TPM_XDATA_FIFO).
+
+  @param[in] TisReg  Pointer to TIS register.
+
+  @retval    TRUE    32-bit accesses to the extended data FIFO are supported.
+  @retval    FALSE   The data FIFO must be accessed one byte at a time.
+**/
+BOOLEAN
+TisPcIsWideFifoSupported (
+  IN      TIS_PC_REGISTERS_PTR  TisReg
+  )
+{
+  PTP_FIFO_INTERFACE_CAPABILITY  InterfaceCapability;
+
+  InterfaceCapability.Uint32 = MmioRead32 ((UINTN)&TisReg->IntfCapability);
+  if ((InterfaceCapability.Bits.InterfaceVersion != INTERFACE_CAPABILITY_INTERFACE_VERSION_TIS_13) &&
+      (InterfaceCapability.Bits.InterfaceVersion != INTERFACE_CAPABILITY_INTERFACE_VERSION_PTP))
+  {
+    return FALSE;
+  }
+
+  //
+  // 0 means legacy, one byte transfers only.
+  //
+  return (BOOLEAN)(InterfaceCapability.Bits.DataTransferSizeSupport != 0);
+}
+
+/**
+  Write data to the TPM data FIFO.
+
+  @param[in] TisReg   Pointer to TIS register.
+  @param[in] WideFifo TRUE to write 4 bytes at a time to the extended data FIFO.
+  @param[in] Buffer   Data to write.
+  @param[in] Size     Size of data to write, at most the current burst count.
+**/
+VOID
+TisPcWriteFifo (
+  IN      TIS_PC_REGISTERS_PTR  TisReg,
+  IN      BOOLEAN               WideFifo,
+  IN      UINT8                 *Buffer,
+  IN      UINT32                Size
+  )
+{
+  if (WideFifo) {
+    for ( ; Size >= sizeof (UINT32); Size -= sizeof (UINT32), Buffer += sizeof (UINT32)) {
+      MmioWrite32 ((UINTN)&((PTP_FIFO_REGISTERS *)TisReg)->XDataFifo, ReadUnaligned32 ((UINT32 *)Buffer));
+    }
+  }
+
+  for ( ; Size > 0; Size--, Buffer++) {
+    MmioWrite8 ((UINTN)&TisReg->DataFifo, *Buffer);
+  }
+}
+
+/**
+  Read data from the TPM data FIFO.
+
+  @param[in]  TisReg   Pointer to TIS register.
+  @param[in]  WideFifo TRUE to read 4 bytes at a time from the extended data FIFO.
+  @param[out] Buffer   Buffer to store the data read.
+  @param[in]  Size     Size of data to read, at most the current burst count.
+**/
+VOID
+TisPcReadFifo (
+  IN      TIS_PC_REGISTERS_PTR  TisReg,
+  IN      BOOLEAN               WideFifo,
+  OUT     UINT8                 *Buffer,
+  IN      UINT32                Size
+  )
+{
+  if (WideFifo) {
+    for ( ; Size >= sizeof (UINT32); Size -= sizeof (UINT32), Buffer += sizeof (UINT32)) {
+      WriteUnaligned32 ((UINT32 *)Buffer, MmioRead32 ((UINTN)&((PTP_FIFO_REGISTERS *)TisReg)->XDataFifo));
+    }
+  }
 
-  return EFI_TIMEOUT;
+  for ( ; Size > 0; Size--, Buffer++) {
+    *Buffer = MmioRead8 ((UINTN)&TisReg->DataFifo);
+  }
 }
 
 /**
@@ -221,9 +325,11 @@ Tpm2TisTpmCommand (
   EFI_STATUS  Status;
   UINT16      BurstCount;
   UINT32      Index;
+  UINT32      Size;
   UINT32      TpmOutSize;
   UINT16      Data16;
   UINT32      Data32;
+  BOOLEAN     WideFifo;
 
   DEBUG_CODE_BEGIN ();
   // MU_CHANGE [BEGIN]
@@ -263,20 +369,20 @@ Tpm2TisTpmCommand (
   }
 
   //
-  // Send the command data to Tpm
+  // Send the command data to Tpm, a whole burst at a time
   //
-  Index = 0;
+  WideFifo = TisPcIsWideFifoSupported (TisReg);
+  Index    = 0;
   while (Index < SizeIn) {
-    Status = TisPcReadBurstCount (TisReg, &BurstCount);
+    Status = TisPcReadBurstCount (TisReg, WideFifo, &BurstCount);
     if (EFI_ERROR (Status)) {
       Status = EFI_DEVICE_ERROR;
       goto Exit;
     }
 
-    for ( ; BurstCount > 0 && Index < SizeIn; BurstCount--) {
-      MmioWrite8 ((UINTN)&TisReg->DataFifo, *(BufferIn + Index));
-      Index++;
-    }
+    Size = MIN (BurstCount, SizeIn - Index);
+    TisPcWriteFifo (TisReg, WideFifo, BufferIn + Index, Size);
+    Index += Size;
   }
 
   //
@@ -341,19 +447,16 @@ Tpm2TisTpmCommand (
   Index      = 0;
   BurstCount = 0;
   while (Index < sizeof (TPM2_RESPONSE_HEADER)) {
-    Status = TisPcReadBurstCount (TisReg, &BurstCount);
+    Status = TisPcReadBurstCount (TisReg, WideFifo, &BurstCount);
     if (EFI_ERROR (Status)) {
       Status = EFI_DEVICE_ERROR;
       goto Exit;
     }
 
-    for ( ; BurstCount > 0; BurstCount--) {
-      *(BufferOut + Index) = MmioRead8 ((UINTN)&TisReg->DataFifo);
-      Index++;
-      if (Index == sizeof (TPM2_RESPONSE_HEADER)) {
-        break;
-      }
-    }
+    Size = MIN (BurstCount, sizeof (TPM2_RESPONSE_HEADER) - Index);
+    TisPcReadFifo (TisReg, WideFifo, BufferOut + Index, Size);
+    BurstCount -= (UINT16)Size;
+    Index      += Size;
   }
 
   // MU_CHANGE [BEGIN]
@@ -389,25 +492,25 @@ Tpm2TisTpmCommand (
 
   *SizeOut = TpmOutSize;
   //
-  // Continue reading the remaining data
+  // Continue reading the remaining data, the rest of the current burst first
   //
-  while ( Index < TpmOutSize ) {
-    for ( ; BurstCount > 0; BurstCount--) {
-      *(BufferOut + Index) = MmioRead8 ((UINTN)&TisReg->DataFifo);
-      Index++;
-      if (Index == TpmOutSize) {
-        Status = EFI_SUCCESS;
+  while (Index < TpmOutSize) {
+    if (BurstCount == 0) {
+      Status = TisPcReadBurstCount (TisReg, WideFifo, &BurstCount);
+      if (EFI_ERROR (Status)) {
+        Status = EFI_DEVICE_ERROR;
         goto Exit;
       }
     }
 
-    Status = TisPcReadBurstCount (TisReg, &BurstCount);
-    if (EFI_ERROR (Status)) {
-      Status = EFI_DEVICE_ERROR;
-      goto Exit;
-    }
+    Size = MIN (BurstCount, TpmOutSize - Index);
+    TisPcReadFifo (TisReg, WideFifo, BufferOut + Index, Size);
+    BurstCount -= (UINT16)Size;
+    Index      += Size;
   }
 
+  Status = EFI_SUCCESS;
+
 Exit:
   DEBUG_CODE_BEGIN ();
   // MU_CHANGE [BEGIN]
@@ -22,9 +22,75 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/PeCoffLib.h>
 #include <Library/Tpm2CommandLib.h>
 #include <Library/HashLib.h>
+#include <Protocol/Tcg2PeImageDigest.h>
 
 UINTN  mTcg2DxeImageSize = 0;
 
+//
+// The digests extended for the PE/COFF image of the last HashLogExtendEvent call.
+//
+BOOLEAN               mTcg2PeImageDigestsValid = FALSE;
+EFI_PHYSICAL_ADDRESS  mTcg2PeImageAddress;
+UINTN                 mTcg2PeImageSize;
+TPML_DIGEST_VALUES    mTcg2PeImageDigests;
+
+/**
+  Drop the digests extended for the PE/COFF image of the last HashLogExtendEvent call.
+**/
+VOID
+Tcg2DropPeImageDigests (
+  VOID
+  )
+{
+  mTcg2PeImageDigestsValid = FALSE;
+  mTcg2PeImageAddress      = 0;
+  mTcg2PeImageSize         = 0;
+  ZeroMem (&mTcg2PeImageDigests, sizeof (mTcg2PeImageDigests));
+}
+
+/**
+  Get the digests that the last HashLogExtendEvent () call extended for a PE/COFF
+  image, and drop them.
+
+  @param[in]  This          Pointer to the EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL instance.
+  @param[in]  ImageAddress  The image address passed to HashLogExtendEvent ().
+  @param[in]  ImageSize     The image size passed to HashLogExtendEvent ().
+  @param[out] DigestList    The digests extended for the image, one per active PCR bank.
+
+  @retval EFI_SUCCESS            The digests were returned.
+  @retval EFI_NOT_FOUND          The last HashLogExtendEvent () call did not measure
+                                 a PE/COFF image at ImageAddress of ImageSize bytes.
+  @retval EFI_INVALID_PARAMETER  DigestList is NULL.
+**/
+EFI_STATUS
+EFIAPI
+Tcg2GetPeImageDigests (
+  IN  EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL  *This,
+  IN  EFI_PHYSICAL_ADDRESS                 ImageAddress,
+  IN  UINT64                               ImageSize,
+  OUT TPML_DIGEST_VALUES                   *DigestList
+  )
+{
+  EFI_STATUS  Status;
+
+  if (DigestList == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = EFI_NOT_FOUND;
+  if (mTcg2PeImageDigestsValid && (mTcg2PeImageAddress == ImageAddress) && (mTcg2PeImageSize == ImageSize)) {
+    CopyMem (DigestList, &mTcg2PeImageDigests, sizeof (*DigestList));
+    Status = EFI_SUCCESS;
+  }
+
+  Tcg2DropPeImageDigests ();
+  return Status;
+}
+
+EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL  mTcg2PeImageDigestProtocol = {
+  Tcg2GetPeImageDigests
+};
+
 /**
   Reads contents of a PE/COFF image in memory buffer.
 
@@ -83,6 +149,9 @@ Tcg2DxeImageRead (
 
   Notes: PE/COFF image is checked by BasePeCoffLib PeCoffLoaderGetImageInfo().
 
+  The digests are kept for EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL until they are
+  read or the next HashLogExtendEvent call.
+
   @param[in]  PCRIndex       TPM PCR index
   @param[in]  ImageAddress   Start address of image buffer.
   @param[in]  ImageSize      Image size
@@ -399,6 +468,11 @@ MeasurePeImageAndExtend (
     goto Finish;
   }
 
+  CopyMem (&mTcg2PeImageDigests, DigestList, sizeof (mTcg2PeImageDigests));
+  mTcg2PeImageAddress      = ImageAddress;
+  mTcg2PeImageSize         = ImageSize;
+  mTcg2PeImageDigestsValid = TRUE;
+
 Finish:
   if (SectionHeader != NULL) {
     FreePool (SectionHeader);
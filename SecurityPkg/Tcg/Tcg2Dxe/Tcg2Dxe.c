@@ -15,6 +15,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/GlobalVariable.h>
 #include <Guid/HobList.h>
 #include <Guid/TcgEventHob.h>
+#include <Guid/Tpm2CommandLatencyHob.h>
 #include <Guid/EventGroup.h>
 #include <Guid/EventExitBootServiceFailed.h>
 #include <Guid/ImageAuthentication.h>
@@ -26,6 +27,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/VariableWrite.h>
 #include <Protocol/Tcg2Protocol.h>
 #include <Protocol/MuTcg2Protocol.h> // MU_CHANGE - Add a new protocol to support Log-only events.
+#include <Protocol/Tcg2PeImageDigest.h>
 #include <Protocol/TrEEProtocol.h>
 #include <Protocol/ResetNotification.h>
 
@@ -86,8 +88,19 @@ typedef struct {
   BOOLEAN                      EventLogStarted;
   BOOLEAN                      EventLogTruncated;
   UINTN                        Next800155EventOffset;
+  //
+  // 800-155 events are staged in a separate buffer until the event log is
+  // published, then inserted at Next800155EventOffset in one move.
+  //
+  BOOLEAN                      Stage800155Events;
+  UINT8                        *Staged800155Events;
+  UINTN                        Staged800155EventsSize;
+  UINTN                        Staged800155EventsBufferSize;
+  UINTN                        LastStaged800155EventOffset;
 } TCG_EVENT_LOG_AREA_STRUCT;
 
+#define TCG_800155_STAGING_BUFFER_MIN_SIZE  SIZE_1KB
+
 typedef struct _TCG_DXE_DATA {
   EFI_TCG2_BOOT_SERVICE_CAPABILITY    BsCap;
   TCG_EVENT_LOG_AREA_STRUCT           EventLogAreaStruct[TCG_EVENT_LOG_AREA_COUNT_MAX];
@@ -152,6 +165,16 @@ MeasurePeImageAndExtend (
   OUT TPML_DIGEST_VALUES    *DigestList
   );
 
+/**
+  Drop the digests extended for the PE/COFF image of the last HashLogExtendEvent call.
+**/
+VOID
+Tcg2DropPeImageDigests (
+  VOID
+  );
+
+extern EDKII_TCG2_PE_IMAGE_DIGEST_PROTOCOL  mTcg2PeImageDigestProtocol;
+
 /**
 
   This function dump raw data.
@@ -700,6 +723,114 @@ DumpEventLog (
   return;
 }
 
+/**
+  Insert the staged 800-155 events into the event log, and log any further
+  800-155 event directly into the event log.
+
+  The staging buffer is not freed, because this is also called from the
+  ExitBootServices notification.
+
+  @param[in, out] EventLogAreaStruct  The event log area data structure
+
+**/
+VOID
+Flush800155Events (
+  IN OUT  TCG_EVENT_LOG_AREA_STRUCT  *EventLogAreaStruct
+  )
+{
+  UINT8  *InsertPoint;
+
+  if (!EventLogAreaStruct->Stage800155Events) {
+    return;
+  }
+
+  EventLogAreaStruct->Stage800155Events = FALSE;
+  if (EventLogAreaStruct->Staged800155EventsSize == 0) {
+    return;
+  }
+
+  InsertPoint = (UINT8 *)(UINTN)EventLogAreaStruct->Lasa + EventLogAreaStruct->Next800155EventOffset;
+  CopyMem (
+    InsertPoint + EventLogAreaStruct->Staged800155EventsSize,
+    InsertPoint,
+    EventLogAreaStruct->EventLogSize - EventLogAreaStruct->Next800155EventOffset
+    );
+  CopyMem (InsertPoint, EventLogAreaStruct->Staged800155Events, EventLogAreaStruct->Staged800155EventsSize);
+
+  if (EventLogAreaStruct->LastEvent >= InsertPoint) {
+    EventLogAreaStruct->LastEvent += EventLogAreaStruct->Staged800155EventsSize;
+  } else {
+    EventLogAreaStruct->LastEvent = InsertPoint + EventLogAreaStruct->LastStaged800155EventOffset;
+  }
+
+  EventLogAreaStruct->Next800155EventOffset += EventLogAreaStruct->Staged800155EventsSize;
+  EventLogAreaStruct->EventLogSize          += EventLogAreaStruct->Staged800155EventsSize;
+  EventLogAreaStruct->Staged800155EventsSize = 0;
+}
+
+/**
+  Stage a 800-155 event until the event log is published.
+
+  @param[in, out] EventLogAreaStruct  The event log area data structure
+  @param[in]      NewEventHdr         Pointer to a TCG_PCR_EVENT_HDR/TCG_PCR_EVENT_EX data structure.
+  @param[in]      NewEventHdrSize     New event header size.
+  @param[in]      NewEventData        Pointer to the new event data.
+  @param[in]      NewEventSize        New event data size.
+
+  @retval EFI_SUCCESS           The new event was staged.
+  @retval EFI_OUT_OF_RESOURCES  No enough memory to stage the new event.
+
+**/
+EFI_STATUS
+Stage800155Event (
+  IN OUT  TCG_EVENT_LOG_AREA_STRUCT  *EventLogAreaStruct,
+  IN      VOID                       *NewEventHdr,
+  IN      UINT32                     NewEventHdrSize,
+  IN      UINT8                      *NewEventData,
+  IN      UINT32                     NewEventSize
+  )
+{
+  UINTN  NewLogSize;
+  UINTN  NewBufferSize;
+  UINT8  *NewBuffer;
+
+  NewLogSize = NewEventHdrSize + NewEventSize;
+  if (EventLogAreaStruct->Staged800155EventsSize + NewLogSize > EventLogAreaStruct->Staged800155EventsBufferSize) {
+    //
+    // Grow the staging buffer geometrically, so staging stays linear in the
+    // total size of the 800-155 events.
+    //
+    NewBufferSize = MAX (EventLogAreaStruct->Staged800155EventsBufferSize * 2, TCG_800155_STAGING_BUFFER_MIN_SIZE);
+    NewBufferSize = MAX (NewBufferSize, EventLogAreaStruct->Staged800155EventsSize + NewLogSize);
+    NewBuffer     = ReallocatePool (
+                      EventLogAreaStruct->Staged800155EventsBufferSize,
+                      NewBufferSize,
+                      EventLogAreaStruct->Staged800155Events
+                      );
+    if (NewBuffer == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    EventLogAreaStruct->Staged800155Events           = NewBuffer;
+    EventLogAreaStruct->Staged800155EventsBufferSize = NewBufferSize;
+  }
+
+  EventLogAreaStruct->LastStaged800155EventOffset = EventLogAreaStruct->Staged800155EventsSize;
+  CopyMem (
+    EventLogAreaStruct->Staged800155Events + EventLogAreaStruct->Staged800155EventsSize,
+    NewEventHdr,
+    NewEventHdrSize
+    );
+  CopyMem (
+    EventLogAreaStruct->Staged800155Events + EventLogAreaStruct->Staged800155EventsSize + NewEventHdrSize,
+    NewEventData,
+    NewEventSize
+    );
+  EventLogAreaStruct->Staged800155EventsSize += NewLogSize;
+
+  return EFI_SUCCESS;
+}
+
 /**
   The EFI_TCG2_PROTOCOL Get Event Log function call allows a caller to
   retrieve the address of a given event log and its last entry.
@@ -765,6 +896,11 @@ Tcg2GetEventLog (
     return EFI_SUCCESS;
   }
 
+  //
+  // The caller reads the event log from memory, so it must be complete.
+  //
+  Flush800155Events (&mTcgDxeData.EventLogAreaStruct[Index]);
+
   if (EventLogLocation != NULL) {
     *EventLogLocation = mTcgDxeData.EventLogAreaStruct[Index].Lasa;
     DEBUG ((DEBUG_INFO, "Tcg2GetEventLog (EventLogLocation - %x)\n", *EventLogLocation));
@@ -863,6 +999,7 @@ TcgCommLogEvent (
   )
 {
   UINTN    NewLogSize;
+  UINTN    LogSize;
   BOOLEAN  Record800155Event;
 
   if (NewEventSize > MAX_ADDRESS -  NewEventHdrSize) {
@@ -871,14 +1008,18 @@ TcgCommLogEvent (
 
   NewLogSize = NewEventHdrSize + NewEventSize;
 
-  if (NewLogSize > MAX_ADDRESS -  EventLogAreaStruct->EventLogSize) {
+  //
+  // Staged 800-155 events take their space in the event log once published.
+  //
+  LogSize = EventLogAreaStruct->EventLogSize + EventLogAreaStruct->Staged800155EventsSize;
+  if (NewLogSize > MAX_ADDRESS -  LogSize) {
     return EFI_OUT_OF_RESOURCES;
   }
 
-  if (NewLogSize + EventLogAreaStruct->EventLogSize > EventLogAreaStruct->Laml) {
+  if (NewLogSize + LogSize > EventLogAreaStruct->Laml) {
     DEBUG ((DEBUG_INFO, "  Laml       - 0x%x\n", EventLogAreaStruct->Laml));
     DEBUG ((DEBUG_INFO, "  NewLogSize - 0x%x\n", NewLogSize));
-    DEBUG ((DEBUG_INFO, "  LogSize    - 0x%x\n", EventLogAreaStruct->EventLogSize));
+    DEBUG ((DEBUG_INFO, "  LogSize    - 0x%x\n", LogSize));
     DEBUG ((DEBUG_INFO, "TcgCommLogEvent - %r\n", EFI_OUT_OF_RESOURCES));
     ASSERT (FALSE); // MU_CHANGE: Assert to catch systematic TCG log truncation during DEBUG testing.
     return EFI_OUT_OF_RESOURCES;
@@ -888,10 +1029,23 @@ TcgCommLogEvent (
   // Check 800-155 event
   // Record to 800-155 event offset only.
   // If the offset is 0, no need to record.
+  // Before the event log is published, stage the event, so that logging it does
+  // not move the events that follow the 800-155 events.
   //
   Record800155Event = Is800155Event (NewEventHdr, NewEventHdrSize, NewEventData, NewEventSize);
   if (Record800155Event) {
     if (EventLogAreaStruct->Next800155EventOffset != 0) {
+      if (EventLogAreaStruct->Stage800155Events) {
+        if (!EFI_ERROR (Stage800155Event (EventLogAreaStruct, NewEventHdr, NewEventHdrSize, NewEventData, NewEventSize))) {
+          return EFI_SUCCESS;
+        }
+
+        //
+        // Fall back to insert the event into the event log directly.
+        //
+        Flush800155Events (EventLogAreaStruct);
+      }
+
       CopyMem (
         (UINT8 *)(UINTN)EventLogAreaStruct->Lasa + EventLogAreaStruct->Next800155EventOffset + NewLogSize,
         (UINT8 *)(UINTN)EventLogAreaStruct->Lasa + EventLogAreaStruct->Next800155EventOffset,
@@ -1331,6 +1485,8 @@ Tcg2HashLogExtendEvent (
 
   DEBUG ((DEBUG_VERBOSE, "Tcg2HashLogExtendEvent ...\n"));
 
+  Tcg2DropPeImageDigests ();
+
   if ((This == NULL) || (Event == NULL)) {
     return EFI_INVALID_PARAMETER;
   }
@@ -1631,6 +1787,207 @@ EFI_TCG2_PROTOCOL  mTcg2Protocol = {
   Tcg2GetResultOfSetActivePcrBanks,
 };
 
+/**
+  Log an event passed from the PEI phase.
+
+  @param[in]      Index     Index of the event log format in mTcg2EventInfo.
+  @param[in, out] TcgEvent  The event, in the format of the event log. The inactive
+                            digests are filtered out of it.
+
+  @retval EFI_SUCCESS     The event was logged.
+  @retval Others          The event was not logged.
+
+**/
+EFI_STATUS
+LogPeiEvent (
+  IN     UINTN  Index,
+  IN OUT VOID   *TcgEvent
+  )
+{
+  EFI_STATUS          Status;
+  VOID                *DigestListBin;
+  TPML_DIGEST_VALUES  TempDigestListBin;
+  UINT32              DigestListBinSize;
+  UINT8               *Event;
+  UINT32              EventSize;
+  UINT32              *EventSizePtr;
+  UINT32              HashAlgorithmMaskCopied;
+
+  Status = EFI_SUCCESS;
+  switch (mTcg2EventInfo[Index].LogFormat) {
+    case EFI_TCG2_EVENT_LOG_FORMAT_TCG_1_2:
+      Status = TcgDxeLogEvent (
+                 mTcg2EventInfo[Index].LogFormat,
+                 TcgEvent,
+                 sizeof (TCG_PCR_EVENT_HDR),
+                 ((TCG_PCR_EVENT *)TcgEvent)->Event,
+                 ((TCG_PCR_EVENT_HDR *)TcgEvent)->EventSize
+                 );
+      break;
+    case EFI_TCG2_EVENT_LOG_FORMAT_TCG_2:
+      DigestListBin     = (UINT8 *)TcgEvent + sizeof (TCG_PCRINDEX) + sizeof (TCG_EVENTTYPE);
+      DigestListBinSize = GetDigestListBinSize (DigestListBin);
+      //
+      // Save event size.
+      //
+      CopyMem (&EventSize, (UINT8 *)DigestListBin + DigestListBinSize, sizeof (UINT32));
+      Event = (UINT8 *)DigestListBin + DigestListBinSize + sizeof (UINT32);
+      //
+      // Filter inactive digest in the event2 log from PEI HOB.
+      //
+      CopyMem (&TempDigestListBin, DigestListBin, GetDigestListBinSize (DigestListBin));
+      EventSizePtr = CopyDigestListBinToBuffer (
+                       DigestListBin,
+                       &TempDigestListBin,
+                       mTcgDxeData.BsCap.ActivePcrBanks,
+                       &HashAlgorithmMaskCopied
+                       );
+      if (HashAlgorithmMaskCopied != mTcgDxeData.BsCap.ActivePcrBanks) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "ERROR: The event2 log includes digest hash mask 0x%x, but required digest hash mask is 0x%x\n",
+          HashAlgorithmMaskCopied,
+          mTcgDxeData.BsCap.ActivePcrBanks
+          ));
+      }
+
+      //
+      // Restore event size.
+      //
+      CopyMem (EventSizePtr, &EventSize, sizeof (UINT32));
+      DigestListBinSize = GetDigestListBinSize (DigestListBin);
+
+      Status = TcgDxeLogEvent (
+                 mTcg2EventInfo[Index].LogFormat,
+                 TcgEvent,
+                 sizeof (TCG_PCRINDEX) + sizeof (TCG_EVENTTYPE) + DigestListBinSize + sizeof (UINT32),
+                 Event,
+                 EventSize
+                 );
+      break;
+  }
+
+  return Status;
+}
+
+/**
+  Get the size of an event passed from the PEI phase.
+
+  @param[in]  Index     Index of the event log format in mTcg2EventInfo.
+  @param[in]  TcgEvent  The event, in the format of the event log.
+  @param[in]  MaxSize   Size of the buffer holding the event.
+
+  @return Size of the event, or 0 if it does not fit in MaxSize.
+
+**/
+UINTN
+GetPeiEventSize (
+  IN UINTN  Index,
+  IN VOID   *TcgEvent,
+  IN UINTN  MaxSize
+  )
+{
+  UINT8   *DigestListBin;
+  UINTN   HeaderSize;
+  UINT32  EventSize;
+
+  if (mTcg2EventInfo[Index].LogFormat == EFI_TCG2_EVENT_LOG_FORMAT_TCG_1_2) {
+    if (MaxSize < sizeof (TCG_PCR_EVENT_HDR)) {
+      return 0;
+    }
+
+    HeaderSize = sizeof (TCG_PCR_EVENT_HDR);
+    EventSize  = ((TCG_PCR_EVENT_HDR *)TcgEvent)->EventSize;
+  } else {
+    if (MaxSize < sizeof (TCG_PCRINDEX) + sizeof (TCG_EVENTTYPE) + sizeof (UINT32)) {
+      return 0;
+    }
+
+    DigestListBin = (UINT8 *)TcgEvent + sizeof (TCG_PCRINDEX) + sizeof (TCG_EVENTTYPE);
+    HeaderSize    = sizeof (TCG_PCRINDEX) + sizeof (TCG_EVENTTYPE) + GetDigestListBinSize (DigestListBin) + sizeof (UINT32);
+    if (MaxSize < HeaderSize) {
+      return 0;
+    }
+
+    CopyMem (&EventSize, (UINT8 *)TcgEvent + HeaderSize - sizeof (UINT32), sizeof (UINT32));
+  }
+
+  if (EventSize > MaxSize - HeaderSize) {
+    return 0;
+  }
+
+  return HeaderSize + EventSize;
+}
+
+/**
+  Log the events of an event log buffer HOB passed from the PEI phase.
+
+  HOBs are read only, and LogPeiEvent () filters the digests of an event in place,
+  so the events are copied to a pool buffer first. The buffer is copied as a whole,
+  with a single allocation, instead of event by event.
+
+  @param[in]  Index       Index of the event log format in mTcg2EventInfo.
+  @param[in]  HobData     The data of the event log buffer HOB.
+  @param[in]  HobSize     Size of the data of the event log buffer HOB.
+
+  @retval EFI_SUCCESS           The events were logged.
+  @retval EFI_OUT_OF_RESOURCES  Out of memory.
+  @retval Others                Failed to log an event.
+
+**/
+EFI_STATUS
+LogPeiEventLogBuffer (
+  IN UINTN  Index,
+  IN VOID   *HobData,
+  IN UINTN  HobSize
+  )
+{
+  EFI_STATUS                Status;
+  TCG_EVENT_LOG_BUFFER_HOB  *LogBuffer;
+  UINT8                     *Events;
+  UINT8                     *TcgEvent;
+  UINTN                     Offset;
+  UINTN                     EventLogSize;
+
+  LogBuffer = HobData;
+  if ((HobSize < sizeof (TCG_EVENT_LOG_BUFFER_HOB)) ||
+      (LogBuffer->LogFormat != mTcg2EventInfo[Index].LogFormat))
+  {
+    return EFI_SUCCESS;
+  }
+
+  if (LogBuffer->EventLogSize > HobSize - sizeof (TCG_EVENT_LOG_BUFFER_HOB)) {
+    DEBUG ((DEBUG_ERROR, "%a - Invalid event log buffer size 0x%x\n", __func__, LogBuffer->EventLogSize));
+    return EFI_SUCCESS;
+  }
+
+  if (LogBuffer->EventLogSize == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Events = AllocateCopyPool (LogBuffer->EventLogSize, LogBuffer + 1);
+  if (Events == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = EFI_SUCCESS;
+  Offset = 0;
+  while (!EFI_ERROR (Status) && (Offset < LogBuffer->EventLogSize)) {
+    TcgEvent     = Events + Offset;
+    EventLogSize = GetPeiEventSize (Index, TcgEvent, LogBuffer->EventLogSize - Offset);
+    if (EventLogSize == 0) {
+      DEBUG ((DEBUG_ERROR, "%a - Invalid event at offset 0x%x\n", __func__, Offset));
+      break;
+    }
+
+    Status = LogPeiEvent (Index, TcgEvent);
+    Offset = ALIGN_VALUE (Offset + EventLogSize, sizeof (UINT64));
+  }
+
+  FreePool (Events);
+  return Status;
+}
+
 /**
   Initialize the Event Log and log events passed from the PEI phase.
 
@@ -1648,13 +2005,6 @@ SetupEventLog (
   EFI_PEI_HOB_POINTERS             GuidHob;
   EFI_PHYSICAL_ADDRESS             Lasa;
   UINTN                            Index;
-  VOID                             *DigestListBin;
-  TPML_DIGEST_VALUES               TempDigestListBin;
-  UINT32                           DigestListBinSize;
-  UINT8                            *Event;
-  UINT32                           EventSize;
-  UINT32                           *EventSizePtr;
-  UINT32                           HashAlgorithmMaskCopied;
   TCG_EfiSpecIDEventStruct         *TcgEfiSpecIdEventStruct;
   UINT8                            TempBuf[sizeof (TCG_EfiSpecIDEventStruct) + sizeof (UINT32) + (HASH_COUNT * sizeof (TCG_EfiSpecIdEventAlgorithmSize)) + sizeof (UINT8)];
   TCG_PCR_EVENT_HDR                SpecIdEvent;
@@ -1795,9 +2145,11 @@ SetupEventLog (
         //
         // record the offset at the end of 800-155 event.
         // the future 800-155 event can be inserted here.
+        // They are staged until the event log is published.
         //
         mTcgDxeData.EventLogAreaStruct[Index].Next800155EventOffset = \
           mTcgDxeData.EventLogAreaStruct[Index].EventLogSize;
+        mTcgDxeData.EventLogAreaStruct[Index].Stage800155Events = TRUE;
 
         //
         // Tcg800155PlatformIdEvent. Event format is TCG_PCR_EVENT2
@@ -1917,66 +2269,19 @@ SetupEventLog (
     if ((mTcgDxeData.BsCap.SupportedEventLogs & mTcg2EventInfo[Index].LogFormat) != 0) {
       GuidHob.Raw = GetHobList ();
       Status      = EFI_SUCCESS;
-      while (!EFI_ERROR (Status) &&
-             (GuidHob.Raw = GetNextGuidHob (mTcg2EventInfo[Index].EventGuid, GuidHob.Raw)) != NULL)
-      {
-        TcgEvent = AllocateCopyPool (GET_GUID_HOB_DATA_SIZE (GuidHob.Guid), GET_GUID_HOB_DATA (GuidHob.Guid));
-        ASSERT (TcgEvent != NULL);
-        GuidHob.Raw = GET_NEXT_HOB (GuidHob);
-        switch (mTcg2EventInfo[Index].LogFormat) {
-          case EFI_TCG2_EVENT_LOG_FORMAT_TCG_1_2:
-            Status = TcgDxeLogEvent (
-                       mTcg2EventInfo[Index].LogFormat,
-                       TcgEvent,
-                       sizeof (TCG_PCR_EVENT_HDR),
-                       ((TCG_PCR_EVENT *)TcgEvent)->Event,
-                       ((TCG_PCR_EVENT_HDR *)TcgEvent)->EventSize
-                       );
-            break;
-          case EFI_TCG2_EVENT_LOG_FORMAT_TCG_2:
-            DigestListBin     = (UINT8 *)TcgEvent + sizeof (TCG_PCRINDEX) + sizeof (TCG_EVENTTYPE);
-            DigestListBinSize = GetDigestListBinSize (DigestListBin);
-            //
-            // Save event size.
-            //
-            CopyMem (&EventSize, (UINT8 *)DigestListBin + DigestListBinSize, sizeof (UINT32));
-            Event = (UINT8 *)DigestListBin + DigestListBinSize + sizeof (UINT32);
-            //
-            // Filter inactive digest in the event2 log from PEI HOB.
-            //
-            CopyMem (&TempDigestListBin, DigestListBin, GetDigestListBinSize (DigestListBin));
-            EventSizePtr = CopyDigestListBinToBuffer (
-                             DigestListBin,
-                             &TempDigestListBin,
-                             mTcgDxeData.BsCap.ActivePcrBanks,
-                             &HashAlgorithmMaskCopied
-                             );
-            if (HashAlgorithmMaskCopied != mTcgDxeData.BsCap.ActivePcrBanks) {
-              DEBUG ((
-                DEBUG_ERROR,
-                "ERROR: The event2 log includes digest hash mask 0x%x, but required digest hash mask is 0x%x\n",
-                HashAlgorithmMaskCopied,
-                mTcgDxeData.BsCap.ActivePcrBanks
-                ));
-            }
-
-            //
-            // Restore event size.
-            //
-            CopyMem (EventSizePtr, &EventSize, sizeof (UINT32));
-            DigestListBinSize = GetDigestListBinSize (DigestListBin);
-
-            Status = TcgDxeLogEvent (
-                       mTcg2EventInfo[Index].LogFormat,
-                       TcgEvent,
-                       sizeof (TCG_PCRINDEX) + sizeof (TCG_EVENTTYPE) + DigestListBinSize + sizeof (UINT32),
-                       Event,
-                       EventSize
-                       );
-            break;
+      while (!EFI_ERROR (Status) && !END_OF_HOB_LIST (GuidHob)) {
+        if (GET_HOB_TYPE (GuidHob) == EFI_HOB_TYPE_GUID_EXTENSION) {
+          if (CompareGuid (&GuidHob.Guid->Name, mTcg2EventInfo[Index].EventGuid)) {
+            TcgEvent = AllocateCopyPool (GET_GUID_HOB_DATA_SIZE (GuidHob.Guid), GET_GUID_HOB_DATA (GuidHob.Guid));
+            ASSERT (TcgEvent != NULL);
+            Status = LogPeiEvent (Index, TcgEvent);
+            FreePool (TcgEvent);
+          } else if (CompareGuid (&GuidHob.Guid->Name, &gTcgEventLogBufferHobGuid)) {
+            Status = LogPeiEventLogBuffer (Index, GET_GUID_HOB_DATA (GuidHob.Guid), GET_GUID_HOB_DATA_SIZE (GuidHob.Guid));
+          }
         }
 
-        FreePool (TcgEvent);
+        GuidHob.Raw = GET_NEXT_HOB (GuidHob);
       }
     }
   }
@@ -2546,6 +2851,46 @@ MeasureSecureBootPolicy (
   return;
 }
 
+/**
+  Dump the TPM2 command latency statistics collected since PEI.
+**/
+VOID
+DumpTpm2CommandLatency (
+  VOID
+  )
+{
+  EFI_HOB_GUID_TYPE           *GuidHob;
+  TPM2_COMMAND_LATENCY_HOB    *LatencyHob;
+  TPM2_COMMAND_LATENCY_ENTRY  *Entry;
+  UINT32                      Index;
+
+  GuidHob = GetFirstGuidHob (&gTpm2CommandLatencyHobGuid);
+  if (GuidHob == NULL) {
+    return;
+  }
+
+  LatencyHob = GET_GUID_HOB_DATA (GuidHob);
+  DEBUG ((DEBUG_INFO, "TPM2 command latency (us):\n"));
+  DEBUG ((DEBUG_INFO, "  CommandCode    Count      Min      Avg      Max    Total\n"));
+  for (Index = 0; Index < LatencyHob->EntryCount; Index++) {
+    Entry = &LatencyHob->Entries[Index];
+    DEBUG ((
+      DEBUG_INFO,
+      "  0x%08x  %8d %8ld %8ld %8ld %8ld\n",
+      Entry->CommandCode,
+      Entry->Count,
+      DivU64x32 (Entry->MinTime, 1000),
+      DivU64x32 (DivU64x32 (Entry->TotalTime, Entry->Count), 1000),
+      DivU64x32 (Entry->MaxTime, 1000),
+      DivU64x32 (Entry->TotalTime, 1000)
+      ));
+  }
+
+  if (LatencyHob->DroppedCount != 0) {
+    DEBUG ((DEBUG_INFO, "  %d commands not recorded\n", LatencyHob->DroppedCount));
+  }
+}
+
 /**
   Ready to Boot Event notification handler.
 
@@ -2665,6 +3010,13 @@ OnReadyToBoot (
   }
 
   DEBUG ((DEBUG_INFO, "TPM2 Tcg2Dxe Measure Data when ReadyToBoot\n"));
+  DEBUG_CODE_BEGIN ();
+  if (mBootAttempts == 0) {
+    DumpTpm2CommandLatency ();
+  }
+
+  DEBUG_CODE_END ();
+
   //
   // Increase boot attempt counter.
   //
@@ -2689,6 +3041,14 @@ OnExitBootServices (
   )
 {
   EFI_STATUS  Status;
+  UINTN       Index;
+
+  //
+  // The OS reads the event log from memory, insert the staged 800-155 events.
+  //
+  for (Index = 0; Index < sizeof (mTcg2EventInfo)/sizeof (mTcg2EventInfo[0]); Index++) {
+    Flush800155Events (&mTcgDxeData.EventLogAreaStruct[Index]);
+  }
 
   //
   // Measure invocation of ExitBootServices,
@@ -2838,6 +3198,8 @@ InstallTcg2 (
                   &mTcg2Protocol,
                   &gMuTcg2ProtocolExGuid,
                   &mMuTcg2Protocol,                         // MU_CHANGE - Add a new protocol to support Log-only events.
+                  &gEdkiiTcg2PeImageDigestProtocolGuid,
+                  &mTcg2PeImageDigestProtocol,
                   NULL
                   );
   return Status;
@@ -24,6 +24,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/ExcludedFvHob.h> // MU_CHANGE
 #include <Guid/TpmInstance.h>
 #include <Guid/MigratedFvInfo.h>
+#include <Guid/Tpm2CommandLatencyHob.h>
 
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
@@ -66,6 +67,28 @@ TCG2_EVENT_INFO_STRUCT  mTcg2EventInfo[] = {
   { &gTcgEvent2EntryHobGuid, EFI_TCG2_EVENT_LOG_FORMAT_TCG_2   },
 };
 
+//
+// Size limits of the event log buffer HOB data.
+//
+#define TCG_EVENT_LOG_BUFFER_HOB_MIN_SIZE  SIZE_4KB
+#define TCG_EVENT_LOG_BUFFER_HOB_MAX_SIZE  (0xFFF8 - sizeof (EFI_HOB_GUID_TYPE))
+
+//
+// Private HOB tracking the event log buffer HOB that events of each log format are
+// appended to, and the end of the HOB list when an event was last appended to it.
+// Only the HOBs built after that end need to be searched for per-event HOBs of the
+// same format. Both are recorded as offsets from the start of the HOB list, which
+// stay valid when the HOB list moves to permanent memory. Zero means no buffer.
+//
+typedef struct {
+  UINT64    BufferOffset[ARRAY_SIZE (mTcg2EventInfo)];
+  UINT64    HobListEndOffset[ARRAY_SIZE (mTcg2EventInfo)];
+} TCG2_EVENT_LOG_BUFFER_TRACKER;
+
+EFI_GUID  mTcg2EventLogBufferTrackerGuid = {
+  0x9d4e2f61, 0x3c8a, 0x4b57, { 0xa0, 0x2e, 0x61, 0xc9, 0x7b, 0x15, 0xd8, 0x34 }
+};
+
 BOOLEAN              mImageInMemory = FALSE;
 EFI_PEI_FILE_HANDLE  mFileHandle;
 
@@ -460,6 +483,109 @@ SyncPcrAllocationsAndPcrMask (
   }
 }
 
+/**
+  Get the offset of the end of the HOB list from its start.
+
+  @return Offset of the end of HOB list HOB.
+**/
+STATIC
+UINT64
+GetHobListEndOffset (
+  VOID
+  )
+{
+  EFI_HOB_HANDOFF_INFO_TABLE  *HandOffHob;
+
+  HandOffHob = GetHobList ();
+  return HandOffHob->EfiEndOfHobList - (UINTN)HandOffHob;
+}
+
+/**
+  Reserve space for a new event at the end of the event log buffer HOB of a log format.
+
+  Events are appended to the current event log buffer HOB of the format, which is
+  recorded in the tracker HOB. A new buffer HOB, twice the size of the previous one,
+  is built when the current one is full, or when a per-event HOB of the same format
+  follows it, so that the events stay in HOB list order. Only the HOBs built since
+  the last event was appended are searched for such a per-event HOB.
+
+  @param[in]  Index         Index of the log format in mTcg2EventInfo.
+  @param[in]  EventSize     Maximum size of the new event.
+  @param[out] LogBuffer     The event log buffer holding the new event. The caller
+                            may lower its EventLogSize if the event is smaller.
+
+  @return Pointer to the space reserved for the new event, or NULL if out of resources.
+**/
+VOID *
+ReserveEventLogBuffer (
+  IN  UINTN                     Index,
+  IN  UINTN                     EventSize,
+  OUT TCG_EVENT_LOG_BUFFER_HOB  **LogBuffer
+  )
+{
+  EFI_PEI_HOB_POINTERS           Hob;
+  TCG2_EVENT_LOG_BUFFER_TRACKER  *Tracker;
+  TCG_EVENT_LOG_BUFFER_HOB       *Buffer;
+  UINTN                          BufferSize;
+  UINTN                          Offset;
+
+  Hob.Raw = GetFirstGuidHob (&mTcg2EventLogBufferTrackerGuid);
+  if (Hob.Raw != NULL) {
+    Tracker = GET_GUID_HOB_DATA (Hob.Guid);
+  } else {
+    Tracker = BuildGuidHob (&mTcg2EventLogBufferTrackerGuid, sizeof (TCG2_EVENT_LOG_BUFFER_TRACKER));
+    if (Tracker == NULL) {
+      return NULL;
+    }
+
+    ZeroMem (Tracker, sizeof (TCG2_EVENT_LOG_BUFFER_TRACKER));
+  }
+
+  Buffer     = NULL;
+  BufferSize = 0;
+  if (Tracker->BufferOffset[Index] != 0) {
+    Hob.Raw    = (UINT8 *)GetHobList () + Tracker->BufferOffset[Index];
+    Buffer     = GET_GUID_HOB_DATA (Hob.Guid);
+    BufferSize = GET_GUID_HOB_DATA_SIZE (Hob.Guid);
+    ASSERT (CompareGuid (&Hob.Guid->Name, &gTcgEventLogBufferHobGuid));
+    ASSERT (Buffer->LogFormat == mTcg2EventInfo[Index].LogFormat);
+
+    Hob.Raw = (UINT8 *)GetHobList () + Tracker->HobListEndOffset[Index];
+    if (GetNextGuidHob (mTcg2EventInfo[Index].EventGuid, Hob.Raw) != NULL) {
+      Buffer = NULL;
+    }
+  }
+
+  if (Buffer != NULL) {
+    Offset = ALIGN_VALUE (Buffer->EventLogSize, sizeof (UINT64));
+    if (sizeof (TCG_EVENT_LOG_BUFFER_HOB) + Offset + EventSize <= BufferSize) {
+      Tracker->HobListEndOffset[Index] = GetHobListEndOffset ();
+      Buffer->EventLogSize             = (UINT32)(Offset + EventSize);
+      *LogBuffer                       = Buffer;
+      return (UINT8 *)(Buffer + 1) + Offset;
+    }
+  }
+
+  BufferSize = MAX (BufferSize * 2, TCG_EVENT_LOG_BUFFER_HOB_MIN_SIZE);
+  BufferSize = MAX (BufferSize, sizeof (TCG_EVENT_LOG_BUFFER_HOB) + EventSize);
+  BufferSize = MIN (BufferSize, TCG_EVENT_LOG_BUFFER_HOB_MAX_SIZE);
+  if (sizeof (TCG_EVENT_LOG_BUFFER_HOB) + EventSize > BufferSize) {
+    return NULL;
+  }
+
+  Buffer = BuildGuidHob (&gTcgEventLogBufferHobGuid, BufferSize);
+  if (Buffer == NULL) {
+    return NULL;
+  }
+
+  Tracker->BufferOffset[Index]     = (UINTN)((UINT8 *)Buffer - sizeof (EFI_HOB_GUID_TYPE) - (UINT8 *)GetHobList ());
+  Tracker->HobListEndOffset[Index] = GetHobListEndOffset ();
+  Buffer->LogFormat                = mTcg2EventInfo[Index].LogFormat;
+  Buffer->EventLogSize             = (UINT32)EventSize;
+  *LogBuffer                       = Buffer;
+  return Buffer + 1;
+}
+
 /**
   Add a new entry to the Event Log.
 
@@ -477,13 +603,14 @@ LogHashEvent (
   IN      UINT8              *NewEventData
   )
 {
-  VOID            *HobData;
-  EFI_STATUS      Status;
-  UINTN           Index;
-  EFI_STATUS      RetStatus;
-  UINT32          SupportedEventLogs;
-  TCG_PCR_EVENT2  *TcgPcrEvent2;
-  UINT8           *DigestBuffer;
+  VOID                      *HobData;
+  TCG_EVENT_LOG_BUFFER_HOB  *LogBuffer;
+  EFI_STATUS                Status;
+  UINTN                     Index;
+  EFI_STATUS                RetStatus;
+  UINT32                    SupportedEventLogs;
+  TCG_PCR_EVENT2            *TcgPcrEvent2;
+  UINT8                     *DigestBuffer;
 
   SupportedEventLogs = EFI_TCG2_EVENT_LOG_FORMAT_TCG_1_2 | EFI_TCG2_EVENT_LOG_FORMAT_TCG_2;
 
@@ -495,9 +622,10 @@ LogHashEvent (
         case EFI_TCG2_EVENT_LOG_FORMAT_TCG_1_2:
           Status = GetDigestFromDigestList (TPM_ALG_SHA1, DigestList, &NewEventHdr->Digest);
           if (!EFI_ERROR (Status)) {
-            HobData = BuildGuidHob (
-                        &gTcgEventEntryHobGuid,
-                        sizeof (*NewEventHdr) + NewEventHdr->EventSize
+            HobData = ReserveEventLogBuffer (
+                        Index,
+                        sizeof (*NewEventHdr) + NewEventHdr->EventSize,
+                        &LogBuffer
                         );
             if (HobData == NULL) {
               RetStatus = EFI_OUT_OF_RESOURCES;
@@ -512,12 +640,13 @@ LogHashEvent (
           break;
         case EFI_TCG2_EVENT_LOG_FORMAT_TCG_2:
           //
-          // Use GetDigestListSize (DigestList) in the GUID HOB DataLength calculation
+          // Use GetDigestListSize (DigestList) in the event size calculation
           // to reserve enough buffer to hold TPML_DIGEST_VALUES compact binary.
           //
-          HobData = BuildGuidHob (
-                      &gTcgEvent2EntryHobGuid,
-                      sizeof (TcgPcrEvent2->PCRIndex) + sizeof (TcgPcrEvent2->EventType) + GetDigestListSize (DigestList) + sizeof (TcgPcrEvent2->EventSize) + NewEventHdr->EventSize
+          HobData = ReserveEventLogBuffer (
+                      Index,
+                      sizeof (TcgPcrEvent2->PCRIndex) + sizeof (TcgPcrEvent2->EventType) + GetDigestListSize (DigestList) + sizeof (TcgPcrEvent2->EventSize) + NewEventHdr->EventSize,
+                      &LogBuffer
                       );
           if (HobData == NULL) {
             RetStatus = EFI_OUT_OF_RESOURCES;
@@ -532,6 +661,10 @@ LogHashEvent (
           CopyMem (DigestBuffer, &NewEventHdr->EventSize, sizeof (TcgPcrEvent2->EventSize));
           DigestBuffer = DigestBuffer + sizeof (TcgPcrEvent2->EventSize);
           CopyMem (DigestBuffer, NewEventData, NewEventHdr->EventSize);
+          //
+          // Release the space of the digests filtered out by PcdTpm2HashMask.
+          //
+          LogBuffer->EventLogSize = (UINT32)(DigestBuffer + NewEventHdr->EventSize - (UINT8 *)(LogBuffer + 1));
           break;
       }
     }
@@ -1189,11 +1322,12 @@ PeimEntryMA (
   IN CONST EFI_PEI_SERVICES     **PeiServices
   )
 {
-  EFI_STATUS     Status;
-  EFI_STATUS     Status2;
-  EFI_BOOT_MODE  BootMode;
-  TPM_PCRINDEX   PcrIndex;
-  BOOLEAN        S3ErrorReport;
+  EFI_STATUS                Status;
+  EFI_STATUS                Status2;
+  EFI_BOOT_MODE             BootMode;
+  TPM_PCRINDEX              PcrIndex;
+  BOOLEAN                   S3ErrorReport;
+  TPM2_COMMAND_LATENCY_HOB  *LatencyHob;
 
   if (CompareGuid (PcdGetPtr (PcdTpmInstanceGuid), &gEfiTpmDeviceInstanceNoneGuid) ||
       CompareGuid (PcdGetPtr (PcdTpmInstanceGuid), &gEfiTpmDeviceInstanceTpm12Guid))
@@ -1223,6 +1357,17 @@ PeimEntryMA (
     }
   }
 
+  //
+  // Create the HOB the dTPM2.0 device library collects command latency statistics in,
+  // before the first TPM2 command is sent.
+  //
+  if (FeaturePcdGet (PcdTpm2CommandLatencyStatistics) && (GetFirstGuidHob (&gTpm2CommandLatencyHobGuid) == NULL)) {
+    LatencyHob = BuildGuidHob (&gTpm2CommandLatencyHobGuid, sizeof (TPM2_COMMAND_LATENCY_HOB));
+    if (LatencyHob != NULL) {
+      ZeroMem (LatencyHob, sizeof (TPM2_COMMAND_LATENCY_HOB));
+    }
+  }
+
   if (!mImageInMemory) {
     //
     // Initialize TPM device
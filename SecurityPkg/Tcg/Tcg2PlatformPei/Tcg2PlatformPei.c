@@ -51,6 +51,10 @@ PlatformInitEndOfPei (
     TcgEventLog = GetFirstGuidHob (&gTcgEvent2EntryHobGuid);
   }
 
+  if (TcgEventLog == NULL) {
+    TcgEventLog = GetFirstGuidHob (&gTcgEventLogBufferHobGuid);
+  }
+
   if (TcgEventLog == NULL) {
     //
     // no S3 error reported
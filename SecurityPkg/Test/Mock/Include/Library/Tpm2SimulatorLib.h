@@ -0,0 +1,100 @@
+/** @file
+  Control interface of Tpm2DeviceLibSimulator, the host based TPM 2.0 simulator
+  instance of Tpm2DeviceLib.
+
+  Host tests link Tpm2DeviceLibSimulator in place of a real TPM transport, so code
+  on top of Tpm2DeviceLib (Tpm2CommandLib, HashLibTpm2, ...) sends its commands to
+  an in-process TPM. These functions let the test configure that TPM and inspect
+  the command counts, the simulated execution time and the resulting PCR values.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef TPM2_SIMULATOR_LIB_H_
+#define TPM2_SIMULATOR_LIB_H_
+
+#include <IndustryStandard/Tpm20.h>
+
+/**
+  Power cycle the simulated TPM.
+
+  PCR values, hash sequences, command counts, latencies and the simulated time
+  are cleared, and the TPM expects TPM2_Startup again.
+
+  @param[in] ActivePcrBanks  Bitmap of the EFI_TCG2_BOOT_HASH_ALG_* PCR banks to activate.
+                             SHA1, SHA256, SHA384 and SHA512 are simulated.
+**/
+VOID
+EFIAPI
+Tpm2SimulatorReset (
+  IN UINT32  ActivePcrBanks
+  );
+
+/**
+  Set the simulated execution time of a command.
+
+  The time of each command received is added to the simulated time returned by
+  Tpm2SimulatorGetElapsedTime (), so tests can measure the TPM cost of a flow
+  without depending on the speed of the host.
+
+  @param[in] CommandCode  Command code, or 0 to set the time of every command
+                          that has no time of its own.
+  @param[in] Latency      Execution time in microseconds.
+
+  @retval EFI_SUCCESS           The execution time is set.
+  @retval EFI_OUT_OF_RESOURCES  Too many command codes have their own execution time.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2SimulatorSetLatency (
+  IN TPM_CC  CommandCode,
+  IN UINT32  Latency
+  );
+
+/**
+  Return the number of commands received since the last Tpm2SimulatorReset ().
+
+  @param[in] CommandCode  Command code, or 0 to count every command.
+
+  @return The number of commands received.
+**/
+UINT32
+EFIAPI
+Tpm2SimulatorGetCommandCount (
+  IN TPM_CC  CommandCode
+  );
+
+/**
+  Return the simulated execution time of the commands received since the last
+  Tpm2SimulatorReset ().
+
+  @return The simulated time in microseconds.
+**/
+UINT64
+EFIAPI
+Tpm2SimulatorGetElapsedTime (
+  VOID
+  );
+
+/**
+  Read a PCR of the simulated TPM.
+
+  @param[in]  HashAlg   Hash algorithm of the PCR bank.
+  @param[in]  PcrIndex  Index of the PCR.
+  @param[out] Digest    Value of the PCR.
+
+  @retval EFI_SUCCESS            The PCR value is returned.
+  @retval EFI_INVALID_PARAMETER  Digest is NULL or PcrIndex is not a PCR.
+  @retval EFI_NOT_FOUND          The PCR bank is not active.
+  @retval EFI_NOT_READY          The TPM has not received TPM2_Startup.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2SimulatorGetPcr (
+  IN  TPMI_ALG_HASH  HashAlg,
+  IN  UINT32         PcrIndex,
+  OUT TPMU_HA        *Digest
+  );
+
+#endif
@@ -0,0 +1,1452 @@
+/** @file
+  Host based TPM 2.0 simulator instance of Tpm2DeviceLib.
+
+  The simulator executes in process the TPM 2.0 commands used for measured boot:
+  TPM2_Startup, TPM2_Shutdown, TPM2_SelfTest, TPM2_GetCapability (PCRs and fixed
+  properties), TPM2_PCR_Extend, TPM2_PCR_Event, TPM2_PCR_Read, TPM2_HashSequenceStart,
+  TPM2_SequenceUpdate, TPM2_SequenceComplete and TPM2_EventSequenceComplete.
+  Other commands fail with TPM_RC_COMMAND_CODE. Authorization sessions are parsed
+  but not checked.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <IndustryStandard/Tpm20.h>
+#include <Protocol/Tcg2Protocol.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/Tpm2DeviceLib.h>
+#include <Library/Tpm2SimulatorLib.h>
+
+#define TPM2_SIM_MAX_RESPONSE_SIZE  0x1000
+#define TPM2_SIM_MAX_HANDLES        2
+#define TPM2_SIM_MAX_SEQUENCES      3
+#define TPM2_SIM_MAX_LATENCIES      16
+#define TPM2_SIM_MAX_COMMAND_CODES  64
+
+//
+// Size of an empty password session in a response: nonce size, sessionAttributes and hmac size.
+//
+#define TPM2_SIM_AUTH_RESPONSE_SIZE  (sizeof (UINT16) + sizeof (UINT8) + sizeof (UINT16))
+
+typedef
+UINTN
+(EFIAPI *TPM2_SIM_HASH_GET_CONTEXT_SIZE)(
+  VOID
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *TPM2_SIM_HASH_INIT)(
+  OUT VOID  *HashContext
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *TPM2_SIM_HASH_UPDATE)(
+  IN OUT VOID        *HashContext,
+  IN     CONST VOID  *Data,
+  IN     UINTN       DataSize
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *TPM2_SIM_HASH_FINAL)(
+  IN OUT VOID   *HashContext,
+  OUT    UINT8  *HashValue
+  );
+
+typedef struct {
+  TPMI_ALG_HASH                     HashAlg;
+  UINT32                            BankMask;
+  UINT16                            DigestSize;
+  TPM2_SIM_HASH_GET_CONTEXT_SIZE    GetContextSize;
+  TPM2_SIM_HASH_INIT                Init;
+  TPM2_SIM_HASH_UPDATE              Update;
+  TPM2_SIM_HASH_FINAL               Final;
+} TPM2_SIM_HASH_ALGORITHM;
+
+STATIC CONST TPM2_SIM_HASH_ALGORITHM  mHashAlgorithms[] = {
+  { TPM_ALG_SHA1,   EFI_TCG2_BOOT_HASH_ALG_SHA1,   SHA1_DIGEST_SIZE,   Sha1GetContextSize,   Sha1Init,   Sha1Update,   Sha1Final   },
+  { TPM_ALG_SHA256, EFI_TCG2_BOOT_HASH_ALG_SHA256, SHA256_DIGEST_SIZE, Sha256GetContextSize, Sha256Init, Sha256Update, Sha256Final },
+  { TPM_ALG_SHA384, EFI_TCG2_BOOT_HASH_ALG_SHA384, SHA384_DIGEST_SIZE, Sha384GetContextSize, Sha384Init, Sha384Update, Sha384Final },
+  { TPM_ALG_SHA512, EFI_TCG2_BOOT_HASH_ALG_SHA512, SHA512_DIGEST_SIZE, Sha512GetContextSize, Sha512Init, Sha512Update, Sha512Final },
+};
+
+#define TPM2_SIM_HASH_COUNT  ARRAY_SIZE (mHashAlgorithms)
+
+//
+// Fixed TPM properties reported by TPM2_GetCapability, sorted by property.
+//
+STATIC CONST TPMS_TAGGED_PROPERTY  mTpmProperties[] = {
+  { TPM_PT_FAMILY_INDICATOR,  SIGNATURE_32 ('\0', '0', '.', '2')     },
+  { TPM_PT_LEVEL,             0                                      },
+  { TPM_PT_REVISION,          138                                    },
+  { TPM_PT_MANUFACTURER,      SIGNATURE_32 ('S', 'I', 'M', ' ')      },
+  { TPM_PT_VENDOR_STRING_1,   SIGNATURE_32 ('S', 'I', 'M', 'U')      },
+  { TPM_PT_VENDOR_STRING_2,   SIGNATURE_32 ('L', 'A', 'T', 'R')      },
+  { TPM_PT_FIRMWARE_VERSION_1, 0x00010000                            },
+  { TPM_PT_FIRMWARE_VERSION_2, 0                                     },
+  { TPM_PT_INPUT_BUFFER,      MAX_DIGEST_BUFFER                      },
+  { TPM_PT_PCR_COUNT,         IMPLEMENTATION_PCR                     },
+  { TPM_PT_PCR_SELECT_MIN,    PCR_SELECT_MIN                         },
+  { TPM_PT_MAX_COMMAND_SIZE,  TPM2_SIM_MAX_RESPONSE_SIZE             },
+  { TPM_PT_MAX_RESPONSE_SIZE, TPM2_SIM_MAX_RESPONSE_SIZE             },
+  { TPM_PT_MAX_DIGEST,        SHA512_DIGEST_SIZE                     },
+};
+
+typedef struct {
+  BOOLEAN          InUse;
+  //
+  // TPM_ALG_NULL for an event sequence, which hashes with every active PCR bank.
+  //
+  TPMI_ALG_HASH    HashAlg;
+  VOID             *Context[TPM2_SIM_HASH_COUNT];
+} TPM2_SIM_SEQUENCE;
+
+typedef struct {
+  TPM_CC    CommandCode;
+  UINT32    Value;
+} TPM2_SIM_COMMAND_VALUE;
+
+//
+// A command or response buffer, read or written from Offset.
+//
+typedef struct {
+  UINT8      *Data;
+  UINT32     Size;
+  UINT32     Offset;
+  BOOLEAN    Overflow;
+} TPM2_SIM_BUFFER;
+
+typedef
+TPM_RC
+(*TPM2_SIM_COMMAND_HANDLER)(
+  IN     UINT32           *Handles,
+  IN OUT TPM2_SIM_BUFFER  *Parameters,
+  IN OUT TPM2_SIM_BUFFER  *Response
+  );
+
+typedef struct {
+  TPM_CC                      CommandCode;
+  UINT8                       HandleCount;
+  UINT8                       ResponseHandleCount;
+  TPM2_SIM_COMMAND_HANDLER    Handler;
+} TPM2_SIM_COMMAND;
+
+STATIC BOOLEAN                 mStarted;
+STATIC UINT32                  mActivePcrBanks = EFI_TCG2_BOOT_HASH_ALG_SHA256;
+STATIC UINT32                  mPcrUpdateCounter;
+STATIC TPMU_HA                 mPcrs[TPM2_SIM_HASH_COUNT][IMPLEMENTATION_PCR];
+STATIC TPM2_SIM_SEQUENCE       mSequences[TPM2_SIM_MAX_SEQUENCES];
+STATIC UINT32                  mDefaultLatency;
+STATIC TPM2_SIM_COMMAND_VALUE  mLatencies[TPM2_SIM_MAX_LATENCIES];
+STATIC UINTN                   mLatencyCount;
+STATIC TPM2_SIM_COMMAND_VALUE  mCommandCounts[TPM2_SIM_MAX_COMMAND_CODES];
+STATIC UINTN                   mCommandCodeCount;
+STATIC UINT32                  mTotalCommandCount;
+STATIC UINT64                  mElapsedTime;
+STATIC UINT8                   mParameters[TPM2_SIM_MAX_RESPONSE_SIZE];
+
+/**
+  Read bytes from a command buffer.
+
+  @param[in, out] Buffer  Command buffer.
+  @param[in]      Size    Number of bytes to read.
+
+  @return Pointer to the bytes, or NULL if the buffer is too short.
+**/
+STATIC
+UINT8 *
+SimReadBytes (
+  IN OUT TPM2_SIM_BUFFER  *Buffer,
+  IN     UINT32           Size
+  )
+{
+  UINT8  *Bytes;
+
+  if ((Buffer->Overflow) || (Size > Buffer->Size - Buffer->Offset)) {
+    Buffer->Overflow = TRUE;
+    return NULL;
+  }
+
+  Bytes           = Buffer->Data + Buffer->Offset;
+  Buffer->Offset += Size;
+  return Bytes;
+}
+
+/**
+  Read a big endian UINT8, UINT16 or UINT32 from a command buffer.
+
+  @param[in, out] Buffer  Command buffer.
+  @param[in]      Size    Size of the value, 1, 2 or 4.
+
+  @return The value, or 0 if the buffer is too short.
+**/
+STATIC
+UINT32
+SimReadValue (
+  IN OUT TPM2_SIM_BUFFER  *Buffer,
+  IN     UINT32           Size
+  )
+{
+  UINT8   *Bytes;
+  UINT32  Value;
+
+  Bytes = SimReadBytes (Buffer, Size);
+  if (Bytes == NULL) {
+    return 0;
+  }
+
+  for (Value = 0; Size > 0; Size--, Bytes++) {
+    Value = (Value << 8) | *Bytes;
+  }
+
+  return Value;
+}
+
+/**
+  Reserve bytes in a response buffer.
+
+  @param[in, out] Buffer  Response buffer.
+  @param[in]      Size    Number of bytes to reserve.
+
+  @return Pointer to the bytes, or NULL if the buffer is full.
+**/
+STATIC
+UINT8 *
+SimWriteBytes (
+  IN OUT TPM2_SIM_BUFFER  *Buffer,
+  IN     UINT32           Size
+  )
+{
+  return SimReadBytes (Buffer, Size);
+}
+
+/**
+  Write bytes to a response buffer.
+
+  @param[in, out] Buffer  Response buffer.
+  @param[in]      Source  Bytes to write, or NULL to write zeros.
+  @param[in]      Size    Number of bytes to write.
+**/
+STATIC
+VOID
+SimWriteData (
+  IN OUT TPM2_SIM_BUFFER  *Buffer,
+  IN     CONST VOID       *Source,
+  IN     UINT32           Size
+  )
+{
+  UINT8  *Bytes;
+
+  Bytes = SimWriteBytes (Buffer, Size);
+  if (Bytes == NULL) {
+    return;
+  }
+
+  if (Source == NULL) {
+    ZeroMem (Bytes, Size);
+  } else {
+    CopyMem (Bytes, Source, Size);
+  }
+}
+
+/**
+  Write a big endian UINT8, UINT16 or UINT32 to a response buffer.
+
+  @param[in, out] Buffer  Response buffer.
+  @param[in]      Size    Size of the value, 1, 2 or 4.
+  @param[in]      Value   The value.
+**/
+STATIC
+VOID
+SimWriteValue (
+  IN OUT TPM2_SIM_BUFFER  *Buffer,
+  IN     UINT32           Size,
+  IN     UINT32           Value
+  )
+{
+  UINT8  *Bytes;
+
+  Bytes = SimWriteBytes (Buffer, Size);
+  if (Bytes == NULL) {
+    return;
+  }
+
+  for ( ; Size > 0; Size--) {
+    Bytes[Size - 1] = (UINT8)Value;
+    Value         >>= 8;
+  }
+}
+
+/**
+  Return the index in mHashAlgorithms of a hash algorithm.
+
+  @param[in] HashAlg  Hash algorithm.
+
+  @return The index, or TPM2_SIM_HASH_COUNT if the algorithm is not simulated.
+**/
+STATIC
+UINTN
+SimGetHashIndex (
+  IN TPMI_ALG_HASH  HashAlg
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TPM2_SIM_HASH_COUNT; Index++) {
+    if (mHashAlgorithms[Index].HashAlg == HashAlg) {
+      break;
+    }
+  }
+
+  return Index;
+}
+
+/**
+  Check whether a PCR bank is active.
+
+  @param[in] HashIndex  Index in mHashAlgorithms of the bank.
+
+  @retval TRUE   The bank is active.
+  @retval FALSE  The bank is not active.
+**/
+STATIC
+BOOLEAN
+SimIsBankActive (
+  IN UINTN  HashIndex
+  )
+{
+  return (BOOLEAN)((mActivePcrBanks & mHashAlgorithms[HashIndex].BankMask) != 0);
+}
+
+/**
+  Hash data with one algorithm.
+
+  @param[in]  HashIndex  Index in mHashAlgorithms of the algorithm.
+  @param[in]  Data       Data to hash.
+  @param[in]  DataSize   Size of the data.
+  @param[out] Digest     Digest of the data.
+
+  @retval TRUE   The data is hashed.
+  @retval FALSE  The hash failed.
+**/
+STATIC
+BOOLEAN
+SimHash (
+  IN  UINTN       HashIndex,
+  IN  CONST VOID  *Data,
+  IN  UINTN       DataSize,
+  OUT UINT8       *Digest
+  )
+{
+  VOID     *Context;
+  BOOLEAN  Result;
+
+  Context = AllocatePool (mHashAlgorithms[HashIndex].GetContextSize ());
+  if (Context == NULL) {
+    return FALSE;
+  }
+
+  Result = mHashAlgorithms[HashIndex].Init (Context) &&
+           mHashAlgorithms[HashIndex].Update (Context, Data, DataSize) &&
+           mHashAlgorithms[HashIndex].Final (Context, Digest);
+  FreePool (Context);
+  return Result;
+}
+
+/**
+  Extend a digest into a PCR: PCR = Hash (PCR || Digest).
+
+  @param[in] HashIndex  Index in mHashAlgorithms of the PCR bank.
+  @param[in] PcrIndex   Index of the PCR.
+  @param[in] Digest     Digest to extend, of the size of the bank's digests.
+
+  @retval TRUE   The PCR is extended.
+  @retval FALSE  The hash failed.
+**/
+STATIC
+BOOLEAN
+SimExtendPcr (
+  IN UINTN        HashIndex,
+  IN UINT32       PcrIndex,
+  IN CONST UINT8  *Digest
+  )
+{
+  UINT8  Data[sizeof (TPMU_HA) * 2];
+  UINTN  DigestSize;
+
+  DigestSize = mHashAlgorithms[HashIndex].DigestSize;
+  CopyMem (Data, &mPcrs[HashIndex][PcrIndex], DigestSize);
+  CopyMem (Data + DigestSize, Digest, DigestSize);
+  return SimHash (HashIndex, Data, DigestSize * 2, (UINT8 *)&mPcrs[HashIndex][PcrIndex]);
+}
+
+/**
+  Check the PCR handle of a command.
+
+  @param[in]  PcrHandle  PCR handle.
+  @param[out] Extend     TRUE if the handle is a PCR, FALSE for TPM_RH_NULL.
+
+  @retval TPM_RC_SUCCESS  The handle is valid.
+  @retval TPM_RC_VALUE    The handle is not a PCR nor TPM_RH_NULL.
+**/
+STATIC
+TPM_RC
+SimCheckPcrHandle (
+  IN  UINT32   PcrHandle,
+  OUT BOOLEAN  *Extend
+  )
+{
+  *Extend = (BOOLEAN)(PcrHandle != TPM_RH_NULL);
+  if (*Extend && (PcrHandle >= IMPLEMENTATION_PCR)) {
+    return TPM_RC_VALUE;
+  }
+
+  return TPM_RC_SUCCESS;
+}
+
+/**
+  Free a hash sequence.
+
+  @param[in, out] Sequence  The sequence.
+**/
+STATIC
+VOID
+SimFreeSequence (
+  IN OUT TPM2_SIM_SEQUENCE  *Sequence
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TPM2_SIM_HASH_COUNT; Index++) {
+    if (Sequence->Context[Index] != NULL) {
+      FreePool (Sequence->Context[Index]);
+    }
+  }
+
+  ZeroMem (Sequence, sizeof (*Sequence));
+}
+
+/**
+  Return the hash sequence of a handle.
+
+  @param[in] Handle  Sequence handle.
+
+  @return The sequence, or NULL if the handle is not a sequence.
+**/
+STATIC
+TPM2_SIM_SEQUENCE *
+SimGetSequence (
+  IN UINT32  Handle
+  )
+{
+  if ((Handle < HR_TRANSIENT) || (Handle - HR_TRANSIENT >= TPM2_SIM_MAX_SEQUENCES) ||
+      !mSequences[Handle - HR_TRANSIENT].InUse)
+  {
+    return NULL;
+  }
+
+  return &mSequences[Handle - HR_TRANSIENT];
+}
+
+/**
+  Hash the TPM2B_MAX_BUFFER of a sequence command into a sequence.
+
+  @param[in, out] Sequence    The sequence.
+  @param[in, out] Parameters  Command parameters, at the TPM2B_MAX_BUFFER.
+
+  @retval TPM_RC_SUCCESS  The data is hashed.
+  @retval TPM_RC_SIZE     The buffer is larger than MAX_DIGEST_BUFFER.
+  @retval TPM_RC_FAILURE  The hash failed.
+**/
+STATIC
+TPM_RC
+SimUpdateSequence (
+  IN OUT TPM2_SIM_SEQUENCE  *Sequence,
+  IN OUT TPM2_SIM_BUFFER    *Parameters
+  )
+{
+  UINT32  Size;
+  UINT8   *Data;
+  UINTN   Index;
+
+  Size = SimReadValue (Parameters, sizeof (UINT16));
+  if (Size > MAX_DIGEST_BUFFER) {
+    return TPM_RC_SIZE;
+  }
+
+  Data = SimReadBytes (Parameters, Size);
+  if (Data == NULL) {
+    return TPM_RC_SIZE;
+  }
+
+  for (Index = 0; Index < TPM2_SIM_HASH_COUNT; Index++) {
+    if ((Sequence->Context[Index] != NULL) &&
+        !mHashAlgorithms[Index].Update (Sequence->Context[Index], Data, Size))
+    {
+      return TPM_RC_FAILURE;
+    }
+  }
+
+  return TPM_RC_SUCCESS;
+}
+
+/**
+  TPM2_Startup.
+
+  @param[in]      Handles     Command handles.
+  @param[in, out] Parameters  Command parameters.
+  @param[in, out] Response    Response parameters.
+
+  @return The TPM response code.
+**/
+STATIC
+TPM_RC
+SimStartup (
+  IN     UINT32           *Handles,
+  IN OUT TPM2_SIM_BUFFER  *Parameters,
+  IN OUT TPM2_SIM_BUFFER  *Response
+  )
+{
+  UINTN   HashIndex;
+  UINT32  PcrIndex;
+
+  SimReadValue (Parameters, sizeof (TPM_SU));
+  if (mStarted) {
+    return TPM_RC_INITIALIZE;
+  }
+
+  //
+  // No state is saved across Tpm2SimulatorReset (), so TPM_SU_STATE starts like TPM_SU_CLEAR.
+  // PCR 17 to 22 are the DRTM PCRs, which start at all ones.
+  //
+  for (HashIndex = 0; HashIndex < TPM2_SIM_HASH_COUNT; HashIndex++) {
+    for (PcrIndex = 0; PcrIndex < IMPLEMENTATION_PCR; PcrIndex++) {
+      SetMem (
+        &mPcrs[HashIndex][PcrIndex],
+        sizeof (TPMU_HA),
+        ((PcrIndex >= 17) && (PcrIndex <= 22)) ? 0xFF : 0
+        );
+    }
+  }
+
+  mPcrUpdateCounter = 0;
+  mStarted          = TRUE;
+  return TPM_RC_SUCCESS;
+}
+
+/**
+  TPM2_Shutdown and TPM2_SelfTest, which have nothing to simulate.
+
+  @param[in]      Handles     Command handles.
+  @param[in, out] Parameters  Command parameters.
+  @param[in, out] Response    Response parameters.
+
+  @return The TPM response code.
+**/
+STATIC
+TPM_RC
+SimNoOperation (
+  IN     UINT32           *Handles,
+  IN OUT TPM2_SIM_BUFFER  *Parameters,
+  IN OUT TPM2_SIM_BUFFER  *Response
+  )
+{
+  return TPM_RC_SUCCESS;
+}
+
+/**
+  TPM2_GetCapability for TPM_CAP_PCRS and TPM_CAP_TPM_PROPERTIES.
+
+  @param[in]      Handles     Command handles.
+  @param[in, out] Parameters  Command parameters.
+  @param[in, out] Response    Response parameters.
+
+  @return The TPM response code.
+**/
+STATIC
+TPM_RC
+SimGetCapability (
+  IN     UINT32           *Handles,
+  IN OUT TPM2_SIM_BUFFER  *Parameters,
+  IN OUT TPM2_SIM_BUFFER  *Response
+  )
+{
+  UINT32  Capability;
+  UINT32  Property;
+  UINT32  PropertyCount;
+  UINTN   Index;
+  UINTN   Start;
+  UINTN   Count;
+  UINT8   *Select;
+
+  Capability    = SimReadValue (Parameters, sizeof (TPM_CAP));
+  Property      = SimReadValue (Parameters, sizeof (UINT32));
+  PropertyCount = SimReadValue (Parameters, sizeof (UINT32));
+
+  switch (Capability) {
+    case TPM_CAP_PCRS:
+      SimWriteValue (Response, sizeof (TPMI_YES_NO), NO);
+      SimWriteValue (Response, sizeof (TPM_CAP), Capability);
+      SimWriteValue (Response, sizeof (UINT32), (UINT32)TPM2_SIM_HASH_COUNT);
+      for (Index = 0; Index < TPM2_SIM_HASH_COUNT; Index++) {
+        SimWriteValue (Response, sizeof (TPMI_ALG_HASH), mHashAlgorithms[Index].HashAlg);
+        SimWriteValue (Response, sizeof (UINT8), PCR_SELECT_MIN);
+        Select = SimWriteBytes (Response, PCR_SELECT_MIN);
+        if (Select != NULL) {
+          SetMem (Select, PCR_SELECT_MIN, SimIsBankActive (Index) ? 0xFF : 0);
+        }
+      }
+
+      return TPM_RC_SUCCESS;
+
+    case TPM_CAP_TPM_PROPERTIES:
+      for (Start = 0; Start < ARRAY_SIZE (mTpmProperties); Start++) {
+        if (mTpmProperties[Start].property >= Property) {
+          break;
+        }
+      }
+
+      Count = MIN (PropertyCount, ARRAY_SIZE (mTpmProperties) - Start);
+      SimWriteValue (Response, sizeof (TPMI_YES_NO), (Start + Count < ARRAY_SIZE (mTpmProperties)) ? YES : NO);
+      SimWriteValue (Response, sizeof (TPM_CAP), Capability);
+      SimWriteValue (Response, sizeof (UINT32), (UINT32)Count);
+      for (Index = Start; Index < Start + Count; Index++) {
+        SimWriteValue (Response, sizeof (TPM_PT), mTpmProperties[Index].property);
+        SimWriteValue (Response, sizeof (UINT32), mTpmProperties[Index].value);
+      }
+
+      return TPM_RC_SUCCESS;
+
+    default:
+      return TPM_RC_VALUE;
+  }
+}
+
+/**
+  TPM2_PCR_Extend.
+
+  @param[in]      Handles     Command handles.
+  @param[in, out] Parameters  Command parameters.
+  @param[in, out] Response    Response parameters.
+
+  @return The TPM response code.
+**/
+STATIC
+TPM_RC
+SimPcrExtend (
+  IN     UINT32           *Handles,
+  IN OUT TPM2_SIM_BUFFER  *Parameters,
+  IN OUT TPM2_SIM_BUFFER  *Response
+  )
+{
+  TPM_RC   Rc;
+  BOOLEAN  Extend;
+  UINT32   Count;
+  UINT32   Index;
+  UINTN    HashIndex;
+  UINT8    *Digest;
+
+  Rc = SimCheckPcrHandle (Handles[0], &Extend);
+  if (Rc != TPM_RC_SUCCESS) {
+    return Rc;
+  }
+
+  Count = SimReadValue (Parameters, sizeof (UINT32));
+  if (Count > HASH_COUNT) {
+    return TPM_RC_SIZE;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    HashIndex = SimGetHashIndex ((TPMI_ALG_HASH)SimReadValue (Parameters, sizeof (TPMI_ALG_HASH)));
+    if (HashIndex == TPM2_SIM_HASH_COUNT) {
+      return TPM_RC_HASH;
+    }
+
+    Digest = SimReadBytes (Parameters, mHashAlgorithms[HashIndex].DigestSize);
+    if (Digest == NULL) {
+      return TPM_RC_SIZE;
+    }
+
+    if (Extend && SimIsBankActive (HashIndex) && !SimExtendPcr (HashIndex, Handles[0], Digest)) {
+      return TPM_RC_FAILURE;
+    }
+  }
+
+  if (Extend) {
+    mPcrUpdateCounter++;
+  }
+
+  return TPM_RC_SUCCESS;
+}
+
+/**
+  TPM2_PCR_Event.
+
+  @param[in]      Handles     Command handles.
+  @param[in, out] Parameters  Command parameters.
+  @param[in, out] Response    Response parameters.
+
+  @return The TPM response code.
+**/
+STATIC
+TPM_RC
+SimPcrEvent (
+  IN     UINT32           *Handles,
+  IN OUT TPM2_SIM_BUFFER  *Parameters,
+  IN OUT TPM2_SIM_BUFFER  *Response
+  )
+{
+  TPM_RC   Rc;
+  BOOLEAN  Extend;
+  UINT32   Size;
+  UINT8    *Data;
+  UINT32   Count;
+  UINTN    HashIndex;
+  UINT8    *Digest;
+
+  Rc = SimCheckPcrHandle (Handles[0], &Extend);
+  if (Rc != TPM_RC_SUCCESS) {
+    return Rc;
+  }
+
+  Size = SimReadValue (Parameters, sizeof (UINT16));
+  if (Size > sizeof (TPM2B_EVENT) - sizeof (UINT16)) {
+    return TPM_RC_SIZE;
+  }
+
+  Data = SimReadBytes (Parameters, Size);
+  if (Data == NULL) {
+    return TPM_RC_SIZE;
+  }
+
+  for (Count = 0, HashIndex = 0; HashIndex < TPM2_SIM_HASH_COUNT; HashIndex++) {
+    if (SimIsBankActive (HashIndex)) {
+      Count++;
+    }
+  }
+
+  SimWriteValue (Response, sizeof (UINT32), Count);
+  for (HashIndex = 0; HashIndex < TPM2_SIM_HASH_COUNT; HashIndex++) {
+    if (!SimIsBankActive (HashIndex)) {
+      continue;
+    }
+
+    SimWriteValue (Response, sizeof (TPMI_ALG_HASH), mHashAlgorithms[HashIndex].HashAlg);
+    Digest = SimWriteBytes (Response, mHashAlgorithms[HashIndex].DigestSize);
+    if ((Digest == NULL) || !SimHash (HashIndex, Data, Size, Digest)) {
+      return TPM_RC_FAILURE;
+    }
+
+    if (Extend && !SimExtendPcr (HashIndex, Handles[0], Digest)) {
+      return TPM_RC_FAILURE;
+    }
+  }
+
+  if (Extend) {
+    mPcrUpdateCounter++;
+  }
+
+  return TPM_RC_SUCCESS;
+}
+
+/**
+  TPM2_PCR_Read.
+
+  @param[in]      Handles     Command handles.
+  @param[in, out] Parameters  Command parameters.
+  @param[in, out] Response    Response parameters.
+
+  @return The TPM response code.
+**/
+STATIC
+TPM_RC
+SimPcrRead (
+  IN     UINT32           *Handles,
+  IN OUT TPM2_SIM_BUFFER  *Parameters,
+  IN OUT TPM2_SIM_BUFFER  *Response
+  )
+{
+  TPML_PCR_SELECTION  Selection;
+  UINT32              Index;
+  UINT32              PcrIndex;
+  UINT32              DigestCount;
+  UINTN               HashIndex;
+  UINT8               *Select;
+
+  ZeroMem (&Selection, sizeof (Selection));
+  Selection.count = SimReadValue (Parameters, sizeof (UINT32));
+  if (Selection.count > HASH_COUNT) {
+    return TPM_RC_SIZE;
+  }
+
+  //
+  // Return at most 8 digests, clearing the selection of the PCRs not returned.
+  //
+  DigestCount = 0;
+  for (Index = 0; Index < Selection.count; Index++) {
+    Selection.pcrSelections[Index].hash         = (TPMI_ALG_HASH)SimReadValue (Parameters, sizeof (TPMI_ALG_HASH));
+    Selection.pcrSelections[Index].sizeofSelect = (UINT8)SimReadValue (Parameters, sizeof (UINT8));
+    if (Selection.pcrSelections[Index].sizeofSelect > PCR_SELECT_MAX) {
+      return TPM_RC_VALUE;
+    }
+
+    Select = SimReadBytes (Parameters, Selection.pcrSelections[Index].sizeofSelect);
+    if (Select == NULL) {
+      return TPM_RC_SIZE;
+    }
+
+    HashIndex = SimGetHashIndex (Selection.pcrSelections[Index].hash);
+    for (PcrIndex = 0; PcrIndex < Selection.pcrSelections[Index].sizeofSelect * 8U; PcrIndex++) {
+      if (((Select[PcrIndex / 8] & (1 << (PcrIndex % 8))) != 0) &&
+          (HashIndex != TPM2_SIM_HASH_COUNT) && SimIsBankActive (HashIndex) &&
+          (PcrIndex < IMPLEMENTATION_PCR) && (DigestCount < 8))
+      {
+        Selection.pcrSelections[Index].pcrSelect[PcrIndex / 8] |= (UINT8)(1 << (PcrIndex % 8));
+        DigestCount++;
+      }
+    }
+  }
+
+  SimWriteValue (Response, sizeof (UINT32), mPcrUpdateCounter);
+  SimWriteValue (Response, sizeof (UINT32), Selection.count);
+  for (Index = 0; Index < Selection.count; Index++) {
+    SimWriteValue (Response, sizeof (TPMI_ALG_HASH), Selection.pcrSelections[Index].hash);
+    SimWriteValue (Response, sizeof (UINT8), Selection.pcrSelections[Index].sizeofSelect);
+    SimWriteData (Response, Selection.pcrSelections[Index].pcrSelect, Selection.pcrSelections[Index].sizeofSelect);
+  }
+
+  SimWriteValue (Response, sizeof (UINT32), DigestCount);
+  for (Index = 0; Index < Selection.count; Index++) {
+    HashIndex = SimGetHashIndex (Selection.pcrSelections[Index].hash);
+    for (PcrIndex = 0; PcrIndex < Selection.pcrSelections[Index].sizeofSelect * 8U; PcrIndex++) {
+      if ((Selection.pcrSelections[Index].pcrSelect[PcrIndex / 8] & (1 << (PcrIndex % 8))) != 0) {
+        SimWriteValue (Response, sizeof (UINT16), mHashAlgorithms[HashIndex].DigestSize);
+        SimWriteData (Response, &mPcrs[HashIndex][PcrIndex], mHashAlgorithms[HashIndex].DigestSize);
+      }
+    }
+  }
+
+  return TPM_RC_SUCCESS;
+}
+
+/**
+  TPM2_HashSequenceStart.
+
+  @param[in]      Handles     Command handles.
+  @param[in, out] Parameters  Command parameters.
+  @param[in, out] Response    Response handle and parameters.
+
+  @return The TPM response code.
+**/
+STATIC
+TPM_RC
+SimHashSequenceStart (
+  IN     UINT32           *Handles,
+  IN OUT TPM2_SIM_BUFFER  *Parameters,
+  IN OUT TPM2_SIM_BUFFER  *Response
+  )
+{
+  UINT32             AuthSize;
+  TPMI_ALG_HASH      HashAlg;
+  UINTN              HashIndex;
+  UINT32             Handle;
+  TPM2_SIM_SEQUENCE  *Sequence;
+
+  AuthSize = SimReadValue (Parameters, sizeof (UINT16));
+  SimReadBytes (Parameters, AuthSize);
+  HashAlg = (TPMI_ALG_HASH)SimReadValue (Parameters, sizeof (TPMI_ALG_HASH));
+  if ((HashAlg != TPM_ALG_NULL) && (SimGetHashIndex (HashAlg) == TPM2_SIM_HASH_COUNT)) {
+    return TPM_RC_HASH;
+  }
+
+  for (Handle = 0; Handle < TPM2_SIM_MAX_SEQUENCES; Handle++) {
+    if (!mSequences[Handle].InUse) {
+      break;
+    }
+  }
+
+  if (Handle == TPM2_SIM_MAX_SEQUENCES) {
+    return TPM_RC_OBJECT_MEMORY;
+  }
+
+  Sequence          = &mSequences[Handle];
+  Sequence->InUse   = TRUE;
+  Sequence->HashAlg = HashAlg;
+  for (HashIndex = 0; HashIndex < TPM2_SIM_HASH_COUNT; HashIndex++) {
+    if ((HashAlg == TPM_ALG_NULL) ? !SimIsBankActive (HashIndex) : (mHashAlgorithms[HashIndex].HashAlg != HashAlg)) {
+      continue;
+    }
+
+    Sequence->Context[HashIndex] = AllocatePool (mHashAlgorithms[HashIndex].GetContextSize ());
+    if ((Sequence->Context[HashIndex] == NULL) || !mHashAlgorithms[HashIndex].Init (Sequence->Context[HashIndex])) {
+      SimFreeSequence (Sequence);
+      return TPM_RC_MEMORY;
+    }
+  }
+
+  SimWriteValue (Response, sizeof (TPMI_DH_OBJECT), HR_TRANSIENT + Handle);
+  return TPM_RC_SUCCESS;
+}
+
+/**
+  TPM2_SequenceUpdate.
+
+  @param[in]      Handles     Command handles.
+  @param[in, out] Parameters  Command parameters.
+  @param[in, out] Response    Response parameters.
+
+  @return The TPM response code.
+**/
+STATIC
+TPM_RC
+SimSequenceUpdate (
+  IN     UINT32           *Handles,
+  IN OUT TPM2_SIM_BUFFER  *Parameters,
+  IN OUT TPM2_SIM_BUFFER  *Response
+  )
+{
+  TPM2_SIM_SEQUENCE  *Sequence;
+
+  Sequence = SimGetSequence (Handles[0]);
+  if (Sequence == NULL) {
+    return TPM_RC_HANDLE;
+  }
+
+  return SimUpdateSequence (Sequence, Parameters);
+}
+
+/**
+  TPM2_SequenceComplete.
+
+  @param[in]      Handles     Command handles.
+  @param[in, out] Parameters  Command parameters.
+  @param[in, out] Response    Response parameters.
+
+  @return The TPM response code.
+**/
+STATIC
+TPM_RC
+SimSequenceComplete (
+  IN     UINT32           *Handles,
+  IN OUT TPM2_SIM_BUFFER  *Parameters,
+  IN OUT TPM2_SIM_BUFFER  *Response
+  )
+{
+  TPM2_SIM_SEQUENCE  *Sequence;
+  TPM_RC             Rc;
+  UINTN              HashIndex;
+  UINT32             Hierarchy;
+  UINT8              *Digest;
+
+  Sequence = SimGetSequence (Handles[0]);
+  if ((Sequence == NULL) || (Sequence->HashAlg == TPM_ALG_NULL)) {
+    return TPM_RC_HANDLE;
+  }
+
+  Rc = SimUpdateSequence (Sequence, Parameters);
+  if (Rc == TPM_RC_SUCCESS) {
+    Hierarchy = SimReadValue (Parameters, sizeof (TPMI_RH_HIERARCHY));
+    HashIndex = SimGetHashIndex (Sequence->HashAlg);
+    SimWriteValue (Response, sizeof (UINT16), mHashAlgorithms[HashIndex].DigestSize);
+    Digest = SimWriteBytes (Response, mHashAlgorithms[HashIndex].DigestSize);
+    if ((Digest == NULL) || !mHashAlgorithms[HashIndex].Final (Sequence->Context[HashIndex], Digest)) {
+      Rc = TPM_RC_FAILURE;
+    }
+
+    //
+    // Empty TPMT_TK_HASHCHECK validation ticket
+    //
+    SimWriteValue (Response, sizeof (TPM_ST), TPM_ST_HASHCHECK);
+    SimWriteValue (Response, sizeof (TPMI_RH_HIERARCHY), Hierarchy);
+    SimWriteValue (Response, sizeof (UINT16), 0);
+  }
+
+  SimFreeSequence (Sequence);
+  return Rc;
+}
+
+/**
+  TPM2_EventSequenceComplete.
+
+  @param[in]      Handles     Command handles.
+  @param[in, out] Parameters  Command parameters.
+  @param[in, out] Response    Response parameters.
+
+  @return The TPM response code.
+**/
+STATIC
+TPM_RC
+SimEventSequenceComplete (
+  IN     UINT32           *Handles,
+  IN OUT TPM2_SIM_BUFFER  *Parameters,
+  IN OUT TPM2_SIM_BUFFER  *Response
+  )
+{
+  TPM2_SIM_SEQUENCE  *Sequence;
+  TPM_RC             Rc;
+  BOOLEAN            Extend;
+  UINT32             Count;
+  UINTN              HashIndex;
+  UINT8              *Digest;
+
+  Rc = SimCheckPcrHandle (Handles[0], &Extend);
+  if (Rc != TPM_RC_SUCCESS) {
+    return Rc;
+  }
+
+  Sequence = SimGetSequence (Handles[1]);
+  if ((Sequence == NULL) || (Sequence->HashAlg != TPM_ALG_NULL)) {
+    return TPM_RC_HANDLE;
+  }
+
+  Rc = SimUpdateSequence (Sequence, Parameters);
+  if (Rc == TPM_RC_SUCCESS) {
+    for (Count = 0, HashIndex = 0; HashIndex < TPM2_SIM_HASH_COUNT; HashIndex++) {
+      if (Sequence->Context[HashIndex] != NULL) {
+        Count++;
+      }
+    }
+
+    SimWriteValue (Response, sizeof (UINT32), Count);
+    for (HashIndex = 0; HashIndex < TPM2_SIM_HASH_COUNT; HashIndex++) {
+      if (Sequence->Context[HashIndex] == NULL) {
+        continue;
+      }
+
+      SimWriteValue (Response, sizeof (TPMI_ALG_HASH), mHashAlgorithms[HashIndex].HashAlg);
+      Digest = SimWriteBytes (Response, mHashAlgorithms[HashIndex].DigestSize);
+      if ((Digest == NULL) || !mHashAlgorithms[HashIndex].Final (Sequence->Context[HashIndex], Digest) ||
+          (Extend && !SimExtendPcr (HashIndex, Handles[0], Digest)))
+      {
+        Rc = TPM_RC_FAILURE;
+        break;
+      }
+    }
+
+    if (Extend) {
+      mPcrUpdateCounter++;
+    }
+  }
+
+  SimFreeSequence (Sequence);
+  return Rc;
+}
+
+STATIC CONST TPM2_SIM_COMMAND  mCommands[] = {
+  { TPM_CC_Startup,               0, 0, SimStartup               },
+  { TPM_CC_Shutdown,              0, 0, SimNoOperation           },
+  { TPM_CC_SelfTest,              0, 0, SimNoOperation           },
+  { TPM_CC_GetCapability,         0, 0, SimGetCapability         },
+  { TPM_CC_PCR_Extend,            1, 0, SimPcrExtend             },
+  { TPM_CC_PCR_Event,             1, 0, SimPcrEvent              },
+  { TPM_CC_PCR_Read,              0, 0, SimPcrRead               },
+  { TPM_CC_HashSequenceStart,     0, 1, SimHashSequenceStart     },
+  { TPM_CC_SequenceUpdate,        1, 0, SimSequenceUpdate        },
+  { TPM_CC_SequenceComplete,      1, 0, SimSequenceComplete      },
+  { TPM_CC_EventSequenceComplete, 2, 0, SimEventSequenceComplete },
+};
+
+/**
+  Count a command and add its execution time to the simulated time.
+
+  @param[in] CommandCode  Command code.
+**/
+STATIC
+VOID
+SimAccountCommand (
+  IN TPM_CC  CommandCode
+  )
+{
+  UINTN   Index;
+  UINT32  Latency;
+
+  mTotalCommandCount++;
+  for (Index = 0; Index < mCommandCodeCount; Index++) {
+    if (mCommandCounts[Index].CommandCode == CommandCode) {
+      break;
+    }
+  }
+
+  if (Index < mCommandCodeCount) {
+    mCommandCounts[Index].Value++;
+  } else if (mCommandCodeCount < TPM2_SIM_MAX_COMMAND_CODES) {
+    mCommandCounts[mCommandCodeCount].CommandCode = CommandCode;
+    mCommandCounts[mCommandCodeCount].Value       = 1;
+    mCommandCodeCount++;
+  }
+
+  Latency = mDefaultLatency;
+  for (Index = 0; Index < mLatencyCount; Index++) {
+    if (mLatencies[Index].CommandCode == CommandCode) {
+      Latency = mLatencies[Index].Value;
+      break;
+    }
+  }
+
+  mElapsedTime += Latency;
+}
+
+/**
+  Execute a command on the simulated TPM.
+
+  @param[in]      CommandSize   Size of the command.
+  @param[in]      Command       The command.
+  @param[in, out] ResponseSize  On input, size of the response buffer. On output, size of the response.
+  @param[out]     ResponseData  The response.
+
+  @retval EFI_SUCCESS           The command was executed, the response holds its response code.
+  @retval EFI_DEVICE_ERROR      The command is smaller than a command header.
+  @retval EFI_BUFFER_TOO_SMALL  The response buffer is too small.
+**/
+STATIC
+EFI_STATUS
+SimExecuteCommand (
+  IN     UINT32  CommandSize,
+  IN     UINT8   *Command,
+  IN OUT UINT32  *ResponseSize,
+  OUT    UINT8   *ResponseData
+  )
+{
+  TPM2_SIM_BUFFER         Parameters;
+  TPM2_SIM_BUFFER         Output;
+  TPM2_SIM_BUFFER         Response;
+  CONST TPM2_SIM_COMMAND  *Entry;
+  UINT32                  Handles[TPM2_SIM_MAX_HANDLES];
+  TPM_ST                  Tag;
+  TPM_CC                  CommandCode;
+  TPM_RC                  Rc;
+  UINT32                  SessionCount;
+  UINT32                  AuthSize;
+  UINT32                  AuthEnd;
+  UINT32                  HandleSize;
+  UINTN                   Index;
+
+  if (CommandSize < sizeof (TPM2_COMMAND_HEADER)) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  ZeroMem (&Parameters, sizeof (Parameters));
+  Parameters.Data = Command;
+  Parameters.Size = CommandSize;
+  Tag             = (TPM_ST)SimReadValue (&Parameters, sizeof (TPM_ST));
+  SimReadValue (&Parameters, sizeof (UINT32));
+  CommandCode = SimReadValue (&Parameters, sizeof (TPM_CC));
+  SimAccountCommand (CommandCode);
+
+  ZeroMem (&Output, sizeof (Output));
+  Output.Data  = mParameters;
+  Output.Size  = sizeof (mParameters);
+  SessionCount = 0;
+  Entry        = NULL;
+  for (Index = 0; Index < ARRAY_SIZE (mCommands); Index++) {
+    if (mCommands[Index].CommandCode == CommandCode) {
+      Entry = &mCommands[Index];
+      break;
+    }
+  }
+
+  if (SwapBytes32 (ReadUnaligned32 (&((TPM2_COMMAND_HEADER *)Command)->paramSize)) != CommandSize) {
+    Rc = TPM_RC_COMMAND_SIZE;
+  } else if (Entry == NULL) {
+    Rc = TPM_RC_COMMAND_CODE;
+  } else if (!mStarted && (CommandCode != TPM_CC_Startup)) {
+    Rc = TPM_RC_INITIALIZE;
+  } else if ((Tag != TPM_ST_NO_SESSIONS) && (Tag != TPM_ST_SESSIONS)) {
+    Rc = TPM_RC_BAD_TAG;
+  } else {
+    for (Index = 0; Index < Entry->HandleCount; Index++) {
+      Handles[Index] = SimReadValue (&Parameters, sizeof (UINT32));
+    }
+
+    Rc = TPM_RC_SUCCESS;
+    if (Tag == TPM_ST_SESSIONS) {
+      //
+      // Skip the sessions, counting them to return one empty session response each.
+      //
+      AuthSize = SimReadValue (&Parameters, sizeof (UINT32));
+      AuthEnd  = Parameters.Offset + AuthSize;
+      while (!Parameters.Overflow && (Parameters.Offset < AuthEnd)) {
+        SimReadValue (&Parameters, sizeof (TPMI_SH_AUTH_SESSION));
+        SimReadBytes (&Parameters, SimReadValue (&Parameters, sizeof (UINT16)));
+        SimReadValue (&Parameters, sizeof (TPMA_SESSION));
+        SimReadBytes (&Parameters, SimReadValue (&Parameters, sizeof (UINT16)));
+        SessionCount++;
+      }
+
+      if (Parameters.Offset != AuthEnd) {
+        Rc = TPM_RC_AUTHSIZE;
+      }
+    }
+
+    if (Rc == TPM_RC_SUCCESS) {
+      Rc = Entry->Handler (Handles, &Parameters, &Output);
+      if ((Rc == TPM_RC_SUCCESS) && Output.Overflow) {
+        Rc = TPM_RC_FAILURE;
+      }
+    }
+  }
+
+  //
+  // Build the response: header, handles, parameterSize with sessions, parameters and sessions.
+  //
+  if (Rc != TPM_RC_SUCCESS) {
+    Tag           = TPM_ST_NO_SESSIONS;
+    Output.Offset = 0;
+  }
+
+  ZeroMem (&Response, sizeof (Response));
+  Response.Data = ResponseData;
+  Response.Size = *ResponseSize;
+  SimWriteValue (&Response, sizeof (TPM_ST), Tag);
+  SimWriteValue (&Response, sizeof (UINT32), 0);
+  SimWriteValue (&Response, sizeof (TPM_RC), Rc);
+  HandleSize = (Rc == TPM_RC_SUCCESS) ? Entry->ResponseHandleCount * sizeof (UINT32) : 0;
+  SimWriteData (&Response, mParameters, HandleSize);
+  if (Tag == TPM_ST_SESSIONS) {
+    SimWriteValue (&Response, sizeof (UINT32), Output.Offset - HandleSize);
+  }
+
+  SimWriteData (&Response, mParameters + HandleSize, Output.Offset - HandleSize);
+  if (Tag == TPM_ST_SESSIONS) {
+    SimWriteData (&Response, NULL, SessionCount * TPM2_SIM_AUTH_RESPONSE_SIZE);
+  }
+
+  if (Response.Overflow) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  WriteUnaligned32 (&((TPM2_RESPONSE_HEADER *)ResponseData)->paramSize, SwapBytes32 (Response.Offset));
+  *ResponseSize = Response.Offset;
+  return EFI_SUCCESS;
+}
+
+/**
+  Power cycle the simulated TPM.
+
+  PCR values, hash sequences, command counts, latencies and the simulated time
+  are cleared, and the TPM expects TPM2_Startup again.
+
+  @param[in] ActivePcrBanks  Bitmap of the EFI_TCG2_BOOT_HASH_ALG_* PCR banks to activate.
+                             SHA1, SHA256, SHA384 and SHA512 are simulated.
+**/
+VOID
+EFIAPI
+Tpm2SimulatorReset (
+  IN UINT32  ActivePcrBanks
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TPM2_SIM_MAX_SEQUENCES; Index++) {
+    SimFreeSequence (&mSequences[Index]);
+  }
+
+  mStarted           = FALSE;
+  mActivePcrBanks    = ActivePcrBanks;
+  mPcrUpdateCounter  = 0;
+  mDefaultLatency    = 0;
+  mLatencyCount      = 0;
+  mCommandCodeCount  = 0;
+  mTotalCommandCount = 0;
+  mElapsedTime       = 0;
+  ZeroMem (mPcrs, sizeof (mPcrs));
+}
+
+/**
+  Set the simulated execution time of a command.
+
+  The time of each command received is added to the simulated time returned by
+  Tpm2SimulatorGetElapsedTime (), so tests can measure the TPM cost of a flow
+  without depending on the speed of the host.
+
+  @param[in] CommandCode  Command code, or 0 to set the time of every command
+                          that has no time of its own.
+  @param[in] Latency      Execution time in microseconds.
+
+  @retval EFI_SUCCESS           The execution time is set.
+  @retval EFI_OUT_OF_RESOURCES  Too many command codes have their own execution time.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2SimulatorSetLatency (
+  IN TPM_CC  CommandCode,
+  IN UINT32  Latency
+  )
+{
+  UINTN  Index;
+
+  if (CommandCode == 0) {
+    mDefaultLatency = Latency;
+    return EFI_SUCCESS;
+  }
+
+  for (Index = 0; Index < mLatencyCount; Index++) {
+    if (mLatencies[Index].CommandCode == CommandCode) {
+      break;
+    }
+  }
+
+  if (Index == TPM2_SIM_MAX_LATENCIES) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Index == mLatencyCount) {
+    mLatencyCount++;
+  }
+
+  mLatencies[Index].CommandCode = CommandCode;
+  mLatencies[Index].Value       = Latency;
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the number of commands received since the last Tpm2SimulatorReset ().
+
+  @param[in] CommandCode  Command code, or 0 to count every command.
+
+  @return The number of commands received.
+**/
+UINT32
+EFIAPI
+Tpm2SimulatorGetCommandCount (
+  IN TPM_CC  CommandCode
+  )
+{
+  UINTN  Index;
+
+  if (CommandCode == 0) {
+    return mTotalCommandCount;
+  }
+
+  for (Index = 0; Index < mCommandCodeCount; Index++) {
+    if (mCommandCounts[Index].CommandCode == CommandCode) {
+      return mCommandCounts[Index].Value;
+    }
+  }
+
+  return 0;
+}
+
+/**
+  Return the simulated execution time of the commands received since the last
+  Tpm2SimulatorReset ().
+
+  @return The simulated time in microseconds.
+**/
+UINT64
+EFIAPI
+Tpm2SimulatorGetElapsedTime (
+  VOID
+  )
+{
+  return mElapsedTime;
+}
+
+/**
+  Read a PCR of the simulated TPM.
+
+  @param[in]  HashAlg   Hash algorithm of the PCR bank.
+  @param[in]  PcrIndex  Index of the PCR.
+  @param[out] Digest    Value of the PCR.
+
+  @retval EFI_SUCCESS            The PCR value is returned.
+  @retval EFI_INVALID_PARAMETER  Digest is NULL or PcrIndex is not a PCR.
+  @retval EFI_NOT_FOUND          The PCR bank is not active.
+  @retval EFI_NOT_READY          The TPM has not received TPM2_Startup.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2SimulatorGetPcr (
+  IN  TPMI_ALG_HASH  HashAlg,
+  IN  UINT32         PcrIndex,
+  OUT TPMU_HA        *Digest
+  )
+{
+  UINTN  HashIndex;
+
+  if ((Digest == NULL) || (PcrIndex >= IMPLEMENTATION_PCR)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  HashIndex = SimGetHashIndex (HashAlg);
+  if ((HashIndex == TPM2_SIM_HASH_COUNT) || !SimIsBankActive (HashIndex)) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (!mStarted) {
+    return EFI_NOT_READY;
+  }
+
+  CopyMem (Digest, &mPcrs[HashIndex][PcrIndex], mHashAlgorithms[HashIndex].DigestSize);
+  return EFI_SUCCESS;
+}
+
+/**
+  This service enables the sending of commands to the TPM2.
+
+  @param[in]      InputParameterBlockSize  Size of the TPM2 input parameter block.
+  @param[in]      InputParameterBlock      Pointer to the TPM2 input parameter block.
+  @param[in,out]  OutputParameterBlockSize Size of the TPM2 output parameter block.
+  @param[in]      OutputParameterBlock     Pointer to the TPM2 output parameter block.
+
+  @retval EFI_SUCCESS            The command byte stream was successfully sent to the device and a response was successfully received.
+  @retval EFI_DEVICE_ERROR       The command was not successfully sent to the device or a response was not successfully received from the device.
+  @retval EFI_BUFFER_TOO_SMALL   The output parameter block is too small.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2SubmitCommand (
+  IN UINT32      InputParameterBlockSize,
+  IN UINT8       *InputParameterBlock,
+  IN OUT UINT32  *OutputParameterBlockSize,
+  IN UINT8       *OutputParameterBlock
+  )
+{
+  return SimExecuteCommand (
+           InputParameterBlockSize,
+           InputParameterBlock,
+           OutputParameterBlockSize,
+           OutputParameterBlock
+           );
+}
+
+/**
+  This service requests use TPM2.
+
+  @retval EFI_SUCCESS      Get the control of TPM2 chip.
+  @retval EFI_NOT_FOUND    TPM2 not found.
+  @retval EFI_DEVICE_ERROR Unexpected device behavior.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2RequestUseTpm (
+  VOID
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  This service register TPM2 device.
+
+  @param Tpm2Device  TPM2 device
+
+  @retval EFI_UNSUPPORTED      This function is not supported.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2RegisterTpm2DeviceLib (
+  IN TPM2_DEVICE_INTERFACE  *Tpm2Device
+  )
+{
+  return EFI_UNSUPPORTED;
+}